@@ -0,0 +1,18 @@
+/* contrib/pg_buffercache/pg_buffercache--1.5--1.6.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_buffercache UPDATE TO '1.6'" to load this file. \quit
+
+CREATE FUNCTION pg_buffercache_replacement_stats(
+    OUT policy text,
+    OUT probation_buffers int4,
+    OUT protected_buffers int4,
+    OUT probation_admissions int8,
+    OUT ghost_admissions int8,
+    OUT ghosts_remembered int8)
+AS 'MODULE_PATHNAME', 'pg_buffercache_replacement_stats'
+LANGUAGE C PARALLEL SAFE;
+
+-- Don't want this to be available to public.
+REVOKE ALL ON FUNCTION pg_buffercache_replacement_stats() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_buffercache_replacement_stats() TO pg_monitor;
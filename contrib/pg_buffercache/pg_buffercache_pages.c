@@ -13,12 +13,15 @@
 #include "funcapi.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
 
 
 #define NUM_BUFFERCACHE_PAGES_MIN_ELEM	8
 #define NUM_BUFFERCACHE_PAGES_ELEM	9
 #define NUM_BUFFERCACHE_SUMMARY_ELEM 5
 #define NUM_BUFFERCACHE_USAGE_COUNTS_ELEM 4
+#define NUM_BUFFERCACHE_REPLACEMENT_STATS_ELEM 6
 
 PG_MODULE_MAGIC;
 
@@ -64,6 +67,7 @@ PG_FUNCTION_INFO_V1(pg_buffercache_pages);
 PG_FUNCTION_INFO_V1(pg_buffercache_summary);
 PG_FUNCTION_INFO_V1(pg_buffercache_usage_counts);
 PG_FUNCTION_INFO_V1(pg_buffercache_evict);
+PG_FUNCTION_INFO_V1(pg_buffercache_replacement_stats);
 
 Datum
 pg_buffercache_pages(PG_FUNCTION_ARGS)
@@ -367,3 +371,59 @@ pg_buffercache_evict(PG_FUNCTION_ARGS)
 
 	PG_RETURN_BOOL(EvictUnpinnedBuffer(buf));
 }
+
+/*
+ * Report on the buffer replacement policy.  Buffers are counted as being on
+ * probation or protected by the usage count of the pages they hold, which is
+ * how the 2Q policy tells the two queues apart; see StrategyAdmitUsageCount().
+ */
+Datum
+pg_buffercache_replacement_stats(PG_FUNCTION_ARGS)
+{
+	Datum		result;
+	TupleDesc	tupledesc;
+	HeapTuple	tuple;
+	Datum		values[NUM_BUFFERCACHE_REPLACEMENT_STATS_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_REPLACEMENT_STATS_ELEM] = {0};
+
+	int32		probation_buffers = 0;
+	int32		protected_buffers = 0;
+	uint64		probation_admits;
+	uint64		ghost_admits;
+	uint64		ghosts_remembered;
+
+	if (get_call_result_type(fcinfo, NULL, &tupledesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	for (int i = 0; i < NBuffers; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		uint32		buf_state = pg_atomic_read_u32(&bufHdr->state);
+
+		/* No locking, see pg_buffercache_summary() */
+		if (!(buf_state & BM_VALID))
+			continue;
+
+		if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
+			probation_buffers++;
+		else
+			protected_buffers++;
+	}
+
+	StrategyGetReplacementStats(&probation_admits, &ghost_admits,
+								&ghosts_remembered);
+
+	values[0] = CStringGetTextDatum(GetConfigOption("buffer_replacement_policy",
+													false, false));
+	values[1] = Int32GetDatum(probation_buffers);
+	values[2] = Int32GetDatum(protected_buffers);
+	values[3] = Int64GetDatum((int64) probation_admits);
+	values[4] = Int64GetDatum((int64) ghost_admits);
+	values[5] = Int64GetDatum((int64) ghosts_remembered);
+
+	/* Build and return the tuple. */
+	tuple = heap_form_tuple(tupledesc, values, nulls);
+	result = HeapTupleGetDatum(tuple);
+
+	PG_RETURN_DATUM(result);
+}
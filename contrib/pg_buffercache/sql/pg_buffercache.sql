@@ -12,6 +12,13 @@ from pg_buffercache_summary();
 
 SELECT count(*) > 0 FROM pg_buffercache_usage_counts() WHERE buffers >= 0;
 
+SELECT policy IN ('clock', '2q'),
+       probation_buffers >= 0,
+       protected_buffers >= 0,
+       probation_admissions >= 0 AND ghost_admissions >= 0 AND
+       ghosts_remembered >= 0
+FROM pg_buffercache_replacement_stats();
+
 -- Check that the functions / views can't be accessed by default. To avoid
 -- having to create a dedicated user, use the pg_database_owner pseudo-role.
 SET ROLE pg_database_owner;
@@ -19,6 +26,7 @@ SELECT * FROM pg_buffercache;
 SELECT * FROM pg_buffercache_pages() AS p (wrong int);
 SELECT * FROM pg_buffercache_summary();
 SELECT * FROM pg_buffercache_usage_counts();
+SELECT * FROM pg_buffercache_replacement_stats();
 RESET role;
 
 -- Check that pg_monitor is allowed to query view / function
@@ -26,3 +34,4 @@ SET ROLE pg_monitor;
 SELECT count(*) > 0 FROM pg_buffercache;
 SELECT buffers_used + buffers_unused > 0 FROM pg_buffercache_summary();
 SELECT count(*) > 0 FROM pg_buffercache_usage_counts();
+SELECT policy IS NOT NULL FROM pg_buffercache_replacement_stats();
@@ -0,0 +1,100 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test changing shared_buffers_limit while the server is running.
+
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+use Time::HiRes qw(usleep);
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = 2048
+bgwriter_delay = 10ms
+autovacuum = off
+max_parallel_workers_per_gather = 0
+});
+$node->start;
+
+# Number of buffers beyond the given limit that hold a page
+sub buffers_beyond
+{
+	my ($limit) = @_;
+
+	return $node->safe_psql('postgres',
+		"SELECT count(*) FROM pg_buffercache WHERE bufferid > $limit AND relfilenode IS NOT NULL"
+	);
+}
+
+$node->safe_psql(
+	'postgres', q{
+CREATE EXTENSION pg_buffercache;
+CREATE TABLE small (a int, b text);
+INSERT INTO small SELECT g, repeat('x', 1000) FROM generate_series(1, 2000) g;
+CREATE TABLE big (a int, b text);
+INSERT INTO big SELECT g, repeat('x', 1000) FROM generate_series(1, 5000) g;
+VACUUM (FREEZE) small, big;
+CHECKPOINT;
+});
+
+# small is too small to be read through a ring, so its pages spread beyond
+# the first 128 buffers
+$node->safe_psql('postgres', 'SELECT count(*) FROM small');
+cmp_ok(buffers_beyond(128), '>', 0, 'pages are held beyond 128 buffers');
+
+# Lower the limit; the background writer evicts the pages beyond it
+$node->safe_psql(
+	'postgres', q{
+ALTER SYSTEM SET shared_buffers_limit = 128;
+SELECT pg_reload_conf();
+});
+$node->poll_query_until('postgres',
+	"SELECT count(*) = 0 FROM pg_buffercache WHERE bufferid > 128 AND relfilenode IS NOT NULL"
+) or die "timed out waiting for buffers beyond the limit to be evicted";
+pass('pages beyond the lowered limit are evicted');
+
+# Reading doesn't put pages beyond the limit anymore
+$node->safe_psql('postgres', 'SELECT count(*) FROM small');
+is(buffers_beyond(128), '0', 'no pages are read beyond the limit');
+
+# The ring of a large sequential scan is capped at 1/8th of the limit
+$node->safe_psql(
+	'postgres', q{
+SELECT count(pg_buffercache_evict(bufferid)) FROM pg_buffercache
+  WHERE relfilenode = pg_relation_filenode('big');
+SELECT count(*) FROM big;
+});
+my $ring = $node->safe_psql('postgres',
+	"SELECT count(*) FROM pg_buffercache WHERE relfilenode = pg_relation_filenode('big')"
+);
+cmp_ok($ring, '>', 0, 'large sequential scan used buffers');
+cmp_ok($ring, '<=', 16, 'ring of large sequential scan follows the limit');
+
+# Raise the limit again; the whole pool is used again eventually
+$node->safe_psql(
+	'postgres', q{
+ALTER SYSTEM RESET shared_buffers_limit;
+SELECT pg_reload_conf();
+});
+my $tail_used = 0;
+foreach my $i (0 .. 10 * $PostgreSQL::Test::Utils::timeout_default)
+{
+	$node->safe_psql('postgres', 'SELECT count(*) FROM small');
+	if (buffers_beyond(128) > 0)
+	{
+		$tail_used = 1;
+		last;
+	}
+	usleep(100_000);
+}
+ok($tail_used, 'pages are held beyond 128 buffers after raising the limit');
+
+$node->stop;
+
+done_testing();
@@ -10,11 +10,15 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		leader worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, autoprewarm uses a leader worker that reads and
+ *		sorts the list of blocks to be prewarmed and then launches
+ *		per-database workers to load them.  Each dumped block carries the
+ *		usage count its buffer had at dump time, and blocks are reloaded
+ *		one usage count tier at a time, hottest first, so that the pages
+ *		that matter most are resident as early as possible.  Within a tier,
+ *		up to pg_prewarm.autoprewarm_workers databases are loaded
+ *		concurrently.  The leader keeps running after the initial prewarm
+ *		is complete to update the dump file periodically.
  *
  *	Copyright (c) 2016-2024, PostgreSQL Global Development Group
  *
@@ -57,6 +61,9 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Maximum number of concurrently running per-database workers. */
+#define APW_MAX_DATABASE_WORKERS	16
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -65,8 +72,18 @@ typedef struct BlockInfoRecord
 	RelFileNumber filenumber;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usagecount;		/* buffer usage count at dump time */
 } BlockInfoRecord;
 
+/* Work assignment for one per-database worker. */
+typedef struct AutoPrewarmWorkerSlot
+{
+	Oid			database;
+	int			prewarm_start_idx;
+	int			prewarm_stop_idx;
+	int			prewarmed_blocks;
+} AutoPrewarmWorkerSlot;
+
 /* Shared state information for autoprewarm bgworker. */
 typedef struct AutoPrewarmSharedState
 {
@@ -74,12 +91,9 @@ typedef struct AutoPrewarmSharedState
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
-	Oid			database;
-	int			prewarm_start_idx;
-	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	AutoPrewarmWorkerSlot workers[APW_MAX_DATABASE_WORKERS];
 } AutoPrewarmSharedState;
 
 PGDLLEXPORT void autoprewarm_main(Datum main_arg);
@@ -91,7 +105,11 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_leader_worker(void);
-static void apw_start_database_worker(void);
+static BackgroundWorkerHandle *apw_start_database_worker(int slot,
+														  bool missing_ok);
+static int	apw_database_segment_end(BlockInfoRecord *blkinfo,
+									 int num_elements, int start,
+									 Oid *database);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -102,6 +120,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval = 300; /* dump interval */
+static int	autoprewarm_workers = 4;	/* concurrent per-database workers */
 
 /*
  * Module load callback.
@@ -121,6 +140,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the maximum number of databases prewarmed concurrently.",
+							NULL,
+							&autoprewarm_workers,
+							4,
+							1, APW_MAX_DATABASE_WORKERS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -269,8 +300,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers to prewarm the buffers
+ * found there, hottest usage count tier first.
  */
 static void
 apw_load_buffers(void)
@@ -278,8 +309,11 @@ apw_load_buffers(void)
 	FILE	   *file = NULL;
 	int			num_elements,
 				i;
+	int			start;
+	int			prewarmed_blocks = 0;
 	BlockInfoRecord *blkinfo;
 	dsm_segment *seg;
+	char		line[128];
 
 	/*
 	 * Skip the prewarm if the dump file is in use; otherwise, prevent any
@@ -329,14 +363,24 @@ apw_load_buffers(void)
 	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
 	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
-	/* Read records, one per line. */
+	/*
+	 * Read records, one per line.  Files written before usage counts were
+	 * recorded have only five fields; treat their blocks as coldest.
+	 */
 	for (i = 0; i < num_elements; i++)
 	{
 		unsigned	forknum;
+		int			nfields;
 
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
-				   &blkinfo[i].tablespace, &blkinfo[i].filenumber,
-				   &forknum, &blkinfo[i].blocknum) != 5)
+		blkinfo[i].usagecount = 0;
+		if (fgets(line, sizeof(line), file) == NULL)
+			nfields = 0;
+		else
+			nfields = sscanf(line, "%u,%u,%u,%u,%u,%u", &blkinfo[i].database,
+							 &blkinfo[i].tablespace, &blkinfo[i].filenumber,
+							 &forknum, &blkinfo[i].blocknum,
+							 &blkinfo[i].usagecount);
+		if (nfields != 5 && nfields != 6)
 			ereport(ERROR,
 					(errmsg("autoprewarm block dump file is corrupted at line %d",
 							i + 1)));
@@ -351,50 +395,20 @@ apw_load_buffers(void)
 
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
-	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
 
-	/* Get the info position of the first block of the next database. */
-	while (apw_state->prewarm_start_idx < num_elements)
+	/*
+	 * Each round launches workers for consecutive databases within a single
+	 * usage count tier, and waits for all of them before moving on, so that
+	 * no cooler block is loaded while a hotter one is still pending.
+	 */
+	start = 0;
+	while (start < num_elements)
 	{
-		int			j = apw_state->prewarm_start_idx;
-		Oid			current_db = blkinfo[j].database;
-
-		/*
-		 * Advance the prewarm_stop_idx to the first BlockInfoRecord that does
-		 * not belong to this database.
-		 */
-		j++;
-		while (j < num_elements)
-		{
-			if (current_db != blkinfo[j].database)
-			{
-				/*
-				 * Combine BlockInfoRecords for global objects with those of
-				 * the database.
-				 */
-				if (current_db != InvalidOid)
-					break;
-				current_db = blkinfo[j].database;
-			}
-
-			j++;
-		}
-
-		/*
-		 * If we reach this point with current_db == InvalidOid, then only
-		 * BlockInfoRecords belonging to global objects exist.  We can't
-		 * prewarm without a database connection, so just bail out.
-		 */
-		if (current_db == InvalidOid)
-			break;
-
-		/* Configure stop point and database for next per-database worker. */
-		apw_state->prewarm_stop_idx = j;
-		apw_state->database = current_db;
-		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
+		BackgroundWorkerHandle *handles[APW_MAX_DATABASE_WORKERS];
+		uint32		tier = blkinfo[start].usagecount;
+		int			nworkers = 0;
 
-		/* If we've run out of free buffers, don't launch another worker. */
+		/* If we've run out of free buffers, don't launch more workers. */
 		if (!have_free_buffer())
 			break;
 
@@ -405,14 +419,57 @@ apw_load_buffers(void)
 		if (ShutdownRequestPending)
 			break;
 
+		while (start < num_elements && nworkers < autoprewarm_workers &&
+			   blkinfo[start].usagecount == tier)
+		{
+			AutoPrewarmWorkerSlot *slot = &apw_state->workers[nworkers];
+			Oid			database;
+			int			stop;
+
+			stop = apw_database_segment_end(blkinfo, num_elements, start,
+											&database);
+
+			/*
+			 * If only BlockInfoRecords belonging to global objects exist in
+			 * this tier, we can't prewarm them without a database connection,
+			 * so just skip them.
+			 */
+			if (!OidIsValid(database))
+			{
+				start = stop;
+				continue;
+			}
+
+			/* Configure the next per-database worker. */
+			slot->database = database;
+			slot->prewarm_start_idx = start;
+			slot->prewarm_stop_idx = stop;
+			slot->prewarmed_blocks = 0;
+
+			/*
+			 * If we can't get another worker while some are already running,
+			 * leave this database for the next round.
+			 */
+			handles[nworkers] = apw_start_database_worker(nworkers,
+														  nworkers > 0);
+			if (handles[nworkers] == NULL)
+				break;
+
+			nworkers++;
+			start = stop;
+		}
+
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Wait for this round's workers to exit.  Ignore the return value; if
+		 * it fails, postmaster has died, but we have checks for that
+		 * elsewhere.
 		 */
-		apw_start_database_worker();
-
-		/* Prepare for next database. */
-		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
+		for (i = 0; i < nworkers; i++)
+		{
+			WaitForBackgroundWorkerShutdown(handles[i]);
+			prewarmed_blocks += apw_state->workers[i].prewarmed_blocks;
+			pfree(handles[i]);
+		}
 	}
 
 	/* Clean up. */
@@ -426,7 +483,7 @@ apw_load_buffers(void)
 	if (!ShutdownRequestPending)
 		ereport(LOG,
 				(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-						apw_state->prewarmed_blocks, num_elements)));
+						prewarmed_blocks, num_elements)));
 }
 
 /*
@@ -441,6 +498,7 @@ autoprewarm_database_main(Datum main_arg)
 	Relation	rel = NULL;
 	BlockNumber nblocks = 0;
 	BlockInfoRecord *old_blk = NULL;
+	AutoPrewarmWorkerSlot *slot;
 	dsm_segment *seg;
 
 	/* Establish signal handlers; once that's done, unblock signals. */
@@ -454,15 +512,16 @@ autoprewarm_database_main(Datum main_arg)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("could not map dynamic shared memory segment")));
-	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
+	slot = &apw_state->workers[DatumGetInt32(main_arg)];
+	BackgroundWorkerInitializeConnectionByOid(slot->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
+	pos = slot->prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (pos < slot->prewarm_stop_idx && have_free_buffer())
 	{
 		BlockInfoRecord *blk = &block_info[pos++];
 		Buffer		buf;
@@ -543,7 +602,7 @@ autoprewarm_database_main(Datum main_arg)
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			slot->prewarmed_blocks++;
 			ReleaseBuffer(buf);
 		}
 
@@ -626,6 +685,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].forknum =
 				BufTagGetForkNum(&bufHdr->tag);
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usagecount =
+				BUF_STATE_GET_USAGECOUNT(buf_state);
 			++num_blocks;
 		}
 
@@ -658,12 +719,13 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	{
 		CHECK_FOR_INTERRUPTS();
 
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
+		ret = fprintf(file, "%u,%u,%u,%u,%u,%u\n",
 					  block_info_array[i].database,
 					  block_info_array[i].tablespace,
 					  block_info_array[i].filenumber,
 					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
+					  block_info_array[i].blocknum,
+					  block_info_array[i].usagecount);
 		if (ret < 0)
 		{
 			int			save_errno = errno;
@@ -842,10 +904,12 @@ apw_start_leader_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start autoprewarm per-database worker process for the given slot, and
+ * return its handle.  If the worker can't be registered, return NULL when
+ * missing_ok is true, else throw an error.
  */
-static void
-apw_start_database_worker(void)
+static BackgroundWorkerHandle *
+apw_start_database_worker(int slot, bool missing_ok)
 {
 	BackgroundWorker worker;
 	BackgroundWorkerHandle *handle;
@@ -859,21 +923,52 @@ apw_start_database_worker(void)
 	strcpy(worker.bgw_function_name, "autoprewarm_database_main");
 	strcpy(worker.bgw_name, "autoprewarm worker");
 	strcpy(worker.bgw_type, "autoprewarm worker");
+	worker.bgw_main_arg = Int32GetDatum(slot);
 
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
 	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	{
+		if (missing_ok)
+			return NULL;
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing the configuration parameter \"%s\".", "max_worker_processes")));
+	}
 
-	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
-	 * checks for that elsewhere.
-	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	return handle;
+}
+
+/*
+ * Return the index of the first BlockInfoRecord after "start" that belongs
+ * to neither the same usage count tier nor the same database, and set
+ * *database to the database those records belong to.  Records for global
+ * objects are combined with those of the following database in the tier; if
+ * there is none, *database is set to InvalidOid.
+ */
+static int
+apw_database_segment_end(BlockInfoRecord *blkinfo, int num_elements,
+						 int start, Oid *database)
+{
+	Oid			current_db = blkinfo[start].database;
+	uint32		tier = blkinfo[start].usagecount;
+	int			j = start + 1;
+
+	while (j < num_elements && blkinfo[j].usagecount == tier)
+	{
+		if (current_db != blkinfo[j].database)
+		{
+			if (current_db != InvalidOid)
+				break;
+			current_db = blkinfo[j].database;
+		}
+		j++;
+	}
+
+	*database = current_db;
+	return j;
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -888,11 +983,12 @@ do { \
 /*
  * apw_compare_blockinfo
  *
- * We depend on all records for a particular database being consecutive
- * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenumber, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * Blocks are ordered by descending usage count first, so that the hottest
+ * blocks are loaded before cooler ones.  Within a usage count tier, we
+ * depend on all records for a particular database being consecutive; each
+ * per-database worker will preload blocks until it sees a block for some
+ * other database.  Sorting by tablespace, filenumber, forknum, and blocknum
+ * isn't critical for correctness, but helps us get a sequential I/O pattern.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
@@ -900,6 +996,8 @@ apw_compare_blockinfo(const void *p, const void *q)
 	const BlockInfoRecord *a = (const BlockInfoRecord *) p;
 	const BlockInfoRecord *b = (const BlockInfoRecord *) q;
 
+	if (a->usagecount != b->usagecount)
+		return (a->usagecount > b->usagecount) ? -1 : 1;
 	cmp_member_elem(database);
 	cmp_member_elem(tablespace);
 	cmp_member_elem(filenumber);
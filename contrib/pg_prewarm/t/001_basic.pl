@@ -46,6 +46,11 @@ ok( (        $stdout =~ qr/^[1-9][0-9]*$/
 $result = $node->safe_psql("postgres", "SELECT autoprewarm_dump_now();");
 like($result, qr/^[1-9][0-9]*$/, 'autoprewarm_dump_now succeeded');
 
+# each dumped block should record its buffer usage count
+my $blocks = slurp_file($node->data_dir . '/autoprewarm.blocks');
+like($blocks, qr/^<<[1-9][0-9]*>>\n(?:\d+,\d+,\d+,\d+,\d+,\d+\n)+$/,
+	'autoprewarm.blocks records usage counts');
+
 # restart, to verify that auto prewarm actually works
 $node->restart;
 
@@ -164,6 +164,23 @@ commit;
 select * from pg_visibility_map('copyfreeze');
 select * from pg_check_frozen('copyfreeze');
 
+-- With vacuum_freeze_stable_cycles, a regular VACUUM reads some of the
+-- all-visible pages it used to skip, and freezes those that were left alone
+-- since the previous VACUUM.
+create table stable_pages (a int) with (autovacuum_enabled = false);
+insert into stable_pages select generate_series(1, 20000);
+select count(*) from stable_pages;
+set vacuum_freeze_stable_cycles = 1;
+vacuum stable_pages;
+select bool_and(all_visible) as all_visible, bool_or(all_frozen) as any_frozen
+  from pg_visibility_map('stable_pages');
+vacuum stable_pages;
+select bool_and(all_visible) as all_visible, bool_or(all_frozen) as any_frozen,
+  bool_and(all_frozen) as all_frozen
+  from pg_visibility_map('stable_pages');
+select * from pg_check_frozen('stable_pages');
+reset vacuum_freeze_stable_cycles;
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -174,3 +191,4 @@ drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
 drop table copyfreeze;
+drop table stable_pages;
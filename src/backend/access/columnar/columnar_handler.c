@@ -0,0 +1,1142 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_handler.c
+ *	  columnar table access method code
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_handler.c
+ *
+ * NOTES
+ *	  The columnar table AM is append-only: rows can be inserted and read,
+ *	  but not updated, deleted or locked, and the table can't be indexed.
+ *	  Sequential scans read only the columns the plan needs, and skip row
+ *	  groups whose min/max values rule out the scan quals; the executor
+ *	  tells us about both through the scan_set_projection callback.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar_internal.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/relscan.h"
+#include "access/sysattr.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "commands/vacuum.h"
+#include "nodes/execnodes.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "storage/read_stream.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+static const TableAmRoutine columnar_methods;
+
+typedef struct ColumnarScanDescData
+{
+	TableScanDescData rs_base;	/* AM independent part of the descriptor */
+
+	MemoryContext scan_cxt;		/* for the projection and quals */
+	MemoryContext group_cxt;	/* for the current row group */
+	BufferAccessStrategy strategy;
+
+	ColumnarGroupRef *groups;	/* row groups to scan, in stream order */
+	int			ngroups;
+
+	bool	   *needed;			/* columns to read; NULL means all */
+	ColumnarScanQual *quals;	/* quals to check against min/max values */
+	int			nquals;
+
+	bool		inited;			/* false = scan not started yet */
+	int			cur_group;		/* index of the current row group */
+	bool		group_loaded;	/* is 'group' valid? */
+	ColumnarGroup group;		/* current row group */
+	int			cur_row;		/* index of the current row in 'group' */
+
+	/* ANALYZE state */
+	BlockNumber nblocks;
+	int			analyze_next;	/* next row group to sample */
+	int			analyze_end;	/* end of the row groups of this block */
+} ColumnarScanDescData;
+
+typedef struct ColumnarScanDescData *ColumnarScanDesc;
+
+/*
+ * Shared state for parallel scans.  Workers claim row groups one at a time.
+ */
+typedef struct ParallelColumnarScanDescData
+{
+	ParallelTableScanDescData base;
+
+	uint64		data_end;		/* end of the row groups to scan */
+	pg_atomic_uint64 next_group;	/* next row group to hand out */
+} ParallelColumnarScanDescData;
+
+typedef struct ParallelColumnarScanDescData *ParallelColumnarScanDesc;
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+columnar_slot_callbacks(Relation relation)
+{
+	return &TTSOpsVirtual;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static TableScanDesc
+columnar_beginscan(Relation relation, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	ColumnarScanDesc scan;
+	uint64		data_end;
+
+	RelationIncrementReferenceCount(relation);
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+
+	/* scan keys are only used by catalog scans, which never come here */
+	scan->rs_base.rs_rd = relation;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = 0;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+
+	scan->scan_cxt = CurrentMemoryContext;
+	scan->group_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											"columnar scan row group",
+											ALLOCSET_DEFAULT_SIZES);
+	if (flags & (SO_TYPE_SEQSCAN | SO_TYPE_ANALYZE))
+		scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	/* see heap_beginscan() */
+	if (flags & SO_TYPE_SEQSCAN)
+	{
+		Assert(snapshot);
+		PredicateLockRelation(relation, snapshot);
+		pgstat_count_heap_scan(relation);
+	}
+
+	if (parallel_scan != NULL)
+		data_end = ((ParallelColumnarScanDesc) parallel_scan)->data_end;
+	else
+	{
+		ColumnarMetaPageData meta;
+
+		/* rows this backend inserted must be visible to it */
+		columnar_flush_pending(relation);
+		columnar_read_meta(relation, &meta);
+		data_end = meta.data_end;
+	}
+	scan->groups = columnar_get_groups(relation, data_end, &scan->ngroups);
+
+	if (flags & SO_TYPE_ANALYZE)
+		scan->nblocks = RelationGetNumberOfBlocks(relation);
+
+	return (TableScanDesc) scan;
+}
+
+static void
+columnar_endscan(TableScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	RelationDecrementReferenceCount(scan->rs_base.rs_rd);
+
+	MemoryContextDelete(scan->group_cxt);
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+
+	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->rs_base.rs_snapshot);
+
+	pfree(scan->groups);
+	if (scan->needed)
+		pfree(scan->needed);
+	if (scan->quals)
+		pfree(scan->quals);
+	pfree(scan);
+}
+
+static void
+columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->rs_base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->rs_base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	scan->inited = false;
+	scan->group_loaded = false;
+	MemoryContextReset(scan->group_cxt);
+}
+
+/*
+ * Restrict the scan to the columns in 'attrs', and to row groups that may
+ * satisfy 'quals'.  'attrs' holds attribute numbers offset by
+ * FirstLowInvalidHeapAttributeNumber, as built by pull_varattnos().
+ */
+static void
+columnar_set_projection(TableScanDesc sscan, Bitmapset *attrs, List *quals)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+	int			natts = RelationGetDescr(rel)->natts;
+	MemoryContext oldcxt;
+	int			k = -1;
+
+	oldcxt = MemoryContextSwitchTo(scan->scan_cxt);
+
+	if (scan->needed)
+		pfree(scan->needed);
+	scan->needed = NULL;
+
+	/* a whole-row reference needs all columns */
+	if (!bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs))
+	{
+		scan->needed = palloc0(sizeof(bool) * Max(natts, 1));
+		while ((k = bms_next_member(attrs, k)) >= 0)
+		{
+			AttrNumber	attnum = k + FirstLowInvalidHeapAttributeNumber;
+
+			if (attnum > 0 && attnum <= natts)
+				scan->needed[attnum - 1] = true;
+		}
+	}
+
+	if (scan->quals)
+		pfree(scan->quals);
+	scan->quals = columnar_prepare_quals(rel, quals, &scan->nquals);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Move to the next row group in 'direction' that is visible to the scan's
+ * snapshot and may satisfy its quals, and load the needed columns of it.
+ * Returns false at the end of the scan.
+ */
+static bool
+columnar_next_group(ColumnarScanDesc scan, ScanDirection direction)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelColumnarScanDesc pscan =
+		(ParallelColumnarScanDesc) scan->rs_base.rs_parallel;
+	int			step = ScanDirectionIsBackward(direction) ? -1 : 1;
+	MemoryContext oldcxt;
+
+	scan->group_loaded = false;
+	MemoryContextReset(scan->group_cxt);
+
+	if (!scan->inited)
+	{
+		scan->cur_group = step > 0 ? -1 : scan->ngroups;
+		scan->inited = true;
+	}
+
+	oldcxt = MemoryContextSwitchTo(scan->group_cxt);
+
+	for (;;)
+	{
+		int			idx;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (pscan != NULL)
+		{
+			/* parallel scans only go forward */
+			Assert(step > 0);
+			idx = (int) pg_atomic_fetch_add_u64(&pscan->next_group, 1);
+			if (idx >= scan->ngroups)
+				break;
+		}
+		else
+		{
+			idx = scan->cur_group + step;
+			if (idx < 0 || idx >= scan->ngroups)
+			{
+				scan->cur_group = step > 0 ? scan->ngroups : -1;
+				break;
+			}
+		}
+		scan->cur_group = idx;
+
+		columnar_read_group(rel, scan->groups[idx].offset, &scan->group,
+							scan->strategy);
+		if (!columnar_group_visible(&scan->group.hdr,
+									scan->rs_base.rs_snapshot))
+			continue;
+		if (scan->nquals > 0 &&
+			!columnar_group_matches(&scan->group, scan->quals, scan->nquals))
+			continue;
+
+		columnar_load_columns(rel, &scan->group, RelationGetDescr(rel),
+							  scan->needed, scan->strategy);
+		scan->group_loaded = true;
+		scan->cur_row = step > 0 ? -1 : scan->group.hdr.nrows;
+		break;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return scan->group_loaded;
+}
+
+static bool
+columnar_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	int			step = ScanDirectionIsBackward(direction) ? -1 : 1;
+
+	for (;;)
+	{
+		if (!scan->group_loaded &&
+			!columnar_next_group(scan, direction))
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+
+		scan->cur_row += step;
+		if (scan->cur_row >= 0 && scan->cur_row < scan->group.hdr.nrows)
+			break;
+		scan->group_loaded = false;
+	}
+
+	columnar_store_row(&scan->group, scan->cur_row, slot);
+	slot->tts_tableOid = RelationGetRelid(scan->rs_base.rs_rd);
+	pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Parallel scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static Size
+columnar_parallelscan_estimate(Relation rel)
+{
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static Size
+columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+	ColumnarMetaPageData meta;
+
+	/* workers can't see the rows buffered in this backend */
+	columnar_flush_pending(rel);
+	columnar_read_meta(rel, &meta);
+
+	cpscan->base.phs_relid = RelationGetRelid(rel);
+	cpscan->base.phs_syncscan = false;
+	cpscan->data_end = meta.data_end;
+	pg_atomic_init_u64(&cpscan->next_group, 0);
+
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static void
+columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+
+	pg_atomic_write_u64(&cpscan->next_group, 0);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_no_indexes(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support indexes")));
+}
+
+static IndexFetchTableData *
+columnar_index_fetch_begin(Relation rel)
+{
+	columnar_no_indexes();
+	return NULL;				/* keep compiler quiet */
+}
+
+static void
+columnar_index_fetch_reset(IndexFetchTableData *scan)
+{
+	columnar_no_indexes();
+}
+
+static void
+columnar_index_fetch_end(IndexFetchTableData *scan)
+{
+	columnar_no_indexes();
+}
+
+static bool
+columnar_index_fetch_tuple(struct IndexFetchTableData *scan,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	columnar_no_indexes();
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples for columnar
+ * AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_fetch_row_version(Relation relation,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot)
+{
+	uint64		row = columnar_tid_to_row(tid);
+	ColumnarGroupRef ref;
+	ColumnarGroup group;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+	bool		found = false;
+
+	columnar_flush_pending(relation);
+	if (!columnar_find_row_group(relation, row, &ref))
+		return false;
+
+	tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "columnar fetch",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	columnar_read_group(relation, ref.offset, &group, NULL);
+	if (columnar_group_visible(&group.hdr, snapshot))
+	{
+		columnar_load_columns(relation, &group, RelationGetDescr(relation),
+							  NULL, NULL);
+		columnar_store_row(&group, row - group.hdr.first_row, slot);
+		slot->tts_tableOid = RelationGetRelid(relation);
+		ExecMaterializeSlot(slot);
+		found = true;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(tmpcxt);
+
+	return found;
+}
+
+static bool
+columnar_tuple_tid_valid(TableScanDesc scan, ItemPointer tid)
+{
+	OffsetNumber offnum = ItemPointerGetOffsetNumberNoCheck(tid);
+
+	return offnum >= FirstOffsetNumber &&
+		offnum <= COLUMNAR_ROWS_PER_BLOCK &&
+		columnar_tid_to_row(tid) >= COLUMNAR_FIRST_ROW;
+}
+
+static void
+columnar_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	/* rows are never updated, so the TID is always the latest */
+}
+
+static bool
+columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	uint64		row = columnar_tid_to_row(&slot->tts_tid);
+	ColumnarGroupRef ref;
+	ColumnarGroupHeader hdr;
+
+	columnar_flush_pending(rel);
+	if (!columnar_find_row_group(rel, row, &ref))
+		return false;
+
+	columnar_read_bytes(rel, ref.offset, (char *) &hdr,
+						sizeof(ColumnarGroupHeader), NULL);
+
+	return columnar_group_visible(&hdr, snapshot);
+}
+
+static TransactionId
+columnar_index_delete_tuples(Relation rel, TM_IndexDeleteOp *delstate)
+{
+	columnar_no_indexes();
+	return InvalidTransactionId;	/* keep compiler quiet */
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples for columnar AM.
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+columnar_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	columnar_insert(relation, &slot, 1, cid);
+}
+
+static void
+columnar_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	columnar_insert(relation, slots, ntuples, cid);
+}
+
+static void
+columnar_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support INSERT ... ON CONFLICT")));
+}
+
+static void
+columnar_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support INSERT ... ON CONFLICT")));
+}
+
+static TM_Result
+columnar_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support DELETE")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_update(Relation relation, ItemPointer otid,
+					  TupleTableSlot *slot, CommandId cid, Snapshot snapshot,
+					  Snapshot crosscheck, bool wait, TM_FailureData *tmfd,
+					  LockTupleMode *lockmode,
+					  TU_UpdateIndexes *update_indexes)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support UPDATE")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support row locking")));
+	return TM_Ok;				/* keep compiler quiet */
+}
+
+static void
+columnar_finish_bulk_insert(Relation relation, int options)
+{
+	columnar_flush_pending(relation);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks for columnar AM.
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_relation_set_new_filelocator(Relation rel,
+									  const RelFileLocator *newrlocator,
+									  char persistence,
+									  TransactionId *freezeXid,
+									  MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/* rows buffered for the old storage are gone with it */
+	columnar_discard_pending(rel);
+
+	/* see heapam_relation_set_new_filelocator() */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrlocator, persistence, true);
+
+	/*
+	 * An empty main fork is a valid empty columnar table, so the init fork
+	 * of an unlogged table needs no contents.
+	 */
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrlocator, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+columnar_relation_nontransactional_truncate(Relation rel)
+{
+	columnar_discard_pending(rel);
+	RelationTruncate(rel, 0);
+
+	if (rel->rd_amcache)
+	{
+		pfree(rel->rd_amcache);
+		rel->rd_amcache = NULL;
+	}
+}
+
+static void
+columnar_relation_copy_data(Relation rel, const RelFileLocator *newrlocator)
+{
+	SMgrRelation dstrel;
+
+	columnar_flush_pending(rel);
+
+	/* see heapam_relation_copy_data() */
+	FlushRelationBuffers(rel);
+
+	dstrel = RelationCreateStorage(*newrlocator, rel->rd_rel->relpersistence, true);
+
+	RelationCopyStorage(RelationGetSmgr(rel), dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+
+			if (RelationIsPermanent(rel) ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrlocator, forkNum);
+			RelationCopyStorage(RelationGetSmgr(rel), dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * Rows of the new relation that are batched up to be written as one row
+ * group by columnar_relation_copy_for_cluster().
+ */
+typedef struct ColumnarRewriteBatch
+{
+	MemoryContext context;		/* holds the source row groups */
+	TransactionId xmin;
+	CommandId	cmin;
+	int			nrows;
+	Datum	  **values;
+	bool	  **isnull;
+} ColumnarRewriteBatch;
+
+static void
+columnar_write_batch(Relation rel, ColumnarRewriteBatch *batch)
+{
+	uint64		first_row;
+
+	if (batch->nrows == 0)
+		return;
+
+	first_row = columnar_reserve_rows(rel, batch->nrows);
+	columnar_write_group(rel, RelationGetDescr(rel), batch->xmin, batch->cmin,
+						 first_row, first_row + batch->nrows, batch->nrows,
+						 batch->values, batch->isnull);
+
+	batch->nrows = 0;
+	MemoryContextReset(batch->context);
+}
+
+/*
+ * VACUUM FULL and CLUSTER.  Row groups of aborted transactions are left
+ * behind, and small row groups are merged into larger ones.
+ */
+static void
+columnar_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	TupleDesc	tupdesc = RelationGetDescr(OldTable);
+	int			natts = tupdesc->natts;
+	ColumnarMetaPageData meta;
+	ColumnarGroupRef *groups;
+	ColumnarRewriteBatch batch;
+	BufferAccessStrategy strategy;
+	int			ngroups;
+
+	Assert(OldIndex == NULL);
+
+	*num_tuples = 0;
+	*tups_vacuumed = 0;
+	*tups_recently_dead = 0;
+
+	columnar_flush_pending(OldTable);
+	columnar_read_meta(OldTable, &meta);
+	groups = columnar_get_groups(OldTable, meta.data_end, &ngroups);
+
+	strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	batch.context = AllocSetContextCreate(CurrentMemoryContext,
+										  "columnar rewrite",
+										  ALLOCSET_DEFAULT_SIZES);
+	batch.nrows = 0;
+	batch.values = palloc(sizeof(Datum *) * Max(natts, 1));
+	batch.isnull = palloc(sizeof(bool *) * Max(natts, 1));
+	for (int i = 0; i < natts; i++)
+	{
+		batch.values[i] = palloc(sizeof(Datum) * COLUMNAR_GROUP_ROWS);
+		batch.isnull[i] = palloc(sizeof(bool) * COLUMNAR_GROUP_ROWS);
+	}
+
+	for (int g = 0; g < ngroups; g++)
+	{
+		ColumnarGroup group;
+		TransactionId xmin;
+		CommandId	cmin;
+		MemoryContext oldcxt;
+		int			nrows = groups[g].nrows;
+
+		CHECK_FOR_INTERRUPTS();
+
+		columnar_read_bytes(OldTable, groups[g].offset, (char *) &group.hdr,
+							sizeof(ColumnarGroupHeader), strategy);
+		xmin = group.hdr.xmin;
+		cmin = group.hdr.cmin;
+
+		if ((group.hdr.flags & COLUMNAR_GROUP_DEAD) ||
+			(TransactionIdIsNormal(xmin) &&
+			 !TransactionIdIsCurrentTransactionId(xmin) &&
+			 !TransactionIdIsInProgress(xmin) &&
+			 !TransactionIdDidCommit(xmin)))
+		{
+			*tups_vacuumed += nrows;
+			continue;
+		}
+
+		if (TransactionIdIsNormal(xmin) &&
+			TransactionIdPrecedes(xmin, *xid_cutoff))
+			xmin = FrozenTransactionId;
+		if (!TransactionIdIsNormal(xmin))
+			cmin = FirstCommandId;
+
+		if (batch.nrows > 0 &&
+			(batch.xmin != xmin || batch.cmin != cmin ||
+			 batch.nrows + nrows > COLUMNAR_GROUP_ROWS))
+			columnar_write_batch(NewTable, &batch);
+
+		oldcxt = MemoryContextSwitchTo(batch.context);
+		columnar_read_group(OldTable, groups[g].offset, &group, strategy);
+		columnar_load_columns(OldTable, &group, tupdesc, NULL, strategy);
+		MemoryContextSwitchTo(oldcxt);
+
+		for (int i = 0; i < natts; i++)
+		{
+			memcpy(batch.values[i] + batch.nrows, group.values[i],
+				   sizeof(Datum) * nrows);
+			memcpy(batch.isnull[i] + batch.nrows, group.isnull[i],
+				   sizeof(bool) * nrows);
+		}
+		batch.xmin = xmin;
+		batch.cmin = cmin;
+		batch.nrows += nrows;
+		*num_tuples += nrows;
+	}
+
+	columnar_write_batch(NewTable, &batch);
+
+	MemoryContextDelete(batch.context);
+	FreeAccessStrategy(strategy);
+	pfree(groups);
+}
+
+/*
+ * Plain VACUUM.  Row groups of committed transactions that every snapshot
+ * sees are frozen, those of aborted transactions are marked dead so that
+ * nobody needs to check their inserter anymore.  The space of dead row
+ * groups is only given back by VACUUM FULL.
+ */
+static void
+columnar_vacuum_rel(Relation rel, VacuumParams *params,
+					BufferAccessStrategy bstrategy)
+{
+	struct VacuumCutoffs cutoffs;
+	ColumnarMetaPageData meta;
+	ColumnarGroupRef *groups;
+	TransactionId new_frozen_xid;
+	double		live_rows = 0;
+	double		dead_rows = 0;
+	int			ngroups;
+
+	vacuum_get_cutoffs(rel, params, &cutoffs);
+	new_frozen_xid = cutoffs.OldestXmin;
+
+	columnar_read_meta(rel, &meta);
+	groups = columnar_get_groups(rel, meta.data_end, &ngroups);
+
+	for (int g = 0; g < ngroups; g++)
+	{
+		ColumnarGroupHeader hdr;
+		TransactionId xmin;
+
+		vacuum_delay_point();
+
+		columnar_read_bytes(rel, groups[g].offset, (char *) &hdr,
+							sizeof(ColumnarGroupHeader), bstrategy);
+		xmin = hdr.xmin;
+
+		if (hdr.flags & COLUMNAR_GROUP_DEAD)
+		{
+			dead_rows += hdr.nrows;
+			continue;
+		}
+
+		if (TransactionIdIsNormal(xmin) &&
+			TransactionIdPrecedes(xmin, cutoffs.OldestXmin))
+		{
+			if (TransactionIdDidCommit(xmin))
+				columnar_update_group_header(rel, groups[g].offset,
+											 FrozenTransactionId, hdr.flags);
+			else if (!TransactionIdIsInProgress(xmin))
+			{
+				columnar_update_group_header(rel, groups[g].offset, xmin,
+											 hdr.flags | COLUMNAR_GROUP_DEAD);
+				dead_rows += hdr.nrows;
+				continue;
+			}
+			else if (TransactionIdPrecedes(xmin, new_frozen_xid))
+				new_frozen_xid = xmin;
+		}
+		else if (TransactionIdIsNormal(xmin) &&
+				 TransactionIdPrecedes(xmin, new_frozen_xid))
+			new_frozen_xid = xmin;
+
+		live_rows += hdr.nrows;
+	}
+
+	pfree(groups);
+
+	vac_update_relstats(rel, RelationGetNumberOfBlocks(rel), live_rows,
+						0, false, new_frozen_xid, cutoffs.OldestMxact,
+						NULL, NULL, false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel), rel->rd_rel->relisshared,
+						 live_rows, dead_rows, 0, 0, InvalidXLogRecPtr);
+}
+
+/*
+ * ANALYZE samples blocks of the relation.  Block 'b' of 'nblocks' stands
+ * for the row groups whose index falls in the b'th share of all of them.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, ReadStream *stream)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Buffer		buf;
+	BlockNumber blkno;
+	uint64		nblocks = Max(scan->nblocks, 1);
+
+	buf = read_stream_next_buffer(stream, NULL);
+	if (!BufferIsValid(buf))
+		return false;
+	blkno = Min(BufferGetBlockNumber(buf), nblocks);
+	ReleaseBuffer(buf);
+
+	scan->analyze_next = ((uint64) blkno * scan->ngroups + nblocks - 1) / nblocks;
+	scan->analyze_end = ((uint64) (blkno + 1) * scan->ngroups + nblocks - 1) / nblocks;
+	scan->analyze_end = Min(scan->analyze_end, scan->ngroups);
+	scan->group_loaded = false;
+
+	return true;
+}
+
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+
+	for (;;)
+	{
+		ColumnarGroupHeader *hdr = &scan->group.hdr;
+		MemoryContext oldcxt;
+
+		if (scan->group_loaded && ++scan->cur_row < hdr->nrows)
+		{
+			columnar_store_row(&scan->group, scan->cur_row, slot);
+			slot->tts_tableOid = RelationGetRelid(rel);
+			*liverows += 1;
+			return true;
+		}
+		scan->group_loaded = false;
+
+		if (scan->analyze_next >= scan->analyze_end)
+			break;
+
+		MemoryContextReset(scan->group_cxt);
+		oldcxt = MemoryContextSwitchTo(scan->group_cxt);
+		columnar_read_group(rel, scan->groups[scan->analyze_next++].offset,
+							&scan->group, scan->strategy);
+		MemoryContextSwitchTo(oldcxt);
+
+		/* see heapam_scan_analyze_next_tuple() for how rows are counted */
+		if (hdr->flags & COLUMNAR_GROUP_DEAD)
+		{
+			*deadrows += hdr->nrows;
+			continue;
+		}
+		if (TransactionIdIsNormal(hdr->xmin) &&
+			!TransactionIdIsCurrentTransactionId(hdr->xmin))
+		{
+			if (TransactionIdIsInProgress(hdr->xmin))
+				continue;
+			if (!TransactionIdDidCommit(hdr->xmin))
+			{
+				*deadrows += hdr->nrows;
+				continue;
+			}
+		}
+
+		oldcxt = MemoryContextSwitchTo(scan->group_cxt);
+		columnar_load_columns(rel, &scan->group, RelationGetDescr(rel), NULL,
+							  scan->strategy);
+		MemoryContextSwitchTo(oldcxt);
+		scan->group_loaded = true;
+		scan->cur_row = -1;
+	}
+
+	ExecClearTuple(slot);
+	return false;
+}
+
+static double
+columnar_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	columnar_no_indexes();
+	return 0;					/* keep compiler quiet */
+}
+
+static void
+columnar_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	columnar_no_indexes();
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Values are stored inline in the column chunks, detoasted, so there's no
+ * use for a TOAST table.
+ */
+static bool
+columnar_relation_needs_toast_table(Relation rel)
+{
+	return false;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	ColumnarMetaPageData meta;
+
+	*pages = RelationGetNumberOfBlocks(rel);
+	if (*pages == 0)
+	{
+		*tuples = 0;
+		*allvisfrac = 0;
+		return;
+	}
+
+	columnar_read_meta(rel, &meta);
+	*tuples = (double) meta.nrows;
+	*allvisfrac = 0;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_scan_sample_next_block(TableScanDesc scan,
+								SampleScanState *scanstate)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support TABLESAMPLE")));
+	return false;				/* keep compiler quiet */
+}
+
+static bool
+columnar_scan_sample_next_tuple(TableScanDesc scan,
+								SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("columnar tables do not support TABLESAMPLE")));
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the columnar table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine columnar_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = columnar_slot_callbacks,
+
+	.scan_begin = columnar_beginscan,
+	.scan_end = columnar_endscan,
+	.scan_rescan = columnar_rescan,
+	.scan_getnextslot = columnar_getnextslot,
+	.scan_set_projection = columnar_set_projection,
+
+	.parallelscan_estimate = columnar_parallelscan_estimate,
+	.parallelscan_initialize = columnar_parallelscan_initialize,
+	.parallelscan_reinitialize = columnar_parallelscan_reinitialize,
+
+	.index_fetch_begin = columnar_index_fetch_begin,
+	.index_fetch_reset = columnar_index_fetch_reset,
+	.index_fetch_end = columnar_index_fetch_end,
+	.index_fetch_tuple = columnar_index_fetch_tuple,
+
+	.tuple_insert = columnar_tuple_insert,
+	.tuple_insert_speculative = columnar_tuple_insert_speculative,
+	.tuple_complete_speculative = columnar_tuple_complete_speculative,
+	.multi_insert = columnar_multi_insert,
+	.tuple_delete = columnar_tuple_delete,
+	.tuple_update = columnar_tuple_update,
+	.tuple_lock = columnar_tuple_lock,
+	.finish_bulk_insert = columnar_finish_bulk_insert,
+
+	.tuple_fetch_row_version = columnar_fetch_row_version,
+	.tuple_get_latest_tid = columnar_get_latest_tid,
+	.tuple_tid_valid = columnar_tuple_tid_valid,
+	.tuple_satisfies_snapshot = columnar_tuple_satisfies_snapshot,
+	.index_delete_tuples = columnar_index_delete_tuples,
+
+	.relation_set_new_filelocator = columnar_relation_set_new_filelocator,
+	.relation_nontransactional_truncate = columnar_relation_nontransactional_truncate,
+	.relation_copy_data = columnar_relation_copy_data,
+	.relation_copy_for_cluster = columnar_relation_copy_for_cluster,
+	.relation_vacuum = columnar_vacuum_rel,
+	.scan_analyze_next_block = columnar_scan_analyze_next_block,
+	.scan_analyze_next_tuple = columnar_scan_analyze_next_tuple,
+	.index_build_range_scan = columnar_index_build_range_scan,
+	.index_validate_scan = columnar_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = columnar_relation_needs_toast_table,
+
+	.relation_estimate_size = columnar_estimate_rel_size,
+
+	.scan_sample_next_block = columnar_scan_sample_next_block,
+	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
+};
+
+Datum
+columnar_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
@@ -0,0 +1,438 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_reader.c
+ *	  reading row groups of the columnar table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_reader.c
+ *
+ * NOTES
+ *	  Only the chunks of the columns a scan needs are read and decoded.
+ *	  Before that, the scan's quals are checked against the min/max values
+ *	  kept for each chunk, and row groups that can't contain a matching row
+ *	  are skipped altogether.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar_internal.h"
+#include "access/detoast.h"
+#include "access/stratnum.h"
+#include "access/tupmacs.h"
+#include "nodes/primnodes.h"
+#include "utils/datum.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+static void columnar_decode_chunk(Relation rel, ColumnarGroup *group,
+								  Form_pg_attribute att, Datum *values,
+								  bool *isnull,
+								  BufferAccessStrategy strategy);
+
+
+/*
+ * Read the header, chunk infos and min/max values of the row group starting
+ * at 'offset'.
+ */
+void
+columnar_read_group(Relation rel, uint64 offset, ColumnarGroup *group,
+					BufferAccessStrategy strategy)
+{
+	ColumnarGroupHeader *hdr = &group->hdr;
+
+	group->offset = offset;
+	columnar_read_bytes(rel, offset, (char *) hdr,
+						sizeof(ColumnarGroupHeader), strategy);
+
+	if (hdr->meta_len < sizeof(ColumnarChunkInfo) * hdr->natts ||
+		hdr->total_len < sizeof(ColumnarGroupHeader) + hdr->meta_len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid row group at offset %llu of columnar table \"%s\"",
+						(unsigned long long) offset,
+						RelationGetRelationName(rel))));
+
+	group->meta = palloc(Max(hdr->meta_len, 1));
+	columnar_read_bytes(rel, offset + sizeof(ColumnarGroupHeader),
+						group->meta, hdr->meta_len, strategy);
+	group->chunks = (ColumnarChunkInfo *) group->meta;
+
+	group->natts = 0;
+	group->values = NULL;
+	group->isnull = NULL;
+}
+
+/*
+ * Decode the columns of 'group' for which needed[] is true (all of them if
+ * needed is NULL).  'tupdesc' describes the rows as the caller wants them;
+ * columns added after the row group was written get their missing value.
+ */
+void
+columnar_load_columns(Relation rel, ColumnarGroup *group, TupleDesc tupdesc,
+					  const bool *needed, BufferAccessStrategy strategy)
+{
+	int			nrows = group->hdr.nrows;
+
+	group->natts = tupdesc->natts;
+	group->values = palloc0(sizeof(Datum *) * tupdesc->natts);
+	group->isnull = palloc0(sizeof(bool *) * tupdesc->natts);
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		Datum	   *values;
+		bool	   *isnull;
+
+		if (needed != NULL && !needed[i])
+			continue;
+
+		values = palloc(sizeof(Datum) * Max(nrows, 1));
+		isnull = palloc(sizeof(bool) * Max(nrows, 1));
+
+		if (att->attisdropped)
+		{
+			memset(values, 0, sizeof(Datum) * nrows);
+			memset(isnull, true, sizeof(bool) * nrows);
+		}
+		else if (i >= group->hdr.natts)
+		{
+			bool		missingnull;
+			Datum		missing = getmissingattr(tupdesc, i + 1, &missingnull);
+
+			for (int row = 0; row < nrows; row++)
+			{
+				values[row] = missing;
+				isnull[row] = missingnull;
+			}
+		}
+		else
+			columnar_decode_chunk(rel, group, att, values, isnull, strategy);
+
+		group->values[i] = values;
+		group->isnull[i] = isnull;
+	}
+}
+
+/*
+ * Read and decode the chunk of 'att' into values[] and isnull[].
+ */
+static void
+columnar_decode_chunk(Relation rel, ColumnarGroup *group,
+					  Form_pg_attribute att, Datum *values, bool *isnull,
+					  BufferAccessStrategy strategy)
+{
+	ColumnarChunkInfo *chunk = &group->chunks[att->attnum - 1];
+	int			nrows = group->hdr.nrows;
+	char	   *buf;
+	char	   *data;
+	bits8	   *bits = NULL;
+	Size		datalen;
+	Size		off = 0;
+
+	if (chunk->flags & COLUMNAR_CHUNK_ALL_NULL)
+	{
+		memset(values, 0, sizeof(Datum) * nrows);
+		memset(isnull, true, sizeof(bool) * nrows);
+		return;
+	}
+
+	buf = palloc(chunk->length);
+	columnar_read_bytes(rel, group->offset + chunk->offset, buf,
+						chunk->length, strategy);
+	if (chunk->flags & COLUMNAR_CHUNK_COMPRESSED)
+	{
+		struct varlena *raw = detoast_attr((struct varlena *) buf);
+
+		pfree(buf);
+		buf = (char *) raw;
+	}
+
+	data = buf + COLUMNAR_CHUNK_PAYLOAD_OFFSET;
+	datalen = VARSIZE(buf) - COLUMNAR_CHUNK_PAYLOAD_OFFSET;
+	if (chunk->flags & COLUMNAR_CHUNK_HAS_NULLS)
+	{
+		Size		bitmaplen = MAXALIGN(BITMAPLEN(nrows));
+
+		bits = (bits8 *) data;
+		data += bitmaplen;
+		datalen -= bitmaplen;
+	}
+
+	for (int row = 0; row < nrows; row++)
+	{
+		if (bits != NULL && att_isnull(row, bits))
+		{
+			values[row] = (Datum) 0;
+			isnull[row] = true;
+			continue;
+		}
+
+		off = att_align_pointer(off, att->attalign, att->attlen, data + off);
+		if (off >= datalen)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid chunk for column \"%s\" in row group at offset %llu of columnar table \"%s\"",
+							NameStr(att->attname),
+							(unsigned long long) group->offset,
+							RelationGetRelationName(rel))));
+
+		values[row] = fetchatt(att, data + off);
+		isnull[row] = false;
+		off = att_addlength_pointer(off, att->attlen, data + off);
+	}
+}
+
+/*
+ * Store row 'rowidx' of 'group' in 'slot'.  Columns that were not loaded
+ * are returned as NULLs.
+ */
+void
+columnar_store_row(ColumnarGroup *group, int rowidx, TupleTableSlot *slot)
+{
+	int			natts = slot->tts_tupleDescriptor->natts;
+
+	ExecClearTuple(slot);
+
+	for (int i = 0; i < natts; i++)
+	{
+		if (i < group->natts && group->values[i] != NULL)
+		{
+			slot->tts_values[i] = group->values[i][rowidx];
+			slot->tts_isnull[i] = group->isnull[i][rowidx];
+		}
+		else
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+	}
+
+	ExecStoreVirtualTuple(slot);
+	columnar_row_to_tid(group->hdr.first_row + rowidx, &slot->tts_tid);
+}
+
+/*
+ * Try to turn "Var op Const" (or "Const op Var") into a ColumnarScanQual.
+ * That works for operators that belong to the default btree opfamily of the
+ * column's type, since the min/max values were computed with it.
+ */
+static bool
+columnar_prepare_opexpr(TupleDesc tupdesc, OpExpr *opexpr,
+						ColumnarScanQual *qual)
+{
+	Node	   *leftop;
+	Node	   *rightop;
+	Var		   *var;
+	Const	   *cnst;
+	Oid			opno = opexpr->opno;
+	Form_pg_attribute att;
+	TypeCacheEntry *typentry;
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (list_length(opexpr->args) != 2)
+		return false;
+	leftop = linitial(opexpr->args);
+	rightop = lsecond(opexpr->args);
+
+	if (IsA(leftop, Var) && IsA(rightop, Const))
+	{
+		var = (Var *) leftop;
+		cnst = (Const *) rightop;
+	}
+	else if (IsA(rightop, Var) && IsA(leftop, Const))
+	{
+		var = (Var *) rightop;
+		cnst = (Const *) leftop;
+		opno = get_commutator(opno);
+		if (!OidIsValid(opno))
+			return false;
+	}
+	else
+		return false;
+
+	if (var->varlevelsup != 0 || var->varattno <= 0 ||
+		var->varattno > tupdesc->natts || cnst->constisnull)
+		return false;
+
+	att = TupleDescAttr(tupdesc, var->varattno - 1);
+	if (att->attisdropped || var->vartype != att->atttypid)
+		return false;
+
+	/* min/max were computed with the column's collation */
+	if (OidIsValid(opexpr->inputcollid) &&
+		opexpr->inputcollid != att->attcollation)
+		return false;
+
+	typentry = lookup_type_cache(att->atttypid, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(typentry->btree_opf) ||
+		!op_in_opfamily(opno, typentry->btree_opf))
+		return false;
+	get_op_opfamily_properties(opno, typentry->btree_opf, false,
+							   &strategy, &lefttype, &righttype);
+
+	qual->attnum = var->varattno;
+	qual->value = cnst->constvalue;
+	qual->collation = opexpr->inputcollid;
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			qual->kind = COLUMNAR_QUAL_MIN;
+			fmgr_info(get_opcode(opno), &qual->proc);
+			break;
+		case BTGreaterStrategyNumber:
+		case BTGreaterEqualStrategyNumber:
+			qual->kind = COLUMNAR_QUAL_MAX;
+			fmgr_info(get_opcode(opno), &qual->proc);
+			break;
+		case BTEqualStrategyNumber:
+			{
+				Oid			leop;
+				Oid			geop;
+
+				leop = get_opfamily_member(typentry->btree_opf,
+										   lefttype, righttype,
+										   BTLessEqualStrategyNumber);
+				geop = get_opfamily_member(typentry->btree_opf,
+										   lefttype, righttype,
+										   BTGreaterEqualStrategyNumber);
+				if (!OidIsValid(leop) || !OidIsValid(geop))
+					return false;
+
+				qual->kind = COLUMNAR_QUAL_RANGE;
+				fmgr_info(get_opcode(leop), &qual->proc);
+				fmgr_info(get_opcode(geop), &qual->proc2);
+				break;
+			}
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Extract the quals that can be checked against chunk min/max values or
+ * null flags from 'quals', an implicitly-ANDed list of expressions on the
+ * relation.
+ */
+ColumnarScanQual *
+columnar_prepare_quals(Relation rel, List *quals, int *nquals)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	ColumnarScanQual *result;
+	ListCell   *lc;
+	int			n = 0;
+
+	result = palloc(sizeof(ColumnarScanQual) * Max(list_length(quals), 1));
+
+	foreach(lc, quals)
+	{
+		Node	   *clause = (Node *) lfirst(lc);
+
+		if (IsA(clause, OpExpr))
+		{
+			if (columnar_prepare_opexpr(tupdesc, (OpExpr *) clause,
+										&result[n]))
+				n++;
+		}
+		else if (IsA(clause, NullTest))
+		{
+			NullTest   *ntest = (NullTest *) clause;
+			Var		   *var = (Var *) ntest->arg;
+
+			if (ntest->argisrow || !IsA(var, Var) ||
+				var->varlevelsup != 0 || var->varattno <= 0 ||
+				var->varattno > tupdesc->natts)
+				continue;
+
+			result[n].kind = ntest->nulltesttype == IS_NULL ?
+				COLUMNAR_QUAL_IS_NULL : COLUMNAR_QUAL_IS_NOT_NULL;
+			result[n].attnum = var->varattno;
+			n++;
+		}
+	}
+
+	*nquals = n;
+	return result;
+}
+
+/*
+ * Can any row of 'group' satisfy all of 'quals'?
+ */
+bool
+columnar_group_matches(ColumnarGroup *group, ColumnarScanQual *quals,
+					   int nquals)
+{
+	for (int i = 0; i < nquals; i++)
+	{
+		ColumnarScanQual *qual = &quals[i];
+		ColumnarChunkInfo *chunk;
+		char	   *ptr;
+		bool		isnull;
+		Datum		min;
+		Datum		max;
+
+		/* columns added later have their missing value; don't bother */
+		if (qual->attnum > group->hdr.natts)
+			continue;
+		chunk = &group->chunks[qual->attnum - 1];
+
+		if (qual->kind == COLUMNAR_QUAL_IS_NULL)
+		{
+			if (!(chunk->flags & (COLUMNAR_CHUNK_HAS_NULLS |
+								  COLUMNAR_CHUNK_ALL_NULL)))
+				return false;
+			continue;
+		}
+
+		/* btree operators are strict, so they can't match nulls */
+		if (chunk->flags & COLUMNAR_CHUNK_ALL_NULL)
+			return false;
+		if (qual->kind == COLUMNAR_QUAL_IS_NOT_NULL ||
+			!(chunk->flags & COLUMNAR_CHUNK_HAS_MINMAX))
+			continue;
+
+		ptr = group->meta + chunk->minmax_off - sizeof(ColumnarGroupHeader);
+		min = datumRestore(&ptr, &isnull);
+		max = datumRestore(&ptr, &isnull);
+
+		switch (qual->kind)
+		{
+			case COLUMNAR_QUAL_MIN:
+				if (!DatumGetBool(FunctionCall2Coll(&qual->proc,
+													qual->collation,
+													min, qual->value)))
+					return false;
+				break;
+			case COLUMNAR_QUAL_MAX:
+				if (!DatumGetBool(FunctionCall2Coll(&qual->proc,
+													qual->collation,
+													max, qual->value)))
+					return false;
+				break;
+			case COLUMNAR_QUAL_RANGE:
+				if (!DatumGetBool(FunctionCall2Coll(&qual->proc,
+													qual->collation,
+													min, qual->value)) ||
+					!DatumGetBool(FunctionCall2Coll(&qual->proc2,
+													qual->collation,
+													max, qual->value)))
+					return false;
+				break;
+			default:
+				Assert(false);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,602 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *	  page-level storage for the columnar table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_storage.c
+ *
+ * NOTES
+ *	  See columnar_internal.h for the layout of a columnar relation.  All
+ *	  changes are WAL-logged using generic WAL records.
+ *
+ *	  Appending a row group happens in two steps: the row group is written
+ *	  past the current data_end, then data_end is advanced on the metapage.
+ *	  Appenders serialize on a heavyweight lock on the metapage, so that
+ *	  readers, which only need data_end, are not blocked while a large row
+ *	  group is being written.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar_internal.h"
+#include "access/generic_xlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "common/int.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+/*
+ * Directory of the row groups of a relation, cached in rd_amcache.  It
+ * covers the stream of the given relfilenumber up to data_end.  The groups
+ * are listed twice: in stream order, and sorted by first row number, so
+ * that the group holding a row can be found by binary search.  byrow points
+ * into the same allocation, after groups.
+ */
+typedef struct ColumnarDirectory
+{
+	RelFileNumber relnumber;
+	uint64		data_end;
+	int			ngroups;
+	ColumnarGroupRef *byrow;	/* ngroups entries, by first_row */
+	ColumnarGroupRef groups[FLEXIBLE_ARRAY_MEMBER]; /* in stream order */
+} ColumnarDirectory;
+
+static Buffer columnar_lock_meta(Relation rel);
+static void columnar_write_bytes(Relation rel, uint64 offset,
+								 const char *src, Size len);
+static ColumnarDirectory *columnar_get_directory(Relation rel);
+static ColumnarDirectory *columnar_extend_directory(Relation rel,
+													ColumnarDirectory *dir,
+													uint64 data_end);
+static bool columnar_search_directory(ColumnarDirectory *dir, uint64 row,
+									  ColumnarGroupRef *ref);
+static int	columnar_cmp_first_row(const void *a, const void *b);
+
+
+/*
+ * Initialize the contents of a metapage.
+ */
+static void
+columnar_init_metapage(Page page)
+{
+	ColumnarMetaPageData *meta;
+
+	PageInit(page, BLCKSZ, 0);
+
+	meta = ColumnarPageGetMeta(page);
+	memset(meta, 0, sizeof(ColumnarMetaPageData));
+	meta->magic = COLUMNAR_MAGIC;
+	meta->version = COLUMNAR_VERSION;
+	meta->data_end = 0;
+	meta->next_row = COLUMNAR_FIRST_ROW;
+	meta->nrows = 0;
+
+	((PageHeader) page)->pd_lower =
+		((char *) meta + sizeof(ColumnarMetaPageData)) - (char *) page;
+}
+
+static void
+columnar_check_metapage(Relation rel, ColumnarMetaPageData *meta)
+{
+	if (meta->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has an invalid metapage",
+						RelationGetRelationName(rel))));
+	if (meta->version != COLUMNAR_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has version %u, but only version %u is supported",
+						RelationGetRelationName(rel), meta->version,
+						COLUMNAR_VERSION)));
+}
+
+/*
+ * Read the metapage.  A relation that has never been written to has no
+ * metapage yet; it is reported as empty.
+ */
+void
+columnar_read_meta(Relation rel, ColumnarMetaPageData *meta)
+{
+	Buffer		buf;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) > COLUMNAR_METAPAGE_BLKNO)
+	{
+		buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+
+		if (!PageIsNew(page))
+		{
+			memcpy(meta, ColumnarPageGetMeta(page),
+				   sizeof(ColumnarMetaPageData));
+			UnlockReleaseBuffer(buf);
+			columnar_check_metapage(rel, meta);
+			return;
+		}
+		UnlockReleaseBuffer(buf);
+	}
+
+	memset(meta, 0, sizeof(ColumnarMetaPageData));
+	meta->magic = COLUMNAR_MAGIC;
+	meta->version = COLUMNAR_VERSION;
+	meta->next_row = COLUMNAR_FIRST_ROW;
+}
+
+/*
+ * Pin and exclusively lock the metapage, creating it if necessary.
+ */
+static Buffer
+columnar_lock_meta(Relation rel)
+{
+	Buffer		buf;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) > COLUMNAR_METAPAGE_BLKNO)
+		buf = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	else
+		buf = ExtendBufferedRelTo(BMR_REL(rel), MAIN_FORKNUM, NULL, 0,
+								  COLUMNAR_METAPAGE_BLKNO + 1, RBM_NORMAL);
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buf);
+
+	if (PageIsNew(page))
+	{
+		GenericXLogState *state;
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+		columnar_init_metapage(page);
+		GenericXLogFinish(state);
+	}
+	else
+		columnar_check_metapage(rel, ColumnarPageGetMeta(page));
+
+	return buf;
+}
+
+/*
+ * Reserve 'count' consecutive row numbers, returning the first one.
+ */
+uint64
+columnar_reserve_rows(Relation rel, uint32 count)
+{
+	Buffer		buf;
+	GenericXLogState *state;
+	ColumnarMetaPageData *meta;
+	uint64		first;
+
+	buf = columnar_lock_meta(rel);
+
+	first = ColumnarPageGetMeta(BufferGetPage(buf))->next_row;
+	if (first + count > COLUMNAR_MAX_ROW)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("columnar table \"%s\" has run out of row numbers",
+						RelationGetRelationName(rel)),
+				 errhint("Rewrite the table with VACUUM FULL.")));
+
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, buf, 0));
+	meta->next_row = first + count;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buf);
+
+	return first;
+}
+
+/*
+ * Where a row group following stream offset 'offset' starts: at 'offset'
+ * itself, unless the header would not fit in the rest of the page.
+ */
+uint64
+columnar_group_start(uint64 offset)
+{
+	uint64		pos = offset % COLUMNAR_PAGE_CAPACITY;
+
+	if (COLUMNAR_PAGE_CAPACITY - pos < sizeof(ColumnarGroupHeader))
+		offset += COLUMNAR_PAGE_CAPACITY - pos;
+
+	return offset;
+}
+
+/*
+ * Append a complete row group, 'len' bytes at 'data', to the stream, and
+ * return where it was put.
+ *
+ * The row group holds 'nrows' rows, numbered from a reservation that ended
+ * at 'reserved_end', of which the numbers up to 'used_end' were used.  If
+ * nobody has reserved row numbers since, the unused ones are handed back.
+ */
+uint64
+columnar_append_group(Relation rel, const char *data, Size len,
+					  uint32 nrows, uint64 reserved_end, uint64 used_end)
+{
+	ColumnarMetaPageData curmeta;
+	ColumnarMetaPageData *meta;
+	GenericXLogState *state;
+	Buffer		buf;
+	uint64		start;
+
+	LockPage(rel, COLUMNAR_METAPAGE_BLKNO, ExclusiveLock);
+
+	columnar_read_meta(rel, &curmeta);
+	start = columnar_group_start(curmeta.data_end);
+	columnar_write_bytes(rel, start, data, len);
+
+	buf = columnar_lock_meta(rel);
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, buf, 0));
+	Assert(meta->data_end == curmeta.data_end);
+	meta->data_end = start + len;
+	meta->nrows += nrows;
+	if (meta->next_row == reserved_end)
+		meta->next_row = used_end;
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(buf);
+
+	UnlockPage(rel, COLUMNAR_METAPAGE_BLKNO, ExclusiveLock);
+
+	return start;
+}
+
+/*
+ * Write 'len' bytes at stream offset 'offset', extending the relation as
+ * needed.  Everything from 'offset' to the end of its page is considered
+ * unused.
+ */
+static void
+columnar_write_bytes(Relation rel, uint64 offset, const char *src, Size len)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = COLUMNAR_FIRST_DATA_BLKNO +
+			offset / COLUMNAR_PAGE_CAPACITY;
+		uint32		pos = offset % COLUMNAR_PAGE_CAPACITY;
+		Size		n = Min(len, COLUMNAR_PAGE_CAPACITY - pos);
+		GenericXLogState *state;
+		Buffer		buf;
+		Page		page;
+
+		CHECK_FOR_INTERRUPTS();
+
+		state = GenericXLogStart(rel);
+		if (pos == 0)
+		{
+			/* start a fresh page, whatever is on it now */
+			buf = ExtendBufferedRelTo(BMR_REL(rel), MAIN_FORKNUM, NULL, 0,
+									  blkno + 1, RBM_ZERO_AND_LOCK);
+			page = GenericXLogRegisterBuffer(state, buf,
+											 GENERIC_XLOG_FULL_IMAGE);
+			PageInit(page, BLCKSZ, 0);
+		}
+		else
+		{
+			buf = ReadBuffer(rel, blkno);
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			page = GenericXLogRegisterBuffer(state, buf, 0);
+		}
+
+		memcpy(PageGetContents(page) + pos, src, n);
+		((PageHeader) page)->pd_lower = MAXALIGN(SizeOfPageHeaderData) + pos + n;
+
+		GenericXLogFinish(state);
+		UnlockReleaseBuffer(buf);
+
+		offset += n;
+		src += n;
+		len -= n;
+	}
+}
+
+/*
+ * Read 'len' bytes at stream offset 'offset' into 'dst'.
+ */
+void
+columnar_read_bytes(Relation rel, uint64 offset, char *dst, Size len,
+					BufferAccessStrategy strategy)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = COLUMNAR_FIRST_DATA_BLKNO +
+			offset / COLUMNAR_PAGE_CAPACITY;
+		uint32		pos = offset % COLUMNAR_PAGE_CAPACITY;
+		Size		n = Min(len, COLUMNAR_PAGE_CAPACITY - pos);
+		Buffer		buf;
+		Page		page;
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 strategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+
+		if (((PageHeader) page)->pd_lower <
+			MAXALIGN(SizeOfPageHeaderData) + pos + n)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("unexpected end of data in block %u of columnar table \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+
+		memcpy(dst, PageGetContents(page) + pos, n);
+		UnlockReleaseBuffer(buf);
+
+		offset += n;
+		dst += n;
+		len -= n;
+	}
+}
+
+/*
+ * Overwrite the xmin and flags of the row group starting at 'offset'.
+ */
+void
+columnar_update_group_header(Relation rel, uint64 offset,
+							 TransactionId xmin, uint16 flags)
+{
+	BlockNumber blkno = COLUMNAR_FIRST_DATA_BLKNO +
+		offset / COLUMNAR_PAGE_CAPACITY;
+	uint32		pos = offset % COLUMNAR_PAGE_CAPACITY;
+	GenericXLogState *state;
+	ColumnarGroupHeader hdr;
+	Buffer		buf;
+	Page		page;
+
+	Assert(pos + sizeof(ColumnarGroupHeader) <= COLUMNAR_PAGE_CAPACITY);
+
+	buf = ReadBuffer(rel, blkno);
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, 0);
+
+	/* the header need not be aligned */
+	memcpy(&hdr, PageGetContents(page) + pos, sizeof(ColumnarGroupHeader));
+	hdr.xmin = xmin;
+	hdr.flags = flags;
+	memcpy(PageGetContents(page) + pos, &hdr, sizeof(ColumnarGroupHeader));
+
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Return a palloc'd array of the row groups below 'data_end', in stream
+ * order, and their number in *ngroups.
+ *
+ * Finding the row groups means reading the header of each of them, so the
+ * result is cached in the relcache entry and extended as the relation
+ * grows.
+ */
+ColumnarGroupRef *
+columnar_get_groups(Relation rel, uint64 data_end, int *ngroups)
+{
+	ColumnarDirectory *dir = columnar_get_directory(rel);
+	ColumnarGroupRef *result;
+	int			n;
+
+	if (dir == NULL || dir->data_end < data_end)
+		dir = columnar_extend_directory(rel, dir, data_end);
+
+	for (n = 0; n < dir->ngroups; n++)
+	{
+		if (dir->groups[n].offset >= data_end)
+			break;
+	}
+
+	result = palloc(sizeof(ColumnarGroupRef) * Max(n, 1));
+	memcpy(result, dir->groups, sizeof(ColumnarGroupRef) * n);
+	*ngroups = n;
+
+	return result;
+}
+
+/*
+ * Find the row group holding row number 'row', and store its location in
+ * *ref.  Returns false if there's no such row group.
+ *
+ * Row groups never move within a relfilenumber, so a row that is covered by
+ * the cached directory is found without even reading the metapage.  Only for
+ * other rows do we have to read it, and extend the directory to the current
+ * end of the data.
+ */
+bool
+columnar_find_row_group(Relation rel, uint64 row, ColumnarGroupRef *ref)
+{
+	ColumnarDirectory *dir = columnar_get_directory(rel);
+	ColumnarMetaPageData meta;
+
+	if (dir != NULL && columnar_search_directory(dir, row, ref))
+		return true;
+
+	columnar_read_meta(rel, &meta);
+	if (dir != NULL && dir->data_end >= meta.data_end)
+		return false;
+
+	dir = columnar_extend_directory(rel, dir, meta.data_end);
+	return columnar_search_directory(dir, row, ref);
+}
+
+/*
+ * Return the cached directory of 'rel', or NULL if there's none.
+ */
+static ColumnarDirectory *
+columnar_get_directory(Relation rel)
+{
+	ColumnarDirectory *dir = (ColumnarDirectory *) rel->rd_amcache;
+
+	/* a new relfilenumber has nothing in common with the old one */
+	if (dir != NULL && dir->relnumber != rel->rd_locator.relNumber)
+	{
+		pfree(dir);
+		rel->rd_amcache = dir = NULL;
+	}
+
+	return dir;
+}
+
+/*
+ * Read the headers of the row groups between the end of 'dir' (NULL if
+ * there's no directory yet) and 'data_end', and install a new directory
+ * covering all of them in rd_amcache.
+ */
+static ColumnarDirectory *
+columnar_extend_directory(Relation rel, ColumnarDirectory *dir,
+						  uint64 data_end)
+{
+	ColumnarGroupRef *groups;
+	ColumnarDirectory *newdir;
+	int			ngroups = 0;
+	int			maxgroups;
+	uint64		offset;
+
+	maxgroups = 64 + (dir ? dir->ngroups : 0);
+	groups = palloc(sizeof(ColumnarGroupRef) * maxgroups);
+	if (dir)
+	{
+		memcpy(groups, dir->groups, sizeof(ColumnarGroupRef) * dir->ngroups);
+		ngroups = dir->ngroups;
+	}
+
+	offset = dir ? dir->data_end : 0;
+	while (offset < data_end)
+	{
+		ColumnarGroupHeader hdr;
+
+		offset = columnar_group_start(offset);
+		columnar_read_bytes(rel, offset, (char *) &hdr,
+							sizeof(ColumnarGroupHeader), NULL);
+
+		if (hdr.total_len < sizeof(ColumnarGroupHeader) ||
+			offset + hdr.total_len > data_end)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid row group at offset %llu of columnar table \"%s\"",
+							(unsigned long long) offset,
+							RelationGetRelationName(rel))));
+
+		if (ngroups >= maxgroups)
+		{
+			maxgroups *= 2;
+			groups = repalloc(groups, sizeof(ColumnarGroupRef) * maxgroups);
+		}
+		groups[ngroups].offset = offset;
+		groups[ngroups].first_row = hdr.first_row;
+		groups[ngroups].nrows = hdr.nrows;
+		ngroups++;
+
+		offset += hdr.total_len;
+	}
+
+	/* rd_amcache must be a single chunk in CacheMemoryContext */
+	newdir = MemoryContextAlloc(CacheMemoryContext,
+								offsetof(ColumnarDirectory, groups) +
+								sizeof(ColumnarGroupRef) * ngroups * 2);
+	newdir->relnumber = rel->rd_locator.relNumber;
+	newdir->data_end = data_end;
+	newdir->ngroups = ngroups;
+	newdir->byrow = newdir->groups + ngroups;
+	memcpy(newdir->groups, groups, sizeof(ColumnarGroupRef) * ngroups);
+	memcpy(newdir->byrow, groups, sizeof(ColumnarGroupRef) * ngroups);
+	qsort(newdir->byrow, ngroups, sizeof(ColumnarGroupRef),
+		  columnar_cmp_first_row);
+	pfree(groups);
+
+	if (rel->rd_amcache)
+		pfree(rel->rd_amcache);
+	rel->rd_amcache = newdir;
+
+	return newdir;
+}
+
+/*
+ * Binary search 'dir' for the row group holding row number 'row'.  The row
+ * number ranges of the groups don't overlap, so it's the group with the
+ * highest first row number not above 'row', if that reaches far enough.
+ */
+static bool
+columnar_search_directory(ColumnarDirectory *dir, uint64 row,
+						  ColumnarGroupRef *ref)
+{
+	int			lo = 0;
+	int			hi = dir->ngroups;
+
+	while (lo < hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (dir->byrow[mid].first_row <= row)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0 || row >= dir->byrow[lo - 1].first_row + dir->byrow[lo - 1].nrows)
+		return false;
+
+	*ref = dir->byrow[lo - 1];
+	return true;
+}
+
+/* qsort comparator for ColumnarGroupRefs, by first row number */
+static int
+columnar_cmp_first_row(const void *a, const void *b)
+{
+	return pg_cmp_u64(((const ColumnarGroupRef *) a)->first_row,
+					  ((const ColumnarGroupRef *) b)->first_row);
+}
+
+/*
+ * Is the row group described by 'hdr' visible to 'snapshot'?
+ *
+ * All rows of a row group were inserted by the same transaction and
+ * command, so this works like a heap tuple visibility check on xmin alone,
+ * as the rows can't be deleted.
+ */
+bool
+columnar_group_visible(const ColumnarGroupHeader *hdr, Snapshot snapshot)
+{
+	TransactionId xmin = hdr->xmin;
+
+	if (hdr->flags & COLUMNAR_GROUP_DEAD)
+		return false;
+
+	if (snapshot->snapshot_type == SNAPSHOT_ANY)
+		return true;
+
+	/* frozen */
+	if (!TransactionIdIsNormal(xmin))
+		return TransactionIdIsValid(xmin);
+
+	if (TransactionIdIsCurrentTransactionId(xmin))
+	{
+		if (snapshot->snapshot_type == SNAPSHOT_MVCC)
+			return hdr->cmin < snapshot->curcid;
+		return true;
+	}
+
+	if (snapshot->snapshot_type == SNAPSHOT_MVCC)
+	{
+		if (XidInMVCCSnapshot(xmin, snapshot))
+			return false;
+		return TransactionIdDidCommit(xmin);
+	}
+
+	/* any other kind of snapshot sees all committed rows */
+	if (TransactionIdIsInProgress(xmin))
+		return false;
+	return TransactionIdDidCommit(xmin);
+}
@@ -0,0 +1,713 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_writer.c
+ *	  writing row groups of the columnar table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_writer.c
+ *
+ * NOTES
+ *	  Inserted rows are collected in a per-relation write buffer in backend
+ *	  memory, and written out as a row group once the buffer is full, or
+ *	  when rows from a different transaction or command come along.  All
+ *	  rows of a row group therefore share the same xmin and cmin.  Before
+ *	  the relation is read in this backend, and at commit, the pending rows
+ *	  are written out too; on (sub)transaction abort they are thrown away.
+ *
+ *	  Row numbers, and hence TIDs, are handed out at insert time from a
+ *	  reservation made on the metapage.  Reservations start small and grow
+ *	  as long as they can be extended contiguously, so that a single-row
+ *	  INSERT doesn't waste row numbers while a bulk load still gets full row
+ *	  groups.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar_internal.h"
+#include "access/detoast.h"
+#include "access/relation.h"
+#include "access/toast_compression.h"
+#include "access/toast_internals.h"
+#include "access/tupmacs.h"
+#include "access/xact.h"
+#include "lib/stringinfo.h"
+#include "pgstat.h"
+#include "storage/predicate.h"
+#include "utils/attoptcache.h"
+#include "utils/datum.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+/* Size of the first row number reservation of a write buffer */
+#define COLUMNAR_INITIAL_RESERVATION	64
+
+/*
+ * Rows inserted into a relation that have not been written out yet.
+ */
+typedef struct ColumnarWriteBuffer
+{
+	Oid			relid;			/* hash key (must be first) */
+	SubTransactionId subid;		/* subtransaction that inserted the rows */
+	TransactionId xmin;			/* inserting transaction */
+	CommandId	cmin;			/* inserting command */
+	MemoryContext context;		/* holds everything below */
+	TupleDesc	tupdesc;		/* copy of the descriptor at insert time */
+	uint64		first_row;		/* start of our row number reservation */
+	uint64		reserved_end;	/* end of our row number reservation */
+	int			nrows;			/* rows buffered so far */
+	Size		nbytes;			/* space taken by by-reference values */
+	Datum	  **values;			/* per attribute, reserved rows each */
+	bool	  **isnull;
+} ColumnarWriteBuffer;
+
+/* write buffers, by relation OID; lives in TopTransactionContext */
+static HTAB *pending_writes = NULL;
+
+/* have we registered our transaction callbacks yet? */
+static bool xact_callbacks_registered = false;
+
+static void columnar_flush_buffer(Relation rel, ColumnarWriteBuffer *buf);
+static void columnar_xact_callback(XactEvent event, void *arg);
+static void columnar_subxact_callback(SubXactEvent event,
+									  SubTransactionId mySubid,
+									  SubTransactionId parentSubid,
+									  void *arg);
+
+
+/*
+ * Start a write buffer for 'rel', with row numbers reserved from 'first_row'
+ * to 'reserved_end'.
+ */
+static ColumnarWriteBuffer *
+columnar_new_buffer(Relation rel, uint64 first_row, uint64 reserved_end)
+{
+	ColumnarWriteBuffer *buf;
+	Oid			relid = RelationGetRelid(rel);
+	MemoryContext oldcxt;
+	int			nreserved = reserved_end - first_row;
+	int			natts;
+	bool		found;
+
+	if (pending_writes == NULL)
+	{
+		HASHCTL		ctl;
+
+		/* Arrange to write out or forget the buffers at end of transaction */
+		if (!xact_callbacks_registered)
+		{
+			RegisterXactCallback(columnar_xact_callback, NULL);
+			RegisterSubXactCallback(columnar_subxact_callback, NULL);
+			xact_callbacks_registered = true;
+		}
+
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(ColumnarWriteBuffer);
+		ctl.hcxt = TopTransactionContext;
+		pending_writes = hash_create("columnar write buffers", 16, &ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	buf = hash_search(pending_writes, &relid, HASH_ENTER, &found);
+	Assert(!found);
+
+	buf->subid = GetCurrentSubTransactionId();
+	buf->xmin = GetCurrentTransactionId();
+	buf->cmin = InvalidCommandId;
+	buf->context = AllocSetContextCreate(TopTransactionContext,
+										 "columnar write buffer",
+										 ALLOCSET_DEFAULT_SIZES);
+	buf->first_row = first_row;
+	buf->reserved_end = reserved_end;
+	buf->nrows = 0;
+	buf->nbytes = 0;
+
+	oldcxt = MemoryContextSwitchTo(buf->context);
+	buf->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	natts = buf->tupdesc->natts;
+	buf->values = palloc(sizeof(Datum *) * natts);
+	buf->isnull = palloc(sizeof(bool *) * natts);
+	for (int i = 0; i < natts; i++)
+	{
+		buf->values[i] = palloc(sizeof(Datum) * nreserved);
+		buf->isnull[i] = palloc(sizeof(bool) * nreserved);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	return buf;
+}
+
+/*
+ * Return a write buffer for 'rel' that can take one more row inserted by
+ * command 'cid' of the current (sub)transaction, writing out the rows
+ * buffered so far if necessary.
+ */
+static ColumnarWriteBuffer *
+columnar_get_buffer(Relation rel, CommandId cid)
+{
+	ColumnarWriteBuffer *buf = NULL;
+	Oid			relid = RelationGetRelid(rel);
+	uint32		nreserve = COLUMNAR_INITIAL_RESERVATION;
+	uint64		first;
+
+	if (pending_writes != NULL)
+		buf = hash_search(pending_writes, &relid, HASH_FIND, NULL);
+
+	if (buf != NULL)
+	{
+		if (buf->xmin != GetCurrentTransactionId() ||
+			(buf->nrows > 0 && buf->cmin != cid) ||
+			buf->tupdesc->natts != RelationGetDescr(rel)->natts ||
+			buf->nbytes >= COLUMNAR_GROUP_MAX_BYTES)
+		{
+			columnar_flush_buffer(rel, buf);
+			buf = NULL;
+		}
+		else if (buf->first_row + buf->nrows == buf->reserved_end)
+		{
+			int			nreserved = buf->reserved_end - buf->first_row;
+
+			if (nreserved >= COLUMNAR_GROUP_ROWS)
+			{
+				/* the next row group is likely to fill up as well */
+				columnar_flush_buffer(rel, buf);
+				buf = NULL;
+				nreserve = COLUMNAR_GROUP_ROWS;
+			}
+			else
+			{
+				/* try to extend the reservation */
+				nreserve = Min(nreserved, COLUMNAR_GROUP_ROWS - nreserved);
+				first = columnar_reserve_rows(rel, nreserve);
+				if (first == buf->reserved_end)
+				{
+					MemoryContext oldcxt;
+
+					oldcxt = MemoryContextSwitchTo(buf->context);
+					for (int i = 0; i < buf->tupdesc->natts; i++)
+					{
+						buf->values[i] = repalloc(buf->values[i],
+												  sizeof(Datum) * (nreserved + nreserve));
+						buf->isnull[i] = repalloc(buf->isnull[i],
+												  sizeof(bool) * (nreserved + nreserve));
+					}
+					MemoryContextSwitchTo(oldcxt);
+					buf->reserved_end += nreserve;
+				}
+				else
+				{
+					/* somebody else got in between; start a new row group */
+					columnar_flush_buffer(rel, buf);
+					buf = columnar_new_buffer(rel, first, first + nreserve);
+				}
+			}
+		}
+	}
+
+	if (buf == NULL)
+	{
+		first = columnar_reserve_rows(rel, nreserve);
+		buf = columnar_new_buffer(rel, first, first + nreserve);
+	}
+
+	buf->cmin = cid;
+
+	return buf;
+}
+
+/*
+ * Buffer the rows in 'slots', inserted by command 'cid', and set their TIDs.
+ */
+void
+columnar_insert(Relation rel, TupleTableSlot **slots, int nslots,
+				CommandId cid)
+{
+	/* there are no row locks; check for conflicts on the whole relation */
+	CheckForSerializableConflictIn(rel, NULL, InvalidBlockNumber);
+
+	for (int n = 0; n < nslots; n++)
+	{
+		TupleTableSlot *slot = slots[n];
+		ColumnarWriteBuffer *buf = columnar_get_buffer(rel, cid);
+		int			row = buf->nrows;
+		MemoryContext oldcxt;
+
+		slot_getallattrs(slot);
+
+		oldcxt = MemoryContextSwitchTo(buf->context);
+		for (int i = 0; i < buf->tupdesc->natts; i++)
+		{
+			Form_pg_attribute att = TupleDescAttr(buf->tupdesc, i);
+			Datum		value = slot->tts_values[i];
+
+			if (slot->tts_isnull[i] || att->attisdropped)
+			{
+				buf->values[i][row] = (Datum) 0;
+				buf->isnull[i][row] = true;
+				continue;
+			}
+
+			if (!att->attbyval)
+			{
+				/* values are stored inline, so flatten anything toasted */
+				if (att->attlen == -1 &&
+					VARATT_IS_EXTENDED(DatumGetPointer(value)))
+					value = PointerGetDatum(detoast_attr((struct varlena *) DatumGetPointer(value)));
+				else
+					value = datumCopy(value, false, att->attlen);
+				buf->nbytes += datumGetSize(value, false, att->attlen);
+			}
+
+			buf->values[i][row] = value;
+			buf->isnull[i][row] = false;
+		}
+		MemoryContextSwitchTo(oldcxt);
+
+		buf->nrows++;
+
+		slot->tts_tableOid = RelationGetRelid(rel);
+		columnar_row_to_tid(buf->first_row + row, &slot->tts_tid);
+	}
+
+	pgstat_count_heap_insert(rel, nslots);
+}
+
+/*
+ * Write out the buffered rows of 'buf' and get rid of it.
+ */
+static void
+columnar_flush_buffer(Relation rel, ColumnarWriteBuffer *buf)
+{
+	Oid			relid = buf->relid;
+
+	if (buf->nrows > 0)
+		columnar_write_group(rel, buf->tupdesc, buf->xmin, buf->cmin,
+							 buf->first_row, buf->reserved_end, buf->nrows,
+							 buf->values, buf->isnull);
+
+	MemoryContextDelete(buf->context);
+	hash_search(pending_writes, &relid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Write out the rows buffered for 'rel', if any.  Must be done before the
+ * relation is read in this backend.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	ColumnarWriteBuffer *buf;
+	Oid			relid = RelationGetRelid(rel);
+
+	if (pending_writes == NULL)
+		return;
+
+	buf = hash_search(pending_writes, &relid, HASH_FIND, NULL);
+	if (buf != NULL)
+		columnar_flush_buffer(rel, buf);
+}
+
+/*
+ * Throw away the rows buffered for 'rel', if any, as when it's truncated.
+ */
+void
+columnar_discard_pending(Relation rel)
+{
+	ColumnarWriteBuffer *buf;
+	Oid			relid = RelationGetRelid(rel);
+
+	if (pending_writes == NULL)
+		return;
+
+	buf = hash_search(pending_writes, &relid, HASH_FIND, NULL);
+	if (buf != NULL)
+	{
+		MemoryContextDelete(buf->context);
+		hash_search(pending_writes, &relid, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Append 'value' of 'att' at offset 'off' of 'data', aligned as in a heap
+ * tuple, and return the offset just past it.  If 'data' is NULL, only
+ * compute the offset.
+ */
+static Size
+columnar_put_value(char *data, Size off, Form_pg_attribute att, Datum value)
+{
+	Size		size;
+
+	if (att->attbyval)
+	{
+		off = att_align_nominal(off, att->attalign);
+		if (data)
+			store_att_byval(data + off, value, att->attlen);
+		return off + att->attlen;
+	}
+
+	if (att->attlen > 0)
+	{
+		off = att_align_nominal(off, att->attalign);
+		if (data)
+			memcpy(data + off, DatumGetPointer(value), att->attlen);
+		return off + att->attlen;
+	}
+
+	if (att->attlen == -1)
+	{
+		Pointer		val = DatumGetPointer(value);
+
+		Assert(!VARATT_IS_EXTERNAL(val) && !VARATT_IS_COMPRESSED(val));
+
+		if (VARATT_IS_SHORT(val))
+		{
+			size = VARSIZE_SHORT(val);
+			if (data)
+				memcpy(data + off, val, size);
+		}
+		else if (att->attstorage != TYPSTORAGE_PLAIN &&
+				 VARATT_CAN_MAKE_SHORT(val))
+		{
+			/* convert to short varlena, as heap_fill_tuple would */
+			size = VARATT_CONVERTED_SHORT_SIZE(val);
+			if (data)
+			{
+				SET_VARSIZE_SHORT(data + off, size);
+				memcpy(data + off + 1, VARDATA(val), size - 1);
+			}
+		}
+		else
+		{
+			off = att_align_nominal(off, att->attalign);
+			size = VARSIZE(val);
+			if (data)
+				memcpy(data + off, val, size);
+		}
+		return off + size;
+	}
+
+	Assert(att->attlen == -2);
+	off = att_align_nominal(off, att->attalign);
+	size = strlen(DatumGetCString(value)) + 1;
+	if (data)
+		memcpy(data + off, DatumGetPointer(value), size);
+	return off + size;
+}
+
+/*
+ * Serialize the values of 'att' into a chunk, compressed if that pays off,
+ * and fill in 'chunk', except for its offset.  The min/max values, if
+ * computed, are appended to 'minmax' with chunk->minmax_off relative to
+ * its start.  Returns the chunk, or NULL if no values need to be stored.
+ */
+static struct varlena *
+columnar_build_chunk(Relation rel, Form_pg_attribute att, int nrows,
+					 Datum *values, bool *isnull, ColumnarChunkInfo *chunk,
+					 StringInfo minmax)
+{
+	TypeCacheEntry *typentry;
+	struct varlena *raw;
+	Pointer		compressed;
+	char	   *payload;
+	Size		bitmaplen = 0;
+	Size		datalen = 0;
+	Size		size;
+	Size		off;
+	int			nnulls = 0;
+	char		cmethod;
+	int			clevel = 0;
+
+	memset(chunk, 0, sizeof(ColumnarChunkInfo));
+
+	for (int row = 0; row < nrows; row++)
+	{
+		if (isnull[row])
+			nnulls++;
+	}
+
+	if (att->attisdropped || nnulls == nrows)
+	{
+		chunk->flags = COLUMNAR_CHUNK_ALL_NULL;
+		return NULL;
+	}
+
+	if (nnulls > 0)
+	{
+		chunk->flags |= COLUMNAR_CHUNK_HAS_NULLS;
+		bitmaplen = MAXALIGN(BITMAPLEN(nrows));
+	}
+
+	for (int row = 0; row < nrows; row++)
+	{
+		if (!isnull[row])
+			datalen = columnar_put_value(NULL, datalen, att, values[row]);
+	}
+
+	size = COLUMNAR_CHUNK_PAYLOAD_OFFSET + bitmaplen + datalen;
+	raw = (struct varlena *) palloc0(size);
+	SET_VARSIZE(raw, size);
+	payload = (char *) raw + COLUMNAR_CHUNK_PAYLOAD_OFFSET;
+
+	off = 0;
+	for (int row = 0; row < nrows; row++)
+	{
+		if (isnull[row])
+			continue;
+		if (bitmaplen > 0)
+			payload[row >> 3] |= 1 << (row & 0x07);
+		off = columnar_put_value(payload + bitmaplen, off, att, values[row]);
+	}
+	Assert(off == datalen);
+
+	/* min/max values, if the type has a btree ordering */
+	typentry = lookup_type_cache(att->atttypid, TYPECACHE_CMP_PROC_FINFO);
+	if (OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+	{
+		Datum		min = (Datum) 0;
+		Datum		max = (Datum) 0;
+		bool		first = true;
+
+		for (int row = 0; row < nrows; row++)
+		{
+			Datum		value = values[row];
+
+			if (isnull[row])
+				continue;
+			if (first)
+			{
+				min = max = value;
+				first = false;
+				continue;
+			}
+			if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+												att->attcollation,
+												value, min)) < 0)
+				min = value;
+			else if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+													 att->attcollation,
+													 value, max)) > 0)
+				max = value;
+		}
+
+		if (datumGetSize(min, att->attbyval, att->attlen) <= COLUMNAR_MAX_MINMAX_SIZE &&
+			datumGetSize(max, att->attbyval, att->attlen) <= COLUMNAR_MAX_MINMAX_SIZE)
+		{
+			Size		len;
+			char	   *ptr;
+
+			len = datumEstimateSpace(min, false, att->attbyval, att->attlen) +
+				datumEstimateSpace(max, false, att->attbyval, att->attlen);
+			enlargeStringInfo(minmax, len);
+			ptr = minmax->data + minmax->len;
+			datumSerialize(min, false, att->attbyval, att->attlen, &ptr);
+			datumSerialize(max, false, att->attbyval, att->attlen, &ptr);
+
+			chunk->flags |= COLUMNAR_CHUNK_HAS_MINMAX;
+			chunk->minmax_off = minmax->len;
+			chunk->minmax_len = len;
+			minmax->len += len;
+		}
+	}
+
+	/* compress with the column's compression method */
+	cmethod = att->attcompression;
+	if (!CompressionMethodIsValid(cmethod))
+		cmethod = default_toast_compression;
+	if (cmethod == TOAST_ZSTD_COMPRESSION)
+	{
+		AttributeOpts *aopt;
+
+		aopt = get_attribute_options(RelationGetRelid(rel), att->attnum);
+		if (aopt != NULL)
+		{
+			clevel = aopt->compression_level;
+			pfree(aopt);
+		}
+	}
+
+	compressed = DatumGetPointer(toast_compress_datum(PointerGetDatum(raw),
+													  cmethod, clevel));
+	if (compressed != NULL)
+	{
+		pfree(raw);
+		raw = (struct varlena *) compressed;
+		chunk->flags |= COLUMNAR_CHUNK_COMPRESSED;
+	}
+
+	chunk->length = VARSIZE(raw);
+	return raw;
+}
+
+/*
+ * Write 'nrows' rows, described by 'tupdesc', as a new row group of 'rel'.
+ * values[] and isnull[] hold the rows column by column.  The rows are
+ * numbered from 'first_row', part of a reservation ending at
+ * 'reserved_end'.
+ */
+void
+columnar_write_group(Relation rel, TupleDesc tupdesc, TransactionId xmin,
+					 CommandId cmin, uint64 first_row, uint64 reserved_end,
+					 int nrows, Datum **values, bool **isnull)
+{
+	int			natts = tupdesc->natts;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+	ColumnarGroupHeader hdr;
+	ColumnarChunkInfo *chunks;
+	struct varlena **data;
+	StringInfoData minmax;
+	Size		infolen = sizeof(ColumnarChunkInfo) * natts;
+	Size		offset;
+	char	   *image;
+
+	Assert(nrows > 0 && nrows <= COLUMNAR_GROUP_ROWS);
+	Assert(first_row + nrows <= reserved_end);
+
+	tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "columnar row group",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	chunks = palloc(infolen);
+	data = palloc(sizeof(struct varlena *) * natts);
+	initStringInfo(&minmax);
+
+	for (int i = 0; i < natts; i++)
+		data[i] = columnar_build_chunk(rel, TupleDescAttr(tupdesc, i), nrows,
+									   values[i], isnull[i], &chunks[i],
+									   &minmax);
+
+	/* lay out the row group */
+	offset = sizeof(ColumnarGroupHeader) + infolen + minmax.len;
+	for (int i = 0; i < natts; i++)
+	{
+		chunks[i].minmax_off += sizeof(ColumnarGroupHeader) + infolen;
+		chunks[i].offset = offset;
+		offset += chunks[i].length;
+	}
+
+	memset(&hdr, 0, sizeof(ColumnarGroupHeader));
+	hdr.first_row = first_row;
+	hdr.total_len = offset;
+	hdr.xmin = xmin;
+	hdr.cmin = cmin;
+	hdr.nrows = nrows;
+	hdr.meta_len = infolen + minmax.len;
+	hdr.natts = natts;
+	hdr.flags = 0;
+
+	image = MemoryContextAllocHuge(tmpcxt, hdr.total_len);
+	memcpy(image, &hdr, sizeof(ColumnarGroupHeader));
+	memcpy(image + sizeof(ColumnarGroupHeader), chunks, infolen);
+	memcpy(image + sizeof(ColumnarGroupHeader) + infolen, minmax.data,
+		   minmax.len);
+	for (int i = 0; i < natts; i++)
+	{
+		if (data[i] != NULL)
+			memcpy(image + chunks[i].offset, data[i], chunks[i].length);
+	}
+
+	columnar_append_group(rel, image, hdr.total_len, nrows, reserved_end,
+						  first_row + nrows);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(tmpcxt);
+}
+
+/*
+ * Write out all buffered rows, at commit or prepare.
+ */
+static void
+columnar_flush_all(void)
+{
+	HASH_SEQ_STATUS status;
+	ColumnarWriteBuffer *buf;
+
+	if (pending_writes == NULL)
+		return;
+
+	hash_seq_init(&status, pending_writes);
+	while ((buf = hash_seq_search(&status)) != NULL)
+	{
+		Relation	rel;
+
+		/* the relation may have been dropped since */
+		rel = try_relation_open(buf->relid, NoLock);
+		if (rel == NULL)
+		{
+			MemoryContextDelete(buf->context);
+			hash_search(pending_writes, &buf->relid, HASH_REMOVE, NULL);
+			continue;
+		}
+
+		columnar_flush_buffer(rel, buf);
+		relation_close(rel, NoLock);
+	}
+}
+
+/*
+ * Transaction callback: write out the buffered rows before commit, and forget
+ * the write buffers at end of transaction.  They live in
+ * TopTransactionContext, so there's nothing to free.
+ */
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			columnar_flush_all();
+			break;
+
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			pending_writes = NULL;
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Subtransaction callback: at end of subtransaction, hand its write buffers
+ * over to the parent, or throw them away.
+ */
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	HASH_SEQ_STATUS status;
+	ColumnarWriteBuffer *buf;
+
+	if (event != SUBXACT_EVENT_COMMIT_SUB && event != SUBXACT_EVENT_ABORT_SUB)
+		return;
+
+	if (pending_writes == NULL)
+		return;
+
+	hash_seq_init(&status, pending_writes);
+	while ((buf = hash_seq_search(&status)) != NULL)
+	{
+		if (buf->subid != mySubid)
+			continue;
+
+		if (event == SUBXACT_EVENT_COMMIT_SUB)
+			buf->subid = parentSubid;
+		else
+		{
+			MemoryContextDelete(buf->context);
+			hash_search(pending_writes, &buf->relid, HASH_REMOVE, NULL);
+		}
+	}
+}
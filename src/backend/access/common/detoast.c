@@ -14,21 +14,29 @@
 #include "postgres.h"
 
 #include "access/detoast.h"
+#include "access/heaptoast.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/toast_internals.h"
 #include "common/int.h"
 #include "common/pg_lzcompress.h"
 #include "utils/expandeddatum.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
 static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 sliceoffset,
 											   int32 slicelength);
+static struct varlena *toast_fetch_framed_slice(struct varlena *attr,
+												int32 sliceoffset,
+												int32 slicelength);
 static struct varlena *toast_decompress_datum(struct varlena *attr);
 static struct varlena *toast_decompress_datum_slice(struct varlena *attr, int32 slicelength);
 
+/* Fewest TOAST chunks or zstd frames of a datum that is worth slicing */
+#define SEEKABLE_MIN_PIECES		4
+
 /* ----------
  * detoast_external_attr -
  *
@@ -233,6 +241,19 @@ detoast_attr_slice(struct varlena *attr,
 		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
+		/*
+		 * zstd values compressed in frames can be sliced anywhere, by
+		 * decompressing just the frames holding the slice.
+		 */
+		if (slicelimit >= 0 &&
+			VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
+			TOAST_ZSTD_COMPRESSION_ID)
+		{
+			result = toast_fetch_framed_slice(attr, sliceoffset, slicelength);
+			if (result != NULL)
+				return result;
+		}
+
 		/*
 		 * For compressed values, we need to fetch enough slices to decompress
 		 * at least the requested part (when a prefix is requested).
@@ -462,6 +483,232 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset,
 	return result;
 }
 
+/*
+ * The seek table and first frame of the zstd-compressed datum sliced last.
+ * Callers like the jsonb operators take several slices of the same datum,
+ * the first ones usually from its start, so this saves fetching the seek
+ * table and decompressing the first frame again each time.  It lives in
+ * TopTransactionContext, and is forgotten when that is reset, since a TOAST
+ * value ID can be reused once the value has been vacuumed away.
+ */
+typedef struct ToastFrameCache
+{
+	struct varatt_external pointer; /* the datum it's for */
+	int32		tablesize;		/* 0 if the datum has no seek table */
+	int32		framesize;
+	int32		nframes;
+	char	   *table;			/* the seek table, or NULL */
+	char	   *frame0;			/* decompressed first frame, or NULL */
+	int32		frame0len;
+	MemoryContextCallback callback;
+} ToastFrameCache;
+
+static ToastFrameCache *frame_cache = NULL;
+
+static void
+toast_frame_cache_reset(void *arg)
+{
+	frame_cache = NULL;
+}
+
+/*
+ * Look up the seek table of a zstd-compressed external datum, from the cache
+ * or else by fetching it, and make it the cached one.
+ */
+static ToastFrameCache *
+toast_lookup_seek_table(Relation toastrel, struct varatt_external *toast_pointer)
+{
+	struct varlena *table;
+	char	   *copy = NULL;
+	int32		attrsize = VARATT_EXTERNAL_GET_EXTSIZE(*toast_pointer);
+	int32		rawsize = toast_pointer->va_rawsize - VARHDRSZ;
+	int32		streamoff = VARHDRSZ_COMPRESSED - VARHDRSZ;
+	int32		tablesize;
+	int32		framesize;
+	int32		nframes;
+
+	if (frame_cache != NULL &&
+		memcmp(&frame_cache->pointer, toast_pointer,
+			   sizeof(struct varatt_external)) == 0)
+		return frame_cache;
+
+	/* Fetch the start of the stream, to see if it has a seek table */
+	table = (struct varlena *) palloc(ZSTD_SEEK_TABLE_HEADER_SIZE + VARHDRSZ);
+	SET_VARSIZE(table, ZSTD_SEEK_TABLE_HEADER_SIZE + VARHDRSZ);
+	table_relation_fetch_toast_slice(toastrel, toast_pointer->va_valueid,
+									 attrsize, streamoff,
+									 ZSTD_SEEK_TABLE_HEADER_SIZE, table);
+	tablesize = zstd_seek_table_size(VARDATA(table), &framesize, &nframes);
+	pfree(table);
+
+	if (tablesize > 0 &&
+		(tablesize > attrsize - streamoff ||
+		 (int64) framesize * nframes < rawsize))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+
+	if (tablesize > 0)
+	{
+		table = (struct varlena *) palloc(tablesize + VARHDRSZ);
+		SET_VARSIZE(table, tablesize + VARHDRSZ);
+		table_relation_fetch_toast_slice(toastrel, toast_pointer->va_valueid,
+										 attrsize, streamoff, tablesize,
+										 table);
+		copy = MemoryContextAlloc(TopTransactionContext, tablesize);
+		memcpy(copy, VARDATA(table), tablesize);
+		pfree(table);
+	}
+
+	/* Replace the cached entry, if any */
+	if (frame_cache == NULL)
+	{
+		frame_cache = MemoryContextAllocZero(TopTransactionContext,
+											 sizeof(ToastFrameCache));
+		frame_cache->callback.func = toast_frame_cache_reset;
+		MemoryContextRegisterResetCallback(TopTransactionContext,
+										   &frame_cache->callback);
+	}
+	else
+	{
+		if (frame_cache->table)
+			pfree(frame_cache->table);
+		if (frame_cache->frame0)
+			pfree(frame_cache->frame0);
+	}
+	frame_cache->pointer = *toast_pointer;
+	frame_cache->tablesize = tablesize;
+	frame_cache->framesize = framesize;
+	frame_cache->nframes = nframes;
+	frame_cache->table = copy;
+	frame_cache->frame0 = NULL;
+	frame_cache->frame0len = 0;
+
+	return frame_cache;
+}
+
+/* ----------
+ * toast_fetch_framed_slice -
+ *
+ *	Reconstruct a segment of a zstd-compressed external Datum by fetching
+ *	and decompressing only the frames that hold it.  Returns NULL if the
+ *	Datum was not compressed in frames.
+ * ----------
+ */
+static struct varlena *
+toast_fetch_framed_slice(struct varlena *attr, int32 sliceoffset,
+						 int32 slicelength)
+{
+	Relation	toastrel;
+	ToastFrameCache *cache;
+	struct varlena *result;
+	struct varlena *frames;
+	struct varatt_external toast_pointer;
+	int32		attrsize;
+	int32		rawsize;
+	int32		streamoff;
+	int32		framesize;
+	int32		firstframe;
+	int32		fetchframe;
+	int32		lastframe;
+	int32		start;
+	int32		end;
+	int32		unused;
+	int32		rawstart;
+	int32		rawlen;
+	int32		fetchoff;
+	char	   *raw;
+
+	/* Must copy to access aligned fields */
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+	rawsize = toast_pointer.va_rawsize - VARHDRSZ;
+
+	/* The compressed stream follows the rest of the compression header */
+	streamoff = VARHDRSZ_COMPRESSED - VARHDRSZ;
+	if (attrsize < streamoff + ZSTD_SEEK_TABLE_HEADER_SIZE)
+		return NULL;
+
+	toastrel = table_open(toast_pointer.va_toastrelid, AccessShareLock);
+
+	cache = toast_lookup_seek_table(toastrel, &toast_pointer);
+	if (cache->tablesize == 0)
+	{
+		table_close(toastrel, AccessShareLock);
+		return NULL;
+	}
+	framesize = cache->framesize;
+
+	if (sliceoffset >= rawsize)
+		slicelength = 0;
+	else if (slicelength > rawsize - sliceoffset)
+		slicelength = rawsize - sliceoffset;
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+	SET_VARSIZE(result, slicelength + VARHDRSZ);
+
+	if (slicelength == 0)
+	{
+		table_close(toastrel, AccessShareLock);
+		return result;
+	}
+
+	firstframe = sliceoffset / framesize;
+	lastframe = (sliceoffset + slicelength - 1) / framesize;
+	rawstart = firstframe * framesize;
+	rawlen = Min((int64) (lastframe + 1) * framesize, rawsize) - rawstart;
+	raw = palloc(rawlen);
+
+	/* Take the first frame from the cache, if we have it */
+	fetchframe = firstframe;
+	if (firstframe == 0 && cache->frame0 != NULL)
+	{
+		memcpy(raw, cache->frame0, cache->frame0len);
+		fetchframe = 1;
+	}
+
+	/* Fetch and decompress the rest of the frames */
+	if (fetchframe <= lastframe)
+	{
+		zstd_frame_bounds(cache->table, fetchframe, &start, &unused);
+		zstd_frame_bounds(cache->table, lastframe, &unused, &end);
+
+		if (start < cache->tablesize || end > attrsize - streamoff ||
+			start > end)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed zstd data is corrupt")));
+
+		frames = (struct varlena *) palloc(end - start + VARHDRSZ);
+		SET_VARSIZE(frames, end - start + VARHDRSZ);
+		table_relation_fetch_toast_slice(toastrel, toast_pointer.va_valueid,
+										 attrsize, streamoff + start,
+										 end - start, frames);
+
+		fetchoff = (fetchframe - firstframe) * framesize;
+		zstd_decompress_frames(VARDATA(frames), end - start,
+							   raw + fetchoff, rawlen - fetchoff);
+		pfree(frames);
+
+		/* Remember the first frame for the next slice */
+		if (fetchframe == 0)
+		{
+			cache->frame0len = Min(framesize, rawlen);
+			cache->frame0 = MemoryContextAlloc(TopTransactionContext,
+											   cache->frame0len);
+			memcpy(cache->frame0, raw, cache->frame0len);
+		}
+	}
+
+	table_close(toastrel, AccessShareLock);
+
+	memcpy(VARDATA(result), raw + (sliceoffset - rawstart), slicelength);
+	pfree(raw);
+
+	return result;
+}
+
 /* ----------
  * toast_decompress_datum -
  *
@@ -485,6 +732,8 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -528,6 +777,8 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -591,6 +842,45 @@ toast_raw_datum_size(Datum value)
 	return result;
 }
 
+/* ----------
+ * toast_datum_is_seekable -
+ *
+ *	Can slices of a varlena datum be fetched from anywhere in it, without
+ *	fetching or decompressing all that comes before?  That's the case for
+ *	uncompressed external datums, which are fetched chunk by chunk, and for
+ *	zstd-compressed external datums large enough to be compressed in frames.
+ *	Datums that aren't external are in memory already, and are best
+ *	detoasted whole.
+ *
+ *	Each slice costs a separate index lookup in the TOAST table, so callers
+ *	that take several of them only come out ahead if they'd otherwise fetch
+ *	a lot more.  We therefore don't report datums that span only a few TOAST
+ *	chunks, or zstd frames, as seekable.
+ * ----------
+ */
+
+bool
+toast_datum_is_seekable(Datum value)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(value);
+	struct varatt_external toast_pointer;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr))
+		return false;
+
+	/* Must copy to access aligned fields */
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+		return VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer) >
+			SEEKABLE_MIN_PIECES * TOAST_MAX_CHUNK_SIZE;
+
+	return VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
+		TOAST_ZSTD_COMPRESSION_ID &&
+		toast_pointer.va_rawsize - VARHDRSZ >
+		SEEKABLE_MIN_PIECES * ZSTD_TOAST_FRAME_SIZE;
+}
+
 /* ----------
  * toast_datum_size
  *
@@ -120,6 +120,15 @@ static relopt_bool boolRelOpts[] =
 		},
 		false
 	},
+	{
+		{
+			"warm_updates",
+			"Enables updates that only insert into the indexes whose columns changed",
+			RELOPT_KIND_HEAP,
+			AccessExclusiveLock
+		},
+		false
+	},
 	{
 		{
 			"fastupdate",
@@ -380,6 +389,15 @@ static relopt_int intRelOpts[] =
 		},
 		-1, 0, 1024
 	},
+	{
+		{
+			"compression_level",
+			"Sets the level at which values in this column are compressed, for compression methods that support levels (0 selects the method's default).",
+			RELOPT_KIND_ATTRIBUTE,
+			ShareUpdateExclusiveLock
+		},
+		0, 0, 22
+	},
 
 	/* list terminator */
 	{{NULL}}
@@ -1880,7 +1898,9 @@ default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 		{"vacuum_index_cleanup", RELOPT_TYPE_ENUM,
 		offsetof(StdRdOptions, vacuum_index_cleanup)},
 		{"vacuum_truncate", RELOPT_TYPE_BOOL,
-		offsetof(StdRdOptions, vacuum_truncate)}
+		offsetof(StdRdOptions, vacuum_truncate)},
+		{"warm_updates", RELOPT_TYPE_BOOL,
+		offsetof(StdRdOptions, warm_updates)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate, kind,
@@ -2070,7 +2090,8 @@ attribute_reloptions(Datum reloptions, bool validate)
 {
 	static const relopt_parse_elt tab[] = {
 		{"n_distinct", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct)},
-		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)}
+		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)},
+		{"compression_level", RELOPT_TYPE_INT, offsetof(AttributeOpts, compression_level)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate,
@@ -16,6 +16,9 @@
 #ifdef USE_LZ4
 #include <lz4.h>
 #endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/toast_compression.h"
@@ -31,6 +34,125 @@ int			default_toast_compression = TOAST_PGLZ_COMPRESSION;
 			 errmsg("compression method lz4 not supported"), \
 			 errdetail("This functionality requires the server to be built with lz4 support.")))
 
+#define NO_ZSTD_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("compression method zstd not supported"), \
+			 errdetail("This functionality requires the server to be built with zstd support.")))
+
+#ifdef USE_ZSTD
+/*
+ * zstd contexts, created on first use and kept for later values.  Values are
+ * typically small, so we don't want to pay for setting up a new context for
+ * each one.  But a context keeps the buffers it grew to for the largest
+ * window and compression level it was used with, so we free it if it has
+ * grown beyond ZSTD_CTX_KEEP_SIZE rather than hold on to that for the life
+ * of the backend.
+ */
+#define ZSTD_CTX_KEEP_SIZE			(4 * 1024 * 1024)
+
+static ZSTD_CCtx *zstd_cctx = NULL;
+static ZSTD_DCtx *zstd_dctx = NULL;
+
+static ZSTD_CCtx *
+zstd_get_cctx(void)
+{
+	if (zstd_cctx == NULL)
+	{
+		zstd_cctx = ZSTD_createCCtx();
+		if (zstd_cctx == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+	}
+	return zstd_cctx;
+}
+
+static ZSTD_DCtx *
+zstd_get_dctx(void)
+{
+	if (zstd_dctx == NULL)
+	{
+		zstd_dctx = ZSTD_createDCtx();
+		if (zstd_dctx == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+	}
+	ZSTD_DCtx_reset(zstd_dctx, ZSTD_reset_session_only);
+	return zstd_dctx;
+}
+
+/* Free the contexts if they've grown too large to keep */
+static void
+zstd_trim_contexts(void)
+{
+	if (zstd_cctx != NULL && ZSTD_sizeof_CCtx(zstd_cctx) > ZSTD_CTX_KEEP_SIZE)
+	{
+		ZSTD_freeCCtx(zstd_cctx);
+		zstd_cctx = NULL;
+	}
+	if (zstd_dctx != NULL && ZSTD_sizeof_DCtx(zstd_dctx) > ZSTD_CTX_KEEP_SIZE)
+	{
+		ZSTD_freeDCtx(zstd_dctx);
+		zstd_dctx = NULL;
+	}
+}
+
+/*
+ * Complain if a compressed zstd frame needs a dictionary.  See
+ * toast_compression.h.
+ */
+static void
+zstd_check_dictionary(const char *src, size_t srclen)
+{
+	unsigned int dictid = ZSTD_getDictID_fromFrame(src, srclen);
+
+	if (dictid != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot decompress zstd data compressed with dictionary %u",
+						dictid)));
+}
+#endif
+
+/*
+ * Layout of the seek table of a zstd value compressed in frames (see
+ * toast_compression.h), all fields little-endian as zstd requires of the
+ * skippable frame header:
+ *
+ *	uint32	magic, one of the skippable frame magic numbers
+ *	uint32	size of the rest of the skippable frame
+ *	uint32	raw bytes per frame
+ *	uint32	number of frames
+ *	uint32	end offset of each frame in the compressed stream
+ *
+ * The compressed frames follow, in order.
+ */
+#define ZSTD_SEEK_TABLE_MAGIC		0x184D2A5E
+
+static inline uint32
+zstd_read_le32(const char *ptr)
+{
+	const unsigned char *p = (const unsigned char *) ptr;
+
+	return (uint32) p[0] | ((uint32) p[1] << 8) |
+		((uint32) p[2] << 16) | ((uint32) p[3] << 24);
+}
+
+#ifdef USE_ZSTD
+static inline void
+zstd_write_le32(char *ptr, uint32 val)
+{
+	unsigned char *p = (unsigned char *) ptr;
+
+	p[0] = val & 0xFF;
+	p[1] = (val >> 8) & 0xFF;
+	p[2] = (val >> 16) & 0xFF;
+	p[3] = (val >> 24) & 0xFF;
+}
+#endif
+
 /*
  * Compress a varlena using PGLZ.
  *
@@ -245,6 +367,288 @@ lz4_decompress_datum_slice(const struct varlena *value, int32 slicelength)
 #endif
 }
 
+/*
+ * Compress a varlena using zstd, at the given compression level (0 means
+ * zstd's default level).
+ *
+ * Returns the compressed varlena, or NULL if compression fails.
+ */
+struct varlena *
+zstd_compress_datum(const struct varlena *value, int level)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	int32		valsize;
+	int32		nframes;
+	int32		framesize;
+	size_t		tablesize;
+	size_t		len;
+	size_t		max_size;
+	char	   *stream;
+	struct varlena *tmp = NULL;
+	ZSTD_CCtx  *cctx = zstd_get_cctx();
+
+	valsize = VARSIZE_ANY_EXHDR(value);
+
+	/* Large values are compressed in frames, behind a seek table */
+	if (valsize > ZSTD_TOAST_FRAME_SIZE)
+	{
+		framesize = ZSTD_TOAST_FRAME_SIZE;
+		nframes = (valsize + framesize - 1) / framesize;
+		tablesize = ZSTD_SEEK_TABLE_HEADER_SIZE + nframes * sizeof(uint32);
+	}
+	else
+	{
+		framesize = valsize;
+		nframes = 1;
+		tablesize = 0;
+	}
+
+	/*
+	 * Figure out the maximum possible size of the zstd output, add the bytes
+	 * that will be needed for varlena overhead, and allocate that amount.
+	 */
+	max_size = tablesize + nframes * ZSTD_compressBound(framesize);
+	tmp = (struct varlena *) palloc(max_size + VARHDRSZ_COMPRESSED);
+	stream = (char *) tmp + VARHDRSZ_COMPRESSED;
+
+	/*
+	 * The raw size is kept in the TOAST compression header already, so leave
+	 * it out of the zstd frame header.
+	 */
+	ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+						   level != 0 ? level : ZSTD_CLEVEL_DEFAULT);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
+
+	if (tablesize > 0)
+	{
+		zstd_write_le32(stream, ZSTD_SEEK_TABLE_MAGIC);
+		zstd_write_le32(stream + 4, tablesize - 8);
+		zstd_write_le32(stream + 8, framesize);
+		zstd_write_le32(stream + 12, nframes);
+	}
+
+	len = tablesize;
+	for (int i = 0; i < nframes; i++)
+	{
+		int32		rawlen = Min(framesize, valsize - i * framesize);
+		size_t		framelen;
+
+		/* each call starts a new frame, keeping the parameters */
+		framelen = ZSTD_compress2(cctx, stream + len, max_size - len,
+								  VARDATA_ANY(value) + i * framesize,
+								  rawlen);
+		if (ZSTD_isError(framelen))
+			elog(ERROR, "zstd compression failed: %s",
+				 ZSTD_getErrorName(framelen));
+		len += framelen;
+
+		/* data is incompressible so just free the memory and return NULL */
+		if (len > valsize)
+		{
+			zstd_trim_contexts();
+			pfree(tmp);
+			return NULL;
+		}
+
+		if (tablesize > 0)
+			zstd_write_le32(stream + ZSTD_SEEK_TABLE_HEADER_SIZE +
+							i * sizeof(uint32), len);
+	}
+
+	zstd_trim_contexts();
+
+	SET_VARSIZE_COMPRESSED(tmp, len + VARHDRSZ_COMPRESSED);
+
+	return tmp;
+#endif
+}
+
+#ifdef USE_ZSTD
+/*
+ * Decompress at most rawsize bytes of a zstd-compressed varlena into result.
+ * Returns the number of bytes produced.
+ */
+static size_t
+zstd_decompress_into(const struct varlena *value, char *result, int32 rawsize)
+{
+	ZSTD_DCtx  *dctx = zstd_get_dctx();
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	int32		framesize;
+	int32		nframes;
+
+	in.src = (char *) value + VARHDRSZ_COMPRESSED;
+	in.size = VARSIZE(value) - VARHDRSZ_COMPRESSED;
+	in.pos = 0;
+	out.dst = result;
+	out.size = rawsize;
+	out.pos = 0;
+
+	/* Look at the first compressed frame, after the seek table if any */
+	if (in.size >= ZSTD_SEEK_TABLE_HEADER_SIZE)
+	{
+		int32		tablesize = zstd_seek_table_size(in.src, &framesize,
+													 &nframes);
+
+		if ((size_t) tablesize < in.size)
+			zstd_check_dictionary((const char *) in.src + tablesize,
+								  in.size - tablesize);
+	}
+	else
+		zstd_check_dictionary(in.src, in.size);
+
+	/*
+	 * Use streaming decompression, which stops once the output buffer is
+	 * full.  That lets us decompress just a prefix for slices.  It goes on
+	 * from one frame to the next by itself, and skips the seek table of a
+	 * value compressed in frames.
+	 */
+	while (in.pos < in.size && out.pos < out.size)
+	{
+		size_t		ret = ZSTD_decompressStream(dctx, &out, &in);
+
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed zstd data is corrupt")));
+	}
+
+	zstd_trim_contexts();
+
+	return out.pos;
+}
+#endif
+
+/*
+ * Decompress a varlena that was compressed using zstd.
+ */
+struct varlena *
+zstd_decompress_datum(const struct varlena *value)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	int32		rawsize = VARDATA_COMPRESSED_GET_EXTSIZE(value);
+	struct varlena *result;
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(rawsize + VARHDRSZ);
+
+	/* decompress the data */
+	if (zstd_decompress_into(value, VARDATA(result), rawsize) != rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Decompress part of a varlena that was compressed using zstd.
+ */
+struct varlena *
+zstd_decompress_datum_slice(const struct varlena *value, int32 slicelength)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	struct varlena *result;
+	size_t		rawsize;
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	/* decompress the data */
+	rawsize = zstd_decompress_into(value, VARDATA(result), slicelength);
+
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Check whether a zstd-compressed stream, of which at least the first
+ * ZSTD_SEEK_TABLE_HEADER_SIZE bytes are given, starts with a seek table.
+ * If so, returns the size of the seek table, and sets *framesize and
+ * *nframes; otherwise, returns 0.
+ */
+int32
+zstd_seek_table_size(const char *stream, int32 *framesize, int32 *nframes)
+{
+	uint32		nf;
+
+	if (zstd_read_le32(stream) != ZSTD_SEEK_TABLE_MAGIC)
+		return 0;
+
+	*framesize = zstd_read_le32(stream + 8);
+	nf = zstd_read_le32(stream + 12);
+	if (*framesize <= 0 || nf == 0 || nf > PG_INT32_MAX / sizeof(uint32) ||
+		zstd_read_le32(stream + 4) != 8 + nf * sizeof(uint32))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+	*nframes = nf;
+
+	return ZSTD_SEEK_TABLE_HEADER_SIZE + nf * sizeof(uint32);
+}
+
+/*
+ * Get the start and end offsets of a frame of a zstd-compressed stream,
+ * whose seek table must be given in full.
+ */
+void
+zstd_frame_bounds(const char *stream, int32 frame, int32 *start, int32 *end)
+{
+	const char *ends = stream + ZSTD_SEEK_TABLE_HEADER_SIZE;
+
+	Assert(frame >= 0 && (uint32) frame < zstd_read_le32(stream + 12));
+
+	if (frame == 0)
+		*start = ZSTD_SEEK_TABLE_HEADER_SIZE +
+			zstd_read_le32(stream + 12) * sizeof(uint32);
+	else
+		*start = zstd_read_le32(ends + (frame - 1) * sizeof(uint32));
+	*end = zstd_read_le32(ends + frame * sizeof(uint32));
+
+	if (*start > *end)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+}
+
+/*
+ * Decompress a run of whole zstd frames, which must yield exactly dstlen
+ * bytes.
+ */
+void
+zstd_decompress_frames(const char *src, int32 srclen, char *dst, int32 dstlen)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+#else
+	ZSTD_DCtx  *dctx = zstd_get_dctx();
+	size_t		len;
+
+	zstd_check_dictionary(src, srclen);
+	len = ZSTD_decompressDCtx(dctx, dst, dstlen, src, srclen);
+	if (ZSTD_isError(len) || len != (size_t) dstlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+	zstd_trim_contexts();
+#endif
+}
+
 /*
  * Extract compression ID from a varlena.
  *
@@ -293,6 +697,13 @@ CompressionNameToMethod(const char *compression)
 #endif
 		return TOAST_LZ4_COMPRESSION;
 	}
+	else if (strcmp(compression, "zstd") == 0)
+	{
+#ifndef USE_ZSTD
+		NO_ZSTD_SUPPORT();
+#endif
+		return TOAST_ZSTD_COMPRESSION;
+	}
 
 	return InvalidCompressionMethod;
 }
@@ -309,6 +720,8 @@ GetCompressionMethodName(char method)
 			return "pglz";
 		case TOAST_LZ4_COMPRESSION:
 			return "lz4";
+		case TOAST_ZSTD_COMPRESSION:
+			return "zstd";
 		default:
 			elog(ERROR, "invalid compression method %c", method);
 			return NULL;		/* keep compiler quiet */
@@ -317,7 +317,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 		scan->rs_nblocks = RelationGetNumberOfBlocks(scan->rs_base.rs_rd);
 
 	/*
-	 * If the table is large relative to NBuffers, use a bulk-read access
+	 * If the table is large relative to the part of the buffer pool in use
+	 * (see shared_buffers_limit), use a bulk-read access
 	 * strategy and enable synchronized scanning (see syncscan.c).  Although
 	 * the thresholds for these features could be different, we make them the
 	 * same so that there are only two behaviors to tune rather than four.
@@ -329,7 +330,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	 * if you change this, consider changing that one, too.
 	 */
 	if (!RelationUsesLocalBuffers(scan->rs_base.rs_rd) &&
-		scan->rs_nblocks > NBuffers / 4)
+		scan->rs_nblocks > SharedBuffersLimit() / 4)
 	{
 		allow_strat = (scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0;
 		allow_sync = (scan->rs_base.rs_flags & SO_ALLOW_SYNC) != 0;
@@ -516,7 +517,10 @@ heap_prepare_pagescan(TableScanDesc sscan)
 	/*
 	 * We must hold share lock on the buffer content while examining tuple
 	 * visibility.  Afterwards, however, the tuples we have found to be
-	 * visible are guaranteed good as long as we hold the buffer pin.
+	 * visible are guaranteed good as long as we hold the buffer pin: our pin
+	 * keeps pruning from moving tuple data, and pruning without a cleanup
+	 * lock only changes the line pointers of tuples that are dead to
+	 * everyone, which tuples visible to our snapshot are not.
 	 */
 	LockBuffer(buffer, BUFFER_LOCK_SHARE);
 
@@ -1999,6 +2003,7 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	Buffer		buffer;
 	Buffer		vmbuffer = InvalidBuffer;
 	bool		all_visible_cleared = false;
+	bool		cleared_all_frozen = false;
 
 	/* Cheap, simplistic check that the tuple matches the rel's rowtype. */
 	Assert(HeapTupleHeaderGetNatts(tup->t_data) <=
@@ -2048,9 +2053,11 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 	{
 		all_visible_cleared = true;
 		PageClearAllVisible(BufferGetPage(buffer));
-		visibilitymap_clear(relation,
-							ItemPointerGetBlockNumber(&(heaptup->t_self)),
-							vmbuffer, VISIBILITYMAP_VALID_BITS);
+		if (visibilitymap_clear(relation,
+								ItemPointerGetBlockNumber(&(heaptup->t_self)),
+								vmbuffer, VISIBILITYMAP_VALID_BITS) &
+			VISIBILITYMAP_ALL_FROZEN)
+			cleared_all_frozen = true;
 	}
 
 	/*
@@ -2161,6 +2168,8 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
 	/* Note: speculative insertions are counted too, even if aborted later */
 	pgstat_count_heap_insert(relation, 1);
+	if (cleared_all_frozen)
+		pgstat_count_heap_unfreeze(relation, 1);
 
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
@@ -2277,6 +2286,7 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 	bool		starting_with_empty_page = false;
 	int			npages = 0;
 	int			npages_used = 0;
+	int			npages_unfrozen = 0;
 
 	/* currently not needed (thus unsupported) for heap_multi_insert() */
 	Assert(!(options & HEAP_INSERT_NO_LOGICAL));
@@ -2414,9 +2424,11 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		{
 			all_visible_cleared = true;
 			PageClearAllVisible(page);
-			visibilitymap_clear(relation,
-								BufferGetBlockNumber(buffer),
-								vmbuffer, VISIBILITYMAP_VALID_BITS);
+			if (visibilitymap_clear(relation,
+									BufferGetBlockNumber(buffer),
+									vmbuffer, VISIBILITYMAP_VALID_BITS) &
+				VISIBILITYMAP_ALL_FROZEN)
+				npages_unfrozen++;
 		}
 		else if (all_frozen_set)
 			PageSetAllVisible(page);
@@ -2610,6 +2622,8 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 		slots[i]->tts_tid = heaptuples[i]->t_self;
 
 	pgstat_count_heap_insert(relation, ntuples);
+	if (npages_unfrozen > 0)
+		pgstat_count_heap_unfreeze(relation, npages_unfrozen);
 }
 
 /*
@@ -2698,6 +2712,7 @@ heap_delete(Relation relation, ItemPointer tid,
 	bool		have_tuple_lock = false;
 	bool		iscombo;
 	bool		all_visible_cleared = false;
+	bool		cleared_all_frozen = false;
 	HeapTuple	old_key_tuple = NULL;	/* replica identity of the tuple */
 	bool		old_key_copied = false;
 
@@ -2959,8 +2974,10 @@ l1:
 	{
 		all_visible_cleared = true;
 		PageClearAllVisible(page);
-		visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
-							vmbuffer, VISIBILITYMAP_VALID_BITS);
+		if (visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
+								vmbuffer, VISIBILITYMAP_VALID_BITS) &
+			VISIBILITYMAP_ALL_FROZEN)
+			cleared_all_frozen = true;
 	}
 
 	/* store transaction information of xact deleting the tuple */
@@ -3085,6 +3102,8 @@ l1:
 		UnlockTupleTuplock(relation, &(tp.t_self), LockTupleExclusive);
 
 	pgstat_count_heap_delete(relation);
+	if (cleared_all_frozen)
+		pgstat_count_heap_unfreeze(relation, 1);
 
 	if (old_key_tuple != NULL && old_key_copied)
 		heap_freetuple(old_key_tuple);
@@ -3156,6 +3175,7 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
 	Bitmapset  *sum_attrs;
+	Bitmapset  *warm_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
 	Bitmapset  *interesting_attrs;
@@ -3179,9 +3199,11 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		iscombo;
 	bool		use_hot_update = false;
 	bool		summarized_update = false;
+	bool		warm_update = false;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
 	bool		all_visible_cleared_new = false;
+	int			npages_unfrozen = 0;
 	bool		checked_lockers;
 	bool		locker_remains;
 	bool		id_has_external = false;
@@ -3228,6 +3250,8 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
 	sum_attrs = RelationGetIndexAttrBitmap(relation,
 										   INDEX_ATTR_BITMAP_SUMMARIZED);
+	warm_attrs = RelationGetIndexAttrBitmap(relation,
+											INDEX_ATTR_BITMAP_WARM_BLOCKING);
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
@@ -3549,6 +3573,7 @@ l2:
 
 		bms_free(hot_attrs);
 		bms_free(sum_attrs);
+		bms_free(warm_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
 		bms_free(modified_attrs);
@@ -3755,6 +3780,9 @@ l2:
 
 		END_CRIT_SECTION();
 
+		if (cleared_all_frozen)
+			npages_unfrozen++;
+
 		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
 
 		/*
@@ -3884,6 +3912,19 @@ l2:
 			if (bms_overlap(modified_attrs, sum_attrs))
 				summarized_update = true;
 		}
+		else if (!bms_overlap(modified_attrs, warm_attrs) &&
+				 !HeapTupleIsHeapOnly(&oldtup))
+		{
+			/*
+			 * Only columns of indexes that can cope with stale entries were
+			 * changed, so we can still do a HOT update, if the caller inserts
+			 * entries for the new values pointing to the old tuple.  That
+			 * only works if the old tuple is the root of its HOT chain, which
+			 * limits each chain to one WARM update.  See README.HOT.
+			 */
+			use_hot_update = true;
+			warm_update = true;
+		}
 	}
 	else
 	{
@@ -3958,15 +3999,19 @@ l2:
 	{
 		all_visible_cleared = true;
 		PageClearAllVisible(BufferGetPage(buffer));
-		visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
-							vmbuffer, VISIBILITYMAP_VALID_BITS);
+		if (visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
+								vmbuffer, VISIBILITYMAP_VALID_BITS) &
+			VISIBILITYMAP_ALL_FROZEN)
+			npages_unfrozen++;
 	}
 	if (newbuf != buffer && PageIsAllVisible(BufferGetPage(newbuf)))
 	{
 		all_visible_cleared_new = true;
 		PageClearAllVisible(BufferGetPage(newbuf));
-		visibilitymap_clear(relation, BufferGetBlockNumber(newbuf),
-							vmbuffer_new, VISIBILITYMAP_VALID_BITS);
+		if (visibilitymap_clear(relation, BufferGetBlockNumber(newbuf),
+								vmbuffer_new, VISIBILITYMAP_VALID_BITS) &
+			VISIBILITYMAP_ALL_FROZEN)
+			npages_unfrozen++;
 	}
 
 	if (newbuf != buffer)
@@ -4032,6 +4077,8 @@ l2:
 		UnlockTupleTuplock(relation, &(oldtup.t_self), *lockmode);
 
 	pgstat_count_heap_update(relation, use_hot_update, newbuf != buffer);
+	if (npages_unfrozen > 0)
+		pgstat_count_heap_unfreeze(relation, npages_unfrozen);
 
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
@@ -4051,7 +4098,9 @@ l2:
 	 */
 	if (use_hot_update)
 	{
-		if (summarized_update)
+		if (warm_update)
+			*update_indexes = TU_Warm;
+		else if (summarized_update)
 			*update_indexes = TU_Summarizing;
 		else
 			*update_indexes = TU_None;
@@ -4064,6 +4113,7 @@ l2:
 
 	bms_free(hot_attrs);
 	bms_free(sum_attrs);
+	bms_free(warm_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
 	bms_free(modified_attrs);
@@ -4968,6 +5018,9 @@ failed:
 
 	END_CRIT_SECTION();
 
+	if (cleared_all_frozen)
+		pgstat_count_heap_unfreeze(relation, 1);
+
 	result = TM_Ok;
 
 out_locked:
@@ -5719,6 +5772,12 @@ l4:
 
 		END_CRIT_SECTION();
 
+		if (cleared_all_frozen)
+		{
+			pgstat_count_heap_unfreeze(rel, 1);
+			cleared_all_frozen = false;
+		}
+
 next:
 		/* if we find the end of update chain, we're done. */
 		if (mytup.t_data->t_infomask & HEAP_XMAX_INVALID ||
@@ -8766,11 +8825,8 @@ heap_xlog_prune_freeze(XLogReaderState *record)
 	/*
 	 * We will take an ordinary exclusive lock or a cleanup lock depending on
 	 * whether the XLHP_CLEANUP_LOCK flag is set.  With an ordinary exclusive
-	 * lock, we better not be doing anything that requires moving existing
-	 * tuple data.
+	 * lock, heap_page_prune_execute() won't move any existing tuple data.
 	 */
-	Assert((xlrec.flags & XLHP_CLEANUP_LOCK) != 0 ||
-		   (xlrec.flags & (XLHP_HAS_REDIRECTIONS | XLHP_HAS_DEAD_ITEMS)) == 0);
 
 	/*
 	 * We are about to remove and/or freeze tuples.  In Hot Standby mode,
@@ -8821,11 +8877,14 @@ heap_xlog_prune_freeze(XLogReaderState *record)
 
 		/*
 		 * Update all line pointers per the record, and repair fragmentation
-		 * if needed.
+		 * if needed.  A page left fragmented by an earlier prune without a
+		 * cleanup lock is defragmented by the next record that has one, as
+		 * on the primary.
 		 */
-		if (nredirected > 0 || ndead > 0 || nunused > 0)
+		if (nredirected > 0 || ndead > 0 || nunused > 0 ||
+			((xlrec.flags & XLHP_CLEANUP_LOCK) != 0 && PageNeedsDefrag(page)))
 			heap_page_prune_execute(buffer,
-									(xlrec.flags & XLHP_CLEANUP_LOCK) == 0,
+									(xlrec.flags & XLHP_CLEANUP_LOCK) != 0,
 									redirected, nredirected,
 									nowdead, ndead,
 									nowunused, nunused);
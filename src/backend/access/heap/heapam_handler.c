@@ -337,7 +337,8 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	 *
 	 * If the update is not HOT, we must update all indexes. If the update is
 	 * HOT, it could be that we updated summarized columns, so we either
-	 * update only summarized indexes, or none at all.
+	 * update only summarized indexes, or none at all.  A WARM update is a
+	 * HOT update that also needs entries in some of the other indexes.
 	 */
 	if (result != TM_Ok)
 	{
@@ -348,6 +349,7 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 		Assert(*update_indexes == TU_All);
 	else
 		Assert((*update_indexes == TU_Summarizing) ||
+			   (*update_indexes == TU_Warm) ||
 			   (*update_indexes == TU_None));
 
 	if (shouldFree)
@@ -1361,14 +1363,24 @@ heapam_index_build_range_scan(Relation heapRelation,
 		 * It might look unsafe to use this information across buffer
 		 * lock/unlock.  However, we hold ShareLock on the table so no
 		 * ordinary insert/update/delete should occur; and we hold pin on the
-		 * buffer continuously while visiting the page, so no pruning
-		 * operation can occur either.
+		 * buffer continuously while visiting the page.  That doesn't prevent
+		 * pruning, which can do without a cleanup lock, but without one it
+		 * never moves tuple data, and it never changes the root of a HOT
+		 * chain: it only redirects a dead root to a later chain member, and
+		 * marks dead heap-only tuples unused.  So the root recorded for any
+		 * tuple that we still find on the page stays valid.  A line pointer
+		 * freed that way can only be reused by a new tuple, which we don't
+		 * expect under ShareLock.
 		 *
 		 * In cases with only ShareUpdateExclusiveLock on the table, it's
 		 * possible for some HOT tuples to appear that we didn't know about
 		 * when we first read the page.  To handle that case, we re-obtain the
 		 * list of root offsets when a HOT tuple points to a root item that we
-		 * don't know about.
+		 * don't know about.  A new tuple could also take over a line pointer
+		 * that pruning freed after we built the map, and inherit a stale
+		 * root; but with an MVCC snapshot (CREATE INDEX CONCURRENTLY) we never
+		 * return tuples that new, and the only other such caller, BRIN
+		 * summarization, uses no more than the block number of the TID.
 		 *
 		 * Also, although our opinions about tuple liveness could change while
 		 * we scan the page (due to concurrent transaction commits/aborts),
@@ -1402,7 +1414,9 @@ heapam_index_build_range_scan(Relation heapRelation,
 			 * We could possibly get away with not locking the buffer here,
 			 * since caller should hold ShareLock on the relation, but let's
 			 * be conservative about it.  (This remark is still correct even
-			 * with HOT-pruning: our pin on the buffer prevents pruning.)
+			 * with HOT-pruning: our pin on the buffer keeps pruning from
+			 * moving the tuple data that heapTuple points to, even if its
+			 * line pointer has been marked unused in the meantime.)
 			 */
 			LockBuffer(hscan->rs_cbuf, BUFFER_LOCK_SHARE);
 
@@ -2180,7 +2194,10 @@ heapam_scan_bitmap_next_block(TableScanDesc scan,
 	/*
 	 * We must hold share lock on the buffer content while examining tuple
 	 * visibility.  Afterwards, however, the tuples we have found to be
-	 * visible are guaranteed good as long as we hold the buffer pin.
+	 * visible are guaranteed good as long as we hold the buffer pin: our pin
+	 * keeps pruning from moving tuple data, and pruning without a cleanup
+	 * lock only changes the line pointers of tuples that are dead to
+	 * everyone, which tuples visible to our snapshot are not.
 	 */
 	LockBuffer(buffer, BUFFER_LOCK_SHARE);
 
@@ -210,6 +210,67 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 	return released_locks;
 }
 
+/*
+ * Pre-extend the relation by an extent of empty pages, for other backends to
+ * find in the FSM.
+ *
+ * Extending by more than MAX_BUFFERS_TO_EXTEND_BY pages through the buffer
+ * manager isn't possible, as all the new buffers have to be pinned at once.
+ * But new heap pages don't need to be in shared buffers: an all-zeroes page
+ * is valid, and RelationGetBufferForTuple() initializes such pages when it
+ * finds them in the FSM.  So when many backends are waiting to extend the
+ * relation, we zero-extend the file directly, typically with fallocate(), by
+ * the 'shortfall' of pages the buffered extension couldn't provide, and enter
+ * them into the FSM.  The backends inserting into the relation then rarely
+ * need the extension lock at all.
+ *
+ * The extent is at least PREEXTEND_MIN_PAGES, so that the file grows in
+ * reasonably large steps.  But it is kept to half of what would make VACUUM
+ * consider truncating the relation (see should_attempt_truncation()), since
+ * the pages are empty until somebody uses them; otherwise VACUUM would keep
+ * truncating what the next burst of inserts adds again.  Small relations are
+ * therefore never pre-extended.
+ *
+ * If somebody else holds the extension lock, we don't wait for it: they are
+ * extending the relation already.
+ */
+#define PREEXTEND_MIN_PAGES		((1024 * 1024) / BLCKSZ)
+#define PREEXTEND_MAX_PAGES		(REL_TRUNCATE_MINIMUM / 2)
+
+static void
+RelationPreExtend(Relation relation, BlockNumber shortfall)
+{
+	SMgrRelation smgr;
+	BlockNumber first_block;
+	BlockNumber nblocks;
+	Size		freespace = BLCKSZ - SizeOfPageHeaderData;
+
+	if (!ConditionalLockRelationForExtension(relation, ExclusiveLock))
+		return;
+
+	smgr = RelationGetSmgr(relation);
+	first_block = smgrnblocks(smgr, MAIN_FORKNUM);
+
+	nblocks = Max(shortfall, PREEXTEND_MIN_PAGES);
+	nblocks = Min(nblocks, PREEXTEND_MAX_PAGES);
+	nblocks = Min(nblocks, first_block / (2 * REL_TRUNCATE_FRACTION));
+	if (nblocks < PREEXTEND_MIN_PAGES ||
+		(uint64) first_block + nblocks >= MaxBlockNumber)
+	{
+		UnlockRelationForExtension(relation, ExclusiveLock);
+		return;
+	}
+
+	smgrzeroextend(smgr, MAIN_FORKNUM, first_block, nblocks, false);
+
+	UnlockRelationForExtension(relation, ExclusiveLock);
+
+	for (BlockNumber blkno = first_block; blkno < first_block + nblocks; blkno++)
+		RecordPageWithFreeSpace(relation, blkno, freespace);
+
+	FreeSpaceMapVacuumRange(relation, first_block, first_block + nblocks);
+}
+
 /*
  * Extend the relation. By multiple pages, if beneficial.
  *
@@ -226,13 +287,13 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  * benefits with higher numbers. This partially is because copyfrom.c's
  * MAX_BUFFERED_TUPLES / MAX_BUFFERED_BYTES prevents larger multi_inserts.
  *
+ * If more backends are waiting than MAX_BUFFERS_TO_EXTEND_BY pages can serve,
+ * we additionally pre-extend the relation by the remainder, without going
+ * through shared buffers, see RelationPreExtend().
+ *
  * Returns a buffer for a newly extended block. If possible, the buffer is
  * returned exclusively locked. *did_unlock is set to true if the lock had to
  * be released, false otherwise.
- *
- *
- * XXX: It would likely be beneficial for some workloads to extend more
- * aggressively, e.g. using a heuristic based on the relation size.
  */
 static Buffer
 RelationAddBlocks(Relation relation, BulkInsertState bistate,
@@ -243,7 +304,9 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 	BlockNumber first_block = InvalidBlockNumber;
 	BlockNumber last_block = InvalidBlockNumber;
 	uint32		extend_by_pages;
+	uint32		wanted_pages = 0;
 	uint32		not_in_fsm_pages;
+	uint32		waitcount = 0;
 	Buffer		buffer;
 	Page		page;
 
@@ -260,8 +323,6 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 	}
 	else
 	{
-		uint32		waitcount;
-
 		/*
 		 * Try to extend at least by the number of pages the caller needs. We
 		 * can remember the additional pages (either via FSM or bistate).
@@ -270,8 +331,6 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 
 		if (!RELATION_IS_LOCAL(relation))
 			waitcount = RelationExtensionLockWaiterCount(relation);
-		else
-			waitcount = 0;
 
 		/*
 		 * Multiply the number of pages to extend by the number of waiters. Do
@@ -281,6 +340,7 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 		 * bistate->next_free.
 		 */
 		extend_by_pages += extend_by_pages * waitcount;
+		wanted_pages = extend_by_pages;
 
 		/* ---
 		 * If we previously extended using the same bistate, it's very likely
@@ -336,7 +396,8 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 	 *
 	 * With the current MAX_BUFFERS_TO_EXTEND_BY there's no danger of
 	 * [auto]vacuum trying to truncate later pages as REL_TRUNCATE_MINIMUM is
-	 * way larger.
+	 * way larger.  RelationPreExtend() takes care of the same for the pages
+	 * it adds.
 	 */
 	first_block = ExtendBufferedRelBy(BMR_REL(relation), MAIN_FORKNUM,
 									  bistate ? bistate->strategy : NULL,
@@ -406,6 +467,14 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 		FreeSpaceMapVacuumRange(relation, first_fsm_block, last_block);
 	}
 
+	/*
+	 * The pages extended by above already account for the backends that
+	 * were queued up on the extension lock.  Only if MAX_BUFFERS_TO_EXTEND_BY
+	 * cut that short, pre-extend by what's missing.
+	 */
+	if (use_fsm && waitcount > 1 && wanted_pages > extend_by_pages)
+		RelationPreExtend(relation, wanted_pages - extend_by_pages);
+
 	if (bistate)
 	{
 		/*
@@ -43,6 +43,8 @@ typedef struct
 	bool		mark_unused_now;
 	/* whether to attempt freezing tuples */
 	bool		freeze;
+	/* whether caller holds a cleanup lock, so that we can defragment */
+	bool		cleanup_lock;
 	struct VacuumCutoffs *cutoffs;
 
 	/*-------------------------------------------------------
@@ -182,7 +184,10 @@ static void page_verify_redirects(Page page);
  *
  * This is an opportunistic function.  It will perform housekeeping
  * only if the page heuristically looks like a candidate for pruning and we
- * can acquire buffer cleanup lock without blocking.
+ * can acquire a buffer lock without blocking.  If we get a cleanup lock, the
+ * page is defragmented as well.  If other backends have the page pinned, we
+ * settle for an ordinary exclusive lock and only update line pointers,
+ * leaving the defragmentation to a later visit (see README.HOT).
  *
  * Note: this is called quite often.  It's important that it fall out quickly
  * if there's not any use in pruning.
@@ -195,6 +200,7 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	Page		page = BufferGetPage(buffer);
 	TransactionId prune_xid;
 	GlobalVisState *vistest;
+	bool		can_prune;
 	Size		minfree;
 
 	/*
@@ -211,16 +217,22 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	 * (i.e. no updates/deletes left potentially dead tuples around).
 	 */
 	prune_xid = ((PageHeader) page)->pd_prune_xid;
-	if (!TransactionIdIsValid(prune_xid))
+	if (!TransactionIdIsValid(prune_xid) && !PageNeedsDefrag(page))
 		return;
 
 	/*
 	 * Check whether prune_xid indicates that there may be dead rows that can
-	 * be cleaned up.
+	 * be cleaned up.  A page that was pruned earlier without being
+	 * defragmented is still worth a visit if we can get a cleanup lock, but
+	 * only once an UPDATE has failed to find room on it.  Until then nobody
+	 * is asking for the space, and a page that is always pinned would have
+	 * us try for the cleanup lock on every access.
 	 */
 	vistest = GlobalVisTestFor(relation);
 
-	if (!GlobalVisTestIsRemovableXid(vistest, prune_xid))
+	can_prune = TransactionIdIsValid(prune_xid) &&
+		GlobalVisTestIsRemovableXid(vistest, prune_xid);
+	if (!can_prune && !(PageNeedsDefrag(page) && PageIsFull(page)))
 		return;
 
 	/*
@@ -241,9 +253,31 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 
 	if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
 	{
-		/* OK, try to get exclusive buffer lock */
-		if (!ConditionalLockBufferForCleanup(buffer))
+		int			options = 0;
+
+		/*
+		 * OK, try to get exclusive buffer lock.  If someone else has the page
+		 * pinned, so that the lock is not a cleanup lock, prune without
+		 * moving any tuple data.
+		 */
+		if (!ConditionalLockBuffer(buffer))
 			return;
+		if (!IsBufferCleanupOK(buffer))
+		{
+			if (!can_prune)
+			{
+				/*
+				 * Defragmenting was all we had to do.  Clear the "page is
+				 * full" hint, so that we don't try again until another
+				 * UPDATE fails to find room on the page.
+				 */
+				PageClearFull(page);
+				MarkBufferDirtyHint(buffer, true);
+				LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+				return;
+			}
+			options |= HEAP_PAGE_PRUNE_NO_CLEANUP_LOCK;
+		}
 
 		/*
 		 * Now that we have buffer lock, get accurate information about the
@@ -260,7 +294,7 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 			 * not the relation has indexes, since we cannot safely determine
 			 * that during on-access pruning with the current implementation.
 			 */
-			heap_page_prune_and_freeze(relation, buffer, vistest, 0,
+			heap_page_prune_and_freeze(relation, buffer, vistest, options,
 									   NULL, &presult, PRUNE_ON_ACCESS, &dummy_off_loc, NULL, NULL);
 
 			/*
@@ -298,7 +332,8 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
  * Prune and repair fragmentation and potentially freeze tuples on the
  * specified page.
  *
- * Caller must have pin and buffer cleanup lock on the page.  Note that we
+ * Caller must have pin and buffer cleanup lock on the page, unless the
+ * HEAP_PAGE_PRUNE_NO_CLEANUP_LOCK option is set.  Note that we
  * don't update the FSM information for page on caller's behalf.  Caller might
  * also need to account for a reduction in the length of the line pointer
  * array following array truncation by us.
@@ -323,6 +358,12 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
  *   FREEZE indicates that we will also freeze tuples, and will return
  *   'all_visible', 'all_frozen' flags to the caller.
  *
+ *   NO_CLEANUP_LOCK indicates that the caller holds only an ordinary
+ *   exclusive lock.  Line pointers are updated as usual, but tuple data is
+ *   left in place for backends that still have the page pinned, and the page
+ *   is marked PD_NEEDS_DEFRAG instead of being defragmented.  Cannot be
+ *   combined with FREEZE.
+ *
  * cutoffs contains the freeze cutoffs, established by VACUUM at the beginning
  * of vacuuming the relation.  Required if HEAP_PRUNE_FREEZE option is set.
  *
@@ -371,7 +412,9 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 	prstate.vistest = vistest;
 	prstate.mark_unused_now = (options & HEAP_PAGE_PRUNE_MARK_UNUSED_NOW) != 0;
 	prstate.freeze = (options & HEAP_PAGE_PRUNE_FREEZE) != 0;
+	prstate.cleanup_lock = (options & HEAP_PAGE_PRUNE_NO_CLEANUP_LOCK) == 0;
 	prstate.cutoffs = cutoffs;
+	Assert(prstate.cleanup_lock || !prstate.freeze);
 
 	/*
 	 * Our strategy is to scan the page and make lists of items to change,
@@ -652,9 +695,15 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 	/* Clear the offset information once we have processed the given page. */
 	*off_loc = InvalidOffsetNumber;
 
+	/*
+	 * Space left behind by an earlier prune without a cleanup lock is
+	 * reclaimed by the next prune that has one, even if it has no line
+	 * pointers of its own to change.
+	 */
 	do_prune = prstate.nredirected > 0 ||
 		prstate.ndead > 0 ||
-		prstate.nunused > 0;
+		prstate.nunused > 0 ||
+		(prstate.cleanup_lock && PageNeedsDefrag(page));
 
 	/*
 	 * Even if we don't prune anything, if we found a new value for the
@@ -697,10 +746,16 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 			if (prstate.all_visible && prstate.all_frozen && prstate.nfrozen > 0)
 			{
 				/*
-				 * Freezing would make the page all-frozen.  Have already
-				 * emitted an FPI or will do so anyway?
+				 * Freezing would make the page all-frozen.  Has the page
+				 * gone unmodified through the last few VACUUMs, so that it
+				 * will likely stay frozen?  (See vacuum_get_cutoffs().)
+				 * Otherwise, have already emitted an FPI or will do so
+				 * anyway?
 				 */
-				if (RelationNeedsWAL(relation))
+				if (!XLogRecPtrIsInvalid(prstate.cutoffs->StablePageLSN) &&
+					PageGetLSN(page) < prstate.cutoffs->StablePageLSN)
+					do_freeze = true;
+				else if (RelationNeedsWAL(relation))
 				{
 					if (hint_bit_fpi)
 						do_freeze = true;
@@ -780,7 +835,7 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 		/* Apply the planned item changes and repair page fragmentation. */
 		if (do_prune)
 		{
-			heap_page_prune_execute(buffer, false,
+			heap_page_prune_execute(buffer, prstate.cleanup_lock,
 									prstate.redirected, prstate.nredirected,
 									prstate.nowdead, prstate.ndead,
 									prstate.nowunused, prstate.nunused);
@@ -834,7 +889,7 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 
 			log_heap_prune_and_freeze(relation, buffer,
 									  conflict_xid,
-									  true, reason,
+									  prstate.cleanup_lock, reason,
 									  prstate.frozen, prstate.nfrozen,
 									  prstate.redirected, prstate.nredirected,
 									  prstate.nowdead, prstate.ndead,
@@ -1529,15 +1584,16 @@ heap_prune_record_unchanged_lp_redirect(PruneState *prstate, OffsetNumber offnum
 /*
  * Perform the actual page changes needed by heap_page_prune_and_freeze().
  *
- * If 'lp_truncate_only' is set, we are merely marking LP_DEAD line pointers
- * as unused, not redirecting or removing anything else.  The
- * PageRepairFragmentation() call is skipped in that case.
- *
- * If 'lp_truncate_only' is not set, the caller must hold a cleanup lock on
- * the buffer.  If it is set, an ordinary exclusive lock suffices.
+ * If 'cleanup_lock' is set, the caller holds a cleanup lock on the buffer,
+ * and we finish by repairing page fragmentation.  Otherwise an ordinary
+ * exclusive lock suffices: we only update line pointers, leaving tuple data
+ * where it is, since other backends may still be looking at it.  Tuple space
+ * that is no longer referenced is then reclaimed by the next call that has a
+ * cleanup lock, which is why the page is marked PD_NEEDS_DEFRAG.  VACUUM's
+ * second pass (marking LP_DEAD items unused) is replayed that way, too.
  */
 void
-heap_page_prune_execute(Buffer buffer, bool lp_truncate_only,
+heap_page_prune_execute(Buffer buffer, bool cleanup_lock,
 						OffsetNumber *redirected, int nredirected,
 						OffsetNumber *nowdead, int ndead,
 						OffsetNumber *nowunused, int nunused)
@@ -1545,12 +1601,11 @@ heap_page_prune_execute(Buffer buffer, bool lp_truncate_only,
 	Page		page = (Page) BufferGetPage(buffer);
 	OffsetNumber *offnum;
 	HeapTupleHeader htup PG_USED_FOR_ASSERTS_ONLY;
+	bool		freed_storage = false;
 
 	/* Shouldn't be called unless there's something to do */
-	Assert(nredirected > 0 || ndead > 0 || nunused > 0);
-
-	/* If 'lp_truncate_only', we can only remove already-dead line pointers */
-	Assert(!lp_truncate_only || (nredirected == 0 && ndead == 0));
+	Assert(nredirected > 0 || ndead > 0 || nunused > 0 ||
+		   (cleanup_lock && PageNeedsDefrag(page)));
 
 	/* Update all redirected line pointers */
 	offnum = redirected;
@@ -1606,6 +1661,8 @@ heap_page_prune_execute(Buffer buffer, bool lp_truncate_only,
 		Assert(HeapTupleHeaderIsHeapOnly(htup));
 #endif
 
+		if (ItemIdHasStorage(fromlp))
+			freed_storage = true;
 		ItemIdSetRedirect(fromlp, tooff);
 	}
 
@@ -1638,6 +1695,8 @@ heap_page_prune_execute(Buffer buffer, bool lp_truncate_only,
 		}
 #endif
 
+		if (ItemIdHasStorage(lp))
+			freed_storage = true;
 		ItemIdSetDead(lp);
 	}
 
@@ -1650,52 +1709,65 @@ heap_page_prune_execute(Buffer buffer, bool lp_truncate_only,
 
 #ifdef USE_ASSERT_CHECKING
 
-		if (lp_truncate_only)
+		/*
+		 * When heap_page_prune_and_freeze() was called, mark_unused_now may
+		 * have been passed as true, which allows would-be LP_DEAD items to be
+		 * made LP_UNUSED instead.  This is only possible if the relation has
+		 * no indexes.  If there are any dead items, then mark_unused_now was
+		 * not true and every item being marked LP_UNUSED must refer to a
+		 * heap-only tuple.  (In VACUUM's second pass, every item is LP_DEAD
+		 * already.)
+		 */
+		if (ndead > 0)
 		{
-			/* Setting LP_DEAD to LP_UNUSED in vacuum's second pass */
-			Assert(ItemIdIsDead(lp) && !ItemIdHasStorage(lp));
+			Assert(ItemIdHasStorage(lp) && ItemIdIsNormal(lp));
+			htup = (HeapTupleHeader) PageGetItem(page, lp);
+			Assert(HeapTupleHeaderIsHeapOnly(htup));
 		}
 		else
-		{
-			/*
-			 * When heap_page_prune_and_freeze() was called, mark_unused_now
-			 * may have been passed as true, which allows would-be LP_DEAD
-			 * items to be made LP_UNUSED instead.  This is only possible if
-			 * the relation has no indexes.  If there are any dead items, then
-			 * mark_unused_now was not true and every item being marked
-			 * LP_UNUSED must refer to a heap-only tuple.
-			 */
-			if (ndead > 0)
-			{
-				Assert(ItemIdHasStorage(lp) && ItemIdIsNormal(lp));
-				htup = (HeapTupleHeader) PageGetItem(page, lp);
-				Assert(HeapTupleHeaderIsHeapOnly(htup));
-			}
-			else
-				Assert(ItemIdIsUsed(lp));
-		}
+			Assert(ItemIdIsUsed(lp));
 
 #endif
 
+		if (ItemIdHasStorage(lp))
+			freed_storage = true;
 		ItemIdSetUnused(lp);
 	}
 
-	if (lp_truncate_only)
-		PageTruncateLinePointerArray(page);
-	else
+	if (cleanup_lock)
 	{
 		/*
 		 * Finally, repair any fragmentation, and update the page's hint bit
 		 * about whether it has free pointers.
 		 */
 		PageRepairFragmentation(page);
-
+	}
+	else
+	{
 		/*
-		 * Now that the page has been modified, assert that redirect items
-		 * still point to valid targets.
+		 * Tuple data must stay put.  We can still get rid of unused line
+		 * pointers at the end of the array, since nobody can be interested
+		 * in those anymore, but any storage that we just released stays
+		 * allocated until the page is next pruned with a cleanup lock.
 		 */
-		page_verify_redirects(page);
+		if (nunused > 0)
+		{
+			/*
+			 * Let PageAddItem() reuse the line pointers we just freed.
+			 * Truncating the array clears the hint again if none are left.
+			 */
+			PageSetHasFreeLinePointers(page);
+			PageTruncateLinePointerArray(page);
+		}
+		if (freed_storage)
+			PageSetNeedsDefrag(page);
 	}
+
+	/*
+	 * Now that the page has been modified, assert that redirect items still
+	 * point to valid targets.
+	 */
+	page_verify_redirects(page);
 }
 
 
@@ -2019,10 +2091,10 @@ heap_log_freeze_plan(HeapTupleFreeze *tuples, int ntuples,
  * They have enough commonalities that we use a single WAL record for them
  * all.
  *
- * If replaying the record requires a cleanup lock, pass cleanup_lock = true.
- * Replaying 'redirected' or 'dead' items always requires a cleanup lock, but
- * replaying 'unused' items depends on whether they were all previously marked
- * as dead.
+ * If the page was modified under a cleanup lock, pass cleanup_lock = true.
+ * Replay then takes a cleanup lock too, and defragments the page just like
+ * heap_page_prune_execute() did.  Without it, replay only updates line
+ * pointers, leaving tuple data in place for concurrent readers on a standby.
  *
  * Note: This function scribbles on the 'frozen' array.
  *
@@ -2121,11 +2193,6 @@ log_heap_prune_and_freeze(Relation relation, Buffer buffer,
 		xlrec.flags |= XLHP_HAS_CONFLICT_HORIZON;
 	if (cleanup_lock)
 		xlrec.flags |= XLHP_CLEANUP_LOCK;
-	else
-	{
-		Assert(nredirected == 0 && ndead == 0);
-		/* also, any items in 'unused' must've been LP_DEAD previously */
-	}
 	XLogRegisterData((char *) &xlrec, SizeOfHeapPrune);
 	if (TransactionIdIsValid(conflict_xid))
 		XLogRegisterData((char *) &conflict_xid, sizeof(TransactionId));
@@ -20,6 +20,13 @@
  * that there only needs to be one call to lazy_vacuum, after the initial pass
  * completes.
  *
+ * In a parallel VACUUM of a large enough table, the initial pass is shared
+ * between the leader and the parallel vacuum workers.  Each participant
+ * claims a chunk of blocks at a time and adds the TIDs it collects to the
+ * shared TID store.  When the store fills up, all participants stop claiming
+ * blocks, and the leader performs a round of index and heap vacuuming before
+ * relaunching the workers to scan the remaining blocks.
+ *
  * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -41,6 +48,7 @@
 #include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xlog.h"
 #include "access/xloginsert.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
@@ -55,22 +63,13 @@
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/spin.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
 #include "utils/timestamp.h"
 
 
-/*
- * Space/time tradeoff parameters: do these need to be user-tunable?
- *
- * To consider truncating the relation, we want there to be at least
- * REL_TRUNCATE_MINIMUM or (relsize / REL_TRUNCATE_FRACTION) (whichever
- * is less) potentially-freeable pages.
- */
-#define REL_TRUNCATE_MINIMUM	1000
-#define REL_TRUNCATE_FRACTION	16
-
 /*
  * Timing parameters for truncate locking heuristics.
  *
@@ -110,6 +109,14 @@
  */
 #define SKIP_PAGES_THRESHOLD	((BlockNumber) 32)
 
+/*
+ * When vacuum_freeze_stable_cycles is in effect, a non-aggressive VACUUM
+ * scans up to this fraction of the pages that are all-visible but not
+ * all-frozen, instead of skipping them, so that the ones that have been left
+ * alone long enough get frozen.  Successive VACUUMs get around to the rest.
+ */
+#define STABLE_SCAN_FRACTION	0.2
+
 /*
  * Size of the prefetch window for lazy vacuum backwards truncation scan.
  * Needs to be a power of 2.
@@ -122,6 +129,12 @@
  */
 #define ParallelVacuumIsActive(vacrel) ((vacrel)->pvs != NULL)
 
+/*
+ * Number of blocks a participant in a parallel heap scan claims at a time.
+ * Large enough for the OS to recognize the access pattern as sequential.
+ */
+#define PARALLEL_SCAN_CHUNK_PAGES	((BlockNumber) 256)
+
 /* Phases of vacuum during which we report error context. */
 typedef enum
 {
@@ -133,6 +146,90 @@ typedef enum
 	VACUUM_ERRCB_PHASE_TRUNCATE,
 } VacErrPhase;
 
+/*
+ * Counters maintained by each parallel vacuum worker during its part of the
+ * first heap pass.  The leader adds them to its own LVRelState counters.
+ */
+typedef struct LVScanCounters
+{
+	TransactionId NewRelfrozenXid;
+	MultiXactId NewRelminMxid;
+	bool		skippedallvis;
+
+	BlockNumber scanned_pages;
+	BlockNumber frozen_pages;
+	BlockNumber lpdead_item_pages;
+	BlockNumber missed_dead_pages;
+	BlockNumber nonempty_pages;
+
+	uint64		freeze_wal_bytes;
+	int64		tuples_deleted;
+	int64		tuples_frozen;
+	int64		lpdead_items;
+	int64		live_tuples;
+	int64		recently_dead_tuples;
+	int64		missed_dead_tuples;
+} LVScanCounters;
+
+/*
+ * Shared state of a parallel first heap pass.  This lives in the parallel
+ * vacuum DSM segment.  The leader fills in the description of the VACUUM
+ * operation once; workers only read it.
+ *
+ * Participants claim PARALLEL_SCAN_CHUNK_PAGES blocks at a time by advancing
+ * next_block.  When dead_items fills up in the middle of a chunk, the
+ * participant gives back the rest of it as an unfinished range, and stops.
+ * The unfinished ranges are handed out again before any new chunks, so a
+ * block before next_block has been scanned once all participants are done,
+ * unless it's in one of them.
+ *
+ * Since new chunks are only claimed while there are no unfinished ranges,
+ * each participant accounts for at most one range, either one it is scanning
+ * or one it has given back.  The unfinished array therefore only needs room
+ * for as many ranges as there can be participants.
+ */
+typedef struct LVScanRange
+{
+	BlockNumber start;
+	BlockNumber end;			/* exclusive */
+} LVScanRange;
+
+typedef struct LVParallelScanState
+{
+	struct VacuumCutoffs cutoffs;
+	GlobalVisState vistest;
+	bool		aggressive;
+	bool		skipwithvm;
+	int			nindexes;
+	BlockNumber rel_pages;
+
+	/* Set by the leader before each round of scanning */
+	bool		do_index_vacuuming;
+
+	/* Pages left to spend on all-visible pages; protected by mutex */
+	BlockNumber stable_scan_budget;
+
+	/* Next block to hand out */
+	pg_atomic_uint64 next_block;
+
+	/* Counters of the workers that finished the current round */
+	slock_t		mutex;
+	LVScanCounters counters;
+
+	/* Ranges given back unscanned; protected by mutex */
+	int			max_unfinished;
+	int			nunfinished;
+	LVScanRange unfinished[FLEXIBLE_ARRAY_MEMBER];
+} LVParallelScanState;
+
+/*
+ * Size of LVParallelScanState.  There are never more participants than
+ * max_parallel_maintenance_workers plus the leader.
+ */
+#define PARALLEL_SCAN_STATE_SIZE \
+	add_size(offsetof(LVParallelScanState, unfinished), \
+			 mul_size(max_parallel_maintenance_workers + 1, sizeof(LVScanRange)))
+
 typedef struct LVRelState
 {
 	/* Target heap relation and its indexes */
@@ -143,6 +240,8 @@ typedef struct LVRelState
 	/* Buffer access strategy and parallel vacuum state */
 	BufferAccessStrategy bstrategy;
 	ParallelVacuumState *pvs;
+	/* Parallel first heap pass state (NULL if we scan the heap alone) */
+	LVParallelScanState *pscan;
 
 	/* Aggressive VACUUM? (must set relfrozenxid >= FreezeLimit) */
 	bool		aggressive;
@@ -159,6 +258,8 @@ typedef struct LVRelState
 	/* VACUUM operation's cutoffs for freezing and pruning */
 	struct VacuumCutoffs cutoffs;
 	GlobalVisState *vistest;
+	/* All-visible pages we may still scan to freeze them, see above */
+	BlockNumber stable_scan_budget;
 	/* Tracks oldest extant XID/MXID for setting relfrozenxid/relminmxid */
 	TransactionId NewRelfrozenXid;
 	MultiXactId NewRelminMxid;
@@ -191,6 +292,7 @@ typedef struct LVRelState
 	BlockNumber scanned_pages;	/* # pages examined (not skipped via VM) */
 	BlockNumber removed_pages;	/* # pages removed by relation truncation */
 	BlockNumber frozen_pages;	/* # pages with newly frozen tuples */
+	uint64		freeze_wal_bytes;	/* WAL bytes for pages in frozen_pages */
 	BlockNumber lpdead_item_pages;	/* # pages with LP_DEAD items */
 	BlockNumber missed_dead_pages;	/* # pages with missed dead tuples */
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
@@ -212,6 +314,7 @@ typedef struct LVRelState
 	int64		missed_dead_tuples; /* # removable, but not removed */
 
 	/* State maintained by heap_vac_scan_next_block() */
+	BlockNumber scan_end_block; /* end of the range to scan */
 	BlockNumber current_block;	/* last block returned */
 	BlockNumber next_unskippable_block; /* next unskippable block */
 	bool		next_unskippable_allvis;	/* its visibility status */
@@ -229,9 +332,22 @@ typedef struct LVSavedErrInfo
 
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel);
+static bool lazy_scan_heap_page(LVRelState *vacrel, BlockNumber blkno,
+								bool all_visible_according_to_vm,
+								Buffer *vmbuffer);
+static void lazy_scan_heap_parallel(LVRelState *vacrel, Buffer *vmbuffer,
+									BlockNumber *next_fsm_block_to_vacuum);
+static void parallel_lazy_scan_chunks(LVRelState *vacrel, Buffer *vmbuffer);
+static bool parallel_lazy_scan_claim(LVRelState *vacrel, BlockNumber *start,
+									 BlockNumber *end);
+static void parallel_lazy_scan_give_back(LVParallelScanState *pscan,
+										 BlockNumber start, BlockNumber end);
+static void parallel_lazy_scan_skip_to(LVParallelScanState *pscan,
+									   BlockNumber blkno);
 static bool heap_vac_scan_next_block(LVRelState *vacrel, BlockNumber *blkno,
 									 bool *all_visible_according_to_vm);
 static void find_next_unskippable_block(LVRelState *vacrel, bool *skipsallvis);
+static bool claim_stable_scan_page(LVRelState *vacrel);
 static bool lazy_scan_new_or_empty(LVRelState *vacrel, Buffer buf,
 								   BlockNumber blkno, Page page,
 								   bool sharelock, Buffer vmbuffer);
@@ -410,6 +526,7 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	vacrel->scanned_pages = 0;
 	vacrel->removed_pages = 0;
 	vacrel->frozen_pages = 0;
+	vacrel->freeze_wal_bytes = 0;
 	vacrel->lpdead_item_pages = 0;
 	vacrel->missed_dead_pages = 0;
 	vacrel->nonempty_pages = 0;
@@ -466,6 +583,25 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 
 	vacrel->skipwithvm = skipwithvm;
 
+	/*
+	 * If pages that have been left alone for long enough can be frozen (see
+	 * vacuum_get_cutoffs()), a non-aggressive VACUUM must not skip all of
+	 * them just because they're all-visible.  Allow it to scan a share of
+	 * them.
+	 */
+	vacrel->stable_scan_budget = 0;
+	if (!vacrel->aggressive && skipwithvm &&
+		!XLogRecPtrIsInvalid(vacrel->cutoffs.StablePageLSN))
+	{
+		BlockNumber all_visible;
+		BlockNumber all_frozen;
+
+		visibilitymap_count(rel, &all_visible, &all_frozen);
+		if (all_visible > all_frozen)
+			vacrel->stable_scan_budget = (BlockNumber)
+				ceil((all_visible - all_frozen) * STABLE_SCAN_FRACTION);
+	}
+
 	if (verbose)
 	{
 		if (vacrel->aggressive)
@@ -583,12 +719,22 @@ heap_vacuum_rel(Relation rel, VacuumParams *params,
 	 * It seems like a good idea to err on the side of not vacuuming again too
 	 * soon in cases where the failsafe prevented significant amounts of heap
 	 * vacuuming.
+	 *
+	 * The WAL insert position is taken only now, so that the pages that this
+	 * VACUUM itself pruned or marked all-visible don't look recently modified
+	 * to later VACUUMs.  Pages modified concurrently with this VACUUM then
+	 * look older than they are, too, but vacuum_freeze_stable_cycles being a
+	 * count of VACUUMs, that's off by at most one.
 	 */
 	pgstat_report_vacuum(RelationGetRelid(rel),
 						 rel->rd_rel->relisshared,
 						 Max(vacrel->new_live_tuples, 0),
 						 vacrel->recently_dead_tuples +
-						 vacrel->missed_dead_tuples);
+						 vacrel->missed_dead_tuples,
+						 vacrel->frozen_pages,
+						 vacrel->freeze_wal_bytes,
+						 RelationNeedsWAL(rel) ? GetInsertRecPtr() :
+						 InvalidXLogRecPtr);
 	pgstat_progress_end_command();
 
 	if (instrument)
@@ -820,7 +966,6 @@ lazy_scan_heap(LVRelState *vacrel)
 				next_fsm_block_to_vacuum = 0;
 	bool		all_visible_according_to_vm;
 
-	TidStore   *dead_items = vacrel->dead_items;
 	VacDeadItemsInfo *dead_items_info = vacrel->dead_items_info;
 	Buffer		vmbuffer = InvalidBuffer;
 	const int	initprog_index[] = {
@@ -837,180 +982,93 @@ lazy_scan_heap(LVRelState *vacrel)
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/* Initialize for the first heap_vac_scan_next_block() call */
+	vacrel->scan_end_block = rel_pages;
 	vacrel->current_block = InvalidBlockNumber;
 	vacrel->next_unskippable_block = InvalidBlockNumber;
 	vacrel->next_unskippable_allvis = false;
 	vacrel->next_unskippable_vmbuffer = InvalidBuffer;
 
-	while (heap_vac_scan_next_block(vacrel, &blkno, &all_visible_according_to_vm))
+	if (vacrel->pscan != NULL)
 	{
-		Buffer		buf;
-		Page		page;
-		bool		has_lpdead_items;
-		bool		got_cleanup_lock = false;
-
-		vacrel->scanned_pages++;
-
-		/* Report as block scanned, update error traceback information */
-		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
-		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
-								 blkno, InvalidOffsetNumber);
+		/* Share the scan with parallel vacuum workers */
+		lazy_scan_heap_parallel(vacrel, &vmbuffer, &next_fsm_block_to_vacuum);
+		blkno = rel_pages;
+	}
+	else
+	{
+		while (heap_vac_scan_next_block(vacrel, &blkno,
+										&all_visible_according_to_vm))
+		{
+			vacrel->scanned_pages++;
 
-		vacuum_delay_point();
+			/* Report as block scanned, update error traceback information */
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+			update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
+									 blkno, InvalidOffsetNumber);
 
-		/*
-		 * Regularly check if wraparound failsafe should trigger.
-		 *
-		 * There is a similar check inside lazy_vacuum_all_indexes(), but
-		 * relfrozenxid might start to look dangerously old before we reach
-		 * that point.  This check also provides failsafe coverage for the
-		 * one-pass strategy, and the two-pass strategy with the index_cleanup
-		 * param set to 'off'.
-		 */
-		if (vacrel->scanned_pages % FAILSAFE_EVERY_PAGES == 0)
-			lazy_check_wraparound_failsafe(vacrel);
+			vacuum_delay_point();
 
-		/*
-		 * Consider if we definitely have enough space to process TIDs on page
-		 * already.  If we are close to overrunning the available space for
-		 * dead_items TIDs, pause and do a cycle of vacuuming before we tackle
-		 * this page.
-		 */
-		if (TidStoreMemoryUsage(dead_items) > dead_items_info->max_bytes)
-		{
 			/*
-			 * Before beginning index vacuuming, we release any pin we may
-			 * hold on the visibility map page.  This isn't necessary for
-			 * correctness, but we do it anyway to avoid holding the pin
-			 * across a lengthy, unrelated operation.
+			 * Regularly check if wraparound failsafe should trigger.
+			 *
+			 * There is a similar check inside lazy_vacuum_all_indexes(), but
+			 * relfrozenxid might start to look dangerously old before we
+			 * reach that point.  This check also provides failsafe coverage
+			 * for the one-pass strategy, and the two-pass strategy with the
+			 * index_cleanup param set to 'off'.
 			 */
-			if (BufferIsValid(vmbuffer))
-			{
-				ReleaseBuffer(vmbuffer);
-				vmbuffer = InvalidBuffer;
-			}
-
-			/* Perform a round of index and heap vacuuming */
-			vacrel->consider_bypass_optimization = false;
-			lazy_vacuum(vacrel);
+			if (vacrel->scanned_pages % FAILSAFE_EVERY_PAGES == 0)
+				lazy_check_wraparound_failsafe(vacrel);
 
 			/*
-			 * Vacuum the Free Space Map to make newly-freed space visible on
-			 * upper-level FSM pages.  Note we have not yet processed blkno.
+			 * Consider if we definitely have enough space to process TIDs on
+			 * page already.  If we are close to overrunning the available
+			 * space for dead_items TIDs, pause and do a cycle of vacuuming
+			 * before we tackle this page.  (A shared TidStore never reports
+			 * less than one DSA segment in use, which can be more than a low
+			 * maintenance_work_mem, so there must be some items, too.)
 			 */
-			FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
-									blkno);
-			next_fsm_block_to_vacuum = blkno;
-
-			/* Report that we are once again scanning the heap */
-			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
-		}
-
-		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.
-		 */
-		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
-
-		buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
-								 vacrel->bstrategy);
-		page = BufferGetPage(buf);
-
-		/*
-		 * We need a buffer cleanup lock to prune HOT chains and defragment
-		 * the page in lazy_scan_prune.  But when it's not possible to acquire
-		 * a cleanup lock right away, we may be able to settle for reduced
-		 * processing using lazy_scan_noprune.
-		 */
-		got_cleanup_lock = ConditionalLockBufferForCleanup(buf);
-
-		if (!got_cleanup_lock)
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-
-		/* Check for new or empty pages before lazy_scan_[no]prune call */
-		if (lazy_scan_new_or_empty(vacrel, buf, blkno, page, !got_cleanup_lock,
-								   vmbuffer))
-		{
-			/* Processed as new/empty page (lock and pin released) */
-			continue;
-		}
-
-		/*
-		 * If we didn't get the cleanup lock, we can still collect LP_DEAD
-		 * items in the dead_items area for later vacuuming, count live and
-		 * recently dead tuples for vacuum logging, and determine if this
-		 * block could later be truncated. If we encounter any xid/mxids that
-		 * require advancing the relfrozenxid/relminxid, we'll have to wait
-		 * for a cleanup lock and call lazy_scan_prune().
-		 */
-		if (!got_cleanup_lock &&
-			!lazy_scan_noprune(vacrel, buf, blkno, page, &has_lpdead_items))
-		{
-			/*
-			 * lazy_scan_noprune could not do all required processing.  Wait
-			 * for a cleanup lock, and call lazy_scan_prune in the usual way.
-			 */
-			Assert(vacrel->aggressive);
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			got_cleanup_lock = true;
-		}
+			if (dead_items_info->num_items > 0 &&
+				TidStoreMemoryUsage(vacrel->dead_items) > dead_items_info->max_bytes)
+			{
+				/*
+				 * Before beginning index vacuuming, we release any pin we may
+				 * hold on the visibility map page.  This isn't necessary for
+				 * correctness, but we do it anyway to avoid holding the pin
+				 * across a lengthy, unrelated operation.
+				 */
+				if (BufferIsValid(vmbuffer))
+				{
+					ReleaseBuffer(vmbuffer);
+					vmbuffer = InvalidBuffer;
+				}
 
-		/*
-		 * If we have a cleanup lock, we must now prune, freeze, and count
-		 * tuples. We may have acquired the cleanup lock originally, or we may
-		 * have gone back and acquired it after lazy_scan_noprune() returned
-		 * false. Either way, the page hasn't been processed yet.
-		 *
-		 * Like lazy_scan_noprune(), lazy_scan_prune() will count
-		 * recently_dead_tuples and live tuples for vacuum logging, determine
-		 * if the block can later be truncated, and accumulate the details of
-		 * remaining LP_DEAD line pointers on the page into dead_items. These
-		 * dead items include those pruned by lazy_scan_prune() as well as
-		 * line pointers previously marked LP_DEAD.
-		 */
-		if (got_cleanup_lock)
-			lazy_scan_prune(vacrel, buf, blkno, page,
-							vmbuffer, all_visible_according_to_vm,
-							&has_lpdead_items);
+				/* Perform a round of index and heap vacuuming */
+				vacrel->consider_bypass_optimization = false;
+				lazy_vacuum(vacrel);
 
-		/*
-		 * Now drop the buffer lock and, potentially, update the FSM.
-		 *
-		 * Our goal is to update the freespace map the last time we touch the
-		 * page. If we'll process a block in the second pass, we may free up
-		 * additional space on the page, so it is better to update the FSM
-		 * after the second pass. If the relation has no indexes, or if index
-		 * vacuuming is disabled, there will be no second heap pass; if this
-		 * particular page has no dead items, the second heap pass will not
-		 * touch this page. So, in those cases, update the FSM now.
-		 *
-		 * Note: In corner cases, it's possible to miss updating the FSM
-		 * entirely. If index vacuuming is currently enabled, we'll skip the
-		 * FSM update now. But if failsafe mode is later activated, or there
-		 * are so few dead tuples that index vacuuming is bypassed, there will
-		 * also be no opportunity to update the FSM later, because we'll never
-		 * revisit this page. Since updating the FSM is desirable but not
-		 * absolutely required, that's OK.
-		 */
-		if (vacrel->nindexes == 0
-			|| !vacrel->do_index_vacuuming
-			|| !has_lpdead_items)
-		{
-			Size		freespace = PageGetHeapFreeSpace(page);
+				/*
+				 * Vacuum the Free Space Map to make newly-freed space visible
+				 * on upper-level FSM pages.  Note we have not yet processed
+				 * blkno.
+				 */
+				FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
+										blkno);
+				next_fsm_block_to_vacuum = blkno;
 
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+				/* Report that we are once again scanning the heap */
+				pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+											 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+			}
 
 			/*
 			 * Periodically perform FSM vacuuming to make newly-freed space
-			 * visible on upper FSM pages. This is done after vacuuming if the
-			 * table has indexes. There will only be newly-freed space if we
-			 * held the cleanup lock and lazy_scan_prune() was called.
+			 * visible on upper FSM pages.  This is done after vacuuming if
+			 * the table has indexes.
 			 */
-			if (got_cleanup_lock && vacrel->nindexes == 0 && has_lpdead_items &&
+			if (lazy_scan_heap_page(vacrel, blkno, all_visible_according_to_vm,
+									&vmbuffer) &&
+				vacrel->nindexes == 0 &&
 				blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
 			{
 				FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
@@ -1018,8 +1076,6 @@ lazy_scan_heap(LVRelState *vacrel)
 				next_fsm_block_to_vacuum = blkno;
 			}
 		}
-		else
-			UnlockReleaseBuffer(buf);
 	}
 
 	vacrel->blkno = InvalidBlockNumber;
@@ -1064,6 +1120,489 @@ lazy_scan_heap(LVRelState *vacrel)
 		lazy_cleanup_all_indexes(vacrel);
 }
 
+/*
+ *	lazy_scan_heap_page() -- first heap pass processing of one block.
+ *
+ * Prunes, freezes and counts the tuples on the page, and updates the
+ * visibility map and (where appropriate) the FSM.  *vmbuffer is the
+ * caller's pin on a visibility map page, which we keep for the next call.
+ *
+ * Returns true if we pruned away LP_DEAD items and recorded the page's free
+ * space in the FSM.
+ */
+static bool
+lazy_scan_heap_page(LVRelState *vacrel, BlockNumber blkno,
+					bool all_visible_according_to_vm, Buffer *vmbuffer)
+{
+	Buffer		buf;
+	Page		page;
+	bool		has_lpdead_items;
+	bool		got_cleanup_lock = false;
+
+	/*
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.
+	 */
+	visibilitymap_pin(vacrel->rel, blkno, vmbuffer);
+
+	buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+							 vacrel->bstrategy);
+	page = BufferGetPage(buf);
+
+	/*
+	 * We need a buffer cleanup lock to prune HOT chains and defragment the
+	 * page in lazy_scan_prune.  But when it's not possible to acquire a
+	 * cleanup lock right away, we may be able to settle for reduced
+	 * processing using lazy_scan_noprune.
+	 */
+	got_cleanup_lock = ConditionalLockBufferForCleanup(buf);
+
+	if (!got_cleanup_lock)
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+	/* Check for new or empty pages before lazy_scan_[no]prune call */
+	if (lazy_scan_new_or_empty(vacrel, buf, blkno, page, !got_cleanup_lock,
+							   *vmbuffer))
+	{
+		/* Processed as new/empty page (lock and pin released) */
+		return false;
+	}
+
+	/*
+	 * If we didn't get the cleanup lock, we can still collect LP_DEAD items
+	 * in the dead_items area for later vacuuming, count live and recently
+	 * dead tuples for vacuum logging, and determine if this block could later
+	 * be truncated. If we encounter any xid/mxids that require advancing the
+	 * relfrozenxid/relminxid, we'll have to wait for a cleanup lock and call
+	 * lazy_scan_prune().
+	 */
+	if (!got_cleanup_lock &&
+		!lazy_scan_noprune(vacrel, buf, blkno, page, &has_lpdead_items))
+	{
+		/*
+		 * lazy_scan_noprune could not do all required processing.  Wait for a
+		 * cleanup lock, and call lazy_scan_prune in the usual way.
+		 */
+		Assert(vacrel->aggressive);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		got_cleanup_lock = true;
+	}
+
+	/*
+	 * If we have a cleanup lock, we must now prune, freeze, and count tuples.
+	 * We may have acquired the cleanup lock originally, or we may have gone
+	 * back and acquired it after lazy_scan_noprune() returned false. Either
+	 * way, the page hasn't been processed yet.
+	 *
+	 * Like lazy_scan_noprune(), lazy_scan_prune() will count
+	 * recently_dead_tuples and live tuples for vacuum logging, determine if
+	 * the block can later be truncated, and accumulate the details of
+	 * remaining LP_DEAD line pointers on the page into dead_items. These dead
+	 * items include those pruned by lazy_scan_prune() as well as line
+	 * pointers previously marked LP_DEAD.
+	 */
+	if (got_cleanup_lock)
+		lazy_scan_prune(vacrel, buf, blkno, page,
+						*vmbuffer, all_visible_according_to_vm,
+						&has_lpdead_items);
+
+	/*
+	 * Now drop the buffer lock and, potentially, update the FSM.
+	 *
+	 * Our goal is to update the freespace map the last time we touch the
+	 * page. If we'll process a block in the second pass, we may free up
+	 * additional space on the page, so it is better to update the FSM after
+	 * the second pass. If the relation has no indexes, or if index vacuuming
+	 * is disabled, there will be no second heap pass; if this particular page
+	 * has no dead items, the second heap pass will not touch this page. So,
+	 * in those cases, update the FSM now.
+	 *
+	 * Note: In corner cases, it's possible to miss updating the FSM entirely.
+	 * If index vacuuming is currently enabled, we'll skip the FSM update now.
+	 * But if failsafe mode is later activated, or there are so few dead
+	 * tuples that index vacuuming is bypassed, there will also be no
+	 * opportunity to update the FSM later, because we'll never revisit this
+	 * page. Since updating the FSM is desirable but not absolutely required,
+	 * that's OK.
+	 */
+	if (vacrel->nindexes == 0
+		|| !vacrel->do_index_vacuuming
+		|| !has_lpdead_items)
+	{
+		Size		freespace = PageGetHeapFreeSpace(page);
+
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+
+		/*
+		 * There will only be newly-freed space if we held the cleanup lock
+		 * and lazy_scan_prune() was called.
+		 */
+		return got_cleanup_lock && has_lpdead_items;
+	}
+
+	UnlockReleaseBuffer(buf);
+	return false;
+}
+
+/*
+ *	lazy_scan_heap_parallel() -- first heap pass shared with parallel workers.
+ *
+ * The leader sets up the shared scan state, then repeatedly launches the
+ * workers and takes part in the scan itself until either all blocks have
+ * been scanned, or dead_items has filled up.  In the latter case we perform
+ * a round of index and heap vacuuming before relaunching the workers, much
+ * like lazy_scan_heap does in the serial case.
+ *
+ * Only the first heap pass is shared.  The second pass, lazy_vacuum_heap_rel,
+ * is left to the leader: it iterates over dead_items, and TidStore has no
+ * way to split an iteration among processes.  It also visits only the pages
+ * that have LP_DEAD items, and does little more on each than mark them
+ * unused, so it's usually much cheaper than the first pass, or than the
+ * index vacuuming in between, which the workers already share.
+ */
+static void
+lazy_scan_heap_parallel(LVRelState *vacrel, Buffer *vmbuffer,
+						BlockNumber *next_fsm_block_to_vacuum)
+{
+	LVParallelScanState *pscan = vacrel->pscan;
+
+	pscan->cutoffs = vacrel->cutoffs;
+	pscan->vistest = *vacrel->vistest;
+	pscan->aggressive = vacrel->aggressive;
+	pscan->skipwithvm = vacrel->skipwithvm;
+	pscan->nindexes = vacrel->nindexes;
+	pscan->rel_pages = vacrel->rel_pages;
+	pscan->stable_scan_budget = vacrel->stable_scan_budget;
+	pscan->nunfinished = 0;
+	pg_atomic_init_u64(&pscan->next_block, 0);
+	SpinLockInit(&pscan->mutex);
+
+	for (;;)
+	{
+		LVScanCounters *counters = &pscan->counters;
+		BlockNumber next_block;
+		BlockNumber scanned_upto;
+
+		/* Prepare for this round */
+		pscan->do_index_vacuuming = vacrel->do_index_vacuuming;
+		memset(counters, 0, sizeof(LVScanCounters));
+		counters->NewRelfrozenXid = vacrel->cutoffs.OldestXmin;
+		counters->NewRelminMxid = vacrel->cutoffs.OldestMxact;
+
+		parallel_vacuum_heap_scan_begin(vacrel->pvs);
+		parallel_lazy_scan_chunks(vacrel, vmbuffer);
+		parallel_vacuum_heap_scan_end(vacrel->pvs);
+
+		/* Add the workers' counters to ours */
+		if (TransactionIdPrecedes(counters->NewRelfrozenXid,
+								  vacrel->NewRelfrozenXid))
+			vacrel->NewRelfrozenXid = counters->NewRelfrozenXid;
+		if (MultiXactIdPrecedes(counters->NewRelminMxid,
+								vacrel->NewRelminMxid))
+			vacrel->NewRelminMxid = counters->NewRelminMxid;
+		vacrel->skippedallvis |= counters->skippedallvis;
+		vacrel->scanned_pages += counters->scanned_pages;
+		vacrel->frozen_pages += counters->frozen_pages;
+		vacrel->freeze_wal_bytes += counters->freeze_wal_bytes;
+		vacrel->lpdead_item_pages += counters->lpdead_item_pages;
+		vacrel->missed_dead_pages += counters->missed_dead_pages;
+		vacrel->nonempty_pages = Max(vacrel->nonempty_pages,
+									 counters->nonempty_pages);
+		vacrel->tuples_deleted += counters->tuples_deleted;
+		vacrel->tuples_frozen += counters->tuples_frozen;
+		vacrel->lpdead_items += counters->lpdead_items;
+		vacrel->live_tuples += counters->live_tuples;
+		vacrel->recently_dead_tuples += counters->recently_dead_tuples;
+		vacrel->missed_dead_tuples += counters->missed_dead_tuples;
+
+		next_block = (BlockNumber) Min(pg_atomic_read_u64(&pscan->next_block),
+									   (uint64) vacrel->rel_pages);
+		if (next_block >= vacrel->rel_pages && pscan->nunfinished == 0)
+			break;
+
+		/* Every block before this has been processed */
+		scanned_upto = next_block;
+		for (int i = 0; i < pscan->nunfinished; i++)
+			scanned_upto = Min(scanned_upto, pscan->unfinished[i].start);
+
+		/*
+		 * dead_items is full.  Perform a round of index and heap vacuuming,
+		 * without holding on to the visibility map pin meanwhile.
+		 */
+		if (BufferIsValid(*vmbuffer))
+		{
+			ReleaseBuffer(*vmbuffer);
+			*vmbuffer = InvalidBuffer;
+		}
+
+		vacrel->consider_bypass_optimization = false;
+		lazy_vacuum(vacrel);
+
+		if (scanned_upto > *next_fsm_block_to_vacuum)
+		{
+			FreeSpaceMapVacuumRange(vacrel->rel, *next_fsm_block_to_vacuum,
+									scanned_upto);
+			*next_fsm_block_to_vacuum = scanned_upto;
+		}
+
+		/* Report that we are once again scanning the heap */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+	}
+}
+
+/*
+ *	parallel_lazy_scan_chunks() -- scan chunks of a parallel heap scan.
+ *
+ * Used by the leader and the workers alike.  Keeps claiming chunks of blocks
+ * and processing them until either the whole relation has been handed out,
+ * or dead_items is full.  Counters are accumulated in vacrel.
+ */
+static void
+parallel_lazy_scan_chunks(LVRelState *vacrel, Buffer *vmbuffer)
+{
+	LVParallelScanState *pscan = vacrel->pscan;
+	VacDeadItemsInfo *dead_items_info = vacrel->dead_items_info;
+	BlockNumber blkno;
+	bool		all_visible_according_to_vm;
+	BlockNumber start;
+	BlockNumber end;
+	bool		full = false;
+
+	while (!full && parallel_lazy_scan_claim(vacrel, &start, &end))
+	{
+		/*
+		 * Set up heap_vac_scan_next_block() to scan just this range.  This
+		 * relies on start - 1 wrapping around to InvalidBlockNumber for the
+		 * first chunk, like lazy_scan_heap's initialization.
+		 */
+		vacrel->scan_end_block = end;
+		vacrel->current_block = start - 1;
+		vacrel->next_unskippable_block = vacrel->current_block;
+		vacrel->next_unskippable_allvis = false;
+
+		while (heap_vac_scan_next_block(vacrel, &blkno,
+										&all_visible_according_to_vm))
+		{
+			/*
+			 * Once dead_items is full, give back the rest of the range for
+			 * the next round.  Checking before each block, rather than only
+			 * before claiming a chunk, keeps every participant from adding a
+			 * whole chunk's worth of dead items beyond the limit.  The shared
+			 * TidStore never reports less than one DSA segment in use, so
+			 * don't give up until there is at least one dead item, to be sure
+			 * that each round makes progress.
+			 */
+			if (dead_items_info->num_items > 0 &&
+				TidStoreMemoryUsage(vacrel->dead_items) >
+				dead_items_info->max_bytes)
+			{
+				parallel_lazy_scan_give_back(pscan, blkno, end);
+				full = true;
+				break;
+			}
+
+			vacrel->scanned_pages++;
+
+			update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
+									 blkno, InvalidOffsetNumber);
+
+			vacuum_delay_point();
+
+			/*
+			 * Only the leader reports progress and checks the failsafe.  Its
+			 * progress is approximate: we report how far the blocks have
+			 * been handed out.  If the failsafe kicks in, tell the workers
+			 * that index vacuuming is off, so that they record free space
+			 * right away like we do.
+			 */
+			if (!IsParallelWorker())
+			{
+				pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+											 Min(pg_atomic_read_u64(&pscan->next_block),
+												 (uint64) pscan->rel_pages));
+				if (vacrel->scanned_pages % FAILSAFE_EVERY_PAGES == 0 &&
+					lazy_check_wraparound_failsafe(vacrel))
+				{
+					SpinLockAcquire(&pscan->mutex);
+					pscan->do_index_vacuuming = vacrel->do_index_vacuuming;
+					SpinLockRelease(&pscan->mutex);
+				}
+			}
+
+			(void) lazy_scan_heap_page(vacrel, blkno,
+									   all_visible_according_to_vm, vmbuffer);
+		}
+	}
+
+	if (BufferIsValid(vacrel->next_unskippable_vmbuffer))
+	{
+		ReleaseBuffer(vacrel->next_unskippable_vmbuffer);
+		vacrel->next_unskippable_vmbuffer = InvalidBuffer;
+	}
+	vacrel->blkno = InvalidBlockNumber;
+}
+
+/*
+ * Claim the next range of blocks to scan in a parallel heap scan: one that
+ * was given back unfinished, or else a new chunk.  Returns false if there
+ * are no blocks left to hand out.
+ *
+ * This is also where participants pick up the leader's decision to stop
+ * index vacuuming.
+ */
+static bool
+parallel_lazy_scan_claim(LVRelState *vacrel, BlockNumber *start,
+						 BlockNumber *end)
+{
+	LVParallelScanState *pscan = vacrel->pscan;
+	uint64		chunk_start;
+
+	SpinLockAcquire(&pscan->mutex);
+	vacrel->do_index_vacuuming = pscan->do_index_vacuuming;
+	if (pscan->nunfinished > 0)
+	{
+		LVScanRange *range = &pscan->unfinished[--pscan->nunfinished];
+
+		*start = range->start;
+		*end = range->end;
+		SpinLockRelease(&pscan->mutex);
+		return true;
+	}
+	SpinLockRelease(&pscan->mutex);
+
+	chunk_start = pg_atomic_fetch_add_u64(&pscan->next_block,
+										  PARALLEL_SCAN_CHUNK_PAGES);
+	if (chunk_start >= pscan->rel_pages)
+		return false;
+
+	*start = (BlockNumber) chunk_start;
+	*end = (BlockNumber) Min(chunk_start + PARALLEL_SCAN_CHUNK_PAGES,
+							 pscan->rel_pages);
+	return true;
+}
+
+/*
+ * Give back blocks start up to end of a range claimed by
+ * parallel_lazy_scan_claim(), unscanned.
+ */
+static void
+parallel_lazy_scan_give_back(LVParallelScanState *pscan, BlockNumber start,
+							 BlockNumber end)
+{
+	bool		overflow = false;
+
+	SpinLockAcquire(&pscan->mutex);
+	if (pscan->nunfinished < pscan->max_unfinished)
+	{
+		pscan->unfinished[pscan->nunfinished].start = start;
+		pscan->unfinished[pscan->nunfinished].end = end;
+		pscan->nunfinished++;
+	}
+	else
+		overflow = true;
+	SpinLockRelease(&pscan->mutex);
+
+	if (overflow)
+		elog(ERROR, "too many unfinished ranges in parallel heap scan");
+}
+
+/*
+ * Advance a parallel heap scan to blkno, unless it has already gone past it.
+ * Caller has found that all blocks before blkno may be skipped.
+ */
+static void
+parallel_lazy_scan_skip_to(LVParallelScanState *pscan, BlockNumber blkno)
+{
+	uint64		next_block = pg_atomic_read_u64(&pscan->next_block);
+
+	while (next_block < blkno)
+	{
+		if (pg_atomic_compare_exchange_u64(&pscan->next_block, &next_block,
+										   blkno))
+			break;
+	}
+}
+
+/*
+ * Perform a parallel vacuum worker's part of the first heap pass.
+ *
+ * Called from parallel_vacuum_main() with the shared dead_items already
+ * attached to pvs.  We scan chunks of the heap with a private LVRelState
+ * built from the leader's shared description of the VACUUM, and add our
+ * counters to the shared ones for the leader to pick up.
+ */
+void
+heap_parallel_vacuum_scan_worker(Relation rel, ParallelVacuumState *pvs,
+								 BufferAccessStrategy bstrategy)
+{
+	LVParallelScanState *pscan = parallel_vacuum_get_heap_scan(pvs);
+	LVScanCounters *counters = &pscan->counters;
+	LVRelState	vacrel;
+	Buffer		vmbuffer = InvalidBuffer;
+	ErrorContextCallback errcallback;
+
+	Assert(IsParallelWorker());
+
+	memset(&vacrel, 0, sizeof(LVRelState));
+	vacrel.rel = rel;
+	vacrel.nindexes = pscan->nindexes;
+	vacrel.bstrategy = bstrategy;
+	vacrel.pscan = pscan;
+	vacrel.aggressive = pscan->aggressive;
+	vacrel.skipwithvm = pscan->skipwithvm;
+	vacrel.do_index_vacuuming = pscan->do_index_vacuuming;
+	vacrel.cutoffs = pscan->cutoffs;
+	vacrel.vistest = &pscan->vistest;
+	vacrel.NewRelfrozenXid = pscan->cutoffs.OldestXmin;
+	vacrel.NewRelminMxid = pscan->cutoffs.OldestMxact;
+	vacrel.rel_pages = pscan->rel_pages;
+	vacrel.dead_items = parallel_vacuum_get_dead_items(pvs,
+													   &vacrel.dead_items_info);
+
+	/* Setup error traceback support for ereport() */
+	vacrel.relnamespace = get_namespace_name(RelationGetNamespace(rel));
+	vacrel.relname = pstrdup(RelationGetRelationName(rel));
+	vacrel.phase = VACUUM_ERRCB_PHASE_UNKNOWN;
+	errcallback.callback = vacuum_error_callback;
+	errcallback.arg = &vacrel;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	parallel_lazy_scan_chunks(&vacrel, &vmbuffer);
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	SpinLockAcquire(&pscan->mutex);
+	if (TransactionIdPrecedes(vacrel.NewRelfrozenXid,
+							  counters->NewRelfrozenXid))
+		counters->NewRelfrozenXid = vacrel.NewRelfrozenXid;
+	if (MultiXactIdPrecedes(vacrel.NewRelminMxid, counters->NewRelminMxid))
+		counters->NewRelminMxid = vacrel.NewRelminMxid;
+	counters->skippedallvis |= vacrel.skippedallvis;
+	counters->scanned_pages += vacrel.scanned_pages;
+	counters->frozen_pages += vacrel.frozen_pages;
+	counters->freeze_wal_bytes += vacrel.freeze_wal_bytes;
+	counters->lpdead_item_pages += vacrel.lpdead_item_pages;
+	counters->missed_dead_pages += vacrel.missed_dead_pages;
+	counters->nonempty_pages = Max(counters->nonempty_pages,
+								   vacrel.nonempty_pages);
+	counters->tuples_deleted += vacrel.tuples_deleted;
+	counters->tuples_frozen += vacrel.tuples_frozen;
+	counters->lpdead_items += vacrel.lpdead_items;
+	counters->live_tuples += vacrel.live_tuples;
+	counters->recently_dead_tuples += vacrel.recently_dead_tuples;
+	counters->missed_dead_tuples += vacrel.missed_dead_tuples;
+	SpinLockRelease(&pscan->mutex);
+}
+
 /*
  *	heap_vac_scan_next_block() -- get next block for vacuum to process
  *
@@ -1074,7 +1613,9 @@ lazy_scan_heap(LVRelState *vacrel)
  *
  * The block number and visibility status of the next block to process are set
  * in *blkno and *all_visible_according_to_vm.  The return value is false if
- * there are no further blocks to process.
+ * there are no further blocks to process before vacrel->scan_end_block, which
+ * is the end of the relation unless we're scanning one chunk of a parallel
+ * heap scan.
  *
  * vacrel is an in/out parameter here.  Vacuum options and information about
  * the relation are read.  vacrel->skippedallvis is set if we skip a block
@@ -1091,15 +1632,15 @@ heap_vac_scan_next_block(LVRelState *vacrel, BlockNumber *blkno,
 	/* relies on InvalidBlockNumber + 1 overflowing to 0 on first call */
 	next_block = vacrel->current_block + 1;
 
-	/* Have we reached the end of the relation? */
-	if (next_block >= vacrel->rel_pages)
+	/* Have we reached the end of the range to scan? */
+	if (next_block >= vacrel->scan_end_block)
 	{
 		if (BufferIsValid(vacrel->next_unskippable_vmbuffer))
 		{
 			ReleaseBuffer(vacrel->next_unskippable_vmbuffer);
 			vacrel->next_unskippable_vmbuffer = InvalidBuffer;
 		}
-		*blkno = vacrel->rel_pages;
+		*blkno = vacrel->scan_end_block;
 		return false;
 	}
 
@@ -1138,6 +1679,20 @@ heap_vac_scan_next_block(LVRelState *vacrel, BlockNumber *blkno,
 			next_block = vacrel->next_unskippable_block;
 			if (skipsallvis)
 				vacrel->skippedallvis = true;
+
+			/*
+			 * In a parallel heap scan, the range we skip can extend beyond
+			 * the chunk we claimed.  Make sure the other participants don't
+			 * go over the rest of it again.  (The last block of the relation
+			 * is never skipped, so this can't happen otherwise.)
+			 */
+			if (next_block >= vacrel->scan_end_block)
+			{
+				Assert(vacrel->pscan != NULL);
+				parallel_lazy_scan_skip_to(vacrel->pscan, next_block);
+				*blkno = vacrel->scan_end_block;
+				return false;
+			}
 		}
 	}
 
@@ -1235,6 +1790,14 @@ find_next_unskippable_block(LVRelState *vacrel, bool *skipsallvis)
 			if (vacrel->aggressive)
 				break;
 
+			/*
+			 * Scan it anyway if it might have been left alone for long
+			 * enough to be frozen now, as long as the budget lasts.  We
+			 * can't tell before reading it.
+			 */
+			if (claim_stable_scan_page(vacrel))
+				break;
+
 			/*
 			 * All-visible block is safe to skip in non-aggressive case.  But
 			 * remember that the final range contains such a block for later.
@@ -1251,6 +1814,38 @@ find_next_unskippable_block(LVRelState *vacrel, bool *skipsallvis)
 	vacrel->next_unskippable_vmbuffer = next_unskippable_vmbuffer;
 }
 
+/*
+ * Take one page from the budget for scanning all-visible pages that we'd
+ * otherwise skip, and return whether there was any left.  In a parallel heap
+ * scan, the participants share the budget.
+ */
+static bool
+claim_stable_scan_page(LVRelState *vacrel)
+{
+	LVParallelScanState *pscan = vacrel->pscan;
+	bool		claimed = false;
+
+	if (pscan == NULL)
+	{
+		if (vacrel->stable_scan_budget > 0)
+		{
+			vacrel->stable_scan_budget--;
+			claimed = true;
+		}
+		return claimed;
+	}
+
+	SpinLockAcquire(&pscan->mutex);
+	if (pscan->stable_scan_budget > 0)
+	{
+		pscan->stable_scan_budget--;
+		claimed = true;
+	}
+	SpinLockRelease(&pscan->mutex);
+
+	return claimed;
+}
+
 /*
  *	lazy_scan_new_or_empty() -- lazy_scan_heap() new/empty page handling.
  *
@@ -1414,6 +2009,7 @@ lazy_scan_prune(LVRelState *vacrel,
 	Relation	rel = vacrel->rel;
 	PruneFreezeResult presult;
 	int			prune_options = 0;
+	uint64		wal_bytes_before = pgWalUsage.wal_bytes;
 
 	Assert(BufferGetBlockNumber(buf) == blkno);
 
@@ -1450,8 +2046,12 @@ lazy_scan_prune(LVRelState *vacrel,
 		 * We don't increment the frozen_pages instrumentation counter when
 		 * nfrozen == 0, since it only counts pages with newly frozen tuples
 		 * (don't confuse that with pages newly set all-frozen in VM).
+		 *
+		 * The WAL record that froze the tuples may also have pruned the
+		 * page; we count all of it as the cost of freezing.
 		 */
 		vacrel->frozen_pages++;
+		vacrel->freeze_wal_bytes += pgWalUsage.wal_bytes - wal_bytes_before;
 	}
 
 	/*
@@ -2821,12 +3421,22 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 		autovacuum_work_mem != -1 ?
 		autovacuum_work_mem : maintenance_work_mem;
 
+	/*
+	 * Tests can lower the limit below the minimum of the memory settings, to
+	 * make even a small table need several rounds of index vacuuming.
+	 */
+	if (debug_vacuum_dead_items_limit > 0)
+		vac_work_mem = Min(vac_work_mem, debug_vacuum_dead_items_limit);
+
 	/*
 	 * Initialize state for a parallel vacuum.  As of now, only one worker can
-	 * be used for an index, so we invoke parallelism only if there are at
-	 * least two indexes on a table.
+	 * be used for an index, so index processing benefits from parallelism
+	 * only if there are at least two indexes on a table.  But a large table
+	 * with a single index can still have its first heap pass done in
+	 * parallel.  Tables without indexes are always vacuumed serially, since
+	 * they use the one-pass strategy.
 	 */
-	if (nworkers >= 0 && vacrel->nindexes > 1 && vacrel->do_index_vacuuming)
+	if (nworkers >= 0 && vacrel->nindexes > 0 && vacrel->do_index_vacuuming)
 	{
 		/*
 		 * Since parallel workers cannot access data in temporary tables, we
@@ -2848,7 +3458,8 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 											   vacrel->nindexes, nworkers,
 											   vac_work_mem,
 											   vacrel->verbose ? INFO : DEBUG2,
-											   vacrel->bstrategy);
+											   vacrel->bstrategy,
+											   PARALLEL_SCAN_STATE_SIZE);
 
 		/*
 		 * If parallel mode started, dead_items and dead_items_info spaces are
@@ -2858,6 +3469,10 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 		{
 			vacrel->dead_items = parallel_vacuum_get_dead_items(vacrel->pvs,
 																&vacrel->dead_items_info);
+			vacrel->pscan = parallel_vacuum_get_heap_scan(vacrel->pvs);
+			if (vacrel->pscan != NULL)
+				vacrel->pscan->max_unfinished =
+					max_parallel_maintenance_workers + 1;
 			return;
 		}
 	}
@@ -2877,6 +3492,9 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 
 /*
  * Add the given block number and offset numbers to dead_items.
+ *
+ * In a parallel heap scan, other participants are adding to the same shared
+ * dead_items concurrently, so we must hold its lock.
  */
 static void
 dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
@@ -2889,11 +3507,15 @@ dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
 	};
 	int64		prog_val[2];
 
+	TidStoreLockExclusive(dead_items);
 	TidStoreSetBlockOffsets(dead_items, blkno, offsets, num_offsets);
 	vacrel->dead_items_info->num_items += num_offsets;
-
-	/* update the progress information */
 	prog_val[0] = vacrel->dead_items_info->num_items;
+	TidStoreUnlock(dead_items);
+
+	/* update the progress information (workers don't report progress) */
+	if (IsParallelWorker())
+		return;
 	prog_val[1] = TidStoreMemoryUsage(dead_items);
 	pgstat_progress_update_multi_param(2, prog_index, prog_val);
 }
@@ -2909,6 +3531,8 @@ dead_items_reset(LVRelState *vacrel)
 	if (ParallelVacuumIsActive(vacrel))
 	{
 		parallel_vacuum_reset_dead_items(vacrel->pvs);
+		vacrel->dead_items = parallel_vacuum_get_dead_items(vacrel->pvs,
+															&vacrel->dead_items_info);
 		return;
 	}
 
@@ -101,6 +101,7 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 		scan->orderByData = NULL;
 
 	scan->xs_want_itup = false; /* may be set later */
+	scan->xs_warm_recheck = false;	/* likewise */
 
 	/*
 	 * During recovery we ignore killed tuples and don't bother to kill them
@@ -122,6 +123,7 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 	scan->xs_itupdesc = NULL;
 	scan->xs_hitup = NULL;
 	scan->xs_hitupdesc = NULL;
+	scan->xs_batchno = 0;
 
 	return scan;
 }
@@ -31,6 +31,8 @@
  *		index_bulk_delete	- bulk deletion of index tuples
  *		index_vacuum_cleanup	- post-deletion cleanup of an index
  *		index_can_return	- does index support index-only scans?
+ *		index_warm_possible - can the index have stale WARM entries?
+ *		index_warm_eligible - can WARM updates skip the index?
  *		index_getprocid - get a support procedure OID
  *		index_getprocinfo - get a support procedure's lookup info
  *
@@ -44,16 +46,22 @@
 #include "postgres.h"
 
 #include "access/amapi.h"
+#include "access/htup_details.h"
+#include "access/itup.h"
 #include "access/relation.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "catalog/catalog.h"
 #include "catalog/index.h"
+#include "catalog/pg_am_d.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_type.h"
 #include "nodes/execnodes.h"
 #include "pgstat.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -104,6 +112,8 @@ do { \
 			 CppAsString(pname), RelationGetRelationName(scan->indexRelation)); \
 } while(0)
 
+static void index_setup_warm_recheck(IndexScanDesc scan);
+static bool index_warm_keys_match(IndexScanDesc scan, TupleTableSlot *slot);
 static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
@@ -274,6 +284,8 @@ index_beginscan(Relation heapRelation,
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heapRelation);
 
+	index_setup_warm_recheck(scan);
+
 	return scan;
 }
 
@@ -560,6 +572,8 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel, int nkeys,
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heaprel);
 
+	index_setup_warm_recheck(scan);
+
 	return scan;
 }
 
@@ -641,6 +655,17 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	if (found)
 		pgstat_count_heap_fetch(scan->indexRelation);
 
+	/*
+	 * After a WARM update, the index can have an entry for the old and the
+	 * new value of the row, both pointing to the root of the HOT chain.  Only
+	 * return the tuple for the entry that matches it.
+	 */
+	if (found && scan->xs_warm_recheck && !index_warm_keys_match(scan, slot))
+	{
+		ExecClearTuple(slot);
+		found = false;
+	}
+
 	/*
 	 * If we scanned a whole HOT chain and found only dead tuples, tell index
 	 * AM to kill its entry for that TID (this will take effect in the next
@@ -654,6 +679,56 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	return found;
 }
 
+/*
+ * Arrange for index_fetch_heap() to compare index tuples with the heap tuples
+ * they lead to, if WARM updates can leave stale entries in the index.
+ */
+static void
+index_setup_warm_recheck(IndexScanDesc scan)
+{
+	if (index_warm_possible(scan->heapRelation, scan->indexRelation))
+	{
+		scan->xs_want_itup = true;
+		scan->xs_warm_recheck = true;
+	}
+}
+
+/*
+ * Does the index tuple most recently returned by the index AM hold the same
+ * values as the heap tuple in 'slot'?
+ *
+ * index_warm_possible() makes sure that the index only has plain columns of
+ * the same types as the heap, so we can compare the datums directly.
+ */
+static bool
+index_warm_keys_match(IndexScanDesc scan, TupleTableSlot *slot)
+{
+	Form_pg_index index = scan->indexRelation->rd_index;
+	TupleDesc	itupdesc = scan->xs_itupdesc;
+
+	Assert(scan->xs_itup != NULL);
+
+	for (int i = 0; i < index->indnatts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(itupdesc, i);
+		Datum		ivalue;
+		Datum		hvalue;
+		bool		inull;
+		bool		hnull;
+
+		ivalue = index_getattr(scan->xs_itup, i + 1, itupdesc, &inull);
+		hvalue = slot_getattr(slot, index->indkey.values[i], &hnull);
+
+		if (inull != hnull)
+			return false;
+		if (!inull && !datum_image_eq(ivalue, hvalue,
+									  att->attbyval, att->attlen))
+			return false;
+	}
+
+	return true;
+}
+
 /* ----------------
  *		index_getnext_slot - get the next tuple from a scan
  *
@@ -796,6 +871,81 @@ index_can_return(Relation indexRelation, int attno)
 	return indexRelation->rd_indam->amcanreturn(indexRelation, attno);
 }
 
+/* ----------------
+ *		index_warm_possible
+ *
+ *		Can WARM updates of the heap relation have left stale entries in the
+ *		index?  (See README.HOT.)
+ *
+ *		After a WARM update, an index whose columns changed has entries for
+ *		both the old and the new value, and scans must compare each entry
+ *		with the heap tuple it leads to.  So we only allow B-tree indexes on
+ *		plain columns, which store the column values verbatim.  Indexes that
+ *		enforce constraints are not allowed, since their checks don't know
+ *		about stale entries.
+ *
+ *		This depends only on the table's options and the index's definition,
+ *		not on the state of the index in pg_index: DROP INDEX CONCURRENTLY
+ *		and REINDEX CONCURRENTLY clear indisvalid while scans planned before
+ *		that can still be using the index, and those must keep skipping its
+ *		stale entries.
+ * ----------------
+ */
+bool
+index_warm_possible(Relation heapRelation, Relation indexRelation)
+{
+	Form_pg_index index = indexRelation->rd_index;
+	TupleDesc	heapdesc = RelationGetDescr(heapRelation);
+	TupleDesc	indexdesc = RelationGetDescr(indexRelation);
+
+	if (!RelationUsesWarmUpdates(heapRelation) ||
+		IsCatalogRelation(heapRelation))
+		return false;
+
+	if (indexRelation->rd_rel->relam != BTREE_AM_OID ||
+		index->indisunique || index->indisexclusion)
+		return false;
+
+	if (!heap_attisnull(indexRelation->rd_indextuple,
+						Anum_pg_index_indexprs, NULL) ||
+		!heap_attisnull(indexRelation->rd_indextuple,
+						Anum_pg_index_indpred, NULL))
+		return false;
+
+	for (int i = 0; i < index->indnatts; i++)
+	{
+		AttrNumber	attnum = index->indkey.values[i];
+
+		if (attnum <= 0 ||
+			TupleDescAttr(indexdesc, i)->atttypid !=
+			TupleDescAttr(heapdesc, attnum - 1)->atttypid)
+			return false;
+	}
+
+	return true;
+}
+
+/* ----------------
+ *		index_warm_eligible
+ *
+ *		Can a WARM update of the heap relation skip inserting into the index
+ *		when the index's columns didn't change?
+ *
+ *		That takes an index index_warm_possible() accepts, which is neither
+ *		being built nor being dropped.
+ * ----------------
+ */
+bool
+index_warm_eligible(Relation heapRelation, Relation indexRelation)
+{
+	Form_pg_index index = indexRelation->rd_index;
+
+	if (!index->indisvalid || !index->indisready || !index->indislive)
+		return false;
+
+	return index_warm_possible(heapRelation, indexRelation);
+}
+
 /* ----------------
  *		index_getprocid
  *
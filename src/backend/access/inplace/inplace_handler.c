@@ -0,0 +1,1738 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_handler.c
+ *	  in-place update table access method code
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_handler.c
+ *
+ * NOTES
+ *	  The inplace table AM updates rows in place, keeping the versions they
+ *	  replace in undo records; see inplace_internal.h for the storage layout
+ *	  and inplace_modify.c for when an update has to move the row instead.
+ *	  This file contains the table AM callbacks: scans, fetches by TID,
+ *	  index builds, ANALYZE and the DDL-level operations.
+ *
+ *	  A sequential scan copies each data page under a share lock, and then
+ *	  works on the copy, keeping the page pinned meanwhile so that the undo
+ *	  records its rows point to stay around.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/heaptoast.h"
+#include "access/inplace_internal.h"
+#include "access/multixact.h"
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/pg_am_d.h"
+#include "catalog/pg_type.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "commands/progress.h"
+#include "commands/vacuum.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "storage/read_stream.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+
+static const TableAmRoutine inplace_methods;
+
+typedef struct InplaceScanDescData
+{
+	TableScanDescData rs_base;	/* AM independent part of the descriptor */
+
+	BufferAccessStrategy strategy;
+	MemoryContext row_cxt;		/* for the versions of the current row */
+
+	BlockNumber nblocks;		/* number of blocks at the start of the scan */
+	BlockNumber startblock;		/* first block to scan */
+	BlockNumber endblock;		/* block after the last one to scan */
+
+	/* state for parallel scans */
+	ParallelBlockTableScanWorkerData *pbscanwork;
+
+	bool		inited;			/* false = scan not started yet */
+	BlockNumber cblock;			/* current block */
+	Buffer		cbuf;			/* pin on the current block, or invalid */
+	OffsetNumber coffset;		/* current item on 'page' */
+	PGAlignedBlock page;		/* copy of the current block */
+} InplaceScanDescData;
+
+typedef struct InplaceScanDescData *InplaceScanDesc;
+
+typedef struct InplaceIndexFetchData
+{
+	IndexFetchTableData xs_base;	/* AM independent part of the descriptor */
+
+	Buffer		xs_cbuf;		/* current data page, if any */
+} InplaceIndexFetchData;
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks for inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+inplace_slot_callbacks(Relation relation)
+{
+	return &TTSOpsMinimalTuple;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scan callbacks for inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+static TableScanDesc
+inplace_beginscan(Relation relation, Snapshot snapshot,
+				  int nkeys, ScanKey key,
+				  ParallelTableScanDesc parallel_scan,
+				  uint32 flags)
+{
+	InplaceScanDesc scan;
+
+	RelationIncrementReferenceCount(relation);
+
+	scan = (InplaceScanDesc) palloc0(sizeof(InplaceScanDescData));
+
+	/* scan keys are only used by catalog scans, which never come here */
+	scan->rs_base.rs_rd = relation;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = 0;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+
+	scan->row_cxt = AllocSetContextCreate(CurrentMemoryContext,
+										  "inplace scan row",
+										  ALLOCSET_DEFAULT_SIZES);
+	if (flags & (SO_TYPE_SEQSCAN | SO_TYPE_ANALYZE))
+		scan->strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	/* see heap_beginscan() */
+	if (flags & SO_TYPE_SEQSCAN)
+	{
+		Assert(snapshot);
+		PredicateLockRelation(relation, snapshot);
+		pgstat_count_heap_scan(relation);
+	}
+
+	if (parallel_scan != NULL)
+	{
+		scan->pbscanwork = palloc(sizeof(ParallelBlockTableScanWorkerData));
+		scan->nblocks = ((ParallelBlockTableScanDesc) parallel_scan)->phs_nblocks;
+	}
+	else
+		scan->nblocks = RelationGetNumberOfBlocks(relation);
+	scan->startblock = 0;
+	scan->endblock = scan->nblocks;
+	scan->cbuf = InvalidBuffer;
+
+	return (TableScanDesc) scan;
+}
+
+static void
+inplace_endscan(TableScanDesc sscan)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+
+	if (BufferIsValid(scan->cbuf))
+		ReleaseBuffer(scan->cbuf);
+
+	RelationDecrementReferenceCount(scan->rs_base.rs_rd);
+
+	MemoryContextDelete(scan->row_cxt);
+	if (scan->strategy != NULL)
+		FreeAccessStrategy(scan->strategy);
+
+	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->rs_base.rs_snapshot);
+
+	if (scan->pbscanwork)
+		pfree(scan->pbscanwork);
+	pfree(scan);
+}
+
+static void
+inplace_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+			   bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->rs_base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->rs_base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	if (BufferIsValid(scan->cbuf))
+		ReleaseBuffer(scan->cbuf);
+	scan->cbuf = InvalidBuffer;
+	scan->inited = false;
+
+	if (scan->rs_base.rs_parallel == NULL)
+		scan->nblocks = RelationGetNumberOfBlocks(scan->rs_base.rs_rd);
+	scan->startblock = 0;
+	scan->endblock = scan->nblocks;
+}
+
+/*
+ * Restrict a non-parallel scan to 'numblocks' blocks starting at block
+ * 'startblock'.
+ */
+static void
+inplace_scan_set_limits(InplaceScanDesc scan, BlockNumber startblock,
+						BlockNumber numblocks)
+{
+	Assert(!scan->inited);
+	Assert(scan->rs_base.rs_parallel == NULL);
+
+	scan->startblock = Min(startblock, scan->nblocks);
+	if (numblocks > scan->nblocks - scan->startblock)
+		scan->endblock = scan->nblocks;
+	else
+		scan->endblock = scan->startblock + numblocks;
+}
+
+/*
+ * Return the next block to scan in 'direction', or InvalidBlockNumber at the
+ * end of the scan.
+ */
+static BlockNumber
+inplace_scan_next_block(InplaceScanDesc scan, ScanDirection direction)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+	BlockNumber blkno;
+
+	if (pbscan != NULL)
+	{
+		/* parallel scans only go forward */
+		Assert(ScanDirectionIsForward(direction));
+		if (!scan->inited)
+		{
+			table_block_parallelscan_startblock_init(rel, scan->pbscanwork,
+													 pbscan);
+			scan->inited = true;
+		}
+		return table_block_parallelscan_nextpage(rel, scan->pbscanwork,
+												 pbscan);
+	}
+
+	if (ScanDirectionIsBackward(direction))
+	{
+		if (!scan->inited)
+			blkno = scan->endblock;
+		else
+			blkno = scan->cblock;
+		if (blkno <= scan->startblock)
+			return InvalidBlockNumber;
+		blkno--;
+	}
+	else
+	{
+		if (!scan->inited)
+			blkno = scan->startblock;
+		else
+			blkno = scan->cblock + 1;
+		if (blkno >= scan->endblock)
+			return InvalidBlockNumber;
+	}
+
+	return blkno;
+}
+
+/*
+ * Make the pinned block in 'buf' the scan's current one, and take a copy of
+ * it.  Returns whether it is a data page.
+ */
+static bool
+inplace_scan_load_page(InplaceScanDesc scan, Buffer buf)
+{
+	if (BufferIsValid(scan->cbuf))
+		ReleaseBuffer(scan->cbuf);
+	scan->cbuf = buf;
+	scan->cblock = BufferGetBlockNumber(buf);
+
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	memcpy(scan->page.data, BufferGetPage(buf), BLCKSZ);
+	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+	return inplace_is_data_page(scan->page.data);
+}
+
+/*
+ * Move to the next data page in 'direction'.  Returns false at the end of
+ * the scan.
+ */
+static bool
+inplace_scan_next_page(InplaceScanDesc scan, ScanDirection direction)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+
+	for (;;)
+	{
+		BlockNumber blkno;
+		Buffer		buf;
+
+		CHECK_FOR_INTERRUPTS();
+
+		blkno = inplace_scan_next_block(scan, direction);
+		if (blkno == InvalidBlockNumber)
+		{
+			/* like the heap, start over if the direction changes */
+			if (BufferIsValid(scan->cbuf))
+				ReleaseBuffer(scan->cbuf);
+			scan->cbuf = InvalidBuffer;
+			scan->inited = false;
+			return false;
+		}
+		scan->inited = true;
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 scan->strategy);
+		if (inplace_scan_load_page(scan, buf))
+			break;
+	}
+
+	if (ScanDirectionIsBackward(direction))
+		scan->coffset = OffsetNumberNext(PageGetMaxOffsetNumber(scan->page.data));
+	else
+		scan->coffset = InvalidOffsetNumber;
+
+	return true;
+}
+
+/*
+ * Move to the next item in 'direction' that holds a row.  Returns false at
+ * the end of the scan.
+ */
+static bool
+inplace_scan_next_item(InplaceScanDesc scan, ScanDirection direction)
+{
+	Page		page = scan->page.data;
+
+	for (;;)
+	{
+		if (BufferIsValid(scan->cbuf))
+		{
+			OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+			int			offnum = scan->coffset;
+
+			for (;;)
+			{
+				offnum += ScanDirectionIsBackward(direction) ? -1 : 1;
+				if (offnum < FirstOffsetNumber || offnum > maxoff)
+					break;
+				if (ItemIdIsNormal(PageGetItemId(page, offnum)))
+				{
+					scan->coffset = offnum;
+					return true;
+				}
+			}
+		}
+
+		if (!inplace_scan_next_page(scan, direction))
+			return false;
+	}
+}
+
+static bool
+inplace_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					TupleTableSlot *slot)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+
+	while (inplace_scan_next_item(scan, direction))
+	{
+		ItemPointerData tid;
+		InplaceVersion version;
+		InplaceFetchResult result;
+		MemoryContext oldcxt;
+
+		ItemPointerSet(&tid, scan->cblock, scan->coffset);
+
+		MemoryContextReset(scan->row_cxt);
+		oldcxt = MemoryContextSwitchTo(scan->row_cxt);
+		inplace_copy_item(scan->page.data, scan->coffset, &version);
+		result = inplace_resolve_version(rel, &tid, scan->rs_base.rs_snapshot,
+										 &version);
+		MemoryContextSwitchTo(oldcxt);
+
+		if (result == INPLACE_FETCH_OK)
+		{
+			inplace_store_version(rel, &version, &tid, slot);
+			pgstat_count_heap_getnext(rel);
+			return true;
+		}
+	}
+
+	ExecClearTuple(slot);
+	return false;
+}
+
+/*
+ * Return the number of blocks that have been read by this scan since
+ * starting, for progress reporting.  See heapam_scan_get_blocks_done().
+ */
+static BlockNumber
+inplace_scan_get_blocks_done(InplaceScanDesc scan)
+{
+	ParallelBlockTableScanDesc pbscan =
+		(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+	BlockNumber startblock;
+	BlockNumber nblocks;
+
+	if (pbscan != NULL)
+	{
+		startblock = pbscan->phs_startblock;
+		nblocks = pbscan->phs_nblocks;
+	}
+	else
+	{
+		startblock = scan->startblock;
+		nblocks = scan->nblocks;
+	}
+
+	if (scan->cblock >= startblock)
+		return scan->cblock - startblock;
+	return nblocks - startblock + scan->cblock;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks for inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+inplace_index_fetch_begin(Relation rel)
+{
+	InplaceIndexFetchData *scan = palloc0(sizeof(InplaceIndexFetchData));
+
+	scan->xs_base.rel = rel;
+	scan->xs_cbuf = InvalidBuffer;
+
+	return &scan->xs_base;
+}
+
+static void
+inplace_index_fetch_reset(IndexFetchTableData *scan)
+{
+	InplaceIndexFetchData *iscan = (InplaceIndexFetchData *) scan;
+
+	if (BufferIsValid(iscan->xs_cbuf))
+	{
+		ReleaseBuffer(iscan->xs_cbuf);
+		iscan->xs_cbuf = InvalidBuffer;
+	}
+}
+
+static void
+inplace_index_fetch_end(IndexFetchTableData *scan)
+{
+	InplaceIndexFetchData *iscan = (InplaceIndexFetchData *) scan;
+
+	inplace_index_fetch_reset(scan);
+
+	pfree(iscan);
+}
+
+/*
+ * Rows updated in place keep their TID, and moved rows get index entries
+ * of their own, so each index entry leads to exactly one row and there is
+ * never a reason to call us again.
+ */
+static bool
+inplace_index_fetch_tuple(struct IndexFetchTableData *scan,
+						  ItemPointer tid,
+						  Snapshot snapshot,
+						  TupleTableSlot *slot,
+						  bool *call_again, bool *all_dead)
+{
+	InplaceIndexFetchData *iscan = (InplaceIndexFetchData *) scan;
+	Relation	rel = iscan->xs_base.rel;
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	InplaceVersion version;
+
+	*call_again = false;
+
+	if (!BufferIsValid(iscan->xs_cbuf) ||
+		BufferGetBlockNumber(iscan->xs_cbuf) != blkno)
+		iscan->xs_cbuf = ReleaseAndReadBuffer(iscan->xs_cbuf, rel, blkno);
+
+	if (inplace_fetch_version(rel, iscan->xs_cbuf, tid, snapshot, &version,
+							  all_dead) != INPLACE_FETCH_OK)
+		return false;
+
+	PredicateLockTID(rel, tid, snapshot, version.hdr.t_xid);
+	inplace_store_version(rel, &version, tid, slot);
+
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples for inplace
+ * AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+inplace_fetch_row_version(Relation relation,
+						  ItemPointer tid,
+						  Snapshot snapshot,
+						  TupleTableSlot *slot)
+{
+	Buffer		buf;
+	InplaceVersion version;
+	bool		found = false;
+
+	buf = ReadBuffer(relation, ItemPointerGetBlockNumber(tid));
+	if (inplace_fetch_version(relation, buf, tid, snapshot, &version,
+							  NULL) == INPLACE_FETCH_OK)
+	{
+		PredicateLockTID(relation, tid, snapshot, version.hdr.t_xid);
+		inplace_store_version(relation, &version, tid, slot);
+		found = true;
+	}
+	ReleaseBuffer(buf);
+
+	return found;
+}
+
+static bool
+inplace_tuple_tid_valid(TableScanDesc sscan, ItemPointer tid)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+	BlockNumber blkno = ItemPointerGetBlockNumberNoCheck(tid);
+
+	return ItemPointerIsValid(tid) &&
+		blkno != INPLACE_METAPAGE_BLKNO &&
+		blkno < scan->nblocks;
+}
+
+/*
+ * Follow the chain of moves that started at row 'tid', and return the TID
+ * of the last row along it that the scan's snapshot sees.  Rows updated in
+ * place keep their TID, so only moves need to be followed.
+ */
+static void
+inplace_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	Relation	rel = sscan->rs_rd;
+	Snapshot	snapshot = sscan->rs_snapshot;
+	ItemPointerData ctid = *tid;
+
+	for (;;)
+	{
+		Buffer		buf;
+		Page		page;
+		InplaceVersion version;
+		ItemPointerData next;
+		bool		moved;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buf = ReadBuffer(rel, ItemPointerGetBlockNumber(&ctid));
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+		if (inplace_get_item(page, ItemPointerGetOffsetNumber(&ctid)) == NULL)
+		{
+			UnlockReleaseBuffer(buf);
+			break;
+		}
+		inplace_copy_item(page, ItemPointerGetOffsetNumber(&ctid), &version);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		moved = (version.hdr.t_flags & INPLACE_MOVED) &&
+			!ItemPointerIndicatesMovedPartitions(&version.hdr.t_ctid) &&
+			!inplace_version_aborted(&version.hdr);
+		next = version.hdr.t_ctid;
+
+		if (inplace_resolve_version(rel, &ctid, snapshot,
+									&version) == INPLACE_FETCH_OK)
+			*tid = ctid;
+		pfree(version.body);
+		ReleaseBuffer(buf);
+
+		if (!moved)
+			break;
+		ctid = next;
+	}
+}
+
+static bool
+inplace_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								 Snapshot snapshot)
+{
+	Buffer		buf;
+	InplaceVersion version;
+	bool		result = false;
+
+	buf = ReadBuffer(rel, ItemPointerGetBlockNumber(&slot->tts_tid));
+	if (inplace_fetch_version(rel, buf, &slot->tts_tid, snapshot, &version,
+							  NULL) == INPLACE_FETCH_OK)
+	{
+		pfree(version.body);
+		result = true;
+	}
+	ReleaseBuffer(buf);
+
+	return result;
+}
+
+/*
+ * An index entry can be deleted if it points to a dead line pointer, or to
+ * a row that is dead to everyone.
+ */
+static TransactionId
+inplace_index_delete_tuples(Relation rel, TM_IndexDeleteOp *delstate)
+{
+	TransactionId snapshotConflictHorizon = InvalidTransactionId;
+	GlobalVisState *vistest = GlobalVisTestFor(rel);
+	Buffer		buf = InvalidBuffer;
+
+	/*
+	 * Bottom-up deletion looks for old versions of rows whose updates didn't
+	 * change the indexed columns.  Such updates happen in place here and
+	 * don't add index entries, so there is nothing for it to find.
+	 */
+	if (delstate->bottomup)
+	{
+		delstate->ndeltids = 0;
+		return InvalidTransactionId;
+	}
+
+	for (int i = 0; i < delstate->ndeltids; i++)
+	{
+		TM_IndexDelete *ideltid = &delstate->deltids[i];
+		TM_IndexStatus *istatus = delstate->status + ideltid->id;
+		BlockNumber blkno = ItemPointerGetBlockNumber(&ideltid->tid);
+		OffsetNumber offnum = ItemPointerGetOffsetNumber(&ideltid->tid);
+		InplaceTupleHeader hdr;
+		Page		page;
+
+		if (istatus->knowndeletable)
+			continue;
+
+		if (!BufferIsValid(buf) || BufferGetBlockNumber(buf) != blkno)
+		{
+			if (BufferIsValid(buf))
+				UnlockReleaseBuffer(buf);
+			buf = ReadBuffer(rel, blkno);
+			LockBuffer(buf, BUFFER_LOCK_SHARE);
+		}
+		page = BufferGetPage(buf);
+
+		hdr = inplace_get_item(page, offnum);
+		if (hdr == NULL)
+		{
+			if (inplace_is_data_page(page) &&
+				offnum >= FirstOffsetNumber &&
+				offnum <= PageGetMaxOffsetNumber(page) &&
+				ItemIdIsDead(PageGetItemId(page, offnum)))
+				istatus->knowndeletable = true;
+			continue;
+		}
+
+		if (inplace_row_is_dead(hdr, vistest))
+		{
+			istatus->knowndeletable = true;
+			if ((hdr->t_flags & INPLACE_DELETED) &&
+				TransactionIdFollows(hdr->t_xid, snapshotConflictHorizon))
+				snapshotConflictHorizon = hdr->t_xid;
+		}
+	}
+
+	if (BufferIsValid(buf))
+		UnlockReleaseBuffer(buf);
+
+	return snapshotConflictHorizon;
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples for inplace AM.
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+inplace_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					 int options, BulkInsertState bistate)
+{
+	inplace_insert(relation, &slot, 1, cid, options, 0);
+}
+
+static void
+inplace_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					 CommandId cid, int options, BulkInsertState bistate)
+{
+	inplace_insert(relation, slots, ntuples, cid, options, 0);
+}
+
+static void
+inplace_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								 CommandId cid, int options,
+								 BulkInsertState bistate, uint32 specToken)
+{
+	inplace_insert(relation, &slot, 1, cid, options, specToken);
+}
+
+static void
+inplace_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+								   uint32 specToken, bool succeeded)
+{
+	inplace_complete_speculative(relation, &slot->tts_tid, succeeded);
+}
+
+static TM_Result
+inplace_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					 Snapshot snapshot, Snapshot crosscheck, bool wait,
+					 TM_FailureData *tmfd, bool changingPart)
+{
+	return inplace_delete(relation, tid, cid, snapshot, crosscheck, wait,
+						  tmfd, changingPart);
+}
+
+static TM_Result
+inplace_tuple_update(Relation relation, ItemPointer otid,
+					 TupleTableSlot *slot, CommandId cid, Snapshot snapshot,
+					 Snapshot crosscheck, bool wait, TM_FailureData *tmfd,
+					 LockTupleMode *lockmode,
+					 TU_UpdateIndexes *update_indexes)
+{
+	return inplace_update(relation, otid, slot, cid, snapshot, crosscheck,
+						  wait, tmfd, lockmode, update_indexes);
+}
+
+/*
+ * Row locks are always exclusive, whatever 'mode' asks for.
+ */
+static TM_Result
+inplace_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+				   TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+				   LockWaitPolicy wait_policy, uint8 flags,
+				   TM_FailureData *tmfd)
+{
+	return inplace_lock(relation, tid, snapshot, slot, cid, wait_policy,
+						flags, tmfd);
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks for inplace AM.
+ * ------------------------------------------------------------------------
+ */
+
+static void
+inplace_relation_set_new_filelocator(Relation rel,
+									 const RelFileLocator *newrlocator,
+									 char persistence,
+									 TransactionId *freezeXid,
+									 MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/* see heapam_relation_set_new_filelocator() */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrlocator, persistence, true);
+
+	/*
+	 * The metapage is created on first use, so the init fork of an unlogged
+	 * table needs no contents.
+	 */
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrlocator, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+inplace_relation_nontransactional_truncate(Relation rel)
+{
+	RelationTruncate(rel, 0);
+}
+
+static void
+inplace_relation_copy_data(Relation rel, const RelFileLocator *newrlocator)
+{
+	SMgrRelation dstrel;
+
+	/* see heapam_relation_copy_data() */
+	FlushRelationBuffers(rel);
+
+	dstrel = RelationCreateStorage(*newrlocator, rel->rd_rel->relpersistence, true);
+
+	RelationCopyStorage(RelationGetSmgr(rel), dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+
+			if (RelationIsPermanent(rel) ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrlocator, forkNum);
+			RelationCopyStorage(RelationGetSmgr(rel), dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * State of the new relation written by inplace_relation_copy_for_cluster().
+ */
+typedef struct InplaceRewriteData
+{
+	Relation	rel;
+	TransactionId xid_cutoff;	/* freeze rows written before this */
+	Size		saveFreeSpace;	/* free space to leave on each page */
+	Buffer		buf;			/* page being filled, or invalid */
+	GenericXLogState *state;
+	Page		page;
+	int64		tups_written;
+} InplaceRewriteData;
+
+static void
+inplace_rewrite_flush(InplaceRewriteData *rw)
+{
+	if (!BufferIsValid(rw->buf))
+		return;
+
+	GenericXLogFinish(rw->state);
+	UnlockReleaseBuffer(rw->buf);
+	rw->buf = InvalidBuffer;
+}
+
+/*
+ * Append a row to the new relation.  'tup' carries the XID and CID of the
+ * version in its xmin and cmin fields.
+ */
+static void
+inplace_rewrite_tuple(InplaceRewriteData *rw, HeapTuple tup)
+{
+	InplaceTupleHeaderData hdr;
+	MinimalTuple body;
+	Size		size;
+	char	   *item;
+
+	hdr.t_xid = HeapTupleHeaderGetRawXmin(tup->t_data);
+	hdr.t_cid = HeapTupleHeaderGetRawCommandId(tup->t_data);
+	hdr.t_locker = InvalidTransactionId;
+	hdr.t_flags = INPLACE_INSERTED;
+	ItemPointerSetInvalid(&hdr.t_undo);
+	ItemPointerSetInvalid(&hdr.t_ctid);
+
+	/* only our own transaction can be still running */
+	if (TransactionIdIsNormal(hdr.t_xid))
+	{
+		if (TransactionIdPrecedes(hdr.t_xid, rw->xid_cutoff))
+		{
+			hdr.t_xid = FrozenTransactionId;
+			hdr.t_cid = FirstCommandId;
+		}
+		else if (!TransactionIdIsCurrentTransactionId(hdr.t_xid))
+			hdr.t_flags |= INPLACE_XID_COMMITTED;
+	}
+
+	/* toasted values must move to the new relation's TOAST table */
+	body = inplace_prepare_body(rw->rel, tup, NULL,
+								HEAP_INSERT_SKIP_FSM | HEAP_INSERT_NO_LOGICAL);
+	size = inplace_item_size(body);
+
+	if (BufferIsValid(rw->buf) &&
+		PageGetHeapFreeSpace(rw->page) < MAXALIGN(size) + rw->saveFreeSpace)
+		inplace_rewrite_flush(rw);
+
+	if (!BufferIsValid(rw->buf))
+	{
+		rw->buf = inplace_extend(rw->rel);
+		rw->state = GenericXLogStart(rw->rel);
+		rw->page = GenericXLogRegisterBuffer(rw->state, rw->buf,
+											 GENERIC_XLOG_FULL_IMAGE);
+		inplace_init_page(rw->page, INPLACE_PAGE_DATA);
+	}
+
+	item = inplace_form_item(&hdr, body, size);
+	if (PageAddItemExtended(rw->page, item, size, InvalidOffsetNumber,
+							PAI_IS_HEAP) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add row to table \"%s\"",
+			 RelationGetRelationName(rw->rel));
+	pfree(item);
+	pfree(body);
+
+	pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN,
+								 ++rw->tups_written);
+}
+
+/*
+ * VACUUM FULL and CLUSTER.  Only the latest committed version of each row
+ * is kept, so the new relation is not MVCC-safe: a snapshot taken before
+ * the rewrite sees rows that were changed since as if they didn't exist,
+ * and deleted rows are gone for it.  Since that is true of every row
+ * version the rewrite doesn't freeze, rows are always sorted in memory for
+ * CLUSTER, rather than read through the index.
+ */
+static void
+inplace_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								  Relation OldIndex, bool use_sort,
+								  TransactionId OldestXmin,
+								  TransactionId *xid_cutoff,
+								  MultiXactId *multi_cutoff,
+								  double *num_tuples,
+								  double *tups_vacuumed,
+								  double *tups_recently_dead)
+{
+	TableScanDesc sscan;
+	InplaceScanDesc scan;
+	Tuplesortstate *tuplesort = NULL;
+	InplaceRewriteData rw;
+	int64		tups_scanned = 0;
+
+	*num_tuples = 0;
+	*tups_vacuumed = 0;
+	*tups_recently_dead = 0;
+
+	rw.rel = NewTable;
+	rw.xid_cutoff = *xid_cutoff;
+	rw.saveFreeSpace = RelationGetTargetPageFreeSpace(NewTable,
+													  HEAP_DEFAULT_FILLFACTOR);
+	rw.buf = InvalidBuffer;
+	rw.tups_written = 0;
+
+	if (OldIndex != NULL)
+		tuplesort = tuplesort_begin_cluster(RelationGetDescr(OldTable),
+											OldIndex, maintenance_work_mem,
+											NULL, TUPLESORT_NONE);
+
+	pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+								 PROGRESS_CLUSTER_PHASE_SEQ_SCAN_HEAP);
+
+	sscan = table_beginscan(OldTable, SnapshotAny, 0, NULL);
+	scan = (InplaceScanDesc) sscan;
+
+	pgstat_progress_update_param(PROGRESS_CLUSTER_TOTAL_HEAP_BLKS,
+								 scan->nblocks);
+
+	while (inplace_scan_next_item(scan, ForwardScanDirection))
+	{
+		ItemPointerData tid;
+		InplaceVersion version;
+		HeapTuple	tup;
+		MemoryContext oldcxt;
+		bool		keep;
+
+		CHECK_FOR_INTERRUPTS();
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
+									 scan->cblock + 1);
+
+		ItemPointerSet(&tid, scan->cblock, scan->coffset);
+
+		MemoryContextReset(scan->row_cxt);
+		oldcxt = MemoryContextSwitchTo(scan->row_cxt);
+		inplace_copy_item(scan->page.data, scan->coffset, &version);
+		keep = inplace_skip_aborted(OldTable, &tid, &version) &&
+			!(version.hdr.t_flags & INPLACE_DELETED);
+		MemoryContextSwitchTo(oldcxt);
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+									 ++tups_scanned);
+
+		if (!keep)
+		{
+			*tups_vacuumed += 1;
+			continue;
+		}
+
+		tup = heap_tuple_from_minimal_tuple(version.body);
+		HeapTupleHeaderSetXmin(tup->t_data, version.hdr.t_xid);
+		HeapTupleHeaderSetCmin(tup->t_data, version.hdr.t_cid);
+		*num_tuples += 1;
+
+		if (tuplesort != NULL)
+			tuplesort_putheaptuple(tuplesort, tup);
+		else
+			inplace_rewrite_tuple(&rw, tup);
+		heap_freetuple(tup);
+	}
+
+	table_endscan(sscan);
+
+	if (tuplesort != NULL)
+	{
+		HeapTuple	tup;
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_SORT_TUPLES);
+
+		tuplesort_performsort(tuplesort);
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_WRITE_NEW_HEAP);
+
+		while ((tup = tuplesort_getheaptuple(tuplesort, true)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			inplace_rewrite_tuple(&rw, tup);
+		}
+
+		tuplesort_end(tuplesort);
+	}
+
+	inplace_rewrite_flush(&rw);
+}
+
+static void
+inplace_vacuum(Relation rel, VacuumParams *params,
+			   BufferAccessStrategy bstrategy)
+{
+	inplace_vacuum_rel(rel, params, bstrategy);
+}
+
+static bool
+inplace_scan_analyze_next_block(TableScanDesc sscan, ReadStream *stream)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+	Buffer		buf;
+
+	buf = read_stream_next_buffer(stream, NULL);
+	if (!BufferIsValid(buf))
+		return false;
+
+	inplace_scan_load_page(scan, buf);
+	scan->coffset = InvalidOffsetNumber;
+
+	return true;
+}
+
+/*
+ * Rows are counted like heapam_scan_analyze_next_tuple() counts tuples: a
+ * row being deleted by another transaction is live, one being inserted by
+ * another transaction is not counted at all.  A row being updated in place
+ * by another transaction is sampled with the new values.
+ */
+static bool
+inplace_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								double *liverows, double *deadrows,
+								TupleTableSlot *slot)
+{
+	InplaceScanDesc scan = (InplaceScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+	Page		page = scan->page.data;
+	OffsetNumber maxoff;
+
+	if (!inplace_is_data_page(page))
+		goto done;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	while (scan->coffset < maxoff)
+	{
+		ItemId		lp;
+		ItemPointerData tid;
+		InplaceVersion version;
+		InplaceTupleHeader hdr = &version.hdr;
+		MemoryContext oldcxt;
+		bool		sample_it = false;
+
+		scan->coffset++;
+		lp = PageGetItemId(page, scan->coffset);
+		if (ItemIdIsDead(lp))
+		{
+			*deadrows += 1;
+			continue;
+		}
+		if (!ItemIdIsNormal(lp))
+			continue;
+
+		ItemPointerSet(&tid, scan->cblock, scan->coffset);
+
+		MemoryContextReset(scan->row_cxt);
+		oldcxt = MemoryContextSwitchTo(scan->row_cxt);
+		inplace_copy_item(page, scan->coffset, &version);
+		if (!inplace_skip_aborted(rel, &tid, &version))
+			*deadrows += 1;
+		else if (TransactionIdIsNormal(hdr->t_xid) &&
+				 !(hdr->t_flags & INPLACE_XID_COMMITTED) &&
+				 !TransactionIdIsCurrentTransactionId(hdr->t_xid) &&
+				 TransactionIdIsInProgress(hdr->t_xid))
+		{
+			if (!(hdr->t_flags & INPLACE_INSERTED))
+			{
+				sample_it = true;
+				*liverows += 1;
+			}
+		}
+		else if (hdr->t_flags & INPLACE_DELETED)
+			*deadrows += 1;
+		else
+		{
+			sample_it = true;
+			*liverows += 1;
+		}
+		MemoryContextSwitchTo(oldcxt);
+
+		if (sample_it)
+		{
+			inplace_store_version(rel, &version, &tid, slot);
+			return true;
+		}
+	}
+
+done:
+	if (BufferIsValid(scan->cbuf))
+		ReleaseBuffer(scan->cbuf);
+	scan->cbuf = InvalidBuffer;
+
+	ExecClearTuple(slot);
+	return false;
+}
+
+static double
+inplace_index_build_range_scan(Relation tableRelation,
+							   Relation indexRelation,
+							   IndexInfo *indexInfo,
+							   bool allow_sync,
+							   bool anyvisible,
+							   bool progress,
+							   BlockNumber start_blockno,
+							   BlockNumber numblocks,
+							   IndexBuildCallback callback,
+							   void *callback_state,
+							   TableScanDesc scan)
+{
+	InplaceScanDesc iscan;
+	bool		checking_uniqueness;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	double		reltuples;
+	ExprState  *predicate;
+	TupleTableSlot *slot;
+	EState	   *estate;
+	ExprContext *econtext;
+	Snapshot	snapshot;
+	bool		need_unregister_snapshot = false;
+	GlobalVisState *vistest;
+	BlockNumber previous_blkno = InvalidBlockNumber;
+
+	/*
+	 * sanity checks
+	 */
+	Assert(OidIsValid(indexRelation->rd_rel->relam));
+
+	/* See whether we're verifying uniqueness/exclusion properties */
+	checking_uniqueness = (indexInfo->ii_Unique ||
+						   indexInfo->ii_ExclusionOps != NULL);
+
+	/*
+	 * "Any visible" mode is not compatible with uniqueness checks; make sure
+	 * only one of those is requested.
+	 */
+	Assert(!(anyvisible && checking_uniqueness));
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = table_slot_create(tableRelation, NULL);
+
+	/* Arrange for econtext's scan tuple to be the tuple under test */
+	econtext->ecxt_scantuple = slot;
+
+	/* Set up execution state for predicate, if any. */
+	predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+	/*
+	 * As in heapam_index_build_range_scan(), a concurrent build indexes the
+	 * rows its MVCC snapshot sees, and a normal one indexes all rows that
+	 * anyone may still see.
+	 */
+	if (!scan)
+	{
+		if (indexInfo->ii_Concurrent)
+		{
+			snapshot = RegisterSnapshot(GetTransactionSnapshot());
+			need_unregister_snapshot = true;
+		}
+		else
+			snapshot = SnapshotAny;
+
+		scan = table_beginscan_strat(tableRelation,	/* relation */
+									 snapshot,	/* snapshot */
+									 0, /* number of keys */
+									 NULL,	/* scan key */
+									 true,	/* buffer access strategy OK */
+									 allow_sync);	/* syncscan OK? */
+	}
+	else
+	{
+		/*
+		 * Parallel index build.
+		 *
+		 * Parallel case never registers/unregisters own snapshot.  Snapshot
+		 * is taken from parallel scan descriptor.
+		 */
+		Assert(allow_sync);
+		snapshot = scan->rs_snapshot;
+	}
+
+	iscan = (InplaceScanDesc) scan;
+
+	/*
+	 * Must have called GetOldestNonRemovableTransactionId() if using
+	 * SnapshotAny.  Shouldn't have for an MVCC snapshot.
+	 */
+	Assert(snapshot == SnapshotAny || IsMVCCSnapshot(snapshot));
+	vistest = GlobalVisTestFor(tableRelation);
+
+	/* Publish number of blocks to scan */
+	if (progress)
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+									 iscan->nblocks);
+
+	/* set our scan endpoints */
+	if (scan->rs_parallel == NULL)
+		inplace_scan_set_limits(iscan, start_blockno, numblocks);
+	else
+	{
+		/* Parallel scan can't use heap_setscanlimits */
+		Assert(start_blockno == 0);
+		Assert(numblocks == InvalidBlockNumber);
+	}
+
+	reltuples = 0;
+
+	/*
+	 * Scan all rows in the base relation.
+	 */
+	while (inplace_scan_next_item(iscan, ForwardScanDirection))
+	{
+		ItemPointerData tid;
+		InplaceVersion version;
+		InplaceTupleHeader hdr = &version.hdr;
+		MemoryContext oldcxt;
+		bool		indexIt = true;
+		bool		tupleIsAlive = true;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Report scan progress, if asked to. */
+		if (progress && iscan->cblock != previous_blkno)
+		{
+			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+										 inplace_scan_get_blocks_done(iscan));
+			previous_blkno = iscan->cblock;
+		}
+
+		ItemPointerSet(&tid, iscan->cblock, iscan->coffset);
+
+recheck:
+		MemoryContextReset(iscan->row_cxt);
+		oldcxt = MemoryContextSwitchTo(iscan->row_cxt);
+		inplace_copy_item(iscan->page.data, iscan->coffset, &version);
+
+		if (snapshot == SnapshotAny)
+		{
+			/*
+			 * Caller holds ShareLock on the relation, so the only changes
+			 * that may still be in progress are our own transaction's, and
+			 * those of prepared transactions.  In-progress changes are
+			 * indexed since they are good if the index build commits; a
+			 * uniqueness check has to wait for their outcome instead.
+			 */
+			if (!inplace_skip_aborted(tableRelation, &tid, &version))
+				indexIt = false;
+			else if (TransactionIdIsNormal(hdr->t_xid) &&
+					 !(hdr->t_flags & INPLACE_XID_COMMITTED) &&
+					 !TransactionIdIsCurrentTransactionId(hdr->t_xid) &&
+					 TransactionIdIsInProgress(hdr->t_xid))
+			{
+				if (checking_uniqueness)
+				{
+					TransactionId xwait = hdr->t_xid;
+
+					MemoryContextSwitchTo(oldcxt);
+					XactLockTableWait(xwait, tableRelation, &tid,
+									  XLTW_InsertIndexUnique);
+					CHECK_FOR_INTERRUPTS();
+					goto recheck;
+				}
+				tupleIsAlive = !(hdr->t_flags & INPLACE_DELETED);
+				if (!(hdr->t_flags & INPLACE_INSERTED) || anyvisible)
+					reltuples += 1;
+			}
+			else if (hdr->t_flags & INPLACE_DELETED)
+			{
+				/*
+				 * A deleted row must still be indexed if some snapshot may
+				 * see it, but it is excluded from unique checking.
+				 */
+				if (!TransactionIdIsCurrentTransactionId(hdr->t_xid) &&
+					GlobalVisTestIsRemovableXid(vistest, hdr->t_xid))
+					indexIt = false;
+				tupleIsAlive = false;
+			}
+			else
+				reltuples += 1;
+
+			/*
+			 * Older versions of the row in undo may differ in the columns of
+			 * the new index, since updates only kept the columns of the
+			 * existing indexes unchanged.  Like for a broken HOT chain, the
+			 * index must not be used by snapshots that may see them.
+			 */
+			if (indexIt && ItemPointerIsValid(&hdr->t_undo))
+				indexInfo->ii_BrokenHotChain = true;
+		}
+		else
+		{
+			if (inplace_resolve_version(tableRelation, &tid, snapshot,
+										&version) != INPLACE_FETCH_OK)
+				indexIt = false;
+			else
+				reltuples += 1;
+		}
+		MemoryContextSwitchTo(oldcxt);
+
+		if (!indexIt)
+			continue;
+
+		MemoryContextReset(econtext->ecxt_per_tuple_memory);
+
+		/* Set up for predicate or expression evaluation */
+		inplace_store_version(tableRelation, &version, &tid, slot);
+
+		/*
+		 * In a partial index, discard tuples that don't satisfy the
+		 * predicate.
+		 */
+		if (predicate != NULL)
+		{
+			if (!ExecQual(predicate, econtext))
+				continue;
+		}
+
+		/*
+		 * For the current row, extract all the attributes we use in this
+		 * index, and note which are null.  This also performs evaluation of
+		 * any expressions needed.
+		 */
+		FormIndexDatum(indexInfo,
+					   slot,
+					   estate,
+					   values,
+					   isnull);
+
+		/* Call the AM's callback routine to process the tuple */
+		callback(indexRelation, &tid, values, isnull, tupleIsAlive,
+				 callback_state);
+	}
+
+	/* Report scan progress one last time. */
+	if (progress)
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+									 iscan->nblocks);
+
+	table_endscan(scan);
+
+	/* we can now forget our snapshot, if set and registered by us */
+	if (need_unregister_snapshot)
+		UnregisterSnapshot(snapshot);
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	FreeExecutorState(estate);
+
+	/* These may have been pointing to the now-gone estate */
+	indexInfo->ii_ExpressionsState = NIL;
+	indexInfo->ii_PredicateState = NULL;
+
+	return reltuples;
+}
+
+/*
+ * Second pass of CREATE INDEX CONCURRENTLY: insert the rows that 'snapshot'
+ * sees and that are missing from the index.  Unlike the heap, rows never
+ * have to be indexed under another TID, so the scan, which returns rows in
+ * TID order, can be merged with the sorted index TIDs directly.
+ */
+static void
+inplace_index_validate_scan(Relation tableRelation,
+							Relation indexRelation,
+							IndexInfo *indexInfo,
+							Snapshot snapshot,
+							ValidateIndexState *state)
+{
+	TableScanDesc scan;
+	InplaceScanDesc iscan;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	ExprState  *predicate;
+	TupleTableSlot *slot;
+	EState	   *estate;
+	ExprContext *econtext;
+	BlockNumber previous_blkno = InvalidBlockNumber;
+
+	/* state variables for the merge */
+	ItemPointer indexcursor = NULL;
+	ItemPointerData decoded;
+	bool		tuplesort_empty = false;
+
+	/*
+	 * sanity checks
+	 */
+	Assert(OidIsValid(indexRelation->rd_rel->relam));
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = table_slot_create(tableRelation, NULL);
+
+	/* Arrange for econtext's scan tuple to be the tuple under test */
+	econtext->ecxt_scantuple = slot;
+
+	/* Set up execution state for predicate, if any. */
+	predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+	/*
+	 * Prepare for scan of the base relation.  We must disable syncscan here,
+	 * because it's critical that we read from block zero forward to match
+	 * the sorted TIDs.
+	 */
+	scan = table_beginscan_strat(tableRelation,	/* relation */
+								 snapshot,	/* snapshot */
+								 0, /* number of keys */
+								 NULL,	/* scan key */
+								 true,	/* buffer access strategy OK */
+								 false);	/* syncscan not OK */
+	iscan = (InplaceScanDesc) scan;
+
+	pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+								 iscan->nblocks);
+
+	/*
+	 * Scan all rows matching the snapshot.
+	 */
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		ItemPointer tablecursor = &slot->tts_tid;
+
+		CHECK_FOR_INTERRUPTS();
+
+		state->htups += 1;
+
+		if ((previous_blkno == InvalidBlockNumber) ||
+			(iscan->cblock != previous_blkno))
+		{
+			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+										 iscan->cblock);
+			previous_blkno = iscan->cblock;
+		}
+
+		/*
+		 * "merge" by skipping through the index tuples until we find or pass
+		 * the current row.
+		 */
+		while (!tuplesort_empty &&
+			   (!indexcursor ||
+				ItemPointerCompare(indexcursor, tablecursor) < 0))
+		{
+			Datum		ts_val;
+			bool		ts_isnull;
+
+			tuplesort_empty = !tuplesort_getdatum(state->tuplesort, true,
+												  false, &ts_val, &ts_isnull,
+												  NULL);
+			Assert(tuplesort_empty || !ts_isnull);
+			if (!tuplesort_empty)
+			{
+				itemptr_decode(&decoded, DatumGetInt64(ts_val));
+				indexcursor = &decoded;
+			}
+			else
+			{
+				/* Be tidy */
+				indexcursor = NULL;
+			}
+		}
+
+		/*
+		 * If the tuplesort has overshot, then this row is missing from the
+		 * index, so insert it.
+		 */
+		if (tuplesort_empty ||
+			ItemPointerCompare(indexcursor, tablecursor) > 0)
+		{
+			MemoryContextReset(econtext->ecxt_per_tuple_memory);
+
+			/*
+			 * In a partial index, discard tuples that don't satisfy the
+			 * predicate.
+			 */
+			if (predicate != NULL)
+			{
+				if (!ExecQual(predicate, econtext))
+					continue;
+			}
+
+			/*
+			 * For the current row, extract all the attributes we use in this
+			 * index, and note which are null.  This also performs evaluation
+			 * of any expressions needed.
+			 */
+			FormIndexDatum(indexInfo,
+						   slot,
+						   estate,
+						   values,
+						   isnull);
+
+			index_insert(indexRelation,
+						 values,
+						 isnull,
+						 tablecursor,
+						 tableRelation,
+						 indexInfo->ii_Unique ?
+						 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+						 false,
+						 indexInfo);
+
+			state->tups_inserted += 1;
+		}
+	}
+
+	table_endscan(scan);
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	FreeExecutorState(estate);
+
+	/* These may have been pointing to the now-gone estate */
+	indexInfo->ii_ExpressionsState = NIL;
+	indexInfo->ii_PredicateState = NULL;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks for the inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Rows are toasted like heap tuples, so the same rule as in
+ * heapam_relation_needs_toast_table() applies.
+ */
+static bool
+inplace_relation_needs_toast_table(Relation rel)
+{
+	int32		data_length = 0;
+	bool		maxlength_unknown = false;
+	bool		has_toastable_attrs = false;
+	TupleDesc	tupdesc = rel->rd_att;
+	int32		tuple_length;
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			continue;
+		data_length = att_align_nominal(data_length, att->attalign);
+		if (att->attlen > 0)
+		{
+			/* Fixed-length types are never toastable */
+			data_length += att->attlen;
+		}
+		else
+		{
+			int32		maxlen = type_maximum_size(att->atttypid,
+												   att->atttypmod);
+
+			if (maxlen < 0)
+				maxlength_unknown = true;
+			else
+				data_length += maxlen;
+			if (att->attstorage != TYPSTORAGE_PLAIN)
+				has_toastable_attrs = true;
+		}
+	}
+	if (!has_toastable_attrs)
+		return false;			/* nothing to toast? */
+	if (maxlength_unknown)
+		return true;			/* any unlimited-length attrs? */
+	tuple_length = MAXALIGN(SizeofHeapTupleHeader +
+							BITMAPLEN(tupdesc->natts)) +
+		MAXALIGN(data_length);
+	return (tuple_length > TOAST_TUPLE_THRESHOLD);
+}
+
+/*
+ * Values are toasted with the heap's toaster, into a heap TOAST table.
+ */
+static Oid
+inplace_relation_toast_am(Relation rel)
+{
+	return HEAP_TABLE_AM_OID;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks for the inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+#define INPLACE_OVERHEAD_BYTES_PER_TUPLE \
+	(INPLACE_TUPLE_HEADER_SIZE + SizeofMinimalTupleHeader + \
+	 sizeof(ItemIdData))
+#define INPLACE_USABLE_BYTES_PER_PAGE \
+	(BLCKSZ - SizeOfPageHeaderData - MAXALIGN(sizeof(InplacePageOpaqueData)))
+
+static void
+inplace_estimate_rel_size(Relation rel, int32 *attr_widths,
+						  BlockNumber *pages, double *tuples,
+						  double *allvisfrac)
+{
+	table_block_relation_estimate_size(rel, attr_widths, pages,
+									   tuples, allvisfrac,
+									   INPLACE_OVERHEAD_BYTES_PER_TUPLE,
+									   INPLACE_USABLE_BYTES_PER_PAGE);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks for the inplace AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+inplace_scan_sample_next_block(TableScanDesc scan,
+							   SampleScanState *scanstate)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("inplace tables do not support TABLESAMPLE")));
+	return false;				/* keep compiler quiet */
+}
+
+static bool
+inplace_scan_sample_next_tuple(TableScanDesc scan,
+							   SampleScanState *scanstate,
+							   TupleTableSlot *slot)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("inplace tables do not support TABLESAMPLE")));
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the inplace table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine inplace_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = inplace_slot_callbacks,
+
+	.scan_begin = inplace_beginscan,
+	.scan_end = inplace_endscan,
+	.scan_rescan = inplace_rescan,
+	.scan_getnextslot = inplace_getnextslot,
+
+	.parallelscan_estimate = table_block_parallelscan_estimate,
+	.parallelscan_initialize = table_block_parallelscan_initialize,
+	.parallelscan_reinitialize = table_block_parallelscan_reinitialize,
+
+	.index_fetch_begin = inplace_index_fetch_begin,
+	.index_fetch_reset = inplace_index_fetch_reset,
+	.index_fetch_end = inplace_index_fetch_end,
+	.index_fetch_tuple = inplace_index_fetch_tuple,
+
+	.tuple_insert = inplace_tuple_insert,
+	.tuple_insert_speculative = inplace_tuple_insert_speculative,
+	.tuple_complete_speculative = inplace_tuple_complete_speculative,
+	.multi_insert = inplace_multi_insert,
+	.tuple_delete = inplace_tuple_delete,
+	.tuple_update = inplace_tuple_update,
+	.tuple_lock = inplace_tuple_lock,
+
+	.tuple_fetch_row_version = inplace_fetch_row_version,
+	.tuple_get_latest_tid = inplace_get_latest_tid,
+	.tuple_tid_valid = inplace_tuple_tid_valid,
+	.tuple_satisfies_snapshot = inplace_tuple_satisfies_snapshot,
+	.index_delete_tuples = inplace_index_delete_tuples,
+
+	.relation_set_new_filelocator = inplace_relation_set_new_filelocator,
+	.relation_nontransactional_truncate = inplace_relation_nontransactional_truncate,
+	.relation_copy_data = inplace_relation_copy_data,
+	.relation_copy_for_cluster = inplace_relation_copy_for_cluster,
+	.relation_vacuum = inplace_vacuum,
+	.scan_analyze_next_block = inplace_scan_analyze_next_block,
+	.scan_analyze_next_tuple = inplace_scan_analyze_next_tuple,
+	.index_build_range_scan = inplace_index_build_range_scan,
+	.index_validate_scan = inplace_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = inplace_relation_needs_toast_table,
+	.relation_toast_am = inplace_relation_toast_am,
+
+	.relation_estimate_size = inplace_estimate_rel_size,
+
+	.scan_sample_next_block = inplace_scan_sample_next_block,
+	.scan_sample_next_tuple = inplace_scan_sample_next_tuple
+};
+
+Datum
+inplace_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&inplace_methods);
+}
@@ -0,0 +1,902 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_modify.c
+ *	  insert, update, delete and row locking for the inplace table AM
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_modify.c
+ *
+ * NOTES
+ *	  An UPDATE that leaves all indexed columns alone, and whose new version
+ *	  fits into the space of the old one plus the page's free space, is done
+ *	  in place: the old version goes to undo and the item is overwritten, so
+ *	  the row keeps its TID and no index needs a new entry.  Otherwise, the
+ *	  row is moved: the old item is marked as deleted and pointing to the new
+ *	  TID, as the heap would, and the new version is inserted like a new row.
+ *
+ *	  Since executor code outside the table AM expects the heap's behavior
+ *	  when it sees an updated row, a row that was updated in place after the
+ *	  command's snapshot was taken is reported as TM_Updated, pointing to
+ *	  itself, until the updater has locked it.  EvalPlanQual then locks the
+ *	  latest version through inplace_lock() and retries on that.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/heaptoast.h"
+#include "access/inplace_internal.h"
+#include "access/sysattr.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "executor/tuptable.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "utils/datum.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+
+/*
+ * Does storing 'tup', replacing 'oldtup' if not NULL, involve the toaster?
+ */
+/*
+ * Changes are WAL-logged as generic WAL, which logical decoding can't turn
+ * back into rows.  Rather than silently leave the table's changes out of
+ * the decoded stream, refuse to make them while it is being produced.
+ */
+static void
+inplace_check_logical(Relation rel)
+{
+	if (XLogLogicalInfoActive() && RelationNeedsWAL(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot modify table \"%s\" while \"wal_level\" is \"logical\"",
+						RelationGetRelationName(rel)),
+				 errdetail("Changes to inplace tables cannot be decoded.")));
+}
+
+static bool
+inplace_needs_toast(Relation rel, HeapTuple tup, HeapTuple oldtup)
+{
+	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW)
+		return false;
+
+	return HeapTupleHasExternal(tup) ||
+		(oldtup != NULL && HeapTupleHasExternal(oldtup)) ||
+		tup->t_len > TOAST_TUPLE_THRESHOLD;
+}
+
+/*
+ * Prepare a tuple for storage: toast it if needed, and convert it to the
+ * body of an item.  'oldtup' is the prior version of the row for an update.
+ */
+MinimalTuple
+inplace_prepare_body(Relation rel, HeapTuple tup, HeapTuple oldtup,
+					 int options)
+{
+	HeapTuple	toasted = tup;
+	MinimalTuple body;
+
+	if (inplace_needs_toast(rel, tup, oldtup))
+		toasted = heap_toast_insert_or_update(rel, tup, oldtup, options);
+
+	body = minimal_tuple_from_heap_tuple(toasted);
+	if (toasted != tup)
+		heap_freetuple(toasted);
+
+	if (body->t_len > INPLACE_MAX_BODY_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too big: size %zu, maximum size %zu",
+						(size_t) body->t_len, (size_t) INPLACE_MAX_BODY_SIZE)));
+
+	return body;
+}
+
+/*
+ * Does the row body point to toasted values, to be deleted along with it?
+ */
+static bool
+inplace_body_has_external(MinimalTuple body)
+{
+	return (body->t_infomask & HEAP_HASEXTERNAL) != 0;
+}
+
+/*
+ * Roll back aborted changes to the row at 'offnum' on the exclusively
+ * locked data page in 'buf'.
+ */
+static void
+inplace_rollback_buffer(Relation rel, Buffer buf, OffsetNumber offnum)
+{
+	InplaceTupleHeader hdr;
+	GenericXLogState *state;
+	Page		page;
+
+	hdr = inplace_get_item(BufferGetPage(buf), offnum);
+	if (hdr == NULL || !inplace_version_aborted(hdr))
+		return;
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, 0);
+	inplace_rollback(rel, page, BufferGetBlockNumber(buf), offnum);
+	GenericXLogFinish(state);
+}
+
+/*
+ * Record 'xid' as the holder of the row lock on the row at 'offnum'.
+ */
+static void
+inplace_set_locker(Relation rel, Buffer buf, OffsetNumber offnum,
+				   TransactionId xid)
+{
+	GenericXLogState *state;
+	Page		page;
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, 0);
+	inplace_get_item(page, offnum)->t_locker = xid;
+	GenericXLogFinish(state);
+}
+
+/*
+ * Return the transaction that a change to a row must wait for, or invalid
+ * if there is none.
+ */
+static TransactionId
+inplace_busy_xid(InplaceTupleHeader hdr)
+{
+	if (TransactionIdIsNormal(hdr->t_xid) &&
+		!TransactionIdIsCurrentTransactionId(hdr->t_xid) &&
+		TransactionIdIsInProgress(hdr->t_xid))
+		return hdr->t_xid;
+
+	if (TransactionIdIsNormal(hdr->t_locker) &&
+		!TransactionIdIsCurrentTransactionId(hdr->t_locker) &&
+		TransactionIdIsInProgress(hdr->t_locker))
+		return hdr->t_locker;
+
+	return InvalidTransactionId;
+}
+
+/*
+ * Is the current version of the row newer than what 'snapshot' sees?  A
+ * row we have locked ourselves counts as seen: the lock was taken on the
+ * latest version, on purpose.
+ */
+static bool
+inplace_newer_than_snapshot(InplaceTupleHeader hdr, Snapshot snapshot)
+{
+	if (snapshot == InvalidSnapshot || !IsMVCCSnapshot(snapshot))
+		return false;
+	if (!TransactionIdIsNormal(hdr->t_xid))
+		return false;
+	if (TransactionIdIsNormal(hdr->t_locker) &&
+		TransactionIdIsCurrentTransactionId(hdr->t_locker))
+		return false;
+	return XidInMVCCSnapshot(hdr->t_xid, snapshot);
+}
+
+/*
+ * Check whether the current command may update or delete the row at 'tid',
+ * whose data page is exclusively locked in 'buf'.  Waits for concurrent
+ * writers if 'wait', releasing the lock on 'buf' meanwhile.
+ */
+static TM_Result
+inplace_check_modify(Relation rel, Buffer buf, ItemPointer tid,
+					 CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+					 bool wait, XLTW_Oper oper, TM_FailureData *tmfd)
+{
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+
+	for (;;)
+	{
+		InplaceTupleHeader hdr;
+		TransactionId xid;
+		TransactionId busy;
+
+		inplace_rollback_buffer(rel, buf, offnum);
+
+		hdr = inplace_get_item(BufferGetPage(buf), offnum);
+		if (hdr == NULL)
+		{
+			tmfd->ctid = *tid;
+			tmfd->xmax = InvalidTransactionId;
+			tmfd->cmax = InvalidCommandId;
+			return TM_Deleted;
+		}
+		xid = hdr->t_xid;
+
+		if (TransactionIdIsCurrentTransactionId(xid))
+		{
+			if (hdr->t_cid >= cid)
+			{
+				if (hdr->t_flags & INPLACE_INSERTED)
+					return TM_Invisible;
+				tmfd->ctid = *tid;
+				tmfd->xmax = xid;
+				tmfd->cmax = hdr->t_cid;
+				return TM_SelfModified;
+			}
+			if (hdr->t_flags & INPLACE_DELETED)
+				return TM_Invisible;
+			return TM_Ok;
+		}
+
+		busy = inplace_busy_xid(hdr);
+		if (TransactionIdIsValid(busy))
+		{
+			if (!wait)
+			{
+				tmfd->ctid = *tid;
+				tmfd->xmax = busy;
+				tmfd->cmax = InvalidCommandId;
+				return TM_BeingModified;
+			}
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+			XactLockTableWait(busy, rel, tid, oper);
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			continue;
+		}
+
+		/* the writer may have aborted since we rolled back */
+		if (!inplace_version_committed(hdr))
+			continue;
+
+		tmfd->xmax = xid;
+		tmfd->cmax = InvalidCommandId;
+		tmfd->ctid = *tid;
+
+		if (hdr->t_flags & INPLACE_DELETED)
+		{
+			if (hdr->t_flags & INPLACE_MOVED)
+			{
+				tmfd->ctid = hdr->t_ctid;
+				return TM_Updated;
+			}
+			return TM_Deleted;
+		}
+
+		if (inplace_newer_than_snapshot(hdr, snapshot))
+			return TM_Updated;
+
+		if (crosscheck != InvalidSnapshot &&
+			!inplace_version_visible(hdr, crosscheck))
+			return TM_Updated;
+
+		return TM_Ok;
+	}
+}
+
+/*
+ * Insert 'nslots' rows, filling each page before moving to the next.
+ */
+void
+inplace_insert(Relation rel, TupleTableSlot **slots, int nslots,
+			   CommandId cid, int options, uint32 specToken)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	MinimalTuple *bodies;
+	int			ndone = 0;
+
+	inplace_check_logical(rel);
+
+	/* see heap_insert() */
+	CheckForSerializableConflictIn(rel, NULL, InvalidBlockNumber);
+
+	bodies = palloc(sizeof(MinimalTuple) * nslots);
+	for (int i = 0; i < nslots; i++)
+	{
+		bool		shouldFree;
+		HeapTuple	tup = ExecFetchSlotHeapTuple(slots[i], true, &shouldFree);
+
+		bodies[i] = inplace_prepare_body(rel, tup, NULL, options);
+		if (shouldFree)
+			heap_freetuple(tup);
+	}
+
+	while (ndone < nslots)
+	{
+		Buffer		buf;
+		Page		page;
+		BlockNumber blkno;
+		GenericXLogState *state;
+		Size		saveFreeSpace;
+		bool		first = true;
+
+		buf = inplace_get_insert_buffer(rel, inplace_item_size(bodies[ndone]),
+										InvalidBuffer);
+		blkno = BufferGetBlockNumber(buf);
+		saveFreeSpace = RelationGetTargetPageFreeSpace(rel,
+													   HEAP_DEFAULT_FILLFACTOR);
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, 0);
+
+		do
+		{
+			InplaceTupleHeaderData hdr;
+			Size		size = inplace_item_size(bodies[ndone]);
+			char	   *item;
+			OffsetNumber offnum;
+
+			/* the first row is known to fit; stop when the next one doesn't */
+			if (!first &&
+				PageGetHeapFreeSpace(page) < MAXALIGN(size) + saveFreeSpace)
+				break;
+
+			hdr.t_xid = xid;
+			hdr.t_cid = cid;
+			hdr.t_locker = InvalidTransactionId;
+			hdr.t_flags = INPLACE_INSERTED;
+			ItemPointerSetInvalid(&hdr.t_undo);
+			ItemPointerSetInvalid(&hdr.t_ctid);
+			if (specToken != 0)
+			{
+				hdr.t_flags |= INPLACE_SPECULATIVE;
+				ItemPointerSet(&hdr.t_ctid, specToken, InvalidOffsetNumber);
+			}
+
+			item = inplace_form_item(&hdr, bodies[ndone], size);
+			offnum = PageAddItemExtended(page, item, size, InvalidOffsetNumber,
+										 PAI_IS_HEAP);
+			pfree(item);
+			if (offnum == InvalidOffsetNumber)
+			{
+				/* out of line pointers */
+				if (!first)
+					break;
+				elog(ERROR, "failed to add row to table \"%s\"",
+					 RelationGetRelationName(rel));
+			}
+			first = false;
+
+			slots[ndone]->tts_tableOid = RelationGetRelid(rel);
+			ItemPointerSet(&slots[ndone]->tts_tid, blkno, offnum);
+			pfree(bodies[ndone]);
+			ndone++;
+		} while (ndone < nslots);
+
+		GenericXLogFinish(state);
+		UnlockReleaseBuffer(buf);
+	}
+
+	pfree(bodies);
+
+	pgstat_count_heap_insert(rel, nslots);
+}
+
+/*
+ * Confirm or kill a row inserted speculatively.
+ */
+void
+inplace_complete_speculative(Relation rel, ItemPointer tid, bool succeeded)
+{
+	Buffer		buf;
+	Page		page;
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	InplaceTupleHeader hdr;
+	GenericXLogState *state;
+	HeapTuple	oldtup = NULL;
+
+	buf = ReadBuffer(rel, ItemPointerGetBlockNumber(tid));
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	hdr = inplace_get_item(BufferGetPage(buf), offnum);
+	if (hdr == NULL || !(hdr->t_flags & INPLACE_SPECULATIVE))
+		elog(ERROR, "row (%u,%u) of table \"%s\" is not a speculative insertion",
+			 ItemPointerGetBlockNumber(tid), offnum,
+			 RelationGetRelationName(rel));
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, 0);
+	hdr = inplace_get_item(page, offnum);
+	if (succeeded)
+	{
+		hdr->t_flags &= ~INPLACE_SPECULATIVE;
+		ItemPointerSetInvalid(&hdr->t_ctid);
+	}
+	else
+	{
+		MinimalTuple body = InplaceItemGetBody(hdr);
+
+		if (inplace_body_has_external(body))
+			oldtup = heap_tuple_from_minimal_tuple(body);
+		ItemIdSetDead(PageGetItemId(page, offnum));
+	}
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buf);
+
+	if (oldtup != NULL)
+	{
+		heap_toast_delete(rel, oldtup, true);
+		heap_freetuple(oldtup);
+	}
+}
+
+/*
+ * Delete the row at 'tid'.
+ */
+TM_Result
+inplace_delete(Relation rel, ItemPointer tid, CommandId cid,
+			   Snapshot snapshot, Snapshot crosscheck, bool wait,
+			   TM_FailureData *tmfd, bool changingPart)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	Buffer		buf;
+	Buffer		undobuf;
+	Page		page;
+	Page		undopage;
+	InplaceTupleHeader hdr;
+	InplaceTupleHeaderData newhdr;
+	GenericXLogState *state;
+	HeapTuple	oldtup = NULL;
+	TM_Result	result;
+
+	inplace_check_logical(rel);
+
+	buf = ReadBuffer(rel, ItemPointerGetBlockNumber(tid));
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	result = inplace_check_modify(rel, buf, tid, cid, snapshot, crosscheck,
+								  wait, XLTW_Delete, tmfd);
+	if (result != TM_Ok)
+	{
+		UnlockReleaseBuffer(buf);
+		return result;
+	}
+
+	CheckForSerializableConflictIn(rel, tid, ItemPointerGetBlockNumber(tid));
+
+	undobuf = inplace_undo_reserve(rel, inplace_undo_size(NULL));
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, 0);
+	undopage = GenericXLogRegisterBuffer(state, undobuf, 0);
+
+	hdr = inplace_get_item(page, offnum);
+	newhdr = *hdr;
+	inplace_undo_append(undopage, BufferGetBlockNumber(undobuf), xid, tid,
+						hdr, NULL, &newhdr.t_undo);
+	newhdr.t_xid = xid;
+	newhdr.t_cid = cid;
+	newhdr.t_flags = INPLACE_DELETED;
+	ItemPointerSetInvalid(&newhdr.t_ctid);
+	if (changingPart)
+	{
+		newhdr.t_flags |= INPLACE_MOVED;
+		ItemPointerSetMovedPartitions(&newhdr.t_ctid);
+	}
+	*hdr = newhdr;
+
+	if (inplace_body_has_external(InplaceItemGetBody(hdr)))
+		oldtup = heap_tuple_from_minimal_tuple(InplaceItemGetBody(hdr));
+
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(undobuf);
+	UnlockReleaseBuffer(buf);
+
+	if (oldtup != NULL)
+	{
+		heap_toast_delete(rel, oldtup, false);
+		heap_freetuple(oldtup);
+	}
+
+	pgstat_count_heap_delete(rel);
+
+	return TM_Ok;
+}
+
+/*
+ * Do the columns in 'attrs' differ between 'oldtup' and 'newtup'?
+ */
+static bool
+inplace_attrs_changed(Relation rel, Bitmapset *attrs, HeapTuple oldtup,
+					  HeapTuple newtup)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			x = -1;
+
+	while ((x = bms_next_member(attrs, x)) >= 0)
+	{
+		AttrNumber	attnum = x + FirstLowInvalidHeapAttributeNumber;
+		Form_pg_attribute att;
+		Datum		value1,
+					value2;
+		bool		isnull1,
+					isnull2;
+
+		/* whole-row references, and system columns other than tableoid */
+		if (attnum == 0)
+			return true;
+		if (attnum < 0)
+		{
+			if (attnum != TableOidAttributeNumber)
+				return true;
+			continue;
+		}
+
+		att = TupleDescAttr(tupdesc, attnum - 1);
+		value1 = heap_getattr(oldtup, attnum, tupdesc, &isnull1);
+		value2 = heap_getattr(newtup, attnum, tupdesc, &isnull2);
+		if (isnull1 != isnull2)
+			return true;
+		if (!isnull1 &&
+			!datumIsEqual(value1, value2, att->attbyval, att->attlen))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Update the row at 'otid' to the contents of 'slot'.
+ */
+TM_Result
+inplace_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
+			   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+			   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
+			   TU_UpdateIndexes *update_indexes)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	BlockNumber blkno = ItemPointerGetBlockNumber(otid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(otid);
+	HeapTuple	newtup;
+	HeapTuple	oldtup;
+	bool		shouldFree;
+	MinimalTuple newbody;
+	InplaceVersion old;
+	Bitmapset  *hot_attrs;
+	Bitmapset  *sum_attrs;
+	Bitmapset  *key_attrs;
+	bool		move;
+	Buffer		buf;
+	Buffer		newbuf;
+	Buffer		undobuf;
+	Page		page;
+	Page		newpage;
+	Page		undopage;
+	InplaceTupleHeader hdr;
+	InplaceTupleHeaderData newhdr;
+	GenericXLogState *state;
+	Size		newsize;
+	Size		alloc;
+	TM_Result	result;
+
+	*update_indexes = TU_None;
+
+	inplace_check_logical(rel);
+
+	newtup = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+
+	hot_attrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_HOT_BLOCKING);
+	sum_attrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_SUMMARIZED);
+	key_attrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_KEY);
+
+	buf = ReadBuffer(rel, blkno);
+	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+	result = inplace_check_modify(rel, buf, otid, cid, snapshot, crosscheck,
+								  wait, XLTW_Update, tmfd);
+	if (result != TM_Ok)
+	{
+		UnlockReleaseBuffer(buf);
+		*lockmode = LockTupleExclusive;
+		if (shouldFree)
+			heap_freetuple(newtup);
+		return result;
+	}
+
+	CheckForSerializableConflictIn(rel, otid, blkno);
+
+	inplace_copy_item(BufferGetPage(buf), offnum, &old);
+	oldtup = heap_tuple_from_minimal_tuple(old.body);
+
+	*lockmode = inplace_attrs_changed(rel, key_attrs, oldtup, newtup) ?
+		LockTupleExclusive : LockTupleNoKeyExclusive;
+
+	/*
+	 * AFTER ROW triggers fetch the row they fire for by its TID, once the
+	 * statement is done; by then, an update in place would have overwritten
+	 * the version an INSERT or UPDATE trigger must see.  So rows of a table
+	 * with such triggers always move.
+	 */
+	move = inplace_attrs_changed(rel, hot_attrs, oldtup, newtup) ||
+		(rel->trigdesc != NULL &&
+		 (rel->trigdesc->trig_insert_after_row ||
+		  rel->trigdesc->trig_update_after_row));
+
+	if (inplace_needs_toast(rel, newtup, oldtup))
+	{
+		/*
+		 * Toasting may take a while, and inserts into the toast table, so do
+		 * it without holding the buffer lock.  Lock the row meanwhile, so no
+		 * one else changes it.
+		 */
+		inplace_set_locker(rel, buf, offnum, xid);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		newbody = inplace_prepare_body(rel, newtup, oldtup, 0);
+
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		/* VACUUM may have frozen the row meanwhile */
+		pfree(old.body);
+		inplace_copy_item(BufferGetPage(buf), offnum, &old);
+	}
+	else
+		newbody = inplace_prepare_body(rel, newtup, NULL, 0);
+
+	page = BufferGetPage(buf);
+	newsize = inplace_item_size(newbody);
+	alloc = ItemIdGetLength(PageGetItemId(page, offnum));
+
+	if (!move &&
+		MAXALIGN(newsize) > MAXALIGN(alloc) +
+		(((PageHeader) page)->pd_upper - ((PageHeader) page)->pd_lower))
+		move = true;
+
+	if (!move)
+	{
+		undobuf = inplace_undo_reserve(rel, inplace_undo_size(old.body));
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, 0);
+		undopage = GenericXLogRegisterBuffer(state, undobuf, 0);
+
+		hdr = inplace_get_item(page, offnum);
+		newhdr = *hdr;
+		inplace_undo_append(undopage, BufferGetBlockNumber(undobuf), xid, otid,
+							hdr, old.body, &newhdr.t_undo);
+		newhdr.t_xid = xid;
+		newhdr.t_cid = cid;
+		newhdr.t_flags = INPLACE_UPDATED;
+		ItemPointerSetInvalid(&newhdr.t_ctid);
+
+		/* never shrink the item: rollback must be able to restore the old body */
+		if (!inplace_replace_item(page, offnum, &newhdr, newbody,
+								  Max(alloc, newsize)))
+			elog(ERROR, "failed to update row (%u,%u) of table \"%s\"",
+				 blkno, offnum, RelationGetRelationName(rel));
+
+		GenericXLogFinish(state);
+
+		UnlockReleaseBuffer(undobuf);
+		UnlockReleaseBuffer(buf);
+
+		slot->tts_tableOid = RelationGetRelid(rel);
+		slot->tts_tid = *otid;
+
+		if (inplace_attrs_changed(rel, sum_attrs, oldtup, newtup))
+			*update_indexes = TU_Summarizing;
+
+		pgstat_count_heap_update(rel, true, false);
+	}
+	else
+	{
+		ItemPointerData newtid;
+		OffsetNumber newoff;
+		char	   *item;
+
+		if (PageGetHeapFreeSpace(page) >= MAXALIGN(newsize))
+			newbuf = buf;
+		else
+			newbuf = inplace_get_insert_buffer(rel, newsize, buf);
+
+		undobuf = inplace_undo_reserve(rel, inplace_undo_size(NULL));
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, 0);
+		if (newbuf != buf)
+			newpage = GenericXLogRegisterBuffer(state, newbuf, 0);
+		else
+			newpage = page;
+		undopage = GenericXLogRegisterBuffer(state, undobuf, 0);
+
+		newhdr.t_xid = xid;
+		newhdr.t_cid = cid;
+		newhdr.t_locker = InvalidTransactionId;
+		newhdr.t_flags = INPLACE_INSERTED;
+		ItemPointerSetInvalid(&newhdr.t_undo);
+		ItemPointerSetInvalid(&newhdr.t_ctid);
+
+		item = inplace_form_item(&newhdr, newbody, newsize);
+		newoff = PageAddItemExtended(newpage, item, newsize,
+									 InvalidOffsetNumber, PAI_IS_HEAP);
+		if (newoff == InvalidOffsetNumber)
+			elog(ERROR, "failed to add row to table \"%s\"",
+				 RelationGetRelationName(rel));
+		pfree(item);
+		ItemPointerSet(&newtid, BufferGetBlockNumber(newbuf), newoff);
+
+		hdr = inplace_get_item(page, offnum);
+		newhdr = *hdr;
+		inplace_undo_append(undopage, BufferGetBlockNumber(undobuf), xid, otid,
+							hdr, NULL, &newhdr.t_undo);
+		newhdr.t_xid = xid;
+		newhdr.t_cid = cid;
+		newhdr.t_flags = INPLACE_DELETED | INPLACE_MOVED;
+		newhdr.t_ctid = newtid;
+		*hdr = newhdr;
+
+		GenericXLogFinish(state);
+
+		UnlockReleaseBuffer(undobuf);
+		if (newbuf != buf)
+			UnlockReleaseBuffer(newbuf);
+		UnlockReleaseBuffer(buf);
+
+		slot->tts_tableOid = RelationGetRelid(rel);
+		slot->tts_tid = newtid;
+		*update_indexes = TU_All;
+
+		pgstat_count_heap_update(rel, false, newbuf != buf);
+	}
+
+	pfree(newbody);
+	pfree(old.body);
+	heap_freetuple(oldtup);
+	if (shouldFree)
+		heap_freetuple(newtup);
+	bms_free(hot_attrs);
+	bms_free(sum_attrs);
+	bms_free(key_attrs);
+
+	return TM_Ok;
+}
+
+/*
+ * Lock the row at *tid, and store its latest version in 'slot'.
+ *
+ * All row locks are exclusive, whatever 'mode' asks for.
+ */
+TM_Result
+inplace_lock(Relation rel, ItemPointer tid, Snapshot snapshot,
+			 TupleTableSlot *slot, CommandId cid, LockWaitPolicy wait_policy,
+			 uint8 flags, TM_FailureData *tmfd)
+{
+	bool		find_last = (flags & TUPLE_LOCK_FLAG_FIND_LAST_VERSION) != 0;
+
+	tmfd->traversed = false;
+
+	for (;;)
+	{
+		OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+		Buffer		buf;
+		InplaceTupleHeader hdr;
+		InplaceVersion version;
+		TransactionId xid;
+		TransactionId busy;
+
+		buf = ReadBuffer(rel, ItemPointerGetBlockNumber(tid));
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+retry:
+		inplace_rollback_buffer(rel, buf, offnum);
+
+		hdr = inplace_get_item(BufferGetPage(buf), offnum);
+		if (hdr == NULL)
+		{
+			UnlockReleaseBuffer(buf);
+			tmfd->ctid = *tid;
+			tmfd->xmax = InvalidTransactionId;
+			tmfd->cmax = InvalidCommandId;
+			return TM_Deleted;
+		}
+		xid = hdr->t_xid;
+
+		if (TransactionIdIsCurrentTransactionId(xid))
+		{
+			if (hdr->t_cid >= cid && !(hdr->t_flags & INPLACE_INSERTED))
+			{
+				UnlockReleaseBuffer(buf);
+				tmfd->ctid = *tid;
+				tmfd->xmax = xid;
+				tmfd->cmax = hdr->t_cid;
+				return TM_SelfModified;
+			}
+			if (hdr->t_cid >= cid || (hdr->t_flags & INPLACE_DELETED))
+			{
+				UnlockReleaseBuffer(buf);
+				return TM_Invisible;
+			}
+			/* our own change already keeps others away */
+		}
+		else
+		{
+			busy = inplace_busy_xid(hdr);
+			if (TransactionIdIsValid(busy))
+			{
+				switch (wait_policy)
+				{
+					case LockWaitBlock:
+						LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+						XactLockTableWait(busy, rel, tid, XLTW_Lock);
+						LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+						break;
+					case LockWaitSkip:
+						if (!ConditionalXactLockTableWait(busy))
+						{
+							UnlockReleaseBuffer(buf);
+							return TM_WouldBlock;
+						}
+						break;
+					case LockWaitError:
+						if (!ConditionalXactLockTableWait(busy))
+							ereport(ERROR,
+									(errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+									 errmsg("could not obtain lock on row in relation \"%s\"",
+											RelationGetRelationName(rel))));
+						break;
+				}
+				goto retry;
+			}
+
+			/* the writer may have aborted since we rolled back */
+			if (!inplace_version_committed(hdr))
+				goto retry;
+
+			tmfd->xmax = xid;
+			tmfd->cmax = InvalidCommandId;
+			tmfd->ctid = *tid;
+
+			if (hdr->t_flags & INPLACE_DELETED)
+			{
+				if (!(hdr->t_flags & INPLACE_MOVED))
+				{
+					UnlockReleaseBuffer(buf);
+					return TM_Deleted;
+				}
+
+				tmfd->ctid = hdr->t_ctid;
+				UnlockReleaseBuffer(buf);
+				if (!find_last)
+					return TM_Updated;
+
+				if (ItemPointerIndicatesMovedPartitions(&tmfd->ctid))
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("tuple to be locked was already moved to another partition due to concurrent update")));
+
+				/* lock the row where it moved to */
+				*tid = tmfd->ctid;
+				tmfd->traversed = true;
+				continue;
+			}
+
+			if (inplace_newer_than_snapshot(hdr, snapshot))
+			{
+				if (find_last)
+					tmfd->traversed = true;
+				else if (IsolationUsesXactSnapshot())
+				{
+					UnlockReleaseBuffer(buf);
+					return TM_Updated;
+				}
+			}
+
+			if (!TransactionIdIsCurrentTransactionId(hdr->t_locker))
+				inplace_set_locker(rel, buf, offnum, GetCurrentTransactionId());
+		}
+
+		inplace_copy_item(BufferGetPage(buf), offnum, &version);
+		UnlockReleaseBuffer(buf);
+
+		inplace_store_version(rel, &version, tid, slot);
+
+		return TM_Ok;
+	}
+}
@@ -0,0 +1,380 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_page.c
+ *	  page-level storage for the inplace table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_page.c
+ *
+ * NOTES
+ *	  See inplace_internal.h for the layout of an inplace relation.  All
+ *	  changes are WAL-logged using generic WAL records.
+ *
+ *	  Lock order: data pages come first, in block number order, then the
+ *	  metapage, then undo pages.  A backend that already holds a data page
+ *	  lock only ever takes another data page lock conditionally, or on a page
+ *	  it has just added to the relation.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/heapam.h"
+#include "access/inplace_internal.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "utils/rel.h"
+
+/*
+ * Give up on the free space map after this many pages that turned out to
+ * be unusable, and extend the relation instead.
+ */
+#define INPLACE_FSM_TRIES			8
+
+
+/*
+ * Initialize an empty page of the given kind.
+ */
+void
+inplace_init_page(Page page, uint16 flags)
+{
+	InplacePageOpaque opaque;
+
+	PageInit(page, BLCKSZ, sizeof(InplacePageOpaqueData));
+
+	opaque = InplacePageGetOpaque(page);
+	opaque->flags = flags;
+	opaque->unused = 0;
+	opaque->min_xid = InvalidTransactionId;
+	opaque->max_xid = InvalidTransactionId;
+}
+
+static bool
+inplace_page_has_flag(Page page, uint16 flag)
+{
+	if (PageIsNew(page) ||
+		PageGetSpecialSize(page) != MAXALIGN(sizeof(InplacePageOpaqueData)))
+		return false;
+	return (InplacePageGetOpaque(page)->flags & flag) != 0;
+}
+
+bool
+inplace_is_data_page(Page page)
+{
+	return inplace_page_has_flag(page, INPLACE_PAGE_DATA);
+}
+
+bool
+inplace_is_undo_page(Page page)
+{
+	return inplace_page_has_flag(page, INPLACE_PAGE_UNDO);
+}
+
+/*
+ * Does the page hold no items at all?
+ */
+bool
+inplace_page_is_empty(Page page)
+{
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+
+	for (OffsetNumber offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		if (ItemIdIsUsed(PageGetItemId(page, offnum)))
+			return false;
+	}
+	return true;
+}
+
+static void
+inplace_init_metapage(Page page)
+{
+	InplaceMetaPageData *meta;
+
+	inplace_init_page(page, INPLACE_PAGE_META);
+
+	meta = InplacePageGetMeta(page);
+	memset(meta, 0, sizeof(InplaceMetaPageData));
+	meta->magic = INPLACE_MAGIC;
+	meta->version = INPLACE_VERSION;
+	meta->undo_insert = InvalidBlockNumber;
+
+	((PageHeader) page)->pd_lower =
+		((char *) meta + sizeof(InplaceMetaPageData)) - (char *) page;
+}
+
+static void
+inplace_check_metapage(Relation rel, Page page)
+{
+	InplaceMetaPageData *meta = InplacePageGetMeta(page);
+
+	if (!inplace_page_has_flag(page, INPLACE_PAGE_META) ||
+		meta->magic != INPLACE_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("inplace table \"%s\" has an invalid metapage",
+						RelationGetRelationName(rel))));
+	if (meta->version != INPLACE_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("inplace table \"%s\" has version %u, but only version %u is supported",
+						RelationGetRelationName(rel), meta->version,
+						INPLACE_VERSION)));
+}
+
+/*
+ * Pin and lock the metapage, creating it if necessary.  A metapage that
+ * had to be initialized is returned exclusively locked, whatever 'mode'.
+ */
+Buffer
+inplace_lock_meta(Relation rel, int mode)
+{
+	Buffer		buf;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) > INPLACE_METAPAGE_BLKNO)
+		buf = ReadBuffer(rel, INPLACE_METAPAGE_BLKNO);
+	else
+		buf = ExtendBufferedRelTo(BMR_REL(rel), MAIN_FORKNUM, NULL, 0,
+								  INPLACE_METAPAGE_BLKNO + 1, RBM_NORMAL);
+	LockBuffer(buf, mode);
+	page = BufferGetPage(buf);
+
+	if (PageIsNew(page) && mode != BUFFER_LOCK_EXCLUSIVE)
+	{
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+	}
+
+	if (PageIsNew(page))
+	{
+		GenericXLogState *state;
+
+		state = GenericXLogStart(rel);
+		page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+		inplace_init_metapage(page);
+		GenericXLogFinish(state);
+	}
+	else
+		inplace_check_metapage(rel, page);
+
+	return buf;
+}
+
+/*
+ * Initialize a page we have exclusively locked as an empty data page.
+ */
+static void
+inplace_init_data_buffer(Relation rel, Buffer buf)
+{
+	GenericXLogState *state;
+	Page		page;
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+	inplace_init_page(page, INPLACE_PAGE_DATA);
+	GenericXLogFinish(state);
+}
+
+/*
+ * Add a page to the relation, and return it exclusively locked and still
+ * uninitialized.
+ */
+Buffer
+inplace_extend(Relation rel)
+{
+	/* make sure block 0 is taken by the metapage */
+	if (RelationGetNumberOfBlocks(rel) <= INPLACE_METAPAGE_BLKNO)
+		UnlockReleaseBuffer(inplace_lock_meta(rel, BUFFER_LOCK_SHARE));
+
+	return ExtendBufferedRel(BMR_REL(rel), MAIN_FORKNUM, NULL, EB_LOCK_FIRST);
+}
+
+/*
+ * Return an exclusively locked data page with room for an item of 'len'
+ * bytes, leaving the fillfactor's worth of space free for updates.
+ *
+ * If 'otherBuffer' is valid, the caller already holds an exclusive lock on
+ * that data page, which we must not return.  We then only take conditional
+ * locks on existing pages, and extend the relation rather than wait.
+ */
+Buffer
+inplace_get_insert_buffer(Relation rel, Size len, Buffer otherBuffer)
+{
+	Size		needed = MAXALIGN(len);
+	Size		saveFreeSpace;
+	BlockNumber otherBlock = InvalidBlockNumber;
+	BlockNumber targetBlock;
+	Buffer		buf;
+	int			tries = 0;
+
+	Assert(needed <= INPLACE_MAX_ITEM_SIZE);
+
+	saveFreeSpace = RelationGetTargetPageFreeSpace(rel,
+												   HEAP_DEFAULT_FILLFACTOR);
+	if (needed + saveFreeSpace > INPLACE_MAX_ITEM_SIZE)
+		saveFreeSpace = INPLACE_MAX_ITEM_SIZE - needed;
+
+	if (BufferIsValid(otherBuffer))
+		otherBlock = BufferGetBlockNumber(otherBuffer);
+
+	targetBlock = RelationGetTargetBlock(rel);
+	if (targetBlock == InvalidBlockNumber)
+		targetBlock = GetPageWithFreeSpace(rel, needed + saveFreeSpace);
+
+	while (targetBlock != InvalidBlockNumber && tries++ < INPLACE_FSM_TRIES)
+	{
+		Page		page;
+		Size		freespace;
+
+		if (targetBlock == INPLACE_METAPAGE_BLKNO || targetBlock == otherBlock)
+		{
+			targetBlock = GetPageWithFreeSpace(rel, needed + saveFreeSpace);
+			if (targetBlock == otherBlock)
+				break;
+			continue;
+		}
+
+		buf = ReadBuffer(rel, targetBlock);
+		if (BufferIsValid(otherBuffer))
+		{
+			if (!ConditionalLockBuffer(buf))
+			{
+				ReleaseBuffer(buf);
+				break;
+			}
+		}
+		else
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		page = BufferGetPage(buf);
+		if (PageIsNew(page))
+		{
+			/* left behind by a backend that failed while extending */
+			inplace_init_data_buffer(rel, buf);
+		}
+
+		if (inplace_is_data_page(page))
+		{
+			freespace = PageGetHeapFreeSpace(page);
+			if (needed + saveFreeSpace <= freespace)
+			{
+				RelationSetTargetBlock(rel, targetBlock);
+				return buf;
+			}
+		}
+		else
+			freespace = 0;
+
+		UnlockReleaseBuffer(buf);
+		targetBlock = RecordAndGetPageWithFreeSpace(rel, targetBlock, freespace,
+													needed + saveFreeSpace);
+	}
+
+	buf = inplace_extend(rel);
+	inplace_init_data_buffer(rel, buf);
+	RelationSetTargetBlock(rel, BufferGetBlockNumber(buf));
+
+	return buf;
+}
+
+/*
+ * Size of the item that stores a version with the given body.
+ */
+Size
+inplace_item_size(MinimalTuple body)
+{
+	return INPLACE_TUPLE_HEADER_SIZE + body->t_len;
+}
+
+/*
+ * Build the image of an item holding the given version, padded with zeroes
+ * to 'alloc' bytes.
+ */
+char *
+inplace_form_item(InplaceTupleHeader hdr, MinimalTuple body, Size alloc)
+{
+	char	   *item;
+
+	Assert(alloc >= inplace_item_size(body));
+
+	item = palloc0(alloc);
+	memcpy(item, hdr, sizeof(InplaceTupleHeaderData));
+	memcpy(InplaceItemGetBody(item), body, body->t_len);
+
+	return item;
+}
+
+/*
+ * Overwrite item 'offnum' with the given version, resizing its storage to
+ * 'alloc' bytes.  Returns false if the page has no room for that.
+ */
+bool
+inplace_replace_item(Page page, OffsetNumber offnum, InplaceTupleHeader hdr,
+					 MinimalTuple body, Size alloc)
+{
+	ItemId		lp = PageGetItemId(page, offnum);
+	char	   *item;
+	bool		result;
+
+	Assert(ItemIdIsNormal(lp));
+
+	if (ItemIdGetLength(lp) == alloc)
+	{
+		item = PageGetItem(page, lp);
+		memcpy(item, hdr, sizeof(InplaceTupleHeaderData));
+		memcpy(InplaceItemGetBody(item), body, body->t_len);
+		return true;
+	}
+
+	item = inplace_form_item(hdr, body, alloc);
+	result = PageIndexTupleOverwrite(page, offnum, item, alloc);
+	pfree(item);
+
+	return result;
+}
+
+/*
+ * Copy the current version of the row at 'offnum' into palloc'd memory.
+ */
+void
+inplace_copy_item(Page page, OffsetNumber offnum, InplaceVersion *version)
+{
+	ItemId		lp = PageGetItemId(page, offnum);
+	char	   *item = PageGetItem(page, lp);
+	MinimalTuple body = InplaceItemGetBody(item);
+
+	Assert(ItemIdIsNormal(lp));
+
+	memcpy(&version->hdr, item, sizeof(InplaceTupleHeaderData));
+	version->body = palloc(body->t_len);
+	memcpy(version->body, body, body->t_len);
+}
+
+/*
+ * Return the header of the item at 'offnum' if it holds a row, or NULL if
+ * there is no such item or its line pointer is unused or dead.  Like for
+ * heap, a TID that doesn't point to a row is not an error: it may come from
+ * the user, e.g. in WHERE ctid = ..., and the page may not even be a data
+ * page anymore.
+ */
+InplaceTupleHeader
+inplace_get_item(Page page, OffsetNumber offnum)
+{
+	ItemId		lp;
+
+	if (!inplace_is_data_page(page) ||
+		offnum < FirstOffsetNumber || offnum > PageGetMaxOffsetNumber(page))
+		return NULL;
+
+	lp = PageGetItemId(page, offnum);
+	if (!ItemIdIsNormal(lp))
+		return NULL;
+
+	return (InplaceTupleHeader) PageGetItem(page, lp);
+}
@@ -0,0 +1,401 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_undo.c
+ *	  undo records for the inplace table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_undo.c
+ *
+ * NOTES
+ *	  Undo pages live in the main fork of the relation, next to the data
+ *	  pages.  Records are only ever appended to the page the metapage points
+ *	  to; once that is full, a new undo page is taken from the free space map
+ *	  or by extending the relation.  An undo page is discarded as a whole once
+ *	  VACUUM has established that no snapshot can need any record on it.
+ *
+ *	  A record is written in the same generic WAL record as the change to the
+ *	  data page it belongs to, so both become durable together.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/inplace_internal.h"
+#include "access/transam.h"
+#include "access/xlog.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/standby.h"
+#include "utils/rel.h"
+
+/* how many free space map candidates to try for a new undo page */
+#define INPLACE_UNDO_FSM_TRIES		4
+
+
+/*
+ * Find a page to turn into the new undo insertion page, and return it
+ * exclusively locked.  The caller holds an exclusive lock on the metapage,
+ * so we must not wait for a lock on any other existing page.
+ */
+static Buffer
+inplace_undo_new_page(Relation rel)
+{
+	Size		wanted = INPLACE_MAX_ITEM_SIZE / 2;
+	BlockNumber blkno;
+	int			tries = 0;
+
+	blkno = GetPageWithFreeSpace(rel, wanted);
+	while (blkno != InvalidBlockNumber && tries++ < INPLACE_UNDO_FSM_TRIES)
+	{
+		Buffer		buf;
+		Page		page;
+		Size		freespace = 0;
+
+		if (blkno == INPLACE_METAPAGE_BLKNO)
+			break;
+
+		buf = ReadBuffer(rel, blkno);
+		if (ConditionalLockBuffer(buf))
+		{
+			page = BufferGetPage(buf);
+			if (PageIsNew(page) ||
+				(inplace_is_data_page(page) && inplace_page_is_empty(page)))
+			{
+				/* no longer available for rows */
+				RecordPageWithFreeSpace(rel, blkno, 0);
+				return buf;
+			}
+			if (inplace_is_data_page(page))
+				freespace = PageGetHeapFreeSpace(page);
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		}
+		ReleaseBuffer(buf);
+
+		blkno = RecordAndGetPageWithFreeSpace(rel, blkno, freespace, wanted);
+	}
+
+	return ExtendBufferedRel(BMR_REL(rel), MAIN_FORKNUM, NULL, EB_LOCK_FIRST);
+}
+
+/*
+ * Return an exclusively locked undo page with room for a record of 'len'
+ * bytes.
+ *
+ * The caller may hold locks on data pages, but not on the metapage or on
+ * any undo page.
+ */
+Buffer
+inplace_undo_reserve(Relation rel, Size len)
+{
+	Size		needed = MAXALIGN(len);
+
+	Assert(needed <= INPLACE_MAX_ITEM_SIZE);
+
+	for (;;)
+	{
+		Buffer		metabuf;
+		Buffer		buf;
+		Page		page;
+		BlockNumber undo_insert;
+		GenericXLogState *state;
+		Page		metapage;
+
+		metabuf = inplace_lock_meta(rel, BUFFER_LOCK_SHARE);
+		undo_insert = InplacePageGetMeta(BufferGetPage(metabuf))->undo_insert;
+
+		if (BlockNumberIsValid(undo_insert))
+		{
+			/*
+			 * Lock the undo page before releasing the metapage, so that VACUUM
+			 * cannot retire it and discard it under us.
+			 */
+			buf = ReadBuffer(rel, undo_insert);
+			LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+			UnlockReleaseBuffer(metabuf);
+
+			page = BufferGetPage(buf);
+			if (inplace_is_undo_page(page) && PageGetFreeSpace(page) >= needed)
+				return buf;
+			UnlockReleaseBuffer(buf);
+		}
+		else
+			UnlockReleaseBuffer(metabuf);
+
+		/* we need a new undo page; recheck that nobody added one meanwhile */
+		metabuf = inplace_lock_meta(rel, BUFFER_LOCK_EXCLUSIVE);
+		if (InplacePageGetMeta(BufferGetPage(metabuf))->undo_insert != undo_insert)
+		{
+			UnlockReleaseBuffer(metabuf);
+			continue;
+		}
+
+		buf = inplace_undo_new_page(rel);
+
+		state = GenericXLogStart(rel);
+		metapage = GenericXLogRegisterBuffer(state, metabuf, 0);
+		page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+		inplace_init_page(page, INPLACE_PAGE_UNDO);
+		InplacePageGetMeta(metapage)->undo_insert = BufferGetBlockNumber(buf);
+		GenericXLogFinish(state);
+
+		UnlockReleaseBuffer(metabuf);
+
+		return buf;
+	}
+}
+
+/*
+ * Size of the undo record for 'body', or of a header-only record if NULL.
+ */
+Size
+inplace_undo_size(MinimalTuple body)
+{
+	return INPLACE_UNDO_HEADER_SIZE + (body ? body->t_len : 0);
+}
+
+/*
+ * Append a record holding the version of row 'tid' that transaction 'xid'
+ * is about to replace to 'undopage', which is block 'undoblk' as registered
+ * in the caller's generic WAL record.  The location of the new record is
+ * returned in *ptr.
+ */
+void
+inplace_undo_append(Page undopage, BlockNumber undoblk, TransactionId xid,
+					ItemPointer tid, InplaceTupleHeader prior,
+					MinimalTuple body, ItemPointer ptr)
+{
+	InplacePageOpaque opaque = InplacePageGetOpaque(undopage);
+	Size		size = inplace_undo_size(body);
+	InplaceUndoRecord rec;
+	OffsetNumber offnum;
+
+	rec = palloc0(size);
+	rec->ur_xid = xid;
+	rec->ur_tid = *tid;
+	rec->ur_flags = 0;
+	rec->ur_hdr = *prior;
+	/* row locks are not versioned */
+	rec->ur_hdr.t_locker = InvalidTransactionId;
+
+	/*
+	 * The version being replaced was written by the current transaction, or
+	 * else by one that committed: aborted versions are rolled back first,
+	 * and running writers waited for.  Remember the latter, so that nobody
+	 * needs to look up the commit status of what may be an old XID, possibly
+	 * older than the table's relfrozenxid by then.
+	 */
+	if (TransactionIdIsNormal(prior->t_xid) &&
+		!TransactionIdIsCurrentTransactionId(prior->t_xid))
+		rec->ur_hdr.t_flags |= INPLACE_XID_COMMITTED;
+	if (body)
+		memcpy(InplaceUndoGetBody(rec), body, body->t_len);
+
+	offnum = PageAddItem(undopage, (Item) rec, size, InvalidOffsetNumber,
+						 false, false);
+	if (offnum == InvalidOffsetNumber)
+		elog(ERROR, "failed to add undo record to block %u", undoblk);
+
+	ItemPointerSet(ptr, undoblk, offnum);
+
+	if (!TransactionIdIsValid(opaque->max_xid) ||
+		TransactionIdFollows(xid, opaque->max_xid))
+		opaque->max_xid = xid;
+	if (!TransactionIdIsValid(opaque->min_xid) ||
+		TransactionIdPrecedes(xid, opaque->min_xid))
+		opaque->min_xid = xid;
+	if (!(rec->ur_hdr.t_flags & INPLACE_XID_COMMITTED) &&
+		TransactionIdIsNormal(prior->t_xid) &&
+		TransactionIdPrecedes(prior->t_xid, opaque->min_xid))
+		opaque->min_xid = prior->t_xid;
+
+	pfree(rec);
+}
+
+/*
+ * Fetch the version that the undo record at 'ptr' holds for row 'tid'.
+ * 'xid' is the transaction that replaced that version, and so wrote the
+ * record.  On entry, *version is the next newer version; its header is
+ * replaced by the fetched one, and so is its body if the record has one.
+ */
+void
+inplace_undo_fetch(Relation rel, ItemPointer ptr, TransactionId xid,
+				   ItemPointer tid, InplaceVersion *version)
+{
+	Buffer		buf;
+	Page		page;
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(ptr);
+	ItemId		lp = NULL;
+	InplaceUndoRecord rec = NULL;
+
+	buf = ReadBuffer(rel, ItemPointerGetBlockNumber(ptr));
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buf);
+
+	if (inplace_is_undo_page(page) &&
+		offnum >= FirstOffsetNumber && offnum <= PageGetMaxOffsetNumber(page))
+	{
+		lp = PageGetItemId(page, offnum);
+		if (ItemIdIsNormal(lp))
+			rec = (InplaceUndoRecord) PageGetItem(page, lp);
+	}
+
+	/* a record that was discarded and overwritten doesn't match */
+	if (rec == NULL || rec->ur_xid != xid || !ItemPointerEquals(&rec->ur_tid, tid))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("undo record (%u,%u) for row (%u,%u) of table \"%s\" is missing",
+						ItemPointerGetBlockNumber(ptr), offnum,
+						ItemPointerGetBlockNumber(tid),
+						ItemPointerGetOffsetNumber(tid),
+						RelationGetRelationName(rel))));
+
+	version->hdr = rec->ur_hdr;
+	if (ItemIdGetLength(lp) > INPLACE_UNDO_HEADER_SIZE)
+	{
+		MinimalTuple body = InplaceUndoGetBody(rec);
+
+		version->body = palloc(body->t_len);
+		memcpy(version->body, body, body->t_len);
+	}
+
+	UnlockReleaseBuffer(buf);
+}
+
+/*
+ * Undo the changes of aborted transactions to the row at 'offnum' of data
+ * page 'blkno'.  'page' must be registered in the caller's generic WAL
+ * record.  Returns true if anything was changed.
+ *
+ * An aborted insertion leaves a dead line pointer behind; otherwise the
+ * newest version that was not written by an aborted transaction is
+ * restored.  The item keeps its size: it was never shrunk while the undo
+ * records for it were needed, so the older body fits.
+ */
+bool
+inplace_rollback(Relation rel, Page page, BlockNumber blkno,
+				 OffsetNumber offnum)
+{
+	bool		changed = false;
+
+	for (;;)
+	{
+		ItemId		lp = PageGetItemId(page, offnum);
+		InplaceTupleHeader hdr;
+		InplaceVersion version;
+		MinimalTuple current;
+		ItemPointerData tid;
+
+		if (!ItemIdIsNormal(lp))
+			return changed;
+
+		hdr = (InplaceTupleHeader) PageGetItem(page, lp);
+		if (!inplace_version_aborted(hdr))
+			return changed;
+
+		changed = true;
+		if (hdr->t_flags & INPLACE_INSERTED)
+		{
+			ItemIdSetDead(lp);
+			return changed;
+		}
+
+		ItemPointerSet(&tid, blkno, offnum);
+		inplace_copy_item(page, offnum, &version);
+		current = version.body;
+		inplace_undo_fetch(rel, &hdr->t_undo, hdr->t_xid, &tid, &version);
+		version.hdr.t_locker = hdr->t_locker;
+
+		if (!inplace_replace_item(page, offnum, &version.hdr, version.body,
+								  ItemIdGetLength(lp)))
+			elog(ERROR, "failed to roll back row (%u,%u) of table \"%s\"",
+				 blkno, offnum, RelationGetRelationName(rel));
+		if (version.body != current)
+			pfree(version.body);
+		pfree(current);
+	}
+}
+
+/*
+ * Make the metapage forget the current undo insertion page, so that the
+ * next record goes to a new page, and the current one can be discarded
+ * once its records are no longer needed.
+ */
+void
+inplace_undo_retire(Relation rel)
+{
+	Buffer		metabuf;
+	GenericXLogState *state;
+	Page		metapage;
+
+	metabuf = inplace_lock_meta(rel, BUFFER_LOCK_EXCLUSIVE);
+	if (BlockNumberIsValid(InplacePageGetMeta(BufferGetPage(metabuf))->undo_insert))
+	{
+		state = GenericXLogStart(rel);
+		metapage = GenericXLogRegisterBuffer(state, metabuf, 0);
+		InplacePageGetMeta(metapage)->undo_insert = InvalidBlockNumber;
+		GenericXLogFinish(state);
+	}
+	UnlockReleaseBuffer(metabuf);
+}
+
+/*
+ * Discard the exclusively locked undo page in 'buf' if every record on it
+ * was written by a transaction older than 'OldestXmin', turning it into an
+ * empty data page.  The caller must have retired the page beforehand, and
+ * made sure that no row version still points to records on it.
+ *
+ * Returns true if the page was discarded.  Otherwise, *min_xid is lowered
+ * to the oldest XID the page still references.
+ */
+bool
+inplace_undo_discard(Relation rel, Buffer buf, TransactionId OldestXmin,
+					 TransactionId *min_xid)
+{
+	Page		page = BufferGetPage(buf);
+	InplacePageOpaque opaque = InplacePageGetOpaque(page);
+	GenericXLogState *state;
+
+	Assert(inplace_is_undo_page(page));
+
+	if (!TransactionIdIsValid(opaque->max_xid) ||
+		!TransactionIdPrecedes(opaque->max_xid, OldestXmin))
+	{
+		if (TransactionIdIsNormal(opaque->min_xid) &&
+			TransactionIdPrecedes(opaque->min_xid, *min_xid))
+			*min_xid = opaque->min_xid;
+		return false;
+	}
+
+	/* snapshots that don't see max_xid yet may still need the records */
+	inplace_undo_conflict(rel, opaque->max_xid);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buf, GENERIC_XLOG_FULL_IMAGE);
+	inplace_init_page(page, INPLACE_PAGE_DATA);
+	GenericXLogFinish(state);
+
+	return true;
+}
+
+/*
+ * Before WAL-logging a change that makes older versions of rows unreachable,
+ * let a standby cancel the queries that could still need them: those whose
+ * snapshot doesn't see 'horizon', the newest transaction that replaced one
+ * of the versions, as committed.  Generic WAL records don't carry a conflict
+ * horizon themselves, so this is a separate record that goes first.
+ */
+void
+inplace_undo_conflict(Relation rel, TransactionId horizon)
+{
+	if (!TransactionIdIsNormal(horizon) ||
+		!XLogStandbyInfoActive() || !RelationNeedsWAL(rel))
+		return;
+
+	LogStandbySnapshotConflict(rel->rd_locator, horizon,
+							   RelationIsAccessibleInLogicalDecoding(rel));
+}
@@ -0,0 +1,532 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_vacuum.c
+ *	  VACUUM for the inplace table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_vacuum.c
+ *
+ * NOTES
+ *	  VACUUM makes one pass over the data pages.  Every row whose current
+ *	  version was written by a transaction older than any snapshot is
+ *	  finished off: an aborted change is rolled back, a committed deletion
+ *	  leaves a dead line pointer behind, and anything else is frozen, which
+ *	  drops the pointer to the row's older versions.  Once all data pages are
+ *	  done, no row leads to an undo record written before the cutoff anymore,
+ *	  so undo pages holding only such records are discarded.
+ *
+ *	  Dead line pointers are removed from the indexes and then marked unused,
+ *	  like the heap does; rows never need pruning otherwise, since an update
+ *	  doesn't leave a dead version behind on the data page.
+ *
+ *	  There is no visibility map, so every VACUUM reads the whole relation:
+ *	  any page may hold a row whose current version is not frozen yet, or
+ *	  that points to an undo page due for discarding.  A data page that
+ *	  somebody else has pinned is skipped unless the VACUUM is aggressive;
+ *	  that also keeps this VACUUM from discarding undo pages or advancing
+ *	  relfrozenxid, since the skipped rows might need either.
+ *
+ *	  Freezing a row, removing a deleted one, and discarding an undo page
+ *	  make older versions unreachable, which snapshots on a hot standby
+ *	  might still need.  Generic WAL records can't carry a conflict horizon,
+ *	  so each such change is preceded by a standby snapshot conflict record.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "access/genam.h"
+#include "access/inplace_internal.h"
+#include "access/multixact.h"
+#include "access/tidstore.h"
+#include "access/transam.h"
+#include "commands/vacuum.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/autovacuum.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/procarray.h"
+#include "utils/rel.h"
+
+typedef struct InplaceVacState
+{
+	Relation	rel;
+	BufferAccessStrategy bstrategy;
+	struct VacuumCutoffs cutoffs;
+	bool		aggressive;		/* must freeze every page? */
+
+	Relation   *indrels;
+	int			nindexes;
+	IndexBulkDeleteResult **indstats;
+	bool		do_index_vacuuming;
+
+	/* dead line pointers waiting for their index entries to go */
+	TidStore   *dead_items;
+	VacDeadItemsInfo dead_items_info;
+
+	/* undo pages seen on the way */
+	BlockNumber *undo_blocks;
+	int			nundo_blocks;
+	int			maxundo_blocks;
+
+	/* data pages left alone because they were pinned */
+	BlockNumber skipped_pages;
+
+	TransactionId new_frozen_xid;
+	double		live_rows;
+	double		recently_dead_rows;
+	double		removed_rows;
+} InplaceVacState;
+
+
+/*
+ * Register the page in 'buf' in a generic WAL record, unless done already.
+ */
+static Page
+inplace_vacuum_change(InplaceVacState *vacst, Buffer buf, Page page,
+					  GenericXLogState **state)
+{
+	if (*state == NULL)
+	{
+		*state = GenericXLogStart(vacst->rel);
+		page = GenericXLogRegisterBuffer(*state, buf, 0);
+	}
+	return page;
+}
+
+static void
+inplace_vacuum_track_xid(InplaceVacState *vacst, TransactionId xid)
+{
+	if (TransactionIdIsNormal(xid) &&
+		TransactionIdPrecedes(xid, vacst->new_frozen_xid))
+		vacst->new_frozen_xid = xid;
+}
+
+/*
+ * Mark the given dead line pointers unused, on a page registered for WAL.
+ */
+static void
+inplace_vacuum_reap_items(Page page, OffsetNumber *offsets, int noffsets)
+{
+	for (int i = 0; i < noffsets; i++)
+	{
+		ItemId		lp = PageGetItemId(page, offsets[i]);
+
+		Assert(ItemIdIsDead(lp));
+		ItemIdSetUnused(lp);
+	}
+
+	if (inplace_page_is_empty(page))
+		inplace_init_page(page, INPLACE_PAGE_DATA);
+	else
+		PageTruncateLinePointerArray(page);
+}
+
+/*
+ * First pass over one data page, exclusively locked for cleanup in 'buf'.
+ * Returns the free space on the page, or 0 if the page still has dead line
+ * pointers that are to be removed in the second pass.
+ */
+static Size
+inplace_vacuum_page(InplaceVacState *vacst, Buffer buf, BlockNumber blkno)
+{
+	Relation	rel = vacst->rel;
+	TransactionId OldestXmin = vacst->cutoffs.OldestXmin;
+	Page		page = BufferGetPage(buf);
+	GenericXLogState *state = NULL;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	int			ndead = 0;
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	TransactionId conflict_xid = InvalidTransactionId;
+	Size		freespace;
+
+	for (OffsetNumber offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		ItemId		lp = PageGetItemId(page, offnum);
+		InplaceTupleHeader hdr;
+		TransactionId xid;
+
+		if (!ItemIdIsUsed(lp))
+			continue;
+		if (ItemIdIsDead(lp))
+		{
+			deadoffsets[ndead++] = offnum;
+			continue;
+		}
+
+		hdr = (InplaceTupleHeader) PageGetItem(page, lp);
+		xid = hdr->t_xid;
+
+		if (TransactionIdIsNormal(xid) &&
+			TransactionIdPrecedes(xid, OldestXmin) &&
+			!inplace_version_committed(hdr))
+		{
+			/* older than any running transaction, so it aborted */
+			page = inplace_vacuum_change(vacst, buf, page, &state);
+			inplace_rollback(rel, page, blkno, offnum);
+
+			lp = PageGetItemId(page, offnum);
+			if (ItemIdIsDead(lp))
+			{
+				deadoffsets[ndead++] = offnum;
+				vacst->removed_rows++;
+				continue;
+			}
+			hdr = (InplaceTupleHeader) PageGetItem(page, lp);
+			xid = hdr->t_xid;
+		}
+
+		if (TransactionIdIsNormal(xid) &&
+			TransactionIdPrecedes(xid, OldestXmin) &&
+			inplace_version_committed(hdr))
+		{
+			page = inplace_vacuum_change(vacst, buf, page, &state);
+			lp = PageGetItemId(page, offnum);
+			hdr = (InplaceTupleHeader) PageGetItem(page, lp);
+
+			/* the versions it replaced become unreachable */
+			if (TransactionIdFollows(xid, conflict_xid))
+				conflict_xid = xid;
+
+			if (hdr->t_flags & INPLACE_DELETED)
+			{
+				ItemIdSetDead(lp);
+				deadoffsets[ndead++] = offnum;
+				vacst->removed_rows++;
+				continue;
+			}
+			else
+			{
+				InplaceTupleHeaderData newhdr;
+				MinimalTuple body = InplaceItemGetBody(hdr);
+
+				/* freeze, and give back the slack left by updates */
+				newhdr = *hdr;
+				newhdr.t_xid = FrozenTransactionId;
+				newhdr.t_flags = INPLACE_INSERTED;
+				ItemPointerSetInvalid(&newhdr.t_undo);
+				ItemPointerSetInvalid(&newhdr.t_ctid);
+				if (!inplace_replace_item(page, offnum, &newhdr, body,
+										  inplace_item_size(body)))
+					elog(ERROR, "failed to freeze row (%u,%u) of table \"%s\"",
+						 blkno, offnum, RelationGetRelationName(rel));
+				hdr = inplace_get_item(page, offnum);
+			}
+		}
+
+		if (TransactionIdIsNormal(hdr->t_locker) &&
+			TransactionIdPrecedes(hdr->t_locker, OldestXmin))
+		{
+			page = inplace_vacuum_change(vacst, buf, page, &state);
+			hdr = inplace_get_item(page, offnum);
+			hdr->t_locker = InvalidTransactionId;
+		}
+
+		inplace_vacuum_track_xid(vacst, hdr->t_xid);
+		inplace_vacuum_track_xid(vacst, hdr->t_locker);
+
+		if ((hdr->t_flags & INPLACE_DELETED) &&
+			!TransactionIdIsInProgress(hdr->t_xid) &&
+			inplace_version_committed(hdr))
+			vacst->recently_dead_rows++;
+		else
+			vacst->live_rows++;
+	}
+
+	if (ndead > 0 && vacst->nindexes == 0)
+	{
+		/* no index entries to take care of, so reclaim them right away */
+		page = inplace_vacuum_change(vacst, buf, page, &state);
+		inplace_vacuum_reap_items(page, deadoffsets, ndead);
+		ndead = 0;
+	}
+
+	if (state != NULL)
+	{
+		PageRepairFragmentation(page);
+		inplace_undo_conflict(rel, conflict_xid);
+		GenericXLogFinish(state);
+		page = BufferGetPage(buf);
+	}
+
+	if (ndead > 0 && vacst->do_index_vacuuming)
+	{
+		TidStoreSetBlockOffsets(vacst->dead_items, blkno, deadoffsets, ndead);
+		vacst->dead_items_info.num_items += ndead;
+		return 0;
+	}
+
+	freespace = PageGetHeapFreeSpace(page);
+	return freespace;
+}
+
+/*
+ * Remove the collected dead line pointers from all indexes, and then mark
+ * them unused.
+ */
+static void
+inplace_vacuum_dead_items(InplaceVacState *vacst)
+{
+	TidStoreIter *iter;
+	TidStoreIterResult *iter_result;
+
+	for (int i = 0; i < vacst->nindexes; i++)
+	{
+		IndexVacuumInfo ivinfo;
+
+		ivinfo.index = vacst->indrels[i];
+		ivinfo.heaprel = vacst->rel;
+		ivinfo.analyze_only = false;
+		ivinfo.report_progress = false;
+		ivinfo.estimated_count = true;
+		ivinfo.message_level = DEBUG2;
+		ivinfo.num_heap_tuples = vacst->rel->rd_rel->reltuples;
+		ivinfo.strategy = vacst->bstrategy;
+
+		vacst->indstats[i] = vac_bulkdel_one_index(&ivinfo,
+												   vacst->indstats[i],
+												   vacst->dead_items,
+												   &vacst->dead_items_info);
+	}
+
+	iter = TidStoreBeginIterate(vacst->dead_items);
+	while ((iter_result = TidStoreIterateNext(iter)) != NULL)
+	{
+		BlockNumber blkno = iter_result->blkno;
+		Buffer		buf;
+		Page		page;
+		GenericXLogState *state;
+		Size		freespace;
+
+		vacuum_delay_point();
+
+		buf = ReadBufferExtended(vacst->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 vacst->bstrategy);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		state = GenericXLogStart(vacst->rel);
+		page = GenericXLogRegisterBuffer(state, buf, 0);
+		inplace_vacuum_reap_items(page, iter_result->offsets,
+								  iter_result->num_offsets);
+		GenericXLogFinish(state);
+
+		freespace = PageGetHeapFreeSpace(BufferGetPage(buf));
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(vacst->rel, blkno, freespace);
+	}
+	TidStoreEndIterate(iter);
+
+	TidStoreDestroy(vacst->dead_items);
+	vacst->dead_items = TidStoreCreateLocal(vacst->dead_items_info.max_bytes,
+											true);
+	vacst->dead_items_info.num_items = 0;
+}
+
+/*
+ * Discard the undo pages seen during the first pass that are no longer
+ * needed, and make them available for rows again.
+ */
+static void
+inplace_vacuum_undo(InplaceVacState *vacst)
+{
+	TransactionId min_xid = vacst->new_frozen_xid;
+
+	for (int i = 0; i < vacst->nundo_blocks; i++)
+	{
+		BlockNumber blkno = vacst->undo_blocks[i];
+		Buffer		buf;
+		bool		discarded = false;
+		Size		freespace = 0;
+
+		vacuum_delay_point();
+
+		buf = ReadBufferExtended(vacst->rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 vacst->bstrategy);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+
+		/* it can't have changed kind, but be careful */
+		if (inplace_is_undo_page(BufferGetPage(buf)))
+		{
+			discarded = inplace_undo_discard(vacst->rel, buf,
+											 vacst->cutoffs.OldestXmin,
+											 &min_xid);
+			if (discarded)
+				freespace = PageGetHeapFreeSpace(BufferGetPage(buf));
+		}
+		UnlockReleaseBuffer(buf);
+
+		if (discarded)
+			RecordPageWithFreeSpace(vacst->rel, blkno, freespace);
+	}
+
+	vacst->new_frozen_xid = min_xid;
+}
+
+void
+inplace_vacuum_rel(Relation rel, VacuumParams *params,
+				   BufferAccessStrategy bstrategy)
+{
+	InplaceVacState vacst;
+	BlockNumber nblocks;
+	int			vac_work_mem = AmAutoVacuumWorkerProcess() &&
+		autovacuum_work_mem != -1 ?
+		autovacuum_work_mem : maintenance_work_mem;
+
+	memset(&vacst, 0, sizeof(vacst));
+	vacst.rel = rel;
+	vacst.bstrategy = bstrategy;
+	vacst.aggressive = vacuum_get_cutoffs(rel, params, &vacst.cutoffs);
+	vacst.new_frozen_xid = vacst.cutoffs.OldestXmin;
+
+	/*
+	 * Undo records go to a new page from now on, so that all undo pages that
+	 * exist now can be discarded by this VACUUM or a later one.
+	 */
+	inplace_undo_retire(rel);
+
+	vac_open_indexes(rel, RowExclusiveLock, &vacst.nindexes, &vacst.indrels);
+	vacst.indstats = palloc0(sizeof(IndexBulkDeleteResult *) *
+							 Max(vacst.nindexes, 1));
+	vacst.do_index_vacuuming = vacst.nindexes > 0 &&
+		params->index_cleanup != VACOPTVALUE_DISABLED;
+
+	vacst.dead_items_info.max_bytes = vac_work_mem * 1024L;
+	vacst.dead_items_info.num_items = 0;
+	vacst.dead_items = TidStoreCreateLocal(vacst.dead_items_info.max_bytes,
+										   true);
+
+	vacst.maxundo_blocks = 16;
+	vacst.undo_blocks = palloc(sizeof(BlockNumber) * vacst.maxundo_blocks);
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+	for (BlockNumber blkno = INPLACE_METAPAGE_BLKNO + 1; blkno < nblocks; blkno++)
+	{
+		Buffer		buf;
+		Page		page;
+		Size		freespace = 0;
+		bool		record_fsm = false;
+
+		vacuum_delay_point();
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								 bstrategy);
+		if (!ConditionalLockBufferForCleanup(buf))
+		{
+			/*
+			 * Like lazy_scan_heap, don't wait for the pin to go away unless
+			 * we have to.  Undo pages only need to be remembered here, so a
+			 * share lock is enough to tell what kind of page it is.
+			 */
+			LockBuffer(buf, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buf);
+			if (!PageIsNew(page) && inplace_is_data_page(page))
+			{
+				if (!vacst.aggressive)
+				{
+					vacst.skipped_pages++;
+					UnlockReleaseBuffer(buf);
+					continue;
+				}
+				LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+				LockBufferForCleanup(buf);
+			}
+		}
+		page = BufferGetPage(buf);
+
+		if (PageIsNew(page))
+		{
+			/* left behind by a failed extension; see lazy_scan_new_or_empty */
+			if (GetRecordedFreeSpace(rel, blkno) == 0)
+			{
+				freespace = BLCKSZ - SizeOfPageHeaderData;
+				record_fsm = true;
+			}
+		}
+		else if (inplace_is_undo_page(page))
+		{
+			if (vacst.nundo_blocks >= vacst.maxundo_blocks)
+			{
+				vacst.maxundo_blocks *= 2;
+				vacst.undo_blocks = repalloc(vacst.undo_blocks,
+											 sizeof(BlockNumber) * vacst.maxundo_blocks);
+			}
+			vacst.undo_blocks[vacst.nundo_blocks++] = blkno;
+		}
+		else if (inplace_is_data_page(page))
+		{
+			freespace = inplace_vacuum_page(&vacst, buf, blkno);
+			record_fsm = freespace > 0;
+		}
+		UnlockReleaseBuffer(buf);
+
+		if (record_fsm)
+			RecordPageWithFreeSpace(rel, blkno, freespace);
+
+		if (vacst.do_index_vacuuming &&
+			TidStoreMemoryUsage(vacst.dead_items) > vacst.dead_items_info.max_bytes)
+			inplace_vacuum_dead_items(&vacst);
+	}
+
+	if (vacst.do_index_vacuuming && vacst.dead_items_info.num_items > 0)
+		inplace_vacuum_dead_items(&vacst);
+
+	/*
+	 * Rows on a skipped page may still point to any of the undo pages, and
+	 * may carry XIDs older than the new relfrozenxid would be.  Leave both
+	 * to the next VACUUM.
+	 */
+	if (vacst.skipped_pages == 0)
+		inplace_vacuum_undo(&vacst);
+	else
+	{
+		vacst.new_frozen_xid = InvalidTransactionId;
+		vacst.live_rows = vac_estimate_reltuples(rel, nblocks,
+												 nblocks - vacst.skipped_pages,
+												 vacst.live_rows);
+	}
+	FreeSpaceMapVacuum(rel);
+
+	if (params->index_cleanup != VACOPTVALUE_DISABLED)
+	{
+		for (int i = 0; i < vacst.nindexes; i++)
+		{
+			IndexVacuumInfo ivinfo;
+			IndexBulkDeleteResult *istat;
+
+			ivinfo.index = vacst.indrels[i];
+			ivinfo.heaprel = rel;
+			ivinfo.analyze_only = false;
+			ivinfo.report_progress = false;
+			ivinfo.estimated_count = false;
+			ivinfo.message_level = DEBUG2;
+			ivinfo.num_heap_tuples = vacst.live_rows;
+			ivinfo.strategy = bstrategy;
+
+			istat = vac_cleanup_one_index(&ivinfo, vacst.indstats[i]);
+			if (istat != NULL && !istat->estimated_count)
+				vac_update_relstats(vacst.indrels[i], istat->num_pages,
+									istat->num_index_tuples, 0, false,
+									InvalidTransactionId, InvalidMultiXactId,
+									NULL, NULL, false);
+			if (istat != NULL)
+				pfree(istat);
+		}
+	}
+
+	TidStoreDestroy(vacst.dead_items);
+	vac_close_indexes(vacst.nindexes, vacst.indrels, NoLock);
+
+	vac_update_relstats(rel, RelationGetNumberOfBlocks(rel), vacst.live_rows,
+						0, vacst.nindexes > 0, vacst.new_frozen_xid,
+						vacst.cutoffs.OldestMxact, NULL, NULL, false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel), rel->rd_rel->relisshared,
+						 vacst.live_rows, vacst.recently_dead_rows, 0, 0,
+						 InvalidXLogRecPtr);
+}
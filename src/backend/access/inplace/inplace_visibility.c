@@ -0,0 +1,325 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_visibility.c
+ *	  row visibility for the inplace table access method
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/inplace/inplace_visibility.c
+ *
+ * NOTES
+ *	  A reader copies the current version of a row out of the data page
+ *	  under a share lock, and then walks the chain of older versions in undo,
+ *	  newest first, until it finds one that its snapshot can see.  It keeps
+ *	  the data page pinned meanwhile, which prevents VACUUM from freezing the
+ *	  row and discarding undo records that the walk may still need.
+ *
+ *	  Versions written by aborted transactions are simply skipped; see
+ *	  inplace_rollback() for how they are eventually removed.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/inplace_internal.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "executor/tuptable.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+
+/*
+ * Did the transaction that wrote the version with header 'hdr' commit?  Not
+ * to be asked while that transaction may still be running.
+ */
+bool
+inplace_version_committed(InplaceTupleHeader hdr)
+{
+	if (!TransactionIdIsNormal(hdr->t_xid) ||
+		(hdr->t_flags & INPLACE_XID_COMMITTED))
+		return true;
+	return TransactionIdDidCommit(hdr->t_xid);
+}
+
+/*
+ * Was the version with header 'hdr' written by a transaction that aborted,
+ * or crashed?
+ */
+bool
+inplace_version_aborted(InplaceTupleHeader hdr)
+{
+	TransactionId xid = hdr->t_xid;
+
+	if (!TransactionIdIsNormal(xid) || (hdr->t_flags & INPLACE_XID_COMMITTED))
+		return false;
+	if (TransactionIdIsCurrentTransactionId(xid))
+		return false;
+	if (TransactionIdIsInProgress(xid))
+		return false;
+	return !TransactionIdDidCommit(xid);
+}
+
+/*
+ * Does the MVCC snapshot 'snapshot' see the change that created the version
+ * with header 'hdr'?  For the current transaction, that means the change
+ * was made by an earlier command.
+ */
+bool
+inplace_version_visible(InplaceTupleHeader hdr, Snapshot snapshot)
+{
+	TransactionId xid = hdr->t_xid;
+
+	if (!TransactionIdIsNormal(xid))
+		return true;
+	if (TransactionIdIsCurrentTransactionId(xid))
+		return hdr->t_cid < snapshot->curcid;
+	if (XidInMVCCSnapshot(xid, snapshot))
+		return false;
+	return inplace_version_committed(hdr);
+}
+
+/*
+ * Is the row whose current version has header 'hdr' dead to everyone?
+ */
+bool
+inplace_row_is_dead(InplaceTupleHeader hdr, GlobalVisState *vistest)
+{
+	if (!TransactionIdIsNormal(hdr->t_xid))
+		return false;
+
+	if (hdr->t_flags & INPLACE_INSERTED)
+		return inplace_version_aborted(hdr);
+
+	if (hdr->t_flags & INPLACE_DELETED)
+		return GlobalVisTestIsRemovableXid(vistest, hdr->t_xid) &&
+			inplace_version_committed(hdr);
+
+	return false;
+}
+
+/*
+ * Step from *version to the next older version of row 'tid'.
+ */
+static void
+inplace_step_back(Relation rel, ItemPointer tid, InplaceVersion *version)
+{
+	MinimalTuple body = version->body;
+
+	inplace_undo_fetch(rel, &version->hdr.t_undo, version->hdr.t_xid, tid,
+					   version);
+	if (version->body != body)
+		pfree(body);
+}
+
+/*
+ * Step over the versions in *version, a palloc'd copy of the current version
+ * of row 'tid', that were written by aborted transactions.  Returns false if
+ * that leaves nothing, because the row was inserted by an aborted
+ * transaction.
+ */
+bool
+inplace_skip_aborted(Relation rel, ItemPointer tid, InplaceVersion *version)
+{
+	while (inplace_version_aborted(&version->hdr))
+	{
+		if (version->hdr.t_flags & INPLACE_INSERTED)
+			return false;
+		inplace_step_back(rel, tid, version);
+	}
+	return true;
+}
+
+/*
+ * Walk from the version of row 'tid' in *version to the one that 'snapshot'
+ * sees, and leave that in *version.  On entry, *version must hold a palloc'd
+ * copy of the current version; on return, it holds a palloc'd copy of the
+ * version found, if any.
+ *
+ * Like the heap's visibility routines, this fills in snapshot->xmin and
+ * snapshot->xmax for a dirty snapshot.
+ */
+InplaceFetchResult
+inplace_resolve_version(Relation rel, ItemPointer tid, Snapshot snapshot,
+						InplaceVersion *version)
+{
+	bool		check_serializable = false;
+
+	if (snapshot->snapshot_type == SNAPSHOT_MVCC)
+		check_serializable = CheckForSerializableConflictOutNeeded(rel, snapshot);
+	else if (snapshot->snapshot_type == SNAPSHOT_DIRTY)
+	{
+		snapshot->xmin = snapshot->xmax = InvalidTransactionId;
+		snapshot->speculativeToken = 0;
+	}
+
+	for (;;)
+	{
+		InplaceTupleHeader hdr = &version->hdr;
+		TransactionId xid = hdr->t_xid;
+		bool		visible;
+
+		switch (snapshot->snapshot_type)
+		{
+			case SNAPSHOT_MVCC:
+				visible = inplace_version_visible(hdr, snapshot);
+				if (!visible && check_serializable &&
+					TransactionIdIsNormal(xid) &&
+					!TransactionIdIsCurrentTransactionId(xid) &&
+					TransactionIdFollowsOrEquals(xid, TransactionXmin))
+					CheckForSerializableConflictOut(rel, xid, snapshot);
+				break;
+
+			case SNAPSHOT_SELF:
+				if (!TransactionIdIsNormal(xid) ||
+					TransactionIdIsCurrentTransactionId(xid))
+					visible = true;
+				else if (!(hdr->t_flags & INPLACE_XID_COMMITTED) &&
+						 TransactionIdIsInProgress(xid))
+					visible = false;
+				else
+					visible = inplace_version_committed(hdr);
+				break;
+
+			case SNAPSHOT_ANY:
+				return INPLACE_FETCH_OK;
+
+			case SNAPSHOT_DIRTY:
+				if (!TransactionIdIsNormal(xid) ||
+					TransactionIdIsCurrentTransactionId(xid))
+					visible = true;
+				else if (!(hdr->t_flags & INPLACE_XID_COMMITTED) &&
+						 TransactionIdIsInProgress(xid))
+				{
+					/*
+					 * Report the row with the in-progress change applied, and
+					 * tell the caller whom to wait for.
+					 */
+					if (hdr->t_flags & INPLACE_INSERTED)
+					{
+						snapshot->xmin = xid;
+						if (hdr->t_flags & INPLACE_SPECULATIVE)
+							snapshot->speculativeToken =
+								ItemPointerGetBlockNumberNoCheck(&hdr->t_ctid);
+					}
+					else
+						snapshot->xmax = xid;
+					return INPLACE_FETCH_OK;
+				}
+				else
+					visible = inplace_version_committed(hdr);
+				break;
+
+			case SNAPSHOT_NON_VACUUMABLE:
+				if (inplace_version_aborted(hdr))
+					visible = false;
+				else if ((hdr->t_flags & INPLACE_DELETED) &&
+						 GlobalVisTestIsRemovableXid(snapshot->vistest, xid) &&
+						 inplace_version_committed(hdr))
+					return INPLACE_FETCH_INVISIBLE;
+				else
+					return INPLACE_FETCH_OK;
+				break;
+
+			default:
+				elog(ERROR, "unsupported snapshot type %d for inplace table",
+					 (int) snapshot->snapshot_type);
+				visible = false;	/* keep compiler quiet */
+				break;
+		}
+
+		if (visible)
+			return (hdr->t_flags & INPLACE_DELETED) ?
+				INPLACE_FETCH_INVISIBLE : INPLACE_FETCH_OK;
+
+		if (hdr->t_flags & INPLACE_INSERTED)
+			return INPLACE_FETCH_INVISIBLE;
+
+		inplace_step_back(rel, tid, version);
+	}
+}
+
+/*
+ * Fetch the version of row 'tid' that 'snapshot' sees into *version.  'buf'
+ * is the pinned, but not locked, data page holding the row; it stays pinned.
+ *
+ * If 'all_dead' is not NULL, *all_dead is set to whether the row is dead to
+ * everyone.
+ */
+InplaceFetchResult
+inplace_fetch_version(Relation rel, Buffer buf, ItemPointer tid,
+					  Snapshot snapshot, InplaceVersion *version,
+					  bool *all_dead)
+{
+	Page		page = BufferGetPage(buf);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	InplaceTupleHeader hdr;
+	InplaceFetchResult result;
+
+	Assert(BufferGetBlockNumber(buf) == ItemPointerGetBlockNumber(tid));
+
+	if (all_dead)
+		*all_dead = false;
+
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	hdr = inplace_get_item(page, offnum);
+	if (hdr == NULL)
+	{
+		if (all_dead &&
+			inplace_is_data_page(page) &&
+			offnum >= FirstOffsetNumber &&
+			offnum <= PageGetMaxOffsetNumber(page) &&
+			ItemIdIsDead(PageGetItemId(page, offnum)))
+			*all_dead = true;
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		return INPLACE_FETCH_NONE;
+	}
+	inplace_copy_item(page, offnum, version);
+	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+	if (all_dead &&
+		inplace_row_is_dead(&version->hdr, GlobalVisTestFor(rel)))
+	{
+		*all_dead = true;
+		pfree(version->body);
+		version->body = NULL;
+		return INPLACE_FETCH_DEAD;
+	}
+
+	result = inplace_resolve_version(rel, tid, snapshot, version);
+	if (result != INPLACE_FETCH_OK)
+	{
+		pfree(version->body);
+		version->body = NULL;
+	}
+	return result;
+}
+
+/*
+ * Store a version of row 'tid' in 'slot', which takes over the version's
+ * body.
+ */
+void
+inplace_store_version(Relation rel, InplaceVersion *version, ItemPointer tid,
+					  TupleTableSlot *slot)
+{
+	MemoryContext oldcxt;
+	MinimalTuple mtup;
+
+	oldcxt = MemoryContextSwitchTo(slot->tts_mcxt);
+	mtup = heap_copy_minimal_tuple(version->body);
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(version->body);
+	version->body = NULL;
+
+	ExecForceStoreMinimalTuple(mtup, slot, true);
+	slot->tts_tableOid = RelationGetRelid(rel);
+	slot->tts_tid = *tid;
+}
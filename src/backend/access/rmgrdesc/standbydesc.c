@@ -73,6 +73,16 @@ standby_desc(StringInfo buf, XLogReaderState *record)
 								   xlrec->dbId, xlrec->tsId,
 								   xlrec->relcacheInitFileInval);
 	}
+	else if (info == XLOG_SNAPSHOT_CONFLICT)
+	{
+		xl_snapshot_conflict *xlrec = (xl_snapshot_conflict *) rec;
+
+		appendStringInfo(buf, "rel %u/%u/%u; snapshotConflictHorizon %u, isCatalogRel %c",
+						 xlrec->locator.spcOid, xlrec->locator.dbOid,
+						 xlrec->locator.relNumber,
+						 xlrec->snapshotConflictHorizon,
+						 xlrec->isCatalogRel ? 'T' : 'F');
+	}
 }
 
 const char *
@@ -91,6 +101,9 @@ standby_identify(uint8 info)
 		case XLOG_INVALIDATIONS:
 			id = "INVALIDATIONS";
 			break;
+		case XLOG_SNAPSHOT_CONFLICT:
+			id = "SNAPSHOT_CONFLICT";
+			break;
 	}
 
 	return id;
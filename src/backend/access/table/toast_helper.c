@@ -18,6 +18,8 @@
 #include "access/toast_helper.h"
 #include "access/toast_internals.h"
 #include "catalog/pg_type_d.h"
+#include "utils/attoptcache.h"
+#include "utils/rel.h"
 #include "varatt.h"
 
 
@@ -229,8 +231,29 @@ toast_tuple_try_compression(ToastTupleContext *ttc, int attribute)
 	Datum	   *value = &ttc->ttc_values[attribute];
 	Datum		new_value;
 	ToastAttrInfo *attr = &ttc->ttc_attr[attribute];
+	char		cmethod = attr->tai_compression;
+	int			clevel = 0;
 
-	new_value = toast_compress_datum(*value, attr->tai_compression);
+	/*
+	 * The column's compression_level option only matters for methods that
+	 * have levels, so don't bother looking it up otherwise.
+	 */
+	if (!CompressionMethodIsValid(cmethod))
+		cmethod = default_toast_compression;
+	if (cmethod == TOAST_ZSTD_COMPRESSION)
+	{
+		AttributeOpts *aopt;
+
+		aopt = get_attribute_options(RelationGetRelid(ttc->ttc_rel),
+									 attribute + 1);
+		if (aopt != NULL)
+		{
+			clevel = aopt->compression_level;
+			pfree(aopt);
+		}
+	}
+
+	new_value = toast_compress_datum(*value, cmethod, clevel);
 
 	if (DatumGetPointer(new_value) != NULL)
 	{
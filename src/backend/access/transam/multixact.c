@@ -87,6 +87,7 @@
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/spin.h"
 #include "utils/fmgrprotos.h"
 #include "utils/guc_hooks.h"
 #include "utils/memutils.h"
@@ -370,6 +371,41 @@ typedef struct mXactCacheEnt
 static dclist_head MXactCache = DCLIST_STATIC_INIT(MXactCache);
 static MemoryContext MXactContext = NULL;
 
+/*
+ * Definitions for the shared MultiXactId member cache.
+ *
+ * The backend-local cache above only helps with multixacts the backend has
+ * seen in the current transaction.  Multixacts created by foreign key checks
+ * and other row lockers in one backend are, however, typically looked at by
+ * other backends soon after; without a shared cache, each of them has to
+ * read both the offsets and the members SLRU to find out the members.
+ *
+ * So we also keep the members of recently created or looked-up multixacts
+ * in a direct-mapped cache in shared memory, indexed by the MultiXactId.  As
+ * the membership of a multixact never changes, entries never need to be
+ * invalidated: a slot is simply overwritten by the next multixact mapping to
+ * it.  Callers must perform the usual range checks against oldestMultiXactId
+ * and nextMXact before consulting the cache, so that entries for multixacts
+ * that have been truncated away are never returned.
+ *
+ * Multixacts with more than MXACT_SHARED_CACHE_MAX_MEMBERS members are not
+ * cached; they're rare and comparatively expensive anyway.  Each slot is
+ * protected by its own spinlock, which is only held while copying the few
+ * members in or out.
+ */
+#define MXACT_SHARED_CACHE_SLOTS		4096
+#define MXACT_SHARED_CACHE_MAX_MEMBERS	8
+
+typedef struct MXactSharedCacheSlot
+{
+	slock_t		mutex;
+	MultiXactId multi;			/* InvalidMultiXactId if empty */
+	int			nmembers;
+	MultiXactMember members[MXACT_SHARED_CACHE_MAX_MEMBERS];
+} MXactSharedCacheSlot;
+
+static MXactSharedCacheSlot *MXactSharedCache;
+
 #ifdef MULTIXACT_DEBUG
 #define debug_elog2(a,b) elog(a,b)
 #define debug_elog3(a,b,c) elog(a,b,c)
@@ -396,6 +432,9 @@ static MultiXactId mXactCacheGetBySet(int nmembers, MultiXactMember *members);
 static int	mXactCacheGetById(MultiXactId multi, MultiXactMember **members);
 static void mXactCachePut(MultiXactId multi, int nmembers,
 						  MultiXactMember *members);
+static int	mXactSharedCacheGet(MultiXactId multi, MultiXactMember **members);
+static void mXactSharedCachePut(MultiXactId multi, int nmembers,
+								MultiXactMember *members);
 
 static char *mxstatus_to_string(MultiXactStatus status);
 
@@ -1005,6 +1044,9 @@ RecordNewMultiXact(MultiXactId multi, MultiXactOffset offset,
 
 	if (prevlock != NULL)
 		LWLockRelease(prevlock);
+
+	/* Other backends are likely to look at the new multixact soon */
+	mXactSharedCachePut(multi, nmembers, members);
 }
 
 /*
@@ -1377,6 +1419,19 @@ GetMultiXactIdMembers(MultiXactId multi, MultiXactMember **members,
 				 errmsg("MultiXactId %u has not been created yet -- apparent wraparound",
 						multi)));
 
+	/*
+	 * Now that we know the multixact is within the valid range, see if its
+	 * members are in the shared cache.
+	 */
+	length = mXactSharedCacheGet(multi, members);
+	if (length >= 0)
+	{
+		debug_elog3(DEBUG2, "GetMembers: found %s in the shared cache",
+					mxid_to_string(multi, length, *members));
+		mXactCachePut(multi, length, *members);
+		return length;
+	}
+
 	/*
 	 * Find out the offset at which we need to start reading MultiXactMembers
 	 * and the number of members in the multixact.  We determine the latter as
@@ -1560,9 +1615,10 @@ retry:
 	Assert(truelength > 0);
 
 	/*
-	 * Copy the result into the local cache.
+	 * Copy the result into the local and shared caches.
 	 */
 	mXactCachePut(multi, truelength, ptr);
+	mXactSharedCachePut(multi, truelength, ptr);
 
 	debug_elog3(DEBUG2, "GetMembers: no cache for %s",
 				mxid_to_string(multi, truelength, ptr));
@@ -1742,6 +1798,67 @@ mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 	}
 }
 
+/*
+ * mXactSharedCacheGet
+ *		returns the composing MultiXactMember set from the shared cache for
+ *		a given MultiXactId, if present.
+ *
+ * If successful, *members is set to the address of a palloc'd copy of the
+ * MultiXactMember set.  Return value is number of members, or -1 on failure.
+ */
+static int
+mXactSharedCacheGet(MultiXactId multi, MultiXactMember **members)
+{
+	MXactSharedCacheSlot *slot;
+	MultiXactMember buf[MXACT_SHARED_CACHE_MAX_MEMBERS];
+	int			nmembers = -1;
+
+	slot = &MXactSharedCache[multi % MXACT_SHARED_CACHE_SLOTS];
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->multi == multi)
+	{
+		nmembers = slot->nmembers;
+		memcpy(buf, slot->members, nmembers * sizeof(MultiXactMember));
+	}
+	SpinLockRelease(&slot->mutex);
+
+	if (nmembers < 0)
+		return -1;
+
+	*members = (MultiXactMember *) palloc(nmembers * sizeof(MultiXactMember));
+	memcpy(*members, buf, nmembers * sizeof(MultiXactMember));
+
+	return nmembers;
+}
+
+/*
+ * mXactSharedCachePut
+ *		Add a MultiXactId and its composing set into the shared cache.
+ *
+ * If the multixact has too many members to be cached, the slot it maps to is
+ * emptied instead, so that it doesn't keep an unrelated older entry around
+ * for longer than necessary.
+ */
+static void
+mXactSharedCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
+{
+	MXactSharedCacheSlot *slot;
+
+	slot = &MXactSharedCache[multi % MXACT_SHARED_CACHE_SLOTS];
+
+	SpinLockAcquire(&slot->mutex);
+	if (nmembers <= MXACT_SHARED_CACHE_MAX_MEMBERS)
+	{
+		slot->multi = multi;
+		slot->nmembers = nmembers;
+		memcpy(slot->members, members, nmembers * sizeof(MultiXactMember));
+	}
+	else
+		slot->multi = InvalidMultiXactId;
+	SpinLockRelease(&slot->mutex);
+}
+
 static char *
 mxstatus_to_string(MultiXactStatus status)
 {
@@ -1933,7 +2050,8 @@ multixact_twophase_postabort(TransactionId xid, uint16 info,
 /*
  * Initialization of shared memory for MultiXact.  We use two SLRU areas,
  * thus double memory.  Also, reserve space for the shared MultiXactState
- * struct and the per-backend MultiXactId arrays (two of those, too).
+ * struct and the per-backend MultiXactId arrays (two of those, too), and for
+ * the shared member cache.
  */
 Size
 MultiXactShmemSize(void)
@@ -1948,6 +2066,8 @@ MultiXactShmemSize(void)
 	size = SHARED_MULTIXACT_STATE_SIZE;
 	size = add_size(size, SimpleLruShmemSize(multixact_offset_buffers, 0));
 	size = add_size(size, SimpleLruShmemSize(multixact_member_buffers, 0));
+	size = add_size(size, mul_size(sizeof(MXactSharedCacheSlot),
+								   MXACT_SHARED_CACHE_SLOTS));
 
 	return size;
 }
@@ -1997,6 +2117,25 @@ MultiXactShmemInit(void)
 	 */
 	OldestMemberMXactId = MultiXactState->perBackendXactIds;
 	OldestVisibleMXactId = OldestMemberMXactId + MaxOldestSlot;
+
+	/* Initialize the shared member cache */
+	MXactSharedCache = ShmemInitStruct("Shared MultiXact Member Cache",
+									   mul_size(sizeof(MXactSharedCacheSlot),
+												MXACT_SHARED_CACHE_SLOTS),
+									   &found);
+	if (!IsUnderPostmaster)
+	{
+		Assert(!found);
+
+		for (int i = 0; i < MXACT_SHARED_CACHE_SLOTS; i++)
+		{
+			SpinLockInit(&MXactSharedCache[i].mutex);
+			MXactSharedCache[i].multi = InvalidMultiXactId;
+			MXactSharedCache[i].nmembers = 0;
+		}
+	}
+	else
+		Assert(found);
 }
 
 /*
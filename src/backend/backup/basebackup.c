@@ -42,6 +42,7 @@
 #include "storage/checksum.h"
 #include "storage/dsm_impl.h"
 #include "storage/ipc.h"
+#include "storage/page_compression.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
@@ -1999,9 +2000,11 @@ verify_page_checksum(Page page, XLogRecPtr start_lsn, BlockNumber blkno,
 	 * base backup. Otherwise, they might have been written only halfway and
 	 * the checksum would not be valid.  However, replaying WAL would
 	 * reinstate the correct page in this case. We also skip completely new
-	 * pages, since they don't have a checksum yet.
+	 * pages, since they don't have a checksum yet, and compressed pages,
+	 * whose checksum covers the uncompressed image.
 	 */
-	if (PageIsNew(page) || PageGetLSN(page) >= start_lsn)
+	if (PageIsNew(page) || PageIsCompressedSlot(page) ||
+		PageGetLSN(page) >= start_lsn)
 		return true;
 
 	/* Perform the actual checksum calculation. */
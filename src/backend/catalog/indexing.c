@@ -98,6 +98,9 @@ CatalogIndexInsert(CatalogIndexState indstate, HeapTuple heapTuple,
 	/* When only updating summarized indexes, the tuple has to be HOT. */
 	Assert((!onlySummarized) || HeapTupleIsHeapOnly(heapTuple));
 
+	/* System catalogs never allow WARM updates */
+	Assert(updateIndexes != TU_Warm);
+
 	/*
 	 * Get information from the state structure.  Fall out if nothing to do.
 	 */
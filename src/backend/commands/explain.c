@@ -1994,6 +1994,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (es->analyze)
 				ExplainPropertyFloat("Heap Fetches", NULL,
 									 planstate->instrument->ntuples2, 0, es);
+			if (es->analyze && es->verbose)
+				ExplainPropertyFloat("Visibility Map Cache Hits", NULL,
+									 planstate->instrument->ntuples3, 0, es);
 			break;
 		case T_BitmapIndexScan:
 			show_scan_qual(((BitmapIndexScan *) plan)->indexqualorig,
@@ -14743,6 +14743,14 @@ ATPrepSetAccessMethod(AlteredTableInfo *tab, Relation rel, const char *amname)
 	if (rel->rd_rel->relam == amoid)
 		return;
 
+	/* inplace tables can't be published; see check_publication_add_relation */
+	if (amoid == INPLACE_TABLE_AM_OID &&
+		GetRelationPublications(RelationGetRelid(rel)) != NIL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("cannot change access method of table \"%s\" to \"%s\" because it is part of a publication",
+						RelationGetRelationName(rel), "inplace")));
+
 	/* Save info for Phase 3 to do the real work */
 	tab->rewrite |= AT_REWRITE_ACCESS_METHOD;
 	tab->newAccessMethod = amoid;
@@ -14891,6 +14899,8 @@ ATExecSetRelOptions(Relation rel, List *defList, AlterTableType operation,
 	bool		repl_null[Natts_pg_class];
 	bool		repl_repl[Natts_pg_class];
 	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
+	List	   *warmIndexes = NIL;
+	ListCell   *lc;
 
 	if (defList == NIL && operation != AT_ReplaceRelOptions)
 		return;					/* nothing to do */
@@ -14984,6 +14994,37 @@ ATExecSetRelOptions(Relation rel, List *defList, AlterTableType operation,
 		}
 	}
 
+	/*
+	 * If WARM updates are being turned off, the indexes they applied to may
+	 * have stale entries that scans would no longer know to skip.  Remember
+	 * those indexes, so we can rebuild them once the new options are in
+	 * effect.
+	 */
+	if (RelationUsesWarmUpdates(rel))
+	{
+		StdRdOptions *newRdOptions;
+
+		newRdOptions = (StdRdOptions *) heap_reloptions(rel->rd_rel->relkind,
+														newOptions, false);
+		if (newRdOptions == NULL || !newRdOptions->warm_updates)
+		{
+			List	   *indexoidlist = RelationGetIndexList(rel);
+
+			foreach(lc, indexoidlist)
+			{
+				Oid			indexoid = lfirst_oid(lc);
+				Relation	indexRel = index_open(indexoid, AccessShareLock);
+
+				if (index_warm_possible(rel, indexRel))
+					warmIndexes = lappend_oid(warmIndexes, indexoid);
+				index_close(indexRel, NoLock);
+			}
+			list_free(indexoidlist);
+		}
+		if (newRdOptions)
+			pfree(newRdOptions);
+	}
+
 	/*
 	 * All we need do here is update the pg_class row; the new options will be
 	 * propagated into relcaches during post-commit cache inval.
@@ -15073,6 +15114,19 @@ ATExecSetRelOptions(Relation rel, List *defList, AlterTableType operation,
 	}
 
 	table_close(pgclass, RowExclusiveLock);
+
+	/* Rebuild indexes that may have stale entries from WARM updates */
+	if (warmIndexes != NIL)
+	{
+		ReindexParams params = {0};
+
+		CommandCounterIncrement();
+
+		foreach(lc, warmIndexes)
+			reindex_index(NULL, lfirst_oid(lc), false,
+						  rel->rd_rel->relpersistence, &params);
+		list_free(warmIndexes);
+	}
 }
 
 /*
@@ -66,10 +66,12 @@
  */
 int			vacuum_freeze_min_age;
 int			vacuum_freeze_table_age;
+int			vacuum_freeze_stable_cycles;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
 int			vacuum_failsafe_age;
 int			vacuum_multixact_failsafe_age;
+int			debug_vacuum_dead_items_limit = 0;
 
 /*
  * Variables for cost-based vacuum delay. The defaults differ between
@@ -1184,6 +1186,25 @@ vacuum_get_cutoffs(Relation rel, const VacuumParams *params,
 	if (MultiXactIdPrecedes(cutoffs->OldestMxact, cutoffs->MultiXactCutoff))
 		cutoffs->MultiXactCutoff = cutoffs->OldestMxact;
 
+	/*
+	 * Look up where WAL was when the vacuum_freeze_stable_cycles'th previous
+	 * VACUUM of the table ended, to recognize pages that haven't been
+	 * modified since.  That relies on page LSNs, which only WAL-logged
+	 * relations have.  If the table hasn't been vacuumed often enough yet,
+	 * or the stats were reset, the entry is still invalid.
+	 */
+	cutoffs->StablePageLSN = InvalidXLogRecPtr;
+	if (vacuum_freeze_stable_cycles > 0 && RelationNeedsWAL(rel))
+	{
+		PgStat_StatTabEntry *tabentry;
+
+		tabentry = pgstat_fetch_stat_tabentry_ext(rel->rd_rel->relisshared,
+												  RelationGetRelid(rel));
+		if (tabentry)
+			cutoffs->StablePageLSN =
+				tabentry->vacuum_end_lsn[vacuum_freeze_stable_cycles - 1];
+	}
+
 	/*
 	 * Finally, figure out if caller needs to do an aggressive VACUUM or not.
 	 *
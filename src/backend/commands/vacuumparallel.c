@@ -16,6 +16,11 @@
  * the parallel context is re-initialized so that the same DSM can be used for
  * multiple passes of index bulk-deletion and index cleanup.
  *
+ * When the table is large enough, the workers can also take part in the
+ * table AM's first pass over the heap.  The table AM owns the shared state
+ * for that (we merely reserve space for it in the DSM segment); we only take
+ * care of launching the workers and of waiting for them to finish.
+ *
  * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -27,6 +32,7 @@
 #include "postgres.h"
 
 #include "access/amapi.h"
+#include "access/heapam.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "commands/progress.h"
@@ -49,6 +55,7 @@
 #define PARALLEL_VACUUM_KEY_BUFFER_USAGE	3
 #define PARALLEL_VACUUM_KEY_WAL_USAGE		4
 #define PARALLEL_VACUUM_KEY_INDEX_STATS		5
+#define PARALLEL_VACUUM_KEY_HEAP_SCAN		6
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -110,6 +117,12 @@ typedef struct PVShared
 	/* Counter for vacuuming and cleanup */
 	pg_atomic_uint32 idx;
 
+	/*
+	 * True while the launched workers are to join the first pass over the
+	 * heap, rather than processing indexes.
+	 */
+	bool		scanning_heap;
+
 	/* DSA handle where the TidStore lives */
 	dsa_handle	dead_items_dsa_handle;
 
@@ -192,6 +205,17 @@ struct ParallelVacuumState
 	/* Points to WAL usage area in DSM */
 	WalUsage   *wal_usage;
 
+	/*
+	 * Table AM's shared state for a parallel first pass over the heap, or
+	 * NULL if the heap is scanned by the leader alone.  nworkers_heap_scan is
+	 * the number of workers to launch for it.
+	 */
+	void	   *heap_scan;
+	int			nworkers_heap_scan;
+
+	/* Have we launched workers already (so DSM must be re-initialized)? */
+	bool		need_reinitialize_dsm;
+
 	/*
 	 * False if the index is totally unsuitable target for all parallel
 	 * processing. For example, the index could be <
@@ -222,6 +246,7 @@ struct ParallelVacuumState
 
 static int	parallel_vacuum_compute_workers(Relation *indrels, int nindexes, int nrequested,
 											bool *will_parallel_vacuum);
+static int	parallel_vacuum_compute_heap_workers(Relation rel, int nrequested);
 static void parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scans,
 												bool vacuum);
 static void parallel_vacuum_process_safe_indexes(ParallelVacuumState *pvs);
@@ -236,12 +261,18 @@ static void parallel_vacuum_error_callback(void *arg);
  * Try to enter parallel mode and create a parallel context.  Then initialize
  * shared memory state.
  *
+ * heap_scan_size is the size of the table AM's shared state for a parallel
+ * first pass over the heap, or 0 if the caller can only scan the heap by
+ * itself.  If the table turns out to be too small for that to be worthwhile,
+ * no space is reserved and parallel_vacuum_get_heap_scan() returns NULL.
+ *
  * On success, return parallel vacuum state.  Otherwise return NULL.
  */
 ParallelVacuumState *
 parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 					 int nrequested_workers, int vac_work_mem,
-					 int elevel, BufferAccessStrategy bstrategy)
+					 int elevel, BufferAccessStrategy bstrategy,
+					 Size heap_scan_size)
 {
 	ParallelVacuumState *pvs;
 	ParallelContext *pcxt;
@@ -255,6 +286,7 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	Size		est_shared_len;
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
+	int			heap_workers = 0;
 	int			querylen;
 
 	/*
@@ -271,6 +303,10 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	parallel_workers = parallel_vacuum_compute_workers(indrels, nindexes,
 													   nrequested_workers,
 													   will_parallel_vacuum);
+	if (heap_scan_size > 0)
+		heap_workers = parallel_vacuum_compute_heap_workers(rel,
+															nrequested_workers);
+	parallel_workers = Max(parallel_workers, heap_workers);
 	if (parallel_workers <= 0)
 	{
 		/* Can't perform vacuum in parallel -- return NULL */
@@ -284,6 +320,7 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	pvs->will_parallel_vacuum = will_parallel_vacuum;
 	pvs->bstrategy = bstrategy;
 	pvs->heaprel = rel;
+	pvs->nworkers_heap_scan = heap_workers;
 
 	EnterParallelMode();
 	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
@@ -301,6 +338,13 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	shm_toc_estimate_chunk(&pcxt->estimator, est_shared_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
+	/* Estimate size for the heap scan state -- PARALLEL_VACUUM_KEY_HEAP_SCAN */
+	if (heap_workers > 0)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator, heap_scan_size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/*
 	 * Estimate space for BufferUsage and WalUsage --
 	 * PARALLEL_VACUUM_KEY_BUFFER_USAGE and PARALLEL_VACUUM_KEY_WAL_USAGE.
@@ -392,6 +436,13 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
 	pvs->shared = shared;
 
+	/* Reserve space for the heap scan state; the table AM initializes it */
+	if (heap_workers > 0)
+	{
+		pvs->heap_scan = shm_toc_allocate(pcxt->toc, heap_scan_size);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_HEAP_SCAN, pvs->heap_scan);
+	}
+
 	/*
 	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
 	 * initialize
@@ -485,13 +536,105 @@ parallel_vacuum_reset_dead_items(ParallelVacuumState *pvs)
 										   LWTRANCHE_PARALLEL_VACUUM_DSA);
 
 	/* Update the DSA pointer for dead_items to the new one */
-	pvs->shared->dead_items_dsa_handle = dsa_get_handle(TidStoreGetDSA(dead_items));
-	pvs->shared->dead_items_handle = TidStoreGetHandle(dead_items);
+	pvs->shared->dead_items_dsa_handle = dsa_get_handle(TidStoreGetDSA(pvs->dead_items));
+	pvs->shared->dead_items_handle = TidStoreGetHandle(pvs->dead_items);
 
 	/* Reset the counter */
 	dead_items_info->num_items = 0;
 }
 
+/*
+ * Returns the table AM's shared state for a parallel heap scan, or NULL if
+ * the heap is to be scanned by the leader alone.
+ */
+void *
+parallel_vacuum_get_heap_scan(ParallelVacuumState *pvs)
+{
+	return pvs->heap_scan;
+}
+
+/*
+ * Launch parallel workers to join the first pass over the heap.  The caller
+ * must have initialized the heap scan state before calling this, and is
+ * expected to participate in the scan itself before calling
+ * parallel_vacuum_heap_scan_end().
+ *
+ * Returns the number of workers launched.
+ */
+int
+parallel_vacuum_heap_scan_begin(ParallelVacuumState *pvs)
+{
+	int			nworkers = Min(pvs->nworkers_heap_scan, pvs->pcxt->nworkers);
+
+	Assert(!IsParallelWorker());
+	Assert(pvs->heap_scan != NULL);
+
+	pvs->shared->scanning_heap = true;
+
+	/* Reinitialize parallel context to relaunch parallel workers */
+	if (pvs->need_reinitialize_dsm)
+		ReinitializeParallelDSM(pvs->pcxt);
+
+	/* Setup the shared cost-based vacuum delay, as for index processing */
+	pg_atomic_write_u32(&(pvs->shared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(pvs->shared->active_nworkers), 0);
+
+	ReinitializeParallelWorkers(pvs->pcxt, nworkers);
+	LaunchParallelWorkers(pvs->pcxt);
+	pvs->need_reinitialize_dsm = true;
+
+	if (pvs->pcxt->nworkers_launched > 0)
+	{
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+
+		/* Enable shared cost balance for leader backend */
+		VacuumSharedCostBalance = &(pvs->shared->cost_balance);
+		VacuumActiveNWorkers = &(pvs->shared->active_nworkers);
+
+		/* The leader counts as an active worker while it scans, too */
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+
+	ereport(pvs->shared->elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+							 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+							 pvs->pcxt->nworkers_launched),
+					pvs->pcxt->nworkers_launched, nworkers)));
+
+	return pvs->pcxt->nworkers_launched;
+}
+
+/*
+ * Wait for the workers launched by parallel_vacuum_heap_scan_begin() to
+ * finish their part of the heap scan, and accumulate their buffer and WAL
+ * usage.
+ */
+void
+parallel_vacuum_heap_scan_end(ParallelVacuumState *pvs)
+{
+	Assert(!IsParallelWorker());
+	Assert(pvs->shared->scanning_heap);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	WaitForParallelWorkersToFinish(pvs->pcxt);
+
+	for (int i = 0; i < pvs->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pvs->buffer_usage[i], &pvs->wal_usage[i]);
+
+	pvs->shared->scanning_heap = false;
+
+	/* Carry the shared balance value back and disable shared costing */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
 /*
  * Do parallel index bulk-deletion with parallel workers.
  */
@@ -602,6 +745,48 @@ parallel_vacuum_compute_workers(Relation *indrels, int nindexes, int nrequested,
 	return parallel_workers;
 }
 
+/*
+ * Compute the number of parallel worker processes to request for the first
+ * pass over the heap.
+ *
+ * Tables smaller than min_parallel_table_scan_size are scanned by the leader
+ * alone.  Otherwise we honor the user's request, then the table's
+ * parallel_workers reloption, and fall back to adding a worker each time the
+ * table triples in size, like the planner does for parallel sequential scans.
+ */
+static int
+parallel_vacuum_compute_heap_workers(Relation rel, int nrequested)
+{
+	BlockNumber rel_pages;
+	int			parallel_workers;
+
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	rel_pages = RelationGetNumberOfBlocks(rel);
+	if (rel_pages < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	if (nrequested > 0)
+		parallel_workers = nrequested;
+	else if ((parallel_workers = RelationGetParallelWorkers(rel, -1)) < 0)
+	{
+		int			heap_parallel_threshold;
+
+		heap_parallel_threshold = Max(min_parallel_table_scan_size, 1);
+		parallel_workers = 1;
+		while (rel_pages >= (BlockNumber) (heap_parallel_threshold * 3))
+		{
+			parallel_workers++;
+			heap_parallel_threshold *= 3;
+			if (heap_parallel_threshold > INT_MAX / 3)
+				break;			/* avoid overflow */
+		}
+	}
+
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
+
 /*
  * Perform index vacuum or index cleanup with parallel workers.  This function
  * must be used by the parallel vacuum leader process.
@@ -669,7 +854,7 @@ parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scan
 	if (nworkers > 0)
 	{
 		/* Reinitialize parallel context to relaunch parallel workers */
-		if (num_index_scans > 0)
+		if (pvs->need_reinitialize_dsm)
 			ReinitializeParallelDSM(pvs->pcxt);
 
 		/*
@@ -688,6 +873,7 @@ parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scan
 		ReinitializeParallelWorkers(pvs->pcxt, nworkers);
 
 		LaunchParallelWorkers(pvs->pcxt);
+		pvs->need_reinitialize_dsm = true;
 
 		if (pvs->pcxt->nworkers_launched > 0)
 		{
@@ -981,8 +1167,8 @@ parallel_vacuum_index_is_parallel_safe(Relation indrel, int num_index_scans,
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Since parallel vacuum workers perform only the first heap pass, index
+ * vacuum or index cleanup, we don't need to report progress information.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -1040,6 +1226,9 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	dead_items = TidStoreAttach(shared->dead_items_dsa_handle,
 								shared->dead_items_handle);
 
+	/* Find the heap scan state, if we're to help with the heap scan */
+	pvs.heap_scan = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_HEAP_SCAN, true);
+
 	/* Set cost-based vacuum delay */
 	VacuumUpdateCosts();
 	VacuumCostBalance = 0;
@@ -1077,8 +1266,19 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_process_safe_indexes(&pvs);
+	if (shared->scanning_heap)
+	{
+		/* Join the leader's first pass over the heap */
+		Assert(pvs.heap_scan != NULL);
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+		heap_parallel_vacuum_scan_worker(rel, &pvs, pvs.bstrategy);
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_process_safe_indexes(&pvs);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -114,6 +114,7 @@
 #include "executor/executor.h"
 #include "nodes/nodeFuncs.h"
 #include "storage/lmgr.h"
+#include "utils/datum.h"
 #include "utils/snapmgr.h"
 
 /* waitMode argument to check_exclusion_or_unique_constraint() */
@@ -506,6 +507,84 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertWarmIndexTuples
+ *
+ *		This routine inserts index tuples after a WARM update
+ *		(that is, table_tuple_update() set 'update_indexes' to
+ *		TU_Warm), into those indexes whose columns changed.  The
+ *		new entries point to the old tuple in 'oldslot', which is
+ *		the root of the new tuple's HOT chain.  Summarizing indexes
+ *		are not handled here; callers use ExecInsertIndexTuples()
+ *		with 'onlySummarizing' for those.
+ *
+ *		Only indexes that index_warm_eligible() accepts can need
+ *		new entries, and those don't enforce any constraints.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertWarmIndexTuples(ResultRelInfo *resultRelInfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *oldslot,
+						  EState *estate)
+{
+	ItemPointer tupleid = &oldslot->tts_tid;
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	Datum		oldvalues[INDEX_MAX_KEYS];
+	bool		oldisnull[INDEX_MAX_KEYS];
+
+	Assert(ItemPointerIsValid(tupleid));
+
+	for (int i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		Relation	indexRelation = resultRelInfo->ri_IndexRelationDescs[i];
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+		TupleDesc	itupdesc;
+		bool		changed = false;
+
+		if (indexRelation == NULL)
+			continue;
+
+		if (!indexInfo->ii_ReadyForInserts || indexInfo->ii_Summarizing)
+			continue;
+
+		/* Other indexes don't have changed columns, see heap_update() */
+		if (!index_warm_eligible(heapRelation, indexRelation))
+			continue;
+
+		FormIndexDatum(indexInfo, slot, estate, values, isnull);
+		FormIndexDatum(indexInfo, oldslot, estate, oldvalues, oldisnull);
+
+		itupdesc = RelationGetDescr(indexRelation);
+		for (int j = 0; j < indexInfo->ii_NumIndexAttrs; j++)
+		{
+			Form_pg_attribute att = TupleDescAttr(itupdesc, j);
+
+			if (isnull[j] != oldisnull[j] ||
+				(!isnull[j] && !datum_image_eq(values[j], oldvalues[j],
+											   att->attbyval, att->attlen)))
+			{
+				changed = true;
+				break;
+			}
+		}
+
+		if (!changed)
+			continue;
+
+		index_insert(indexRelation, /* index relation */
+					 values,	/* array of index Datums */
+					 isnull,	/* null flags */
+					 tupleid,	/* tid of the HOT chain's root */
+					 heapRelation,	/* heap relation */
+					 UNIQUE_CHECK_NO,	/* type of uniqueness check to do */
+					 false,		/* UPDATE without logical change? */
+					 indexInfo);	/* index AM may need this */
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
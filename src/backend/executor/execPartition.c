@@ -1026,7 +1026,8 @@ ExecInitRoutingInfo(ModifyTableState *mtstate,
 	/*
 	 * Determine if the FDW supports batch insert and determine the batch size
 	 * (a FDW may support batching, but it may be disabled for the
-	 * server/table or for this particular query).
+	 * server/table or for this particular query).  Local partitions are
+	 * batched if the INSERT's plan allows it.
 	 *
 	 * If the FDW does not support batching, we set the batch size to 1.
 	 */
@@ -1035,6 +1036,9 @@ ExecInitRoutingInfo(ModifyTableState *mtstate,
 		partRelInfo->ri_FdwRoutine->ExecForeignBatchInsert)
 		partRelInfo->ri_BatchSize =
 			partRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(partRelInfo);
+	else if (partRelInfo->ri_FdwRoutine == NULL)
+		partRelInfo->ri_BatchSize =
+			ExecGetLocalInsertBatchSize(mtstate, partRelInfo);
 	else
 		partRelInfo->ri_BatchSize = 1;
 
@@ -597,7 +597,12 @@ ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
 												   slot, estate, true, false,
 												   NULL, NIL,
-												   (update_indexes == TU_Summarizing));
+												   (update_indexes == TU_Summarizing ||
+													update_indexes == TU_Warm));
+
+		/* searchslot still holds the old tuple, which WARM entries point to */
+		if (resultRelInfo->ri_NumIndices > 0 && update_indexes == TU_Warm)
+			ExecInsertWarmIndexTuples(resultRelInfo, slot, searchslot, estate);
 
 		/* AFTER ROW UPDATE Triggers */
 		ExecARUpdateTriggers(estate, resultRelInfo,
@@ -183,6 +183,7 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	dst->total += add->total;
 	dst->ntuples += add->ntuples;
 	dst->ntuples2 += add->ntuples2;
+	dst->ntuples3 += add->ntuples3;
 	dst->nloops += add->nloops;
 	dst->nfiltered1 += add->nfiltered1;
 	dst->nfiltered2 += add->nfiltered2;
@@ -196,7 +196,8 @@ BitmapHeapNext(BitmapHeapScanState *node)
 			 * harder than that.
 			 */
 			need_tuples = (node->ss.ps.plan->qual != NIL ||
-						   node->ss.ps.plan->targetlist != NIL);
+						   node->ss.ps.plan->targetlist != NIL ||
+						   node->warm_recheck);
 
 			scan = table_beginscan_bm(node->ss.ss_currentRelation,
 									  node->ss.ps.state->es_snapshot,
@@ -298,9 +299,10 @@ BitmapHeapNext(BitmapHeapScanState *node)
 
 		/*
 		 * If we are using lossy info, we have to recheck the qual conditions
-		 * at every tuple.
+		 * at every tuple.  Likewise if the indexes might have stale entries
+		 * left behind by WARM updates.
 		 */
-		if (tbmres->recheck)
+		if (tbmres->recheck || node->warm_recheck)
 		{
 			econtext->ecxt_scantuple = slot;
 			if (!ExecQualAndReset(node->bitmapqualorig, econtext))
@@ -703,6 +705,7 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	scanstate->shared_tbmiterator = NULL;
 	scanstate->shared_prefetch_iterator = NULL;
 	scanstate->pstate = NULL;
+	scanstate->warm_recheck = false;
 
 	/*
 	 * Miscellaneous initialization
@@ -751,6 +754,12 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 
 	scanstate->ss.ss_currentRelation = currentRelation;
 
+	/*
+	 * After WARM updates, an index entry can lead to a tuple that doesn't
+	 * match it, so we must always recheck the index quals.
+	 */
+	scanstate->warm_recheck = RelationUsesWarmUpdates(currentRelation);
+
 	/*
 	 * all done.
 	 */
@@ -46,7 +46,24 @@
 #include "utils/rel.h"
 
 
+/*
+ * Visibility map bits looked up for the current batch of TIDs returned by
+ * the index AM, see IndexOnlyAllVisible().  This is a direct-mapped cache
+ * indexed by heap block number.
+ */
+#define IOS_VM_CACHE_SIZE	64
+
+typedef struct IndexOnlyVMCache
+{
+	uint64		batchno;		/* batch the entries are valid for */
+	BlockNumber blocks[IOS_VM_CACHE_SIZE];
+	bool		all_visible[IOS_VM_CACHE_SIZE];
+} IndexOnlyVMCache;
+
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
+static inline bool IndexOnlyAllVisible(IndexOnlyScanState *node,
+									   IndexScanDesc scandesc,
+									   BlockNumber blkno);
 static void StoreIndexTuple(IndexOnlyScanState *node, TupleTableSlot *slot,
 							IndexTuple itup, TupleDesc itupdesc);
 
@@ -156,10 +173,13 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 *
 		 * It's worth going through this complexity to avoid needing to lock
 		 * the VM buffer, which could cause significant contention.
+		 *
+		 * The same reasoning holds for all TIDs the index AM read from an
+		 * index page together, so we only look up each heap page once per
+		 * such batch; see IndexOnlyAllVisible.
 		 */
-		if (!VM_ALL_VISIBLE(scandesc->heapRelation,
-							ItemPointerGetBlockNumber(tid),
-							&node->ioss_VMBuffer))
+		if (!IndexOnlyAllVisible(node, scandesc,
+								 ItemPointerGetBlockNumber(tid)))
 		{
 			/*
 			 * Rats, we have to visit the heap to check visibility.
@@ -257,6 +277,50 @@ IndexOnlyNext(IndexOnlyScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/*
+ * IndexOnlyAllVisible
+ *		Is heap page blkno all-visible according to the visibility map?
+ *
+ * If the index AM reports batches (see IndexScanDescData.xs_batchno), the
+ * bits we look up while returning the TIDs of one batch are reused for the
+ * rest of that batch.  They were read after the whole batch was collected
+ * from its index page, which is all the reasoning in IndexOnlyNext needs,
+ * so they're as good as a fresh lookup for any TID of the batch.  Once the
+ * AM moves on to another batch, they must be looked up again.
+ */
+static inline bool
+IndexOnlyAllVisible(IndexOnlyScanState *node, IndexScanDesc scandesc,
+					BlockNumber blkno)
+{
+	IndexOnlyVMCache *cache = node->ioss_VMCache;
+	int			slot;
+	bool		all_visible;
+
+	if (scandesc->xs_batchno == 0)
+		return VM_ALL_VISIBLE(scandesc->heapRelation, blkno,
+							  &node->ioss_VMBuffer);
+
+	if (cache->batchno != scandesc->xs_batchno)
+	{
+		memset(cache->blocks, 0xFF, sizeof(cache->blocks));
+		cache->batchno = scandesc->xs_batchno;
+	}
+
+	slot = blkno % IOS_VM_CACHE_SIZE;
+	if (cache->blocks[slot] == blkno)
+	{
+		InstrCountTuples3(node, 1);
+		return cache->all_visible[slot];
+	}
+
+	all_visible = VM_ALL_VISIBLE(scandesc->heapRelation, blkno,
+								 &node->ioss_VMBuffer);
+	cache->blocks[slot] = blkno;
+	cache->all_visible[slot] = all_visible;
+
+	return all_visible;
+}
+
 /*
  * StoreIndexTuple
  *		Fill the slot with data from the index tuple.
@@ -536,6 +600,9 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 	indexstate->ss.ss_currentRelation = currentRelation;
 	indexstate->ss.ss_currentScanDesc = NULL;	/* no heap scan here */
 
+	/* batches are numbered from 1, so the cache starts out empty */
+	indexstate->ioss_VMCache = palloc0(sizeof(IndexOnlyVMCache));
+
 	/*
 	 * Build the scan tuple type using the indextlist generated by the
 	 * planner.  We use this, rather than the index's physical tuple
@@ -70,6 +70,15 @@
 #include "utils/snapmgr.h"
 
 
+/*
+ * Limits on the rows an INSERT into a local table buffers for a single
+ * table_multi_insert() call, and on the number of partitions that may have
+ * rows buffered at once.  Same as COPY FROM's.
+ */
+#define MAX_BUFFERED_INSERT_TUPLES	1000
+#define MAX_BUFFERED_INSERT_BYTES	65535
+#define MAX_PENDING_INSERT_RELATIONS	32
+
 typedef struct MTTargetRelLookup
 {
 	Oid			relationOid;	/* hash key, must be first */
@@ -123,6 +132,12 @@ typedef struct UpdateContext
 } UpdateContext;
 
 
+static void ExecAddPendingInsert(ModifyTableState *mtstate,
+								 ResultRelInfo *resultRelInfo,
+								 TupleTableSlot *slot,
+								 TupleTableSlot *planSlot,
+								 EState *estate,
+								 bool canSetTag);
 static void ExecBatchInsert(ModifyTableState *mtstate,
 							ResultRelInfo *resultRelInfo,
 							TupleTableSlot **slots,
@@ -771,7 +786,6 @@ ExecInsert(ModifyTableContext *context,
 	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
 	OnConflictAction onconflict = node->onConflictAction;
 	PartitionTupleRouting *proute = mtstate->mt_partition_tuple_routing;
-	MemoryContext oldContext;
 
 	/*
 	 * If the input result relation is a partitioned table, find the leaf
@@ -848,88 +862,8 @@ ExecInsert(ModifyTableContext *context,
 		 */
 		if (resultRelInfo->ri_BatchSize > 1)
 		{
-			bool		flushed = false;
-
-			/*
-			 * When we've reached the desired batch size, perform the
-			 * insertion.
-			 */
-			if (resultRelInfo->ri_NumSlots == resultRelInfo->ri_BatchSize)
-			{
-				ExecBatchInsert(mtstate, resultRelInfo,
-								resultRelInfo->ri_Slots,
-								resultRelInfo->ri_PlanSlots,
-								resultRelInfo->ri_NumSlots,
-								estate, canSetTag);
-				flushed = true;
-			}
-
-			oldContext = MemoryContextSwitchTo(estate->es_query_cxt);
-
-			if (resultRelInfo->ri_Slots == NULL)
-			{
-				resultRelInfo->ri_Slots = palloc(sizeof(TupleTableSlot *) *
-												 resultRelInfo->ri_BatchSize);
-				resultRelInfo->ri_PlanSlots = palloc(sizeof(TupleTableSlot *) *
-													 resultRelInfo->ri_BatchSize);
-			}
-
-			/*
-			 * Initialize the batch slots. We don't know how many slots will
-			 * be needed, so we initialize them as the batch grows, and we
-			 * keep them across batches. To mitigate an inefficiency in how
-			 * resource owner handles objects with many references (as with
-			 * many slots all referencing the same tuple descriptor) we copy
-			 * the appropriate tuple descriptor for each slot.
-			 */
-			if (resultRelInfo->ri_NumSlots >= resultRelInfo->ri_NumSlotsInitialized)
-			{
-				TupleDesc	tdesc = CreateTupleDescCopy(slot->tts_tupleDescriptor);
-				TupleDesc	plan_tdesc =
-					CreateTupleDescCopy(planSlot->tts_tupleDescriptor);
-
-				resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] =
-					MakeSingleTupleTableSlot(tdesc, slot->tts_ops);
-
-				resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots] =
-					MakeSingleTupleTableSlot(plan_tdesc, planSlot->tts_ops);
-
-				/* remember how many batch slots we initialized */
-				resultRelInfo->ri_NumSlotsInitialized++;
-			}
-
-			ExecCopySlot(resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots],
-						 slot);
-
-			ExecCopySlot(resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots],
-						 planSlot);
-
-			/*
-			 * If these are the first tuples stored in the buffers, add the
-			 * target rel and the mtstate to the
-			 * es_insert_pending_result_relations and
-			 * es_insert_pending_modifytables lists respectively, except in
-			 * the case where flushing was done above, in which case they
-			 * would already have been added to the lists, so no need to do
-			 * this.
-			 */
-			if (resultRelInfo->ri_NumSlots == 0 && !flushed)
-			{
-				Assert(!list_member_ptr(estate->es_insert_pending_result_relations,
-										resultRelInfo));
-				estate->es_insert_pending_result_relations =
-					lappend(estate->es_insert_pending_result_relations,
-							resultRelInfo);
-				estate->es_insert_pending_modifytables =
-					lappend(estate->es_insert_pending_modifytables, mtstate);
-			}
-			Assert(list_member_ptr(estate->es_insert_pending_result_relations,
-								   resultRelInfo));
-
-			resultRelInfo->ri_NumSlots++;
-
-			MemoryContextSwitchTo(oldContext);
-
+			ExecAddPendingInsert(mtstate, resultRelInfo, slot, planSlot,
+								 estate, canSetTag);
 			return NULL;
 		}
 
@@ -1132,6 +1066,16 @@ ExecInsert(ModifyTableContext *context,
 
 			/* Since there was no insertion conflict, we're done */
 		}
+		else if (resultRelInfo->ri_BatchSize > 1)
+		{
+			/*
+			 * Buffer the tuple, to be inserted along with the rest of the
+			 * batch by ExecBatchInsert.
+			 */
+			ExecAddPendingInsert(mtstate, resultRelInfo, slot, planSlot,
+								 estate, canSetTag);
+			return NULL;
+		}
 		else
 		{
 			/* insert the tuple normally */
@@ -1210,12 +1154,134 @@ ExecInsert(ModifyTableContext *context,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecAddPendingInsert
+ *
+ *		Add a tuple to the batch being accumulated for resultRelInfo,
+ *		inserting the batch first if it is already full.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecAddPendingInsert(ModifyTableState *mtstate,
+					 ResultRelInfo *resultRelInfo,
+					 TupleTableSlot *slot,
+					 TupleTableSlot *planSlot,
+					 EState *estate,
+					 bool canSetTag)
+{
+	bool		flushed = false;
+	MemoryContext oldContext;
+
+	/*
+	 * When we've reached the desired batch size, perform the insertion.
+	 */
+	if (resultRelInfo->ri_NumSlots == resultRelInfo->ri_BatchSize ||
+		resultRelInfo->ri_BatchBytes >= MAX_BUFFERED_INSERT_BYTES)
+	{
+		ExecBatchInsert(mtstate, resultRelInfo,
+						resultRelInfo->ri_Slots,
+						resultRelInfo->ri_PlanSlots,
+						resultRelInfo->ri_NumSlots,
+						estate, canSetTag);
+		flushed = true;
+	}
+
+	oldContext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	if (resultRelInfo->ri_Slots == NULL)
+	{
+		resultRelInfo->ri_Slots = palloc(sizeof(TupleTableSlot *) *
+										 resultRelInfo->ri_BatchSize);
+		resultRelInfo->ri_PlanSlots = palloc(sizeof(TupleTableSlot *) *
+											 resultRelInfo->ri_BatchSize);
+	}
+
+	/*
+	 * Initialize the batch slots. We don't know how many slots will be
+	 * needed, so we initialize them as the batch grows, and we keep them
+	 * across batches. To mitigate an inefficiency in how resource owner
+	 * handles objects with many references (as with many slots all
+	 * referencing the same tuple descriptor) we copy the appropriate tuple
+	 * descriptor for each slot.
+	 *
+	 * Only FDWs get to see the plan slots, so local tables don't keep them.
+	 */
+	if (resultRelInfo->ri_NumSlots >= resultRelInfo->ri_NumSlotsInitialized)
+	{
+		TupleDesc	tdesc = CreateTupleDescCopy(slot->tts_tupleDescriptor);
+
+		resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] =
+			MakeSingleTupleTableSlot(tdesc, slot->tts_ops);
+
+		if (resultRelInfo->ri_FdwRoutine != NULL)
+		{
+			TupleDesc	plan_tdesc =
+				CreateTupleDescCopy(planSlot->tts_tupleDescriptor);
+
+			resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots] =
+				MakeSingleTupleTableSlot(plan_tdesc, planSlot->tts_ops);
+		}
+		else
+			resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots] = NULL;
+
+		/* remember how many batch slots we initialized */
+		resultRelInfo->ri_NumSlotsInitialized++;
+	}
+
+	ExecCopySlot(resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots],
+				 slot);
+
+	if (resultRelInfo->ri_FdwRoutine != NULL)
+		ExecCopySlot(resultRelInfo->ri_PlanSlots[resultRelInfo->ri_NumSlots],
+					 planSlot);
+	else
+	{
+		/*
+		 * Keep track of roughly how much memory the batch takes, so that wide
+		 * rows don't pile up.
+		 */
+		slot_getallattrs(slot);
+		resultRelInfo->ri_BatchBytes +=
+			heap_compute_data_size(slot->tts_tupleDescriptor,
+								   slot->tts_values, slot->tts_isnull);
+	}
+
+	/*
+	 * If these are the first tuples stored in the buffers, add the target
+	 * rel and the mtstate to the es_insert_pending_result_relations and
+	 * es_insert_pending_modifytables lists respectively, except in the case
+	 * where flushing was done above, in which case they would already have
+	 * been added to the lists, so no need to do this.
+	 */
+	if (resultRelInfo->ri_NumSlots == 0 && !flushed)
+	{
+		/* Don't let batches for too many partitions pile up */
+		if (list_length(estate->es_insert_pending_result_relations) >=
+			MAX_PENDING_INSERT_RELATIONS)
+			ExecPendingInserts(estate);
+
+		Assert(!list_member_ptr(estate->es_insert_pending_result_relations,
+								resultRelInfo));
+		estate->es_insert_pending_result_relations =
+			lappend(estate->es_insert_pending_result_relations,
+					resultRelInfo);
+		estate->es_insert_pending_modifytables =
+			lappend(estate->es_insert_pending_modifytables, mtstate);
+	}
+	Assert(list_member_ptr(estate->es_insert_pending_result_relations,
+						   resultRelInfo));
+
+	resultRelInfo->ri_NumSlots++;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
 /* ----------------------------------------------------------------
  *		ExecBatchInsert
  *
  *		Insert multiple tuples in an efficient way.
- *		Currently, this handles inserting into a foreign table without
- *		RETURNING clause.
+ *		Currently, this handles inserting into a local table, or into a
+ *		foreign table, without RETURNING clause.
  * ----------------------------------------------------------------
  */
 static void
@@ -1232,17 +1298,29 @@ ExecBatchInsert(ModifyTableState *mtstate,
 	TupleTableSlot *slot = NULL;
 	TupleTableSlot **rslots;
 
-	/*
-	 * insert into foreign table: let the FDW do it
-	 */
-	rslots = resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
-																  resultRelInfo,
-																  slots,
-																  planSlots,
-																  &numInserted);
+	if (resultRelInfo->ri_FdwRoutine == NULL)
+	{
+		/* insert into local table: all the tuples in one go */
+		table_multi_insert(resultRelInfo->ri_RelationDesc, slots, numSlots,
+						   estate->es_output_cid, 0, NULL);
+		rslots = slots;
+	}
+	else
+	{
+		/*
+		 * insert into foreign table: let the FDW do it
+		 */
+		rslots = resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																	  resultRelInfo,
+																	  slots,
+																	  planSlots,
+																	  &numInserted);
+	}
 
 	for (i = 0; i < numInserted; i++)
 	{
+		List	   *recheckIndexes = NIL;
+
 		slot = rslots[i];
 
 		/*
@@ -1251,10 +1329,20 @@ ExecBatchInsert(ModifyTableState *mtstate,
 		 */
 		slot->tts_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
 
+		/* insert index entries for local tuples */
+		if (resultRelInfo->ri_FdwRoutine == NULL &&
+			resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
+												   slot, estate, false,
+												   false, NULL, NIL,
+												   false);
+
 		/* AFTER ROW INSERT Triggers */
-		ExecARInsertTriggers(estate, resultRelInfo, slot, NIL,
+		ExecARInsertTriggers(estate, resultRelInfo, slot, recheckIndexes,
 							 mtstate->mt_transition_capture);
 
+		list_free(recheckIndexes);
+
 		/*
 		 * Check any WITH CHECK OPTION constraints from parent views.  See the
 		 * comment in ExecInsert.
@@ -1270,13 +1358,15 @@ ExecBatchInsert(ModifyTableState *mtstate,
 	for (i = 0; i < numSlots; i++)
 	{
 		ExecClearTuple(slots[i]);
-		ExecClearTuple(planSlots[i]);
+		if (planSlots[i])
+			ExecClearTuple(planSlots[i]);
 	}
 	resultRelInfo->ri_NumSlots = 0;
+	resultRelInfo->ri_BatchBytes = 0;
 }
 
 /*
- * ExecPendingInserts -- flushes all pending inserts to the foreign tables
+ * ExecPendingInserts -- flushes all pending inserts to the target tables
  */
 static void
 ExecPendingInserts(EState *estate)
@@ -2139,7 +2229,24 @@ ExecUpdateEpilogue(ModifyTableContext *context, UpdateContext *updateCxt,
 											   slot, context->estate,
 											   true, false,
 											   NULL, NIL,
-											   (updateCxt->updateIndexes == TU_Summarizing));
+											   (updateCxt->updateIndexes == TU_Summarizing ||
+												updateCxt->updateIndexes == TU_Warm));
+
+	/*
+	 * After a WARM update, indexes whose columns changed need entries that
+	 * point to the old tuple, so fetch it to find out which ones.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0 && updateCxt->updateIndexes == TU_Warm)
+	{
+		TupleTableSlot *oldslot = ExecGetTriggerOldSlot(context->estate,
+														resultRelInfo);
+
+		if (!table_tuple_fetch_row_version(resultRelInfo->ri_RelationDesc,
+										   tupleid, SnapshotAny, oldslot))
+			elog(ERROR, "failed to fetch tuple being updated");
+		ExecInsertWarmIndexTuples(resultRelInfo, slot, oldslot,
+								  context->estate);
+	}
 
 	/* AFTER ROW UPDATE Triggers */
 	ExecARUpdateTriggers(context->estate, resultRelInfo,
@@ -4199,6 +4306,47 @@ ExecLookupResultRelByOid(ModifyTableState *node, Oid resultoid,
 	return NULL;
 }
 
+/*
+ * ExecGetLocalInsertBatchSize
+ *
+ * Determine how many tuples an INSERT may buffer for a single
+ * table_multi_insert() call into resultRelInfo, a local table or partition.
+ * The planner has already made sure that nothing in the query can look for
+ * the tuples before the batch is inserted; what's left is BEFORE and INSTEAD
+ * OF ROW triggers, which must see the tuples inserted before theirs.
+ *
+ * Returns 1 if the tuples must be inserted one at a time.
+ */
+int
+ExecGetLocalInsertBatchSize(ModifyTableState *mtstate,
+							ResultRelInfo *resultRelInfo)
+{
+	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
+	TriggerDesc *trigDesc = resultRelInfo->ri_TrigDesc;
+
+	/* COPY FROM does its own buffering, and has no ModifyTable plan */
+	if (node == NULL || !node->canMultiInsert)
+		return 1;
+
+	if (resultRelInfo->ri_RelationDesc->rd_rel->relkind != RELKIND_RELATION)
+		return 1;
+
+	if (trigDesc != NULL &&
+		(trigDesc->trig_insert_before_row ||
+		 trigDesc->trig_insert_instead_row))
+		return 1;
+
+	/*
+	 * Tuples routed to a partition are captured for transition tables using
+	 * state that ExecPrepareTupleRouting sets up anew for every tuple.
+	 */
+	if (resultRelInfo->ri_RootResultRelInfo != NULL &&
+		mtstate->mt_transition_capture != NULL)
+		return 1;
+
+	return MAX_BUFFERED_INSERT_TUPLES;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitModifyTable
  * ----------------------------------------------------------------
@@ -4641,7 +4789,7 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	/*
 	 * Determine if the FDW supports batch insert and determine the batch size
 	 * (a FDW may support batching, but it may be disabled for the
-	 * server/table).
+	 * server/table).  Local tables are batched if the plan allows it.
 	 *
 	 * We only do this for INSERT, so that for UPDATE/DELETE the batch size
 	 * remains set to 0.
@@ -4660,6 +4808,9 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 				resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(resultRelInfo);
 			Assert(resultRelInfo->ri_BatchSize >= 1);
 		}
+		else if (resultRelInfo->ri_FdwRoutine == NULL)
+			resultRelInfo->ri_BatchSize =
+				ExecGetLocalInsertBatchSize(mtstate, resultRelInfo);
 		else
 			resultRelInfo->ri_BatchSize = 1;
 	}
@@ -4708,14 +4859,14 @@ ExecEndModifyTable(ModifyTableState *node)
 														   resultRelInfo);
 
 		/*
-		 * Cleanup the initialized batch slots. This only matters for FDWs
-		 * with batching, but the other cases will have ri_NumSlotsInitialized
-		 * == 0.
+		 * Cleanup the initialized batch slots. This only matters for batched
+		 * inserts, but the other cases will have ri_NumSlotsInitialized == 0.
 		 */
 		for (j = 0; j < resultRelInfo->ri_NumSlotsInitialized; j++)
 		{
 			ExecDropSingleTupleTableSlot(resultRelInfo->ri_Slots[j]);
-			ExecDropSingleTupleTableSlot(resultRelInfo->ri_PlanSlots[j]);
+			if (resultRelInfo->ri_PlanSlots[j])
+				ExecDropSingleTupleTableSlot(resultRelInfo->ri_PlanSlots[j]);
 		}
 	}
 
@@ -31,9 +31,11 @@
 #include "access/tableam.h"
 #include "executor/executor.h"
 #include "executor/nodeSeqscan.h"
+#include "optimizer/optimizer.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static void SeqSetProjection(SeqScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -72,6 +74,7 @@ SeqNext(SeqScanState *node)
 								   estate->es_snapshot,
 								   0, NULL);
 		node->ss.ss_currentScanDesc = scandesc;
+		SeqSetProjection(node);
 	}
 
 	/*
@@ -82,6 +85,26 @@ SeqNext(SeqScanState *node)
 	return NULL;
 }
 
+/*
+ * SeqSetProjection -- tell the table AM which columns and quals the scan uses
+ */
+static void
+SeqSetProjection(SeqScanState *node)
+{
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	Scan	   *plan = (Scan *) node->ss.ps.plan;
+	Bitmapset  *attrs = NULL;
+
+	/* don't bother computing anything if the AM has no use for it */
+	if (scandesc->rs_rd->rd_tableam->scan_set_projection == NULL)
+		return;
+
+	pull_varattnos((Node *) plan->plan.targetlist, plan->scanrelid, &attrs);
+	pull_varattnos((Node *) plan->plan.qual, plan->scanrelid, &attrs);
+
+	table_scan_set_projection(scandesc, attrs, plan->plan.qual);
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -266,6 +289,7 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqSetProjection(node);
 }
 
 /* ----------------------------------------------------------------
@@ -299,4 +323,5 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	SeqSetProjection(node);
 }
@@ -912,6 +912,13 @@ use_physical_tlist(PlannerInfo *root, Path *path, int flags)
 		path->pathtarget->exprs == NIL)
 		return false;
 
+	/*
+	 * If the table AM reads only the columns a scan asks for, a physical
+	 * tlist would make it read all of them.
+	 */
+	if (rel->amflags & AMFLAG_HAS_COLUMN_PROJECTION)
+		return false;
+
 	/*
 	 * Can't do it if any system columns or whole-row Vars are requested.
 	 * (This could possibly be fixed but would take some fragile assumptions
@@ -7059,6 +7066,19 @@ make_modifytable(PlannerInfo *root, Plan *subplan,
 
 	node->operation = operation;
 	node->canSetTag = canSetTag;
+
+	/*
+	 * A plain INSERT may buffer rows and insert them into the table a batch
+	 * at a time, provided that nothing can look for a row between the time
+	 * it's buffered and the time the batch is inserted.  That rules out
+	 * RETURNING, ON CONFLICT and volatile functions anywhere in the query,
+	 * which might read the target table.  As in COPY, nextval() doesn't
+	 * count.  Row triggers are checked at executor startup.
+	 */
+	node->canMultiInsert = (operation == CMD_INSERT &&
+							returningLists == NIL &&
+							onconflict == NULL &&
+							!root->hasVolatileInsert);
 	node->nominalRelation = nominalRelation;
 	node->rootRelation = rootRelation;
 	node->partColsUpdated = partColsUpdated;
@@ -679,6 +679,13 @@ subquery_planner(PlannerGlobal *glob, Query *parse, PlannerInfo *parent_root,
 	root->non_recursive_path = NULL;
 	root->partColsUpdated = false;
 
+	/*
+	 * Check this before preprocessing turns SubLinks into SubPlans, which
+	 * can't be looked into.  See make_modifytable().
+	 */
+	root->hasVolatileInsert = (parse->commandType == CMD_INSERT &&
+							   contain_volatile_functions_not_nextval((Node *) parse));
+
 	/*
 	 * Create the top-level join domain.  This won't have valid contents until
 	 * deconstruct_jointree fills it in, but the node needs to exist before
@@ -245,6 +245,7 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 			int			ncolumns,
 						nkeycolumns;
 			int			i;
+			bool		warm;
 
 			/*
 			 * Extract info from the relation descriptor for the index.
@@ -294,10 +295,18 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 			info->opcintype = (Oid *) palloc(sizeof(Oid) * nkeycolumns);
 			info->canreturn = (bool *) palloc(sizeof(bool) * ncolumns);
 
+			/*
+			 * Index-only scans can't be used on indexes that may have stale
+			 * entries left behind by WARM updates, since the heap tuple isn't
+			 * fetched to check them.
+			 */
+			warm = index_warm_possible(relation, indexRelation);
+
 			for (i = 0; i < ncolumns; i++)
 			{
 				info->indexkeys[i] = index->indkey.values[i];
-				info->canreturn[i] = index_can_return(indexRelation, i + 1);
+				info->canreturn[i] = !warm &&
+					index_can_return(indexRelation, i + 1);
 			}
 
 			for (i = 0; i < nkeycolumns; i++)
@@ -545,6 +554,9 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 		relation->rd_tableam->scan_set_tidrange != NULL &&
 		relation->rd_tableam->scan_getnextslot_tidrange != NULL)
 		rel->amflags |= AMFLAG_HAS_TID_RANGE;
+	if (relation->rd_tableam &&
+		relation->rd_tableam->scan_set_projection != NULL)
+		rel->amflags |= AMFLAG_HAS_COLUMN_PROJECTION;
 
 	/*
 	 * Collect info about relation's partitioning scheme, if any. Only
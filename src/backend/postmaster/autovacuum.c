@@ -192,6 +192,20 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/*
+ * struct to keep track of tables that need a vacuum to prevent wraparound, in
+ * 1st pass.  The ages are relative to recentXid and recentMulti.  awr_urgency
+ * is the larger of the two ages, each as a fraction of the freeze max age that
+ * applies to the table.
+ */
+typedef struct av_wraparound_rel
+{
+	Oid			awr_relid;
+	uint32		awr_xid_age;
+	uint32		awr_mxid_age;
+	double		awr_urgency;
+} av_wraparound_rel;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -338,6 +352,10 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  int effective_multixact_freeze_max_age,
 									  bool *dovacuum, bool *doanalyze, bool *wraparound);
 
+static List *add_wraparound_rel(List *wraparound_rels, Form_pg_class classForm,
+								AutoVacOpts *relopts,
+								int effective_multixact_freeze_max_age);
+static int	av_wraparound_rel_cmp(const ListCell *a, const ListCell *b);
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
@@ -1877,6 +1895,7 @@ do_autovacuum(void)
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
 	List	   *table_oids = NIL;
+	List	   *wraparound_rels = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
@@ -2024,8 +2043,15 @@ do_autovacuum(void)
 								  effective_multixact_freeze_max_age,
 								  &dovacuum, &doanalyze, &wraparound);
 
-		/* Relations that need work are added to table_oids */
-		if (dovacuum || doanalyze)
+		/*
+		 * Relations that need work are added to table_oids, or to
+		 * wraparound_rels if they need a vacuum to prevent wraparound.
+		 */
+		if (dovacuum && wraparound)
+			wraparound_rels = add_wraparound_rel(wraparound_rels, classForm,
+												 relopts,
+												 effective_multixact_freeze_max_age);
+		else if (dovacuum || doanalyze)
 			table_oids = lappend_oid(table_oids, relid);
 
 		/*
@@ -2108,13 +2134,41 @@ do_autovacuum(void)
 								  &dovacuum, &doanalyze, &wraparound);
 
 		/* ignore analyze for toast tables */
-		if (dovacuum)
+		if (dovacuum && wraparound)
+			wraparound_rels = add_wraparound_rel(wraparound_rels, classForm,
+												 relopts,
+												 effective_multixact_freeze_max_age);
+		else if (dovacuum)
 			table_oids = lappend_oid(table_oids, relid);
 	}
 
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables that are at risk of wraparound first, the one
+	 * closest to its limits first.  Vacuuming a large table can take a long
+	 * time, and we'd rather not have the table closest to the wraparound
+	 * limits wait for that, while other tables only needing routine
+	 * maintenance are processed.
+	 */
+	if (wraparound_rels != NIL)
+	{
+		List	   *wraparound_oids = NIL;
+
+		list_sort(wraparound_rels, av_wraparound_rel_cmp);
+		foreach(cell, wraparound_rels)
+		{
+			av_wraparound_rel *rel = lfirst(cell);
+
+			elog(DEBUG2, "autovacuum: table %u needs vacuum to prevent wraparound: xid age %u, multixact age %u",
+				 rel->awr_relid, rel->awr_xid_age, rel->awr_mxid_age);
+			wraparound_oids = lappend_oid(wraparound_oids, rel->awr_relid);
+		}
+		list_free_deep(wraparound_rels);
+		table_oids = list_concat(wraparound_oids, table_oids);
+	}
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -3070,6 +3124,65 @@ relation_needs_vacanalyze(Oid relid,
 		*doanalyze = false;
 }
 
+/*
+ * add_wraparound_rel
+ *
+ * Add the given relation, which needs to be vacuumed to prevent wraparound, to
+ * the wraparound_rels list of do_autovacuum(), remembering its ages and how
+ * urgent its vacuum is.  relopts and effective_multixact_freeze_max_age are as
+ * for relation_needs_vacanalyze().
+ */
+static List *
+add_wraparound_rel(List *wraparound_rels, Form_pg_class classForm,
+				   AutoVacOpts *relopts, int effective_multixact_freeze_max_age)
+{
+	av_wraparound_rel *rel = palloc(sizeof(av_wraparound_rel));
+	int			freeze_max_age;
+	int			multixact_freeze_max_age;
+
+	/* the same limits that relation_needs_vacanalyze() forced a vacuum by */
+	freeze_max_age = (relopts && relopts->freeze_max_age >= 0)
+		? Min(relopts->freeze_max_age, autovacuum_freeze_max_age)
+		: autovacuum_freeze_max_age;
+
+	multixact_freeze_max_age = (relopts && relopts->multixact_freeze_max_age >= 0)
+		? Min(relopts->multixact_freeze_max_age, effective_multixact_freeze_max_age)
+		: effective_multixact_freeze_max_age;
+
+	rel->awr_relid = classForm->oid;
+	rel->awr_xid_age = TransactionIdIsNormal(classForm->relfrozenxid) ?
+		(uint32) (recentXid - classForm->relfrozenxid) : 0;
+	rel->awr_mxid_age = MultiXactIdIsValid(classForm->relminmxid) ?
+		(uint32) (recentMulti - classForm->relminmxid) : 0;
+
+	/*
+	 * When multixact members are running out, the effective multixact limit
+	 * can be zero; don't divide by that.
+	 */
+	rel->awr_urgency = Max((double) rel->awr_xid_age / Max(freeze_max_age, 1),
+						   (double) rel->awr_mxid_age /
+						   Max(multixact_freeze_max_age, 1));
+
+	return lappend(wraparound_rels, rel);
+}
+
+/*
+ * list_sort comparator sorting av_wraparound_rels by descending urgency, and
+ * by descending xid and then multixact age among those with equal urgency.
+ */
+static int
+av_wraparound_rel_cmp(const ListCell *a, const ListCell *b)
+{
+	av_wraparound_rel *ra = lfirst(a);
+	av_wraparound_rel *rb = lfirst(b);
+
+	if (ra->awr_urgency != rb->awr_urgency)
+		return (ra->awr_urgency < rb->awr_urgency) ? 1 : -1;
+	if (ra->awr_xid_age != rb->awr_xid_age)
+		return pg_cmp_u32(rb->awr_xid_age, ra->awr_xid_age);
+	return pg_cmp_u32(rb->awr_mxid_age, ra->awr_mxid_age);
+}
+
 /*
  * autovacuum_do_vac_analyze
  *		Vacuum and/or analyze the specified table
@@ -233,6 +233,13 @@ BackgroundWriterMain(char *startup_data, size_t startup_data_len)
 		 */
 		can_hibernate = BgBufferSync(&wb_context);
 
+		/*
+		 * Apply any change of shared_buffers_limit, and evict pages from
+		 * buffers beyond it.
+		 */
+		if (!BgBufferApplyLimit())
+			can_hibernate = false;
+
 		/* Report pending statistics to the cumulative stats system */
 		pgstat_report_bgwriter();
 		pgstat_report_wal(true);
@@ -385,6 +385,7 @@ standby_decode(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 			}
 			break;
 		case XLOG_STANDBY_LOCK:
+		case XLOG_SNAPSHOT_CONFLICT:
 			break;
 		case XLOG_INVALIDATIONS:
 
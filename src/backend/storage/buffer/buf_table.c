@@ -9,6 +9,10 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * The exceptions are BufTableLookupHint() and BufTableBlockBound(), which
+ * consult lock-free, lossy companions of the hashtable and need no lock at
+ * all.
+ *
  *
  * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,7 +25,10 @@
  */
 #include "postgres.h"
 
+#include "common/hashfn.h"
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
+#include "storage/shmem.h"
 
 /* entry for buffer lookup hashtable */
 typedef struct
@@ -32,6 +39,41 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/*
+ * Lock-free lookup hints.  This is an open-addressed array, indexed by the
+ * low bits of a tag's hash code, of the ID (plus one, zero meaning empty) of
+ * the buffer most recently entered into the hashtable with a hash code
+ * mapping to that slot.  It is updated together with the hashtable, but it
+ * is lossy: colliding tags simply overwrite each other's entries, and readers
+ * don't hold any lock, so an entry can be stale by the time it is used.
+ * Callers must therefore validate a hinted buffer's tag under its header
+ * lock, which is what makes the hint safe to use without the BufMappingLock.
+ */
+static pg_atomic_uint32 *SharedBufHints;
+static uint32 SharedBufHintsMask;
+
+static uint32 BufTableHintSlots(void);
+
+/*
+ * Resident block bounds.  For each relation fork, we need to know an upper
+ * bound of the block numbers that may be in the buffer pool, so that dropping
+ * or truncating it can look up those blocks in the hashtable instead of
+ * scanning all buffer headers, see DropRelationBuffers().  This is an array,
+ * indexed by a hash of the relation fork, of one more than the highest block
+ * number ever entered into the hashtable for any relation fork mapping to
+ * that slot, or zero if there was none.  The bounds only ever increase, as
+ * we can't tell when no relation fork sharing a slot has higher blocks in
+ * the pool anymore, so a slot that was used by a large relation forces a
+ * full scan for small relations sharing it.  With enough slots, that's rare.
+ */
+static pg_atomic_uint32 *SharedBufBounds;
+static uint32 SharedBufBoundsMask;
+
+static uint32 BufTableBoundSlots(void);
+static void BufTableRaiseBound(BufferTag *tagPtr);
+static inline pg_atomic_uint32 *BufTableBoundSlot(const RelFileLocator *rlocator,
+												  ForkNumber forknum);
+
 
 /*
  * Estimate space needed for mapping hashtable
@@ -40,7 +82,47 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	size_t		sz;
+
+	sz = hash_estimate_size(size, sizeof(BufferLookupEnt));
+	sz = add_size(sz, mul_size(BufTableHintSlots(), sizeof(pg_atomic_uint32)));
+	sz = add_size(sz, mul_size(BufTableBoundSlots(), sizeof(pg_atomic_uint32)));
+
+	return sz;
+}
+
+/*
+ * Number of lookup hint slots: twice the number of buffers, rounded up to a
+ * power of two, to keep collisions rare.
+ */
+static uint32
+BufTableHintSlots(void)
+{
+	return pg_nextpower2_32(NBuffers) * 2;
+}
+
+/*
+ * Number of resident block bound slots: one per 16 buffers, rounded up to a
+ * power of two, but at least 1024.
+ */
+static uint32
+BufTableBoundSlots(void)
+{
+	return Max(pg_nextpower2_32(NBuffers) / 16, 1024);
+}
+
+/*
+ * Return the resident block bound slot of a relation fork.
+ */
+static inline pg_atomic_uint32 *
+BufTableBoundSlot(const RelFileLocator *rlocator, ForkNumber forknum)
+{
+	uint32		hash;
+
+	hash = hash_bytes((const unsigned char *) rlocator, sizeof(RelFileLocator));
+	hash = hash_combine(hash, murmurhash32((uint32) forknum));
+
+	return &SharedBufBounds[hash & SharedBufBoundsMask];
 }
 
 /*
@@ -51,6 +133,7 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -63,6 +146,30 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	SharedBufHints = (pg_atomic_uint32 *)
+		ShmemInitStruct("Shared Buffer Lookup Hints",
+						mul_size(BufTableHintSlots(), sizeof(pg_atomic_uint32)),
+						&found);
+	SharedBufHintsMask = BufTableHintSlots() - 1;
+
+	if (!found)
+	{
+		for (uint32 i = 0; i <= SharedBufHintsMask; i++)
+			pg_atomic_init_u32(&SharedBufHints[i], 0);
+	}
+
+	SharedBufBounds = (pg_atomic_uint32 *)
+		ShmemInitStruct("Shared Buffer Resident Block Bounds",
+						mul_size(BufTableBoundSlots(), sizeof(pg_atomic_uint32)),
+						&found);
+	SharedBufBoundsMask = BufTableBoundSlots() - 1;
+
+	if (!found)
+	{
+		for (uint32 i = 0; i <= SharedBufBoundsMask; i++)
+			pg_atomic_init_u32(&SharedBufBounds[i], 0);
+	}
 }
 
 /*
@@ -104,6 +211,45 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupHint
+ *		Return the ID of a buffer that may hold the tag with the given hash
+ *		code, or -1 if there's no candidate
+ *
+ * No lock is needed.  The result is only a hint; the caller must check the
+ * buffer's tag while holding its header lock or a pin, and fall back to
+ * BufTableLookup() if it doesn't match.
+ */
+int
+BufTableLookupHint(uint32 hashcode)
+{
+	uint32		hint;
+
+	hint = pg_atomic_read_u32(&SharedBufHints[hashcode & SharedBufHintsMask]);
+
+	return (int) hint - 1;
+}
+
+/*
+ * Raise the resident block bound of a tag's relation fork to cover it
+ */
+static void
+BufTableRaiseBound(BufferTag *tagPtr)
+{
+	RelFileLocator rlocator = BufTagGetRelFileLocator(tagPtr);
+	pg_atomic_uint32 *bound;
+	uint32		oldval;
+	uint32		newval = tagPtr->blockNum + 1;
+
+	bound = BufTableBoundSlot(&rlocator, BufTagGetForkNum(tagPtr));
+	oldval = pg_atomic_read_u32(bound);
+	while (oldval < newval)
+	{
+		if (pg_atomic_compare_exchange_u32(bound, &oldval, newval))
+			break;
+	}
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -135,6 +281,15 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 
 	result->id = buf_id;
 
+	pg_atomic_write_u32(&SharedBufHints[hashcode & SharedBufHintsMask],
+						buf_id + 1);
+
+	/*
+	 * This happens before the caller releases the mapping lock, so the bound
+	 * covers the block by the time anybody else can find its buffer.
+	 */
+	BufTableRaiseBound(tagPtr);
+
 	return -1;
 }
 
@@ -148,6 +303,7 @@ void
 BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 {
 	BufferLookupEnt *result;
+	uint32		expected;
 
 	result = (BufferLookupEnt *)
 		hash_search_with_hash_value(SharedBufHash,
@@ -158,4 +314,25 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	/* Clear the lookup hint, unless it has been reused for another buffer */
+	expected = result->id + 1;
+	pg_atomic_compare_exchange_u32(&SharedBufHints[hashcode & SharedBufHintsMask],
+								   &expected, 0);
+}
+
+/*
+ * BufTableBlockBound
+ *		Return a number of blocks of the given relation fork such that no
+ *		higher-numbered block of it is in the buffer pool
+ *
+ * The result is exact if the fork has never had any buffers, in which case
+ * it's zero, but is otherwise only an upper bound, possibly a loose one.  No
+ * lock is needed, but the caller must ensure that nobody can be reading in
+ * new blocks of the relation fork concurrently, for the result to stay valid.
+ */
+BlockNumber
+BufTableBlockBound(RelFileLocator rlocator, ForkNumber forknum)
+{
+	return pg_atomic_read_u32(BufTableBoundSlot(&rlocator, forknum));
 }
@@ -39,6 +39,7 @@
 
 #include "access/tableam.h"
 #include "access/xloginsert.h"
+#include "access/xlogrecovery.h"
 #include "access/xlogutils.h"
 #include "catalog/storage.h"
 #include "catalog/storage_xlog.h"
@@ -56,6 +57,7 @@
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
+#include "utils/guc_hooks.h"
 #include "utils/memdebug.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
@@ -139,6 +141,8 @@ typedef struct SMgrSortArray
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
+bool		bgwriter_cold_flush = false;
+int			shared_buffers_limit = -1;
 bool		track_io_timing = false;
 
 /*
@@ -504,11 +508,16 @@ static BlockNumber ExtendBufferedRelShared(BufferManagerRelation bmr,
 										   uint32 *extended_by);
 static bool PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy);
 static void PinBuffer_Locked(BufferDesc *buf);
+static bool PinBufferIfTagMatches(BufferDesc *buf, BufferTag *tag,
+								  BufferAccessStrategy strategy, bool *valid);
 static void UnpinBuffer(BufferDesc *buf);
 static void UnpinBufferNoOwner(BufferDesc *buf);
 static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
+static int	BgBufferSyncCold(WritebackContext *wb_context, int max_written,
+							 bool *idle);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
+						  XLogRecPtr unmodified_since,
 						  WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
 static bool StartBufferIO(BufferDesc *buf, bool forInput, bool nowait);
@@ -1603,6 +1612,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	Buffer		victim_buffer;
 	BufferDesc *victim_buf_hdr;
 	uint32		victim_buf_state;
+	uint32		usage_count;
 
 	/* Make sure we will have room to remember the buffer pin */
 	ResourceOwnerEnlarge(CurrentResourceOwner);
@@ -1615,7 +1625,20 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
+	/*
+	 * See if the block is in the buffer pool already.  Try the lock-free
+	 * lookup hint first, which lets most buffer hits avoid the mapping
+	 * partition lock entirely.
+	 */
+	existing_buf_id = BufTableLookupHint(newHash);
+	if (existing_buf_id >= 0)
+	{
+		BufferDesc *buf = GetBufferDescriptor(existing_buf_id);
+
+		if (PinBufferIfTagMatches(buf, &newTag, strategy, foundPtr))
+			return buf;
+	}
+
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	existing_buf_id = BufTableLookup(&newTag, newHash);
 	if (existing_buf_id >= 0)
@@ -1718,6 +1741,10 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		return existing_buf_hdr;
 	}
 
+	/* Decide how well to protect the new page from eviction */
+	usage_count = StrategyAdmitUsageCount(newHash, victim_buf_hdr->buf_id,
+										  strategy);
+
 	/*
 	 * Need to lock the buffer header too in order to change its tag.
 	 */
@@ -1735,7 +1762,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * checkpoints, except for their "init" forks, which need to be treated
 	 * just like permanent relations.
 	 */
-	victim_buf_state |= BM_TAG_VALID | BUF_USAGECOUNT_ONE;
+	victim_buf_state |= BM_TAG_VALID;
+	victim_buf_state += usage_count * BUF_USAGECOUNT_ONE;
 	if (relpersistence == RELPERSISTENCE_PERMANENT || forkNum == INIT_FORKNUM)
 		victim_buf_state |= BM_PERMANENT;
 
@@ -1863,11 +1891,16 @@ retry:
  * Needs to be called on a buffer with a valid tag, pinned, but without the
  * buffer header spinlock held.
  *
+ * remember tells whether the 2Q policy should remember the evicted page as a
+ * ghost entry.  That's not the case for pages evicted from a strategy ring:
+ * they were read in through the ring, so their earlier stay in the pool says
+ * nothing about whether they are needed repeatedly.
+ *
  * Returns true if the buffer can be reused, in which case the buffer is only
  * pinned by this backend and marked as invalid, false otherwise.
  */
 static bool
-InvalidateVictimBuffer(BufferDesc *buf_hdr)
+InvalidateVictimBuffer(BufferDesc *buf_hdr, bool remember)
 {
 	uint32		buf_state;
 	uint32		hash;
@@ -1927,6 +1960,10 @@ InvalidateVictimBuffer(BufferDesc *buf_hdr)
 
 	LWLockRelease(partition_lock);
 
+	/* Let the replacement policy know the page was evicted */
+	if (remember)
+		StrategyRememberEviction(hash);
+
 	Assert(!(buf_state & (BM_DIRTY | BM_VALID | BM_TAG_VALID)));
 	Assert(BUF_STATE_GET_REFCOUNT(buf_state) > 0);
 	Assert(BUF_STATE_GET_REFCOUNT(pg_atomic_read_u32(&buf_hdr->state)) > 0);
@@ -2033,6 +2070,14 @@ again:
 			}
 		}
 
+		/*
+		 * Let the background writer know that it didn't stay far enough
+		 * ahead of the clock sweep.  Buffers reused from a ring are expected
+		 * to be written by their user.
+		 */
+		if (!from_ring)
+			StrategyReportDirtyEviction();
+
 		/* OK, do the I/O */
 		FlushBuffer(buf_hdr, NULL, IOOBJECT_RELATION, io_context);
 		LWLockRelease(content_lock);
@@ -2069,7 +2114,8 @@ again:
 	 * can fail because another backend could have pinned or dirtied the
 	 * buffer.
 	 */
-	if ((buf_state & BM_TAG_VALID) && !InvalidateVictimBuffer(buf_hdr))
+	if ((buf_state & BM_TAG_VALID) &&
+		!InvalidateVictimBuffer(buf_hdr, !from_ring))
 	{
 		UnpinBuffer(buf_hdr);
 		goto again;
@@ -2095,8 +2141,9 @@ again:
  * One additional pin is always allowed, as otherwise the operation likely
  * cannot be performed at all.
  *
- * The number of allowed pins for a backend is computed based on
- * shared_buffers and the maximum number of connections possible. That's very
+ * The number of allowed pins for a backend is computed based on the number
+ * of shared buffers in use, see shared_buffers_limit, and the maximum number
+ * of connections possible. That's very
  * pessimistic, but outside of toy-sized shared_buffers it should allow
  * sufficient pins.
  */
@@ -2110,7 +2157,7 @@ LimitAdditionalPins(uint32 *additional_pins)
 		return;
 
 	max_backends = MaxBackends + NUM_AUXILIARY_PROCS;
-	max_proportional_pins = NBuffers / max_backends;
+	max_proportional_pins = StrategyGetActiveBuffers() / max_backends;
 
 	/*
 	 * Subtract the approximate number of buffers already pinned by this
@@ -2624,6 +2671,8 @@ ReleaseAndReadBuffer(Buffer buffer,
  * other backends from stealing buffers from our ring.  As long as we cycle
  * through the ring faster than the global clock-sweep cycles, buffers in
  * our ring won't be chosen as victims for replacement by other backends.)
+ * With the 2Q policy, a zero usage_count is also left alone while the page is
+ * in its correlated reference period, see StrategyCorrelatedReference().
  *
  * This should be applied only to shared buffers, never local ones.
  *
@@ -2669,8 +2718,16 @@ PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy)
 
 			if (strategy == NULL)
 			{
-				/* Default case: increase usagecount unless already max. */
-				if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+				/*
+				 * Default case: increase usagecount unless already max, or
+				 * the page is on probation and was read in only just now.
+				 */
+				if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
+				{
+					if (!StrategyCorrelatedReference(buf->buf_id))
+						buf_state += BUF_USAGECOUNT_ONE;
+				}
+				else if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
 					buf_state += BUF_USAGECOUNT_ONE;
 			}
 			else
@@ -2726,6 +2783,69 @@ PinBuffer(BufferDesc *buf, BufferAccessStrategy strategy)
 	return result;
 }
 
+/*
+ * PinBufferIfTagMatches -- pin a buffer if it holds the given tag
+ *
+ * This is used to pin a buffer found without holding the buffer mapping
+ * lock, see BufTableLookupHint().  The buffer's identity can only change
+ * while it is unpinned and its header is locked, so we check the tag while
+ * holding a pin we already had, or else the header lock.  If the tag matches,
+ * the buffer is pinned, with the usage count adjusted as in PinBuffer(),
+ * *valid is set to whether it holds valid data, and true is returned.
+ *
+ * As with PinBuffer(), the caller must have reserved a private refcount
+ * entry and resource owner space.
+ */
+static bool
+PinBufferIfTagMatches(BufferDesc *buf, BufferTag *tag,
+					  BufferAccessStrategy strategy, bool *valid)
+{
+	uint32		buf_state;
+
+	if (GetPrivateRefCount(BufferDescriptorGetBuffer(buf)) > 0)
+	{
+		/* We hold a pin, so the tag can't change under us */
+		if (!BufferTagsEqual(tag, &buf->tag))
+			return false;
+		*valid = PinBuffer(buf, strategy);
+		return true;
+	}
+
+	buf_state = LockBufHdr(buf);
+	if (!(buf_state & BM_TAG_VALID) || !BufferTagsEqual(tag, &buf->tag))
+	{
+		UnlockBufHdr(buf, buf_state);
+		return false;
+	}
+
+	/*
+	 * It's the right buffer.  Adjust the usage count the same way
+	 * PinBuffer() would; since we hold the header lock, nobody else can
+	 * change the state concurrently, so we can just store it.
+	 */
+	if (strategy == NULL)
+	{
+		if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
+		{
+			if (!StrategyCorrelatedReference(buf->buf_id))
+				buf_state += BUF_USAGECOUNT_ONE;
+		}
+		else if (BUF_STATE_GET_USAGECOUNT(buf_state) < BM_MAX_USAGE_COUNT)
+			buf_state += BUF_USAGECOUNT_ONE;
+	}
+	else
+	{
+		if (BUF_STATE_GET_USAGECOUNT(buf_state) == 0)
+			buf_state += BUF_USAGECOUNT_ONE;
+	}
+	pg_atomic_write_u32(&buf->state, buf_state);
+
+	*valid = (buf_state & BM_VALID) != 0;
+	PinBuffer_Locked(buf);		/* releases spinlock */
+
+	return true;
+}
+
 /*
  * PinBuffer_Locked -- as above, but caller already locked the buffer header.
  * The spinlock is released before return.
@@ -3108,7 +3228,8 @@ BufferSync(int flags)
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			if (SyncOneBuffer(buf_id, false, InvalidXLogRecPtr,
+							  &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				PendingCheckpointerStats.buffers_written++;
@@ -3162,46 +3283,72 @@ BufferSync(int flags)
 	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_scan);
 }
 
+/*
+ * State of the LRU scan of BgBufferSync() in one clock sweep partition,
+ * saved between calls so we can determine the partition's strategy point's
+ * advance rate and avoid scanning already-cleaned buffers.
+ */
+typedef struct BgWriterPartition
+{
+	int			first;			/* first buffer of the partition */
+	int			size;			/* number of buffers in it */
+	int			prev_strategy_buf_id;
+	uint32		prev_strategy_passes;
+	int			next_to_clean;
+	uint32		next_passes;
+
+	/* Computed afresh in each call */
+	long		strategy_delta; /* buffers scanned by the clock sweep */
+	int			bufs_to_lap;	/* buffers we can scan before lapping it */
+} BgWriterPartition;
+
 /*
  * BgBufferSync -- Write out some dirty buffers in the pool.
  *
  * This is called periodically by the background writer process.
  *
+ * Each clock sweep partition has its own clock hand, so the LRU scan is run
+ * separately in each of them, ahead of its hand.  The allocation rate and
+ * clean-buffer density are estimated for the whole pool, and the number of
+ * buffers to clean is divided among the partitions according to how far
+ * their hands have advanced since the last call.
+ *
  * Returns true if it's appropriate for the bgwriter process to go into
  * low-power hibernation mode.  (This happens if the strategy clock sweep
- * has been "lapped" and no buffer allocations have occurred recently,
- * or if the bgwriter has been effectively disabled by setting
- * bgwriter_lru_maxpages to 0.)
+ * has been "lapped", no buffer allocations have occurred recently and the
+ * last full pass of the cold buffer sweep found nothing to write, or if the
+ * bgwriter has been effectively disabled by setting bgwriter_lru_maxpages
+ * to 0.)
  */
 bool
 BgBufferSync(WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
-	int			strategy_buf_id;
-	uint32		strategy_passes;
+	int			nbuffers = 0;
+	int			npartitions;
+	int			strategy_buf_id[MAX_CLOCK_SWEEP_PARTITIONS];
+	uint32		strategy_passes[MAX_CLOCK_SWEEP_PARTITIONS];
 	uint32		recent_alloc;
+	uint32		recent_dirty_evictions;
 
-	/*
-	 * Information saved between calls so we can determine the strategy
-	 * point's advance rate and avoid scanning already-cleaned buffers.
-	 */
+	/* Information saved between calls, see BgWriterPartition */
 	static bool saved_info_valid = false;
-	static int	prev_strategy_buf_id;
-	static uint32 prev_strategy_passes;
-	static int	next_to_clean;
-	static uint32 next_passes;
+	static BgWriterPartition partitions[MAX_CLOCK_SWEEP_PARTITIONS];
 
 	/* Moving averages of allocation rate and clean-buffer density */
 	static float smoothed_alloc = 0;
 	static float smoothed_density = 10.0;
 
+	/* Moving average of dirty victims backends had to write themselves */
+	static float smoothed_dirty_evictions = 0;
+
 	/* Potentially these could be tunables, but for now, not */
 	float		smoothing_samples = 16;
 	float		scan_whole_pool_milliseconds = 120000.0;
 
 	/* Used to compute how far we scan ahead */
-	long		strategy_delta;
-	int			bufs_to_lap;
+	long		strategy_delta = 0;
+	int			bufs_to_lap = 0;
 	int			bufs_ahead;
 	float		scans_per_alloc;
 	int			reusable_buffers_est;
@@ -3209,19 +3356,47 @@ BgBufferSync(WritebackContext *wb_context)
 	int			min_scan_buffers;
 
 	/* Variables for the scanning loop proper */
-	int			num_to_scan;
-	int			num_written;
-	int			reusable_buffers;
+	int			num_scanned = 0;
+	int			num_written = 0;
+	int			reusable_buffers = 0;
 
 	/* Variables for final smoothed_density update */
 	long		new_strategy_delta;
 	uint32		new_recent_alloc;
 
+	/* Number of buffers written by the cold buffer sweep */
+	int			num_written_cold = 0;
+	bool		cold_idle = true;
+
 	/*
-	 * Find out where the freelist clock sweep currently is, and how many
-	 * buffer allocations have happened since our last call.
+	 * Find out where the clock hand of each partition currently is, and how
+	 * many buffer allocations have happened since our last call.
+	 *
+	 * Only the active part of the buffer pool is used by the clock sweep.  If
+	 * shared_buffers_limit has changed, the partitions have moved, and the
+	 * strategy points' positions aren't comparable with the saved ones
+	 * anymore, so start over.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	npartitions = StrategyNumPartitions();
+	Assert(npartitions <= MAX_CLOCK_SWEEP_PARTITIONS);
+	for (int partno = 0; partno < npartitions; partno++)
+	{
+		BgWriterPartition *part = &partitions[partno];
+		int			first;
+		int			size;
+
+		/* The alloc counts are for the whole pool, read them only once */
+		strategy_buf_id[partno] =
+			StrategySyncStart(partno, &first, &size, &strategy_passes[partno],
+							  partno == 0 ? &recent_alloc : NULL,
+							  partno == 0 ? &recent_dirty_evictions : NULL);
+
+		if (saved_info_valid && (first != part->first || size != part->size))
+			saved_info_valid = false;
+		part->first = first;
+		part->size = size;
+		nbuffers += size;
+	}
 
 	/* Report buffer alloc counts to pgstat */
 	PendingBgWriterStats.buf_alloc += recent_alloc;
@@ -3237,82 +3412,92 @@ BgBufferSync(WritebackContext *wb_context)
 		return true;
 	}
 
-	/*
-	 * Compute strategy_delta = how many buffers have been scanned by the
-	 * clock sweep since last time.  If first time through, assume none. Then
-	 * see if we are still ahead of the clock sweep, and if so, how many
-	 * buffers we could scan before we'd catch up with it and "lap" it. Note:
-	 * weird-looking coding of xxx_passes comparisons are to avoid bogus
-	 * behavior when the passes counts wrap around.
-	 */
-	if (saved_info_valid)
+	for (int partno = 0; partno < npartitions; partno++)
 	{
-		int32		passes_delta = strategy_passes - prev_strategy_passes;
+		BgWriterPartition *part = &partitions[partno];
+		int			buf_id = strategy_buf_id[partno];
+		uint32		passes = strategy_passes[partno];
 
-		strategy_delta = strategy_buf_id - prev_strategy_buf_id;
-		strategy_delta += (long) passes_delta * NBuffers;
+		/*
+		 * Compute strategy_delta = how many buffers have been scanned by the
+		 * partition's clock sweep since last time.  If first time through,
+		 * assume none. Then see if we are still ahead of the clock sweep, and
+		 * if so, how many buffers we could scan before we'd catch up with it
+		 * and "lap" it. Note: weird-looking coding of xxx_passes comparisons
+		 * are to avoid bogus behavior when the passes counts wrap around.
+		 */
+		if (saved_info_valid)
+		{
+			int32		passes_delta = passes - part->prev_strategy_passes;
 
-		Assert(strategy_delta >= 0);
+			part->strategy_delta = buf_id - part->prev_strategy_buf_id;
+			part->strategy_delta += (long) passes_delta * part->size;
 
-		if ((int32) (next_passes - strategy_passes) > 0)
-		{
-			/* we're one pass ahead of the strategy point */
-			bufs_to_lap = strategy_buf_id - next_to_clean;
+			Assert(part->strategy_delta >= 0);
+
+			if ((int32) (part->next_passes - passes) > 0)
+			{
+				/* we're one pass ahead of the strategy point */
+				part->bufs_to_lap = buf_id - part->next_to_clean;
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta, bufs_to_lap);
+				elog(DEBUG2, "bgwriter ahead in partition %d: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
+					 partno, part->next_passes, part->next_to_clean,
+					 passes, buf_id,
+					 part->strategy_delta, part->bufs_to_lap);
 #endif
-		}
-		else if (next_passes == strategy_passes &&
-				 next_to_clean >= strategy_buf_id)
-		{
-			/* on same pass, but ahead or at least not behind */
-			bufs_to_lap = NBuffers - (next_to_clean - strategy_buf_id);
+			}
+			else if (part->next_passes == passes &&
+					 part->next_to_clean >= buf_id)
+			{
+				/* on same pass, but ahead or at least not behind */
+				part->bufs_to_lap = part->size - (part->next_to_clean - buf_id);
+#ifdef BGW_DEBUG
+				elog(DEBUG2, "bgwriter ahead in partition %d: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
+					 partno, part->next_passes, part->next_to_clean,
+					 passes, buf_id,
+					 part->strategy_delta, part->bufs_to_lap);
+#endif
+			}
+			else
+			{
+				/*
+				 * We're behind, so skip forward to the strategy point and
+				 * start cleaning from there.
+				 */
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta, bufs_to_lap);
+				elog(DEBUG2, "bgwriter behind in partition %d: bgw %u-%u strategy %u-%u delta=%ld",
+					 partno, part->next_passes, part->next_to_clean,
+					 passes, buf_id,
+					 part->strategy_delta);
 #endif
+				part->next_to_clean = buf_id;
+				part->next_passes = passes;
+				part->bufs_to_lap = part->size;
+			}
 		}
 		else
 		{
 			/*
-			 * We're behind, so skip forward to the strategy point and start
-			 * cleaning from there.
+			 * Initializing at startup or after LRU scanning had been off.
+			 * Always start at the strategy point.
 			 */
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter behind: bgw %u-%u strategy %u-%u delta=%ld",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta);
+			elog(DEBUG2, "bgwriter initializing partition %d: strategy %u-%u",
+				 partno, passes, buf_id);
 #endif
-			next_to_clean = strategy_buf_id;
-			next_passes = strategy_passes;
-			bufs_to_lap = NBuffers;
+			part->strategy_delta = 0;
+			part->next_to_clean = buf_id;
+			part->next_passes = passes;
+			part->bufs_to_lap = part->size;
 		}
-	}
-	else
-	{
-		/*
-		 * Initializing at startup or after LRU scanning had been off. Always
-		 * start at the strategy point.
-		 */
-#ifdef BGW_DEBUG
-		elog(DEBUG2, "bgwriter initializing: strategy %u-%u",
-			 strategy_passes, strategy_buf_id);
-#endif
-		strategy_delta = 0;
-		next_to_clean = strategy_buf_id;
-		next_passes = strategy_passes;
-		bufs_to_lap = NBuffers;
-	}
 
-	/* Update saved info for next time */
-	prev_strategy_buf_id = strategy_buf_id;
-	prev_strategy_passes = strategy_passes;
+		/* Update saved info for next time */
+		part->prev_strategy_buf_id = buf_id;
+		part->prev_strategy_passes = passes;
+
+		strategy_delta += part->strategy_delta;
+		bufs_to_lap += part->bufs_to_lap;
+	}
 	saved_info_valid = true;
 
 	/*
@@ -3330,10 +3515,10 @@ BgBufferSync(WritebackContext *wb_context)
 
 	/*
 	 * Estimate how many reusable buffers there are between the current
-	 * strategy point and where we've scanned ahead to, based on the smoothed
+	 * strategy points and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
 	 */
-	bufs_ahead = NBuffers - bufs_to_lap;
+	bufs_ahead = nbuffers - bufs_to_lap;
 	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
 
 	/*
@@ -3347,8 +3532,23 @@ BgBufferSync(WritebackContext *wb_context)
 		smoothed_alloc += ((float) recent_alloc - smoothed_alloc) /
 			smoothing_samples;
 
+	/*
+	 * Every dirty victim a backend had to write out itself means we didn't
+	 * have enough clean buffers ready.  Track those with the same
+	 * fast-attack, slow-decline behavior, and aim for that many additional
+	 * clean buffers, so the number of foreground writes drives the size of
+	 * the pool of clean buffers we keep ahead of the clock sweep.
+	 */
+	if (smoothed_dirty_evictions <= (float) recent_dirty_evictions)
+		smoothed_dirty_evictions = recent_dirty_evictions;
+	else
+		smoothed_dirty_evictions += ((float) recent_dirty_evictions -
+									 smoothed_dirty_evictions) /
+			smoothing_samples;
+
 	/* Scale the estimate by a GUC to allow more aggressive tuning. */
-	upcoming_alloc_est = (int) (smoothed_alloc * bgwriter_lru_multiplier);
+	upcoming_alloc_est = (int) ((smoothed_alloc + smoothed_dirty_evictions) *
+								bgwriter_lru_multiplier);
 
 	/*
 	 * If recent_alloc remains at zero for many cycles, smoothed_alloc will
@@ -3359,7 +3559,10 @@ BgBufferSync(WritebackContext *wb_context)
 	 * syndrome.  It will pop back up as soon as recent_alloc increases.
 	 */
 	if (upcoming_alloc_est == 0)
+	{
 		smoothed_alloc = 0;
+		smoothed_dirty_evictions = 0;
+	}
 
 	/*
 	 * Even in cases where there's been little or no buffer allocation
@@ -3371,7 +3574,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * the BGW will be called during the scan_whole_pool time; slice the
 	 * buffer pool into that many sections.
 	 */
-	min_scan_buffers = (int) (NBuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
+	min_scan_buffers = (int) (nbuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
 
 	if (upcoming_alloc_est < (min_scan_buffers + reusable_buffers_est))
 	{
@@ -3384,50 +3587,89 @@ BgBufferSync(WritebackContext *wb_context)
 
 	/*
 	 * Now write out dirty reusable buffers, working forward from the
-	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
-	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * next_to_clean point of each partition, until we have lapped its
+	 * strategy scan, or cleaned enough buffers to match our estimate of the
+	 * next cycle's allocation requirements in it, or hit the
+	 * bgwriter_lru_maxpages limit.
+	 *
+	 * Backends mostly allocate from their own partition, so the estimate is
+	 * divided among the partitions in proportion to how far their clock hands
+	 * have advanced since last time.  If none has, we go by their sizes.
 	 */
-
-	num_to_scan = bufs_to_lap;
-	num_written = 0;
-	reusable_buffers = reusable_buffers_est;
-
-	/* Execute the LRU scan */
-	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
+	for (int partno = 0; partno < npartitions; partno++)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		BgWriterPartition *part = &partitions[partno];
+		float		share;
+		int			part_alloc_est;
+		int			part_reusable_est;
+		int			part_reusable;
+		int			num_to_scan;
+
+		if (strategy_delta > 0)
+			share = (float) part->strategy_delta / (float) strategy_delta;
+		else
+			share = (float) part->size / (float) nbuffers;
+		part_alloc_est = (int) (upcoming_alloc_est * share);
+		part_reusable_est = (float) (part->size - part->bufs_to_lap) /
+			smoothed_density;
 
-		if (++next_to_clean >= NBuffers)
-		{
-			next_to_clean = 0;
-			next_passes++;
-		}
-		num_to_scan--;
+		num_to_scan = part->bufs_to_lap;
+		part_reusable = part_reusable_est;
 
-		if (sync_state & BUF_WRITTEN)
+		/* Execute the LRU scan */
+		while (num_to_scan > 0 && part_reusable < part_alloc_est)
 		{
-			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			int			sync_state = SyncOneBuffer(part->next_to_clean, true,
+												   InvalidXLogRecPtr,
+												   wb_context);
+
+			if (++part->next_to_clean >= part->first + part->size)
 			{
-				PendingBgWriterStats.maxwritten_clean++;
-				break;
+				part->next_to_clean = part->first;
+				part->next_passes++;
+			}
+			num_to_scan--;
+
+			if (sync_state & BUF_WRITTEN)
+			{
+				part_reusable++;
+				if (++num_written >= bgwriter_lru_maxpages)
+				{
+					PendingBgWriterStats.maxwritten_clean++;
+					break;
+				}
 			}
+			else if (sync_state & BUF_REUSABLE)
+				part_reusable++;
 		}
-		else if (sync_state & BUF_REUSABLE)
-			reusable_buffers++;
+
+		num_scanned += part->bufs_to_lap - num_to_scan;
+		reusable_buffers += part_reusable - part_reusable_est;
+
+		if (num_written >= bgwriter_lru_maxpages)
+			break;
 	}
 
-	PendingBgWriterStats.buf_written_clean += num_written;
+	/* Also write out dirty buffers that haven't been modified in a while */
+	if (bgwriter_cold_flush)
+	{
+		if (num_written < bgwriter_lru_maxpages)
+			num_written_cold = BgBufferSyncCold(wb_context,
+												bgwriter_lru_maxpages - num_written,
+												&cold_idle);
+		else
+			cold_idle = false;
+	}
+
+	PendingBgWriterStats.buf_written_clean += num_written + num_written_cold;
 
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
 		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
 		 smoothed_density, reusable_buffers_est, upcoming_alloc_est,
-		 bufs_to_lap - num_to_scan,
+		 num_scanned,
 		 num_written,
-		 reusable_buffers - reusable_buffers_est);
+		 reusable_buffers);
 #endif
 
 	/*
@@ -3438,8 +3680,8 @@ BgBufferSync(WritebackContext *wb_context)
 	 * which is helpful because a long memory isn't as desirable on the
 	 * density estimates.
 	 */
-	new_strategy_delta = bufs_to_lap - num_to_scan;
-	new_recent_alloc = reusable_buffers - reusable_buffers_est;
+	new_strategy_delta = num_scanned;
+	new_recent_alloc = reusable_buffers;
 	if (new_strategy_delta > 0 && new_recent_alloc > 0)
 	{
 		scans_per_alloc = (float) new_strategy_delta / (float) new_recent_alloc;
@@ -3454,7 +3696,198 @@ BgBufferSync(WritebackContext *wb_context)
 	}
 
 	/* Return true if OK to hibernate */
-	return (bufs_to_lap == 0 && recent_alloc == 0);
+	return (bufs_to_lap == 0 && recent_alloc == 0 && cold_idle);
+}
+
+/*
+ * BgBufferSyncCold -- Write out dirty buffers that haven't been modified in
+ * a while, ahead of the next checkpoint.
+ *
+ * With a large shared_buffers and a working set that fits into it, hardly
+ * any buffers get evicted, so the LRU scan in BgBufferSync() has little to
+ * do and all dirty buffers are left for the checkpointer to write in one go.
+ * To spread those writes out, the bgwriter can additionally sweep through
+ * the whole buffer pool COLD_SWEEPS_PER_CHECKPOINT times per
+ * checkpoint_timeout, writing out unpinned dirty buffers of permanent
+ * relations whose page LSN shows they haven't been WAL-logged since the
+ * previous sweep started.  Such buffers are unlikely to be dirtied again
+ * before the next checkpoint, which would have to write them anyway; hot
+ * buffers that are modified all the time are left alone, so they are still
+ * written once per checkpoint.
+ *
+ * At most max_written buffers are written, which is what the LRU scan has
+ * left of bgwriter_lru_maxpages in this round.
+ *
+ * Returns the number of buffers written.  *idle is set to true only if the
+ * last full sweep, and the current one so far, found nothing to write: a
+ * single round covers only a small part of the pool, so finding nothing in
+ * it doesn't mean there's nothing left to do before hibernating.
+ */
+#define COLD_SWEEPS_PER_CHECKPOINT	4
+
+static int
+BgBufferSyncCold(WritebackContext *wb_context, int max_written, bool *idle)
+{
+	/* Saved between calls: current sweep position and its LSN bounds */
+	static int	next_to_sweep = 0;
+	static XLogRecPtr sweep_start_lsn = InvalidXLogRecPtr;
+	static XLogRecPtr prev_sweep_start_lsn = InvalidXLogRecPtr;
+	static int	sweep_written = 0;
+	static bool prev_sweep_clean = false;
+
+	int			nbuffers;
+	int			num_to_scan;
+	int			num_written = 0;
+
+	/* Scan enough buffers per round to complete the sweep in time */
+	nbuffers = StrategyGetActiveBuffers();
+	num_to_scan = (int) ((double) nbuffers * BgWriterDelay *
+						 COLD_SWEEPS_PER_CHECKPOINT /
+						 (CheckPointTimeout * 1000.0));
+	num_to_scan = Max(num_to_scan, 1);
+
+	while (num_to_scan-- > 0)
+	{
+		if (next_to_sweep == 0)
+		{
+			/* Starting a new sweep; did the one just finished write any? */
+			prev_sweep_clean = !XLogRecPtrIsInvalid(prev_sweep_start_lsn) &&
+				sweep_written == 0;
+			sweep_written = 0;
+
+			/* remember where WAL was */
+			prev_sweep_start_lsn = sweep_start_lsn;
+			sweep_start_lsn = RecoveryInProgress() ?
+				GetXLogReplayRecPtr(NULL) : GetXLogInsertRecPtr();
+		}
+
+		/* During the first sweep, we don't know what's cold yet */
+		if (!XLogRecPtrIsInvalid(prev_sweep_start_lsn) &&
+			(SyncOneBuffer(next_to_sweep, false, prev_sweep_start_lsn,
+						   wb_context) & BUF_WRITTEN))
+			num_written++;
+
+		if (++next_to_sweep >= nbuffers)
+			next_to_sweep = 0;
+
+		if (num_written >= max_written)
+			break;
+	}
+
+	sweep_written += num_written;
+	*idle = prev_sweep_clean && sweep_written == 0;
+
+	return num_written;
+}
+
+/*
+ * SharedBuffersLimit -- number of buffers that may currently be used
+ *
+ * This is shared_buffers_limit, capped at shared_buffers, which is the
+ * number of buffers allocated in shared memory at startup.
+ */
+int
+SharedBuffersLimit(void)
+{
+	if (shared_buffers_limit < 0)
+		return NBuffers;
+	return Min(shared_buffers_limit, NBuffers);
+}
+
+/*
+ * GUC check_hook for shared_buffers_limit
+ */
+bool
+check_shared_buffers_limit(int *newval, void **extra, GucSource source)
+{
+	if (*newval >= 0 && *newval < 16)
+	{
+		GUC_check_errdetail("\"shared_buffers_limit\" must be -1 or at least 16 buffers.");
+		return false;
+	}
+	return true;
+}
+
+/*
+ * BgBufferApplyLimit -- Resize the active part of the buffer pool.
+ *
+ * shared_buffers_limit lets the number of buffers in use be changed without
+ * a restart, between 16 and shared_buffers.  Called by the background writer
+ * in each cycle, this publishes a changed limit to freelist.c, so that new
+ * pages are only read into buffers below it, and then evicts the pages left
+ * in buffers at or above it.  Buffers that are pinned can't be evicted right
+ * away; we keep retrying them in later cycles.  A backend could still have
+ * been in the middle of allocating one of those buffers when the limit was
+ * lowered, so we only stop once the tail of the pool has been found empty
+ * twice in a row.
+ *
+ * The memory of the evicted buffers stays allocated, as the shared memory
+ * segment can't be shrunk, but it is no longer touched.  Conversely, with a
+ * low limit at startup, the tail of the pool is never touched until the
+ * limit is raised, so the operating system doesn't need to back it with
+ * memory, unless huge pages are in use.
+ *
+ * Returns true if there's nothing left to do, so the caller may hibernate.
+ */
+#define BUFFER_LIMIT_SCAN_CHUNK		16384
+
+bool
+BgBufferApplyLimit(void)
+{
+	/* Saved between calls: scan position and number of empty passes */
+	static int	next_to_evict = 0;
+	static int	empty_passes = 0;
+	static bool pass_found_buffers = false;
+
+	int			limit = SharedBuffersLimit();
+	int			num_to_scan = BUFFER_LIMIT_SCAN_CHUNK;
+
+	if (limit != StrategyGetActiveBuffers())
+	{
+		StrategySetActiveBuffers(limit);
+		elog(DEBUG1, "using %d of %d shared buffers", limit, NBuffers);
+
+		/* Start a new scan of the tail of the pool */
+		next_to_evict = limit;
+		empty_passes = 0;
+		pass_found_buffers = false;
+	}
+
+	if (empty_passes >= 2 || limit >= NBuffers)
+		return true;
+
+	if (next_to_evict < limit)
+		next_to_evict = limit;
+
+	while (num_to_scan-- > 0)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(next_to_evict);
+		uint32		buf_state;
+
+		/* Check the flags without the spinlock, EvictUnpinnedBuffer rechecks */
+		buf_state = pg_atomic_read_u32(&bufHdr->state);
+		if (buf_state & (BM_VALID | BM_TAG_VALID))
+		{
+			pass_found_buffers = true;
+			EvictUnpinnedBuffer(BufferDescriptorGetBuffer(bufHdr));
+		}
+
+		if (++next_to_evict >= NBuffers)
+		{
+			/* Finished a pass over the tail of the pool */
+			if (pass_found_buffers)
+				empty_passes = 0;
+			else
+				empty_passes++;
+			pass_found_buffers = false;
+			next_to_evict = limit;
+
+			if (empty_passes >= 2)
+				break;
+		}
+	}
+
+	return empty_passes >= 2;
 }
 
 /*
@@ -3463,6 +3896,9 @@ BgBufferSync(WritebackContext *wb_context)
  * If skip_recently_used is true, we don't write currently-pinned buffers, nor
  * buffers marked recently used, as these are not replacement candidates.
  *
+ * If unmodified_since is valid, we only write buffers that are not pinned and
+ * whose page LSN precedes it.
+ *
  * Returns a bitmask containing the following flag bits:
  *	BUF_WRITTEN: we wrote the buffer.
  *	BUF_REUSABLE: buffer is available for replacement, ie, it has
@@ -3472,7 +3908,8 @@ BgBufferSync(WritebackContext *wb_context)
  * after locking it, but we don't care all that much.)
  */
 static int
-SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
+SyncOneBuffer(int buf_id, bool skip_recently_used, XLogRecPtr unmodified_since,
+			  WritebackContext *wb_context)
 {
 	BufferDesc *bufHdr = GetBufferDescriptor(buf_id);
 	int			result = 0;
@@ -3513,11 +3950,38 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 		return result;
 	}
 
+	/*
+	 * If the caller only wants buffers that haven't been modified recently,
+	 * skip pinned ones, and those of unlogged relations: their pages have no
+	 * meaningful LSN, and checkpoints don't write them anyway.
+	 */
+	if (!XLogRecPtrIsInvalid(unmodified_since) &&
+		(BUF_STATE_GET_REFCOUNT(buf_state) != 0 ||
+		 !(buf_state & BM_PERMANENT)))
+	{
+		UnlockBufHdr(bufHdr, buf_state);
+		return result;
+	}
+
 	/*
 	 * Pin it, share-lock it, write it.  (FlushBuffer will do nothing if the
 	 * buffer is clean by the time we've locked it.)
 	 */
 	PinBuffer_Locked(bufHdr);
+
+	/*
+	 * Now check the page LSN, if asked to.  Without the content lock, someone
+	 * might be modifying the page concurrently, but this is only a
+	 * heuristic: at worst we write out a buffer that is about to be dirtied
+	 * again.
+	 */
+	if (!XLogRecPtrIsInvalid(unmodified_since) &&
+		BufferGetLSNAtomic(BufferDescriptorGetBuffer(bufHdr)) >= unmodified_since)
+	{
+		UnpinBuffer(bufHdr);
+		return result;
+	}
+
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
 	FlushBuffer(bufHdr, NULL, IOOBJECT_RELATION, IOCONTEXT_NORMAL);
@@ -4061,28 +4525,27 @@ DropRelationBuffers(SMgrRelation smgr_reln, ForkNumber *forkNum,
 	 * Linux kernels that might not have accounted for the recent write. But
 	 * that should be fine because there must not be any buffers after that
 	 * file size.
+	 *
+	 * Outside recovery, and as a tighter limit in recovery, we also know an
+	 * upper bound of the blocks that can be in the buffer pool, tracked by
+	 * buf_table.c.  It is exact for forks that never had any buffers.
 	 */
 	for (i = 0; i < nforks; i++)
 	{
 		/* Get the number of blocks for a relation's fork */
-		nForkBlock[i] = smgrnblocks_cached(smgr_reln, forkNum[i]);
-
-		if (nForkBlock[i] == InvalidBlockNumber)
-		{
-			nBlocksToInvalidate = InvalidBlockNumber;
-			break;
-		}
+		nForkBlock[i] = Min(smgrnblocks_cached(smgr_reln, forkNum[i]),
+							BufTableBlockBound(rlocator.locator, forkNum[i]));
 
 		/* calculate the number of blocks to be invalidated */
-		nBlocksToInvalidate += (nForkBlock[i] - firstDelBlock[i]);
+		if (nForkBlock[i] > firstDelBlock[i])
+			nBlocksToInvalidate += (nForkBlock[i] - firstDelBlock[i]);
 	}
 
 	/*
 	 * We apply the optimization iff the total number of blocks to invalidate
 	 * is below the BUF_DROP_FULL_SCAN_THRESHOLD.
 	 */
-	if (BlockNumberIsValid(nBlocksToInvalidate) &&
-		nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	if (nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
 	{
 		for (j = 0; j < nforks; j++)
 			FindAndDropRelationBuffers(rlocator.locator, forkNum[j],
@@ -4148,7 +4611,6 @@ DropRelationsAllBuffers(SMgrRelation *smgr_reln, int nlocators)
 	BlockNumber (*block)[MAX_FORKNUM + 1];
 	uint64		nBlocksToInvalidate = 0;
 	RelFileLocator *locators;
-	bool		cached = true;
 	bool		use_bsearch;
 
 	if (nlocators == 0)
@@ -4187,22 +4649,23 @@ DropRelationsAllBuffers(SMgrRelation *smgr_reln, int nlocators)
 
 	/*
 	 * We can avoid scanning the entire buffer pool if we know the exact size
-	 * of each of the given relation forks. See DropRelationBuffers.
+	 * of each of the given relation forks, or a bound of the blocks that can
+	 * be in the buffer pool. See DropRelationBuffers.
 	 */
-	for (i = 0; i < n && cached; i++)
+	for (i = 0; i < n; i++)
 	{
 		for (int j = 0; j <= MAX_FORKNUM; j++)
 		{
 			/* Get the number of blocks for a relation's fork. */
-			block[i][j] = smgrnblocks_cached(rels[i], j);
+			block[i][j] = Min(smgrnblocks_cached(rels[i], j),
+							  BufTableBlockBound(rels[i]->smgr_rlocator.locator,
+												 j));
 
-			/* We need to only consider the relation forks that exists. */
-			if (block[i][j] == InvalidBlockNumber)
+			/* Forks that never had any buffers can be skipped. */
+			if (block[i][j] == 0)
 			{
-				if (!smgrexists(rels[i], j))
-					continue;
-				cached = false;
-				break;
+				block[i][j] = InvalidBlockNumber;
+				continue;
 			}
 
 			/* calculate the total number of blocks to be invalidated */
@@ -4214,7 +4677,7 @@ DropRelationsAllBuffers(SMgrRelation *smgr_reln, int nlocators)
 	 * We apply the optimization iff the total number of blocks to invalidate
 	 * is below the BUF_DROP_FULL_SCAN_THRESHOLD.
 	 */
-	if (cached && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	if (nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
 	{
 		for (i = 0; i < n; i++)
 		{
@@ -6105,7 +6568,7 @@ EvictUnpinnedBuffer(Buffer buf)
 	}
 
 	/* This will return false if it becomes dirty or someone else pins it. */
-	result = InvalidateVictimBuffer(desc);
+	result = InvalidateVictimBuffer(desc, true);
 
 	UnpinBuffer(desc);
 
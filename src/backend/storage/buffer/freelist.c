@@ -17,12 +17,45 @@
 
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/* GUC variables */
+int			clock_sweep_partitions = 1;
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
+
+/*
+ * A clock sweep partition.  The active part of the buffer pool is divided
+ * into clock_sweep_partitions equally sized, contiguous ranges, each with its
+ * own clock hand.  Each backend runs the clock sweep in its own partition
+ * first, so concurrent backends don't all fight over the same clock hand and
+ * mostly look at buffer headers no other backend is touching.  Partitions
+ * are padded to a cache line, so neighbouring clock hands don't share one.
+ */
+typedef struct
+{
+	/*
+	 * Clock sweep hand: offset of next buffer to consider grabbing, relative
+	 * to the start of the partition.  Note that this isn't a concrete buffer
+	 * - we only ever increase the value. So, to get an actual buffer, it
+	 * needs to be used modulo the partition size.
+	 */
+	pg_atomic_uint32 nextVictimBuffer;
+
+	/* Complete cycles of this clock hand; protected by buffer_strategy_lock */
+	uint32		completePasses;
+} ClockSweepPartition;
+
+typedef union ClockSweepPartitionPadded
+{
+	ClockSweepPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} ClockSweepPartitionPadded;
+
 
 /*
  * The shared freelist control information.
@@ -32,12 +65,18 @@ typedef struct
 	/* Spinlock: protects the values below */
 	slock_t		buffer_strategy_lock;
 
+	/* Number of clock sweep partitions, see ClockSweepPartition */
+	int			numPartitions;
+
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Number of buffers, from the start of the buffer pool, that we hand out
+	 * for new pages.  This is NBuffers unless shared_buffers_limit says
+	 * otherwise.  Buffers beyond it are never returned by StrategyGetBuffer,
+	 * and the background writer evicts the pages they contain after the
+	 * limit has been lowered, see BgBufferApplyLimit().  Can only be changed
+	 * while holding buffer_strategy_lock, but is read without it.
 	 */
-	pg_atomic_uint32 nextVictimBuffer;
+	pg_atomic_uint32 activeBuffers;
 
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
@@ -48,11 +87,20 @@ typedef struct
 	 */
 
 	/*
-	 * Statistics.  These counters should be wide enough that they can't
-	 * overflow during a single bgwriter cycle.
+	 * Statistics.  This counter should be wide enough that it can't overflow
+	 * during a single bgwriter cycle.
 	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+	pg_atomic_uint32 numDirtyEvictions; /* Dirty victims backends had to
+										 * write since last reset */
+
+	/*
+	 * Cumulative statistics of the 2Q replacement policy, see
+	 * StrategyAdmitUsageCount().
+	 */
+	pg_atomic_uint64 probationAdmits;	/* pages admitted on probation */
+	pg_atomic_uint64 ghostAdmits;	/* pages admitted due to a ghost entry */
+	pg_atomic_uint64 ghostsRemembered;	/* evictions remembered as ghosts */
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
@@ -63,6 +111,25 @@ typedef struct
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
+static ClockSweepPartitionPadded *ClockSweepPartitions = NULL;
+
+/*
+ * Ghost entries of the 2Q replacement policy: hash codes of the tags of
+ * recently evicted pages, in a direct-mapped array indexed by the low bits of
+ * the hash code.  Newer evictions simply overwrite older ones that map to the
+ * same slot, which ages out the history without any bookkeeping.  Zero means
+ * an empty slot.
+ */
+static pg_atomic_uint32 *StrategyGhosts = NULL;
+static uint32 StrategyGhostsMask;
+
+/*
+ * For each buffer, the value of probationAdmits when the page in it was
+ * admitted on probation by the 2Q policy, see StrategyCorrelatedReference().
+ */
+static pg_atomic_uint32 *StrategyAdmitStamps = NULL;
+
+static uint32 StrategyGhostSlots(void);
 
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
@@ -98,14 +165,33 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 static void AddBufferToRing(BufferAccessStrategy strategy,
 							BufferDesc *buf);
 
+/*
+ * ClockSweepPartitionRange - Compute the range of buffers in a partition
+ *
+ * Sets *first to the id of the first buffer in the partition, and returns the
+ * number of buffers in it, when nbuffers buffers are in use.
+ */
+static inline uint32
+ClockSweepPartitionRange(int partno, uint32 nbuffers, uint32 *first)
+{
+	int			npartitions = StrategyControl->numPartitions;
+	uint32		end;
+
+	*first = (uint64) partno * nbuffers / npartitions;
+	end = (uint64) (partno + 1) * nbuffers / npartitions;
+
+	return end - *first;
+}
+
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.  The
+ * partition consists of the size buffers starting at first.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(ClockSweepPartition *part, uint32 first, uint32 size)
 {
 	uint32		victim;
 
@@ -115,14 +201,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= size)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % size;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -150,17 +236,17 @@ ClockSweepTick(void)
 				 */
 				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % size;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
+					part->completePasses++;
 				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 			}
 		}
 	}
-	return victim;
+	return first + victim;
 }
 
 /*
@@ -199,6 +285,9 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 	int			bgwprocno;
 	int			trycounter;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
+	uint32		nbuffers;
+	int			npartitions;
+	int			homepart;
 
 	*from_ring = false;
 
@@ -291,6 +380,10 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 			 */
 			SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 
+			/* Buffers beyond the active part of the pool are just dropped */
+			if (buf->buf_id >= pg_atomic_read_u32(&StrategyControl->activeBuffers))
+				continue;
+
 			/*
 			 * If the buffer is pinned or has a nonzero usage_count, we cannot
 			 * use it; discard it and retry.  (This can only happen if VACUUM
@@ -311,49 +404,74 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 		}
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
-	for (;;)
+	/*
+	 * Nothing on the freelist, so run the "clock sweep" algorithm.  Start in
+	 * this backend's own partition, and only move on to the others if all
+	 * the buffers in it are pinned.
+	 */
+	nbuffers = pg_atomic_read_u32(&StrategyControl->activeBuffers);
+	npartitions = StrategyControl->numPartitions;
+	homepart = MyProcNumber != INVALID_PROC_NUMBER ?
+		MyProcNumber % npartitions : 0;
+
+	for (int i = 0; i < npartitions; i++)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		int			partno = (homepart + i) % npartitions;
+		ClockSweepPartition *part = &ClockSweepPartitions[partno].part;
+		uint32		first;
+		uint32		size;
+
+		size = ClockSweepPartitionRange(partno, nbuffers, &first);
+		trycounter = size;
+		for (;;)
+		{
+			buf = GetBufferDescriptor(ClockSweepTick(part, first, size));
 
-		/*
-		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
-		 * it; decrement the usage_count (unless pinned) and keep scanning.
-		 */
-		local_buf_state = LockBufHdr(buf);
+			/*
+			 * If the buffer is pinned or has a nonzero usage_count, we cannot
+			 * use it; decrement the usage_count (unless pinned) and keep
+			 * scanning.
+			 */
+			local_buf_state = LockBufHdr(buf);
 
-		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
-		{
-			if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+			if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
 			{
-				local_buf_state -= BUF_USAGECOUNT_ONE;
-
-				trycounter = NBuffers;
+				if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+				{
+					local_buf_state -= BUF_USAGECOUNT_ONE;
+
+					trycounter = size;
+				}
+				else
+				{
+					/* Found a usable buffer */
+					if (strategy != NULL)
+						AddBufferToRing(strategy, buf);
+					*buf_state = local_buf_state;
+					return buf;
+				}
 			}
-			else
+			else if (--trycounter == 0)
 			{
-				/* Found a usable buffer */
-				if (strategy != NULL)
-					AddBufferToRing(strategy, buf);
-				*buf_state = local_buf_state;
-				return buf;
+				/*
+				 * We've scanned all the buffers in this partition without
+				 * making any state changes, so they are all pinned (or were
+				 * when we looked at them).  Try the next partition.
+				 */
+				UnlockBufHdr(buf, local_buf_state);
+				break;
 			}
-		}
-		else if (--trycounter == 0)
-		{
-			/*
-			 * We've scanned all the buffers without making any state changes,
-			 * so all the buffers are pinned (or were when we looked at them).
-			 * We could hope that someone will free one eventually, but it's
-			 * probably better to fail than to risk getting stuck in an
-			 * infinite loop.
-			 */
 			UnlockBufHdr(buf, local_buf_state);
-			elog(ERROR, "no unpinned buffers available");
 		}
-		UnlockBufHdr(buf, local_buf_state);
 	}
+
+	/*
+	 * We've scanned all the buffers without finding one that's not pinned.
+	 * We could hope that someone will free one eventually, but it's probably
+	 * better to fail than to risk getting stuck in an infinite loop.
+	 */
+	elog(ERROR, "no unpinned buffers available");
+	return NULL;				/* keep compiler quiet */
 }
 
 /*
@@ -366,9 +484,11 @@ StrategyFreeBuffer(BufferDesc *buf)
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
-	 * is already in it; don't screw up the list if so.
+	 * is already in it; don't screw up the list if so.  Buffers beyond the
+	 * active part of the pool are not put in the list at all.
 	 */
-	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
+	if (buf->freeNext == FREENEXT_NOT_IN_LIST &&
+		buf->buf_id < pg_atomic_read_u32(&StrategyControl->activeBuffers))
 	{
 		buf->freeNext = StrategyControl->firstFreeBuffer;
 		if (buf->freeNext < 0)
@@ -382,43 +502,259 @@ StrategyFreeBuffer(BufferDesc *buf)
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
- * The result is the buffer index of the best buffer to sync first.
- * BufferSync() will proceed circularly around the buffer array from there.
+ * With more than one clock sweep partition, there is a clock hand in each of
+ * them, and the background writer has to clean ahead of each hand
+ * separately.  The result is the buffer index of the best buffer to sync
+ * first in the given partition, which consists of the *size buffers starting
+ * at *first.  BufferSync() will proceed circularly around that range from
+ * there.
  *
- * In addition, we return the completed-pass count (which is effectively
- * the higher-order bits of nextVictimBuffer) and the count of recent buffer
- * allocs if non-NULL pointers are passed.  The alloc count is reset after
- * being read.
+ * In addition, we return the completed-pass count of the partition's hand
+ * (which is effectively the higher-order bits of its nextVictimBuffer), the
+ * count of recent buffer allocs and the count of recent dirty victims
+ * written by backends, see StrategyReportDirtyEviction(), if non-NULL
+ * pointers are passed.  The alloc and dirty victim counts are for the whole
+ * buffer pool, and are reset after being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(int partno, int *first, int *size,
+				  uint32 *complete_passes, uint32 *num_buf_alloc,
+				  uint32 *num_dirty_evictions)
 {
+	ClockSweepPartition *part = &ClockSweepPartitions[partno].part;
 	uint32		nextVictimBuffer;
+	uint32		partfirst;
+	uint32		partsize;
 	int			result;
 
+	Assert(partno >= 0 && partno < StrategyControl->numPartitions);
+
 	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	partsize = ClockSweepPartitionRange(partno,
+										pg_atomic_read_u32(&StrategyControl->activeBuffers),
+										&partfirst);
+	nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+	result = partfirst + nextVictimBuffer % partsize;
+
+	*first = partfirst;
+	*size = partsize;
 
 	if (complete_passes)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = part->completePasses;
 
 		/*
 		 * Additionally add the number of wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		*complete_passes += nextVictimBuffer / partsize;
 	}
 
 	if (num_buf_alloc)
 	{
 		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
 	}
+	if (num_dirty_evictions)
+	{
+		*num_dirty_evictions = pg_atomic_exchange_u32(&StrategyControl->numDirtyEvictions, 0);
+	}
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 	return result;
 }
 
+/*
+ * StrategyNumPartitions -- number of clock sweep partitions
+ */
+int
+StrategyNumPartitions(void)
+{
+	return StrategyControl->numPartitions;
+}
+
+/*
+ * StrategyReportDirtyEviction -- note that a backend had to write out a dirty
+ *		victim buffer returned by the clock sweep
+ *
+ * Such writes are what the background writer's cleaning scan is meant to
+ * avoid, so it uses this count to decide how far ahead to clean.
+ */
+void
+StrategyReportDirtyEviction(void)
+{
+	pg_atomic_fetch_add_u32(&StrategyControl->numDirtyEvictions, 1);
+}
+
+/*
+ * StrategyGetActiveBuffers -- number of buffers the strategy hands out
+ */
+int
+StrategyGetActiveBuffers(void)
+{
+	return pg_atomic_read_u32(&StrategyControl->activeBuffers);
+}
+
+/*
+ * StrategySetActiveBuffers -- change the number of buffers the strategy hands
+ *		out
+ *
+ * This only affects future buffer allocations.  When shrinking, the caller is
+ * responsible for evicting the pages in the buffers that are no longer part
+ * of the active pool.
+ */
+void
+StrategySetActiveBuffers(int nbuffers)
+{
+	Assert(nbuffers > 0 && nbuffers <= NBuffers);
+
+	/*
+	 * Hold the spinlock, so StrategySyncStart() sees a value consistent with
+	 * nextVictimBuffer and completePasses.  The clock sweep hands don't need
+	 * to be adjusted, ClockSweepTick() will just wrap them around.
+	 */
+	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+	pg_atomic_write_u32(&StrategyControl->activeBuffers, nbuffers);
+	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+}
+
+/*
+ * Number of ghost entries: half the number of buffers, rounded up to a power
+ * of two, which is the size of the ghost queue suggested for 2Q.
+ */
+static uint32
+StrategyGhostSlots(void)
+{
+	return pg_nextpower2_32(NBuffers) / 2;
+}
+
+/* Value stored in a ghost entry for the given hash code; never zero */
+static inline uint32
+StrategyGhostValue(uint32 hashcode)
+{
+	return hashcode != 0 ? hashcode : 1;
+}
+
+/*
+ * Length of the correlated reference period of the 2Q policy, counted in
+ * pages admitted on probation: a quarter of the active buffers, the size of
+ * the probation queue suggested for 2Q.
+ */
+static inline uint32
+StrategyCorrelatedWindow(void)
+{
+	return pg_atomic_read_u32(&StrategyControl->activeBuffers) / 4;
+}
+
+/*
+ * StrategyAdmitUsageCount -- usage count for a page newly read into a buffer
+ *
+ * With the plain clock sweep, a new page starts with a usage count of one, so
+ * it survives one full pass of the clock hand even if it's never accessed
+ * again.  That lets large index scans and bitmap heap scans, which don't use
+ * a ring buffer, push out the frequently used pages.
+ *
+ * With the 2Q policy, pages instead start on probation, with a usage count of
+ * zero: unless they are accessed again after their correlated reference
+ * period, see StrategyCorrelatedReference(), they are the first to be
+ * evicted.  Pages that were evicted recently, and are read in again while
+ * still remembered by a ghost entry, have shown that they are needed
+ * repeatedly and start with a usage count of two instead.  Pages read through
+ * a ring buffer are not affected, as rings already protect the rest of the
+ * pool from them.
+ *
+ * hashcode is the buffer mapping hash code of the page's tag, and buf_id the
+ * buffer it is read into.
+ */
+uint32
+StrategyAdmitUsageCount(uint32 hashcode, int buf_id,
+						BufferAccessStrategy strategy)
+{
+	pg_atomic_uint32 *ghost;
+	uint32		expected;
+	uint32		stamp;
+
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q)
+		return 1;
+
+	/* Unless admitted on probation, the page is past its correlated period */
+	stamp = (uint32) pg_atomic_read_u64(&StrategyControl->probationAdmits) -
+		NBuffers;
+
+	if (strategy == NULL)
+	{
+		ghost = &StrategyGhosts[hashcode & StrategyGhostsMask];
+		expected = StrategyGhostValue(hashcode);
+		if (pg_atomic_read_u32(ghost) == expected &&
+			pg_atomic_compare_exchange_u32(ghost, &expected, 0))
+		{
+			pg_atomic_fetch_add_u64(&StrategyControl->ghostAdmits, 1);
+			pg_atomic_write_u32(&StrategyAdmitStamps[buf_id], stamp);
+			return 2;
+		}
+
+		stamp = (uint32)
+			pg_atomic_fetch_add_u64(&StrategyControl->probationAdmits, 1);
+		pg_atomic_write_u32(&StrategyAdmitStamps[buf_id], stamp);
+		return 0;
+	}
+
+	pg_atomic_write_u32(&StrategyAdmitStamps[buf_id], stamp);
+	return 1;
+}
+
+/*
+ * StrategyCorrelatedReference -- is an access to a buffer on probation
+ *		correlated with the one that read the page in?
+ *
+ * A page is often accessed several times in quick succession right after
+ * being read, e.g. for each of the tuples a scan finds on it, and that says
+ * nothing about whether it will be needed again later.  So with the 2Q
+ * policy, accesses to a page on probation only count, and raise its usage
+ * count, once fewer than StrategyCorrelatedWindow() other pages have been
+ * admitted on probation since.  Called by PinBuffer() and friends before
+ * incrementing a zero usage count.
+ */
+bool
+StrategyCorrelatedReference(int buf_id)
+{
+	uint32		now;
+
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q)
+		return false;
+
+	now = (uint32) pg_atomic_read_u64(&StrategyControl->probationAdmits);
+	return now - pg_atomic_read_u32(&StrategyAdmitStamps[buf_id]) <
+		StrategyCorrelatedWindow();
+}
+
+/*
+ * StrategyRememberEviction -- remember that a page was evicted
+ *
+ * hashcode is the buffer mapping hash code of the evicted page's tag.  Only
+ * used by the 2Q policy, see StrategyAdmitUsageCount().
+ */
+void
+StrategyRememberEviction(uint32 hashcode)
+{
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q)
+		return;
+
+	pg_atomic_write_u32(&StrategyGhosts[hashcode & StrategyGhostsMask],
+						StrategyGhostValue(hashcode));
+	pg_atomic_fetch_add_u64(&StrategyControl->ghostsRemembered, 1);
+}
+
+/*
+ * StrategyGetReplacementStats -- report 2Q replacement policy statistics
+ */
+void
+StrategyGetReplacementStats(uint64 *probation_admits, uint64 *ghost_admits,
+							uint64 *ghosts_remembered)
+{
+	*probation_admits = pg_atomic_read_u64(&StrategyControl->probationAdmits);
+	*ghost_admits = pg_atomic_read_u64(&StrategyControl->ghostAdmits);
+	*ghosts_remembered = pg_atomic_read_u64(&StrategyControl->ghostsRemembered);
+}
+
 /*
  * StrategyNotifyBgWriter -- set or clear allocation notification latch
  *
@@ -460,6 +796,17 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the clock sweep partitions */
+	size = add_size(size, mul_size(clock_sweep_partitions,
+								   sizeof(ClockSweepPartitionPadded)));
+
+	/* size of the 2Q ghost entries */
+	size = add_size(size, mul_size(StrategyGhostSlots(),
+								   sizeof(pg_atomic_uint32)));
+
+	/* size of the 2Q admission stamps */
+	size = add_size(size, mul_size(NBuffers, sizeof(pg_atomic_uint32)));
+
 	return size;
 }
 
@@ -494,6 +841,20 @@ StrategyInitialize(bool init)
 		ShmemInitStruct("Buffer Strategy Status",
 						sizeof(BufferStrategyControl),
 						&found);
+	ClockSweepPartitions = (ClockSweepPartitionPadded *)
+		ShmemInitStruct("Buffer Strategy Clock Sweep Partitions",
+						mul_size(clock_sweep_partitions,
+								 sizeof(ClockSweepPartitionPadded)),
+						&found);
+	StrategyGhosts = (pg_atomic_uint32 *)
+		ShmemInitStruct("Buffer Strategy Ghost Entries",
+						mul_size(StrategyGhostSlots(), sizeof(pg_atomic_uint32)),
+						&found);
+	StrategyGhostsMask = StrategyGhostSlots() - 1;
+	StrategyAdmitStamps = (pg_atomic_uint32 *)
+		ShmemInitStruct("Buffer Strategy Admission Stamps",
+						mul_size(NBuffers, sizeof(pg_atomic_uint32)),
+						&found);
 
 	if (!found)
 	{
@@ -511,12 +872,34 @@ StrategyInitialize(bool init)
 		StrategyControl->firstFreeBuffer = 0;
 		StrategyControl->lastFreeBuffer = NBuffers - 1;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
+		/* Initialize the clock sweep pointers */
+		StrategyControl->numPartitions = clock_sweep_partitions;
+		for (int partno = 0; partno < clock_sweep_partitions; partno++)
+		{
+			ClockSweepPartition *part = &ClockSweepPartitions[partno].part;
+
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+			part->completePasses = 0;
+		}
+
+		/* Initially, use as much of the pool as shared_buffers_limit allows */
+		pg_atomic_init_u32(&StrategyControl->activeBuffers,
+						   SharedBuffersLimit());
 
 		/* Clear statistics */
-		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
+		pg_atomic_init_u32(&StrategyControl->numDirtyEvictions, 0);
+		pg_atomic_init_u64(&StrategyControl->probationAdmits, 0);
+		pg_atomic_init_u64(&StrategyControl->ghostAdmits, 0);
+		pg_atomic_init_u64(&StrategyControl->ghostsRemembered, 0);
+
+		/* No ghost entries yet */
+		for (uint32 i = 0; i <= StrategyGhostsMask; i++)
+			pg_atomic_init_u32(&StrategyGhosts[i], 0);
+
+		/* No page is in its correlated reference period yet */
+		for (int i = 0; i < NBuffers; i++)
+			pg_atomic_init_u32(&StrategyAdmitStamps[i], (uint32) -NBuffers);
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
@@ -595,10 +978,10 @@ GetAccessStrategyWithSize(BufferAccessStrategyType btype, int ring_size_kb)
 	if (ring_buffers == 0)
 		return NULL;
 
-	/* Cap to 1/8th of shared_buffers */
-	ring_buffers = Min(NBuffers / 8, ring_buffers);
+	/* Cap to 1/8th of the shared buffers in use */
+	ring_buffers = Min(StrategyGetActiveBuffers() / 8, ring_buffers);
 
-	/* NBuffers should never be less than 16, so this shouldn't happen */
+	/* At least 16 buffers are always in use, so this shouldn't happen */
 	Assert(ring_buffers > 0);
 
 	/* Allocate the object and initialize all elements to zeroes */
@@ -647,7 +1030,7 @@ int
 GetAccessStrategyPinLimit(BufferAccessStrategy strategy)
 {
 	if (strategy == NULL)
-		return NBuffers;
+		return StrategyGetActiveBuffers();
 
 	switch (strategy->btype)
 	{
@@ -712,6 +1095,10 @@ GetBufferFromRing(BufferAccessStrategy strategy, uint32 *buf_state)
 	if (bufnum == InvalidBuffer)
 		return NULL;
 
+	/* Don't reuse a buffer that's no longer part of the active pool */
+	if (bufnum > pg_atomic_read_u32(&StrategyControl->activeBuffers))
+		return NULL;
+
 	/*
 	 * If the buffer is pinned we cannot use it under any circumstances.
 	 *
@@ -2405,6 +2405,44 @@ retry:
 	return FileZero(file, offset, amount, wait_event_info);
 }
 
+/*
+ * Deallocate the given range of a file, leaving its size unchanged, so that
+ * it reads back as zeroes without occupying disk space.  Returns -1 with
+ * errno set to EOPNOTSUPP if the platform or file system can't do that.
+ */
+int
+FilePunchHole(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef FALLOC_FL_PUNCH_HOLE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FilePunchHole: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return -1;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = fallocate(VfdCache[file].fd,
+						   FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+						   offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode < 0 && errno == EINTR)
+		goto retry;
+
+	return returnCode;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 off_t
 FileSize(File file)
 {
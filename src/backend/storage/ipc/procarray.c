@@ -95,10 +95,61 @@ typedef struct ProcArrayStruct
 	/* oldest catalog xmin of any replication slot */
 	TransactionId replication_slot_catalog_xmin;
 
+	/*
+	 * Counters for ProcArrayEndTransaction(): transactions whose xid was
+	 * cleared without waiting for ProcArrayLock, groups cleared by a group
+	 * leader, and transactions cleared as part of such a group.  Only changed
+	 * while holding ProcArrayLock exclusively.
+	 */
+	uint64		end_xact_direct_clears;
+	uint64		end_xact_group_clears;
+	uint64		end_xact_group_members;
+
 	/* indexes into allProcs[], has PROCARRAY_MAXPROCS entries */
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * Shared snapshot cache.
+ *
+ * GetSnapshotData() has to look at every entry of the dense ProcGlobal->xids
+ * array, which gets expensive with a large number of connections, even if
+ * only a handful of them have an xid assigned.  As long as no transaction
+ * with an xid has finished, the result of that scan is the same for every
+ * backend that doesn't have an xid of its own; xactCompletionCount serves as
+ * a commit sequence number identifying that state (see
+ * GetSnapshotDataReuse()).  So the most recently computed snapshot of such a
+ * backend is published here, and other backends without an xid copy it
+ * instead of scanning the proc array, as long as its completion count is
+ * still current.
+ *
+ * Readers and writers both hold ProcArrayLock in shared mode.  To keep them
+ * from blocking each other, the contents are protected by a change counter:
+ * a writer makes the counter odd while it modifies the contents and even
+ * again afterwards, and gives up instead of waiting if another writer is
+ * active.  Readers don't wait or retry either: if the counter is odd, or
+ * changed while copying, they just build the snapshot the hard way.
+ *
+ * Only snapshots taken outside of recovery are cached.  The subxid array is
+ * limited to PROCARRAY_MAXPROCS entries; snapshots with more (non-overflowed)
+ * subxids are not published.
+ */
+typedef struct SnapshotCacheData
+{
+	pg_atomic_uint32 changecount;
+
+	/* the rest is only valid while changecount is even */
+	uint64		xactCompletionCount;	/* 0 if nothing cached */
+	TransactionId xmin;
+	TransactionId xmax;
+	int			xcnt;
+	int			subxcnt;
+	bool		suboverflowed;
+
+	/* xip[] followed by subxip[], PROCARRAY_MAXPROCS entries each */
+	TransactionId xids[FLEXIBLE_ARRAY_MEMBER];
+} SnapshotCacheData;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -162,16 +213,8 @@ typedef struct ProcArrayStruct
  * prevent maybe_needed to become old enough after the GetSnapshotData()
  * call.
  *
- * The typedef is in the header.
+ * The struct itself is in the header.
  */
-struct GlobalVisState
-{
-	/* XIDs >= are considered running by some backend */
-	FullTransactionId definitely_needed;
-
-	/* XIDs < are not considered to be running by any backend */
-	FullTransactionId maybe_needed;
-};
 
 /*
  * Result of ComputeXidHorizons().
@@ -268,6 +311,8 @@ typedef enum KAXCompressReason
 
 static ProcArrayStruct *procArray;
 
+static SnapshotCacheData *snapshotCache;
+
 static PGPROC *allProcs;
 
 /*
@@ -360,11 +405,19 @@ static int	KnownAssignedXidsGetAndSetXmin(TransactionId *xarray,
 static TransactionId KnownAssignedXidsGetOldestXmin(void);
 static void KnownAssignedXidsDisplay(int trace_level);
 static void KnownAssignedXidsReset(void);
-static inline void ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid);
+static inline void ProcArrayEndTransactionInternal(PGPROC *proc);
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
 static void MaintainLatestCompletedXid(TransactionId latestXid);
 static void MaintainLatestCompletedXidRecovery(TransactionId latestXid);
 
+static bool SnapshotCacheRead(Snapshot snapshot, uint64 curXactCompletionCount,
+							  TransactionId xmax, TransactionId *xmin,
+							  int *count, int *subcount, bool *suboverflowed);
+static void SnapshotCachePublish(Snapshot snapshot,
+								 uint64 curXactCompletionCount,
+								 TransactionId xmin, TransactionId xmax,
+								 int count, int subcount, bool suboverflowed);
+
 static inline FullTransactionId FullXidRelativeTo(FullTransactionId rel,
 												  TransactionId xid);
 static void GlobalVisUpdateApply(ComputeXidHorizonsResult *horizons);
@@ -383,6 +436,13 @@ ProcArrayShmemSize(void)
 	size = offsetof(ProcArrayStruct, pgprocnos);
 	size = add_size(size, mul_size(sizeof(int), PROCARRAY_MAXPROCS));
 
+	/* Shared snapshot cache, with room for xip[] and subxip[] */
+#define SNAPSHOT_CACHE_SIZE \
+	add_size(offsetof(SnapshotCacheData, xids), \
+			 mul_size(sizeof(TransactionId), mul_size(2, PROCARRAY_MAXPROCS)))
+
+	size = add_size(size, SNAPSHOT_CACHE_SIZE);
+
 	/*
 	 * During Hot Standby processing we have a data structure called
 	 * KnownAssignedXids, created in shared memory. Local data structures are
@@ -441,9 +501,22 @@ CreateSharedProcArray(void)
 		procArray->lastOverflowedXid = InvalidTransactionId;
 		procArray->replication_slot_xmin = InvalidTransactionId;
 		procArray->replication_slot_catalog_xmin = InvalidTransactionId;
+		procArray->end_xact_direct_clears = 0;
+		procArray->end_xact_group_clears = 0;
+		procArray->end_xact_group_members = 0;
 		TransamVariables->xactCompletionCount = 1;
 	}
 
+	/* Create or attach to the shared snapshot cache */
+	snapshotCache = (SnapshotCacheData *)
+		ShmemInitStruct("Snapshot Cache", SNAPSHOT_CACHE_SIZE, &found);
+
+	if (!found)
+	{
+		pg_atomic_init_u32(&snapshotCache->changecount, 0);
+		snapshotCache->xactCompletionCount = 0;
+	}
+
 	allProcs = ProcGlobal->allProcs;
 
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
@@ -683,7 +756,16 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 		 */
 		if (LWLockConditionalAcquire(ProcArrayLock, LW_EXCLUSIVE))
 		{
-			ProcArrayEndTransactionInternal(proc, latestXid);
+			ProcArrayEndTransactionInternal(proc);
+
+			/* Also advance global latestCompletedXid while holding the lock */
+			MaintainLatestCompletedXid(latestXid);
+
+			/* Same with xactCompletionCount  */
+			TransamVariables->xactCompletionCount++;
+
+			procArray->end_xact_direct_clears++;
+
 			LWLockRelease(ProcArrayLock);
 		}
 		else
@@ -725,10 +807,12 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 /*
  * Mark a write transaction as no longer running.
  *
- * We don't do any locking here; caller must handle that.
+ * We don't do any locking here; caller must handle that.  The caller is also
+ * responsible for advancing latestCompletedXid and xactCompletionCount, which
+ * allows ProcArrayGroupClearXid() to do so just once for a whole group.
  */
 static inline void
-ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
+ProcArrayEndTransactionInternal(PGPROC *proc)
 {
 	int			pgxactoff = proc->pgxactoff;
 
@@ -768,12 +852,6 @@ ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
 		proc->subxidStatus.count = 0;
 		proc->subxidStatus.overflowed = false;
 	}
-
-	/* Also advance global latestCompletedXid while holding the lock */
-	MaintainLatestCompletedXid(latestXid);
-
-	/* Same with xactCompletionCount  */
-	TransamVariables->xactCompletionCount++;
 }
 
 /*
@@ -787,6 +865,13 @@ ProcArrayEndTransactionInternal(PGPROC *proc, TransactionId latestXid)
  * around ProcArrayLock when many processes are trying to commit at once,
  * since the lock need not be repeatedly handed off from one committing
  * process to the next.
+ *
+ * The whole group becomes non-running atomically, from the point of view of
+ * anyone taking a snapshot, so latestCompletedXid only needs to be advanced
+ * once, to the latest of the group's xids, and xactCompletionCount needs to
+ * be incremented only once.  That keeps snapshots that were built before
+ * the group was cleared invalidated once per group, rather than once per
+ * member; cf. GetSnapshotDataReuse().
  */
 static void
 ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid)
@@ -795,6 +880,8 @@ ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid)
 	PROC_HDR   *procglobal = ProcGlobal;
 	uint32		nextidx;
 	uint32		wakeidx;
+	TransactionId groupLatestXid = InvalidTransactionId;
+	uint64		nmembers = 0;
 
 	/* We should definitely have an XID to clear. */
 	Assert(TransactionIdIsValid(proc->xid));
@@ -862,12 +949,25 @@ ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid)
 	{
 		PGPROC	   *nextproc = &allProcs[nextidx];
 
-		ProcArrayEndTransactionInternal(nextproc, nextproc->procArrayGroupMemberXid);
+		ProcArrayEndTransactionInternal(nextproc);
+
+		if (!TransactionIdIsValid(groupLatestXid) ||
+			TransactionIdPrecedes(groupLatestXid,
+								  nextproc->procArrayGroupMemberXid))
+			groupLatestXid = nextproc->procArrayGroupMemberXid;
+		nmembers++;
 
 		/* Move to next proc in list. */
 		nextidx = pg_atomic_read_u32(&nextproc->procArrayGroupNext);
 	}
 
+	/* Advance latestCompletedXid and xactCompletionCount once for the group */
+	MaintainLatestCompletedXid(groupLatestXid);
+	TransamVariables->xactCompletionCount++;
+
+	procArray->end_xact_group_clears++;
+	procArray->end_xact_group_members += nmembers;
+
 	/* We're done with the lock now. */
 	LWLockRelease(ProcArrayLock);
 
@@ -895,6 +995,24 @@ ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid)
 	}
 }
 
+/*
+ * ProcArrayGetEndTransactionStats -- report ProcArrayEndTransaction counters
+ *
+ * Returns the number of transactions whose xid was cleared directly, the
+ * number of group clears performed, and the number of transactions cleared
+ * by them, since server start.
+ */
+void
+ProcArrayGetEndTransactionStats(uint64 *direct_clears, uint64 *group_clears,
+								uint64 *group_members)
+{
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+	*direct_clears = procArray->end_xact_direct_clears;
+	*group_clears = procArray->end_xact_group_clears;
+	*group_members = procArray->end_xact_group_members;
+	LWLockRelease(ProcArrayLock);
+}
+
 /*
  * ProcArrayClearTransaction -- clear the transaction fields
  *
@@ -2260,7 +2378,14 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	if (!snapshot->takenDuringRecovery &&
+		!TransactionIdIsValid(myxid) &&
+		SnapshotCacheRead(snapshot, curXactCompletionCount, xmax,
+						  &xmin, &count, &subcount, &suboverflowed))
+	{
+		/* another backend already computed this snapshot for us */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		int			numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2364,6 +2489,11 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		/* let other backends without an xid reuse our work */
+		if (!TransactionIdIsValid(myxid))
+			SnapshotCachePublish(snapshot, curXactCompletionCount,
+								 xmin, xmax, count, subcount, suboverflowed);
 	}
 	else
 	{
@@ -2522,6 +2652,110 @@ GetSnapshotData(Snapshot snapshot)
 	return snapshot;
 }
 
+/*
+ * Helper function for GetSnapshotData() that tries to fill in the snapshot
+ * from the shared snapshot cache, see SnapshotCacheData.
+ *
+ * Returns true if the cache contained a snapshot computed at the current
+ * xactCompletionCount, in which case xip[] and subxip[] have been filled in
+ * and *xmin, *count, *subcount and *suboverflowed are set.  The caller must
+ * hold ProcArrayLock, and must not have an xid assigned.
+ */
+static bool
+SnapshotCacheRead(Snapshot snapshot, uint64 curXactCompletionCount,
+				  TransactionId xmax, TransactionId *xmin,
+				  int *count, int *subcount, bool *suboverflowed)
+{
+	SnapshotCacheData *cache = snapshotCache;
+	uint32		before_changecount;
+	int			xcnt;
+	int			subxcnt;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	before_changecount = pg_atomic_read_u32(&cache->changecount);
+	if (before_changecount & 1)
+		return false;			/* a writer is active */
+	pg_read_barrier();
+
+	if (cache->xactCompletionCount != curXactCompletionCount ||
+		cache->xmax != xmax)
+		return false;
+
+	/*
+	 * The contents might be modified concurrently, so make sure the counts
+	 * are sane before using them.  The changecount check below will reject
+	 * the result in that case anyway.
+	 */
+	xcnt = cache->xcnt;
+	subxcnt = cache->subxcnt;
+	if (xcnt < 0 || xcnt > procArray->maxProcs ||
+		subxcnt < 0 || subxcnt > procArray->maxProcs)
+		return false;
+
+	*xmin = cache->xmin;
+	*suboverflowed = cache->suboverflowed;
+	memcpy(snapshot->xip, cache->xids, xcnt * sizeof(TransactionId));
+	memcpy(snapshot->subxip, cache->xids + procArray->maxProcs,
+		   subxcnt * sizeof(TransactionId));
+
+	pg_read_barrier();
+	if (pg_atomic_read_u32(&cache->changecount) != before_changecount)
+		return false;
+
+	*count = xcnt;
+	*subcount = subxcnt;
+	return true;
+}
+
+/*
+ * Helper function for GetSnapshotData() that publishes a freshly computed
+ * snapshot in the shared snapshot cache, see SnapshotCacheData.
+ *
+ * This is a no-op if the cache already holds a snapshot for the same
+ * xactCompletionCount, or if another backend is updating it right now.  The
+ * caller must hold ProcArrayLock, and must not have an xid assigned.
+ */
+static void
+SnapshotCachePublish(Snapshot snapshot, uint64 curXactCompletionCount,
+					 TransactionId xmin, TransactionId xmax,
+					 int count, int subcount, bool suboverflowed)
+{
+	SnapshotCacheData *cache = snapshotCache;
+	uint32		changecount;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (subcount > procArray->maxProcs)
+		return;
+
+	changecount = pg_atomic_read_u32(&cache->changecount);
+	if (changecount & 1)
+		return;
+
+	/* unlocked check, just to avoid needlessly dirtying the cacheline */
+	if (cache->xactCompletionCount == curXactCompletionCount)
+		return;
+
+	/* acts as a full barrier, so the stores below can't happen before */
+	if (!pg_atomic_compare_exchange_u32(&cache->changecount,
+										&changecount, changecount + 1))
+		return;
+
+	cache->xactCompletionCount = curXactCompletionCount;
+	cache->xmin = xmin;
+	cache->xmax = xmax;
+	cache->xcnt = count;
+	cache->subxcnt = subcount;
+	cache->suboverflowed = suboverflowed;
+	memcpy(cache->xids, snapshot->xip, count * sizeof(TransactionId));
+	memcpy(cache->xids + procArray->maxProcs, snapshot->subxip,
+		   subcount * sizeof(TransactionId));
+
+	pg_write_barrier();
+	pg_atomic_write_u32(&cache->changecount, changecount + 2);
+}
+
 /*
  * ProcArrayInstallImportedXmin -- install imported xmin into MyProc->xmin
  *
@@ -1211,6 +1211,14 @@ standby_redo(XLogReaderState *record)
 											 xlrec->dbId,
 											 xlrec->tsId);
 	}
+	else if (info == XLOG_SNAPSHOT_CONFLICT)
+	{
+		xl_snapshot_conflict *xlrec = (xl_snapshot_conflict *) XLogRecGetData(record);
+
+		ResolveRecoveryConflictWithSnapshot(xlrec->snapshotConflictHorizon,
+											xlrec->isCatalogRel,
+											xlrec->locator);
+	}
 	else
 		elog(PANIC, "standby_redo: unknown op code %u", info);
 }
@@ -1479,6 +1487,31 @@ LogStandbyInvalidations(int nmsgs, SharedInvalidationMessage *msgs,
 	XLogInsert(RM_STANDBY_ID, XLOG_INVALIDATIONS);
 }
 
+/*
+ * Emit WAL that makes a standby cancel the queries whose snapshots might
+ * still see row versions older than snapshotConflictHorizon in the given
+ * relation.  This is for changes whose own WAL records can't carry a
+ * conflict horizon, like generic WAL; the record must be inserted before
+ * the one that removes the versions.
+ */
+void
+LogStandbySnapshotConflict(RelFileLocator locator,
+						   TransactionId snapshotConflictHorizon,
+						   bool isCatalogRel)
+{
+	xl_snapshot_conflict xlrec;
+
+	Assert(TransactionIdIsNormal(snapshotConflictHorizon));
+
+	xlrec.locator = locator;
+	xlrec.snapshotConflictHorizon = snapshotConflictHorizon;
+	xlrec.isCatalogRel = isCatalogRel;
+
+	XLogBeginInsert();
+	XLogRegisterData((char *) &xlrec, SizeOfSnapshotConflict);
+	XLogInsert(RM_STANDBY_ID, XLOG_SNAPSHOT_CONFLICT);
+}
+
 /* Return the description of recovery conflict */
 static const char *
 get_recovery_conflict_desc(ProcSignalReason reason)
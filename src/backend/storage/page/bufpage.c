@@ -692,8 +692,9 @@ compactify_tuples(itemIdCompact itemidbase, int nitems, Page page, bool presorte
  *
  * Caller had better have a full cleanup lock on page's buffer.  As a side
  * effect the page's PD_HAS_FREE_LINES hint bit will be set or unset as
- * needed.  Caller might also need to account for a reduction in the length of
- * the line pointer array following array truncation.
+ * needed, and PD_NEEDS_DEFRAG is cleared.  Caller might also need to account
+ * for a reduction in the length of the line pointer array following array
+ * truncation.
  */
 void
 PageRepairFragmentation(Page page)
@@ -810,6 +811,9 @@ PageRepairFragmentation(Page page)
 		PageSetHasFreeLinePointers(page);
 	else
 		PageClearHasFreeLinePointers(page);
+
+	/* Any space left behind by pruning without a cleanup lock is gone now */
+	PageClearNeedsDefrag(page);
 }
 
 /*
@@ -25,18 +25,29 @@
 #include <fcntl.h>
 #include <sys/file.h>
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "access/xlogutils.h"
 #include "commands/tablespace.h"
 #include "common/file_utils.h"
+#include "common/pg_lzcompress.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/md.h"
+#include "storage/page_compression.h"
 #include "storage/relfilelocator.h"
 #include "storage/smgr.h"
 #include "storage/sync.h"
+#include "utils/guc_hooks.h"
 #include "utils/memutils.h"
 
 /*
@@ -85,6 +96,19 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/* GUC variable */
+int			page_compression = PAGE_COMPRESSION_NONE;
+
+/*
+ * Largest compressed image we'd store: anything bigger would not free a
+ * single PAGE_COMPRESS_ALIGN unit of the slot.
+ */
+#define PAGE_COMPRESS_LIMIT \
+	((int32) (BLCKSZ - PAGE_COMPRESS_ALIGN) - (int32) sizeof(PageCompressHeader))
+
+/* I/O aligned scratch space for writing compressed slots, made on first use */
+static char *page_compress_buf = NULL;
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rlocator,xx_forknum,xx_segno) \
@@ -139,6 +163,13 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forknum,
 							 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
+static int	md_compress_page(const char *page);
+static void md_decompress_page(char *slot, BlockNumber blocknum,
+							   MdfdVec *v);
+static void mdwritev_compressed(SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum,
+								const void **buffers, BlockNumber nblocks,
+								bool skipFsync);
 
 static inline int
 _mdfd_open_flags(void)
@@ -803,6 +834,133 @@ buffers_to_iovec(struct iovec *iov, void **buffers, int nblocks)
 	return iovcnt;
 }
 
+/*
+ * md_compress_page() -- Compress a page into page_compress_buf.
+ *
+ * Returns the number of bytes of page_compress_buf to write into the page's
+ * slot, a multiple of PAGE_COMPRESS_ALIGN less than BLCKSZ, or 0 if the page
+ * should be stored uncompressed.
+ */
+static int
+md_compress_page(const char *page)
+{
+	PageCompressHeader *hdr;
+	char	   *dest;
+	int32		len = -1;
+	int			stored;
+
+	if (PAGE_COMPRESS_LIMIT <= 0)
+		return 0;
+
+	if (page_compress_buf == NULL)
+		page_compress_buf =
+			MemoryContextAllocAligned(TopMemoryContext,
+									  sizeof(PageCompressHeader) +
+									  PGLZ_MAX_OUTPUT(BLCKSZ),
+									  PG_IO_ALIGN_SIZE, 0);
+
+	hdr = (PageCompressHeader *) page_compress_buf;
+	dest = page_compress_buf + sizeof(PageCompressHeader);
+
+	switch ((PageCompression) page_compression)
+	{
+		case PAGE_COMPRESSION_PGLZ:
+			len = pglz_compress(page, BLCKSZ, dest, PGLZ_strategy_default);
+			break;
+
+		case PAGE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(page, dest, BLCKSZ,
+									   PAGE_COMPRESS_LIMIT);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case PAGE_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			len = ZSTD_compress(dest, PAGE_COMPRESS_LIMIT, page, BLCKSZ,
+								ZSTD_CLEVEL_DEFAULT);
+			if (ZSTD_isError(len))
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		case PAGE_COMPRESSION_NONE:
+			Assert(false);		/* cannot happen */
+			break;
+			/* no default case, so that compiler will warn */
+	}
+
+	if (len < 0 || len > PAGE_COMPRESS_LIMIT)
+		return 0;
+
+	hdr->pch_magic = PAGE_COMPRESS_MAGIC;
+	hdr->pch_method = (uint16) page_compression;
+	hdr->pch_length = (uint16) len;
+
+	/* Zero the padding up to the end of the last unit we'll write. */
+	stored = TYPEALIGN(PAGE_COMPRESS_ALIGN, sizeof(PageCompressHeader) + len);
+	memset(dest + len, 0, stored - sizeof(PageCompressHeader) - len);
+
+	return stored;
+}
+
+/*
+ * md_decompress_page() -- Expand a compressed slot in place.
+ */
+static void
+md_decompress_page(char *slot, BlockNumber blocknum, MdfdVec *v)
+{
+	PageCompressHeader hdr;
+	PGAlignedBlock tmp;
+	const char *src = slot + sizeof(PageCompressHeader);
+	bool		decomp_success = false;
+
+	memcpy(&hdr, slot, sizeof(PageCompressHeader));
+	Assert(hdr.pch_magic == PAGE_COMPRESS_MAGIC);
+
+	if (hdr.pch_length <= BLCKSZ - sizeof(PageCompressHeader))
+	{
+		switch (hdr.pch_method)
+		{
+			case PAGE_COMPRESSION_PGLZ:
+				decomp_success =
+					pglz_decompress(src, hdr.pch_length, tmp.data,
+									BLCKSZ, true) == BLCKSZ;
+				break;
+
+			case PAGE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+				decomp_success =
+					LZ4_decompress_safe(src, tmp.data,
+										hdr.pch_length, BLCKSZ) == BLCKSZ;
+#endif
+				break;
+
+			case PAGE_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+				decomp_success =
+					ZSTD_decompress(tmp.data, BLCKSZ,
+									src, hdr.pch_length) == BLCKSZ;
+#endif
+				break;
+		}
+	}
+
+	if (!decomp_success)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("could not decompress block %u in file \"%s\"",
+						blocknum, FilePathName(v->mdfd_vfd))));
+
+	memcpy(slot, tmp.data, BLCKSZ);
+}
+
 /*
  * mdreadv() -- Read the specified blocks from a relation.
  */
@@ -911,6 +1069,17 @@ mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 			iovcnt = compute_remaining_iovec(iov, iov, iovcnt, nbytes);
 		}
 
+		/*
+		 * Expand any pages that were stored compressed.  This is done
+		 * whatever the current setting of page_compression, which only
+		 * controls how pages are written.
+		 */
+		for (BlockNumber i = 0; i < nblocks_this_segment; ++i)
+		{
+			if (PageIsCompressedSlot(buffers[i]))
+				md_decompress_page(buffers[i], blocknum + i, v);
+		}
+
 		nblocks -= nblocks_this_segment;
 		buffers += nblocks_this_segment;
 		blocknum += nblocks_this_segment;
@@ -933,6 +1102,13 @@ mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert((uint64) blocknum + (uint64) nblocks <= (uint64) mdnblocks(reln, forknum));
 #endif
 
+	if (page_compression != PAGE_COMPRESSION_NONE && forknum == MAIN_FORKNUM)
+	{
+		mdwritev_compressed(reln, forknum, blocknum, buffers, nblocks,
+							skipFsync);
+		return;
+	}
+
 	while (nblocks > 0)
 	{
 		struct iovec iov[PG_IOV_MAX];
@@ -1020,6 +1196,104 @@ mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 }
 
 
+/*
+ * mdwritev_compressed() -- mdwritev() for page_compression.
+ *
+ * Each page is written on its own: a page that compresses well enough is
+ * written as a compressed image at the start of its slot, and the rest of
+ * the slot is deallocated, while any other page is written whole.  A crash
+ * between the two steps leaves stale bytes after the compressed image,
+ * which readers ignore.
+ */
+static void
+mdwritev_compressed(SMgrRelation reln, ForkNumber forknum,
+					BlockNumber blocknum, const void **buffers,
+					BlockNumber nblocks, bool skipFsync)
+{
+	for (BlockNumber i = 0; i < nblocks; i++)
+	{
+		const char *page = buffers[i];
+		const char *data;
+		off_t		seekpos;
+		int			nbytes;
+		int			stored;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum + i, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * ((blocknum + i) % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		stored = md_compress_page(page);
+		if (stored > 0)
+			data = page_compress_buf;
+		else
+		{
+			data = page;
+			stored = BLCKSZ;
+		}
+
+		if ((nbytes = FileWrite(v->mdfd_vfd, data, stored, seekpos,
+								WAIT_EVENT_DATA_FILE_WRITE)) != stored)
+		{
+			if (nbytes < 0)
+			{
+				bool		enospc = errno == ENOSPC;
+
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write block %u in file \"%s\": %m",
+								blocknum + i,
+								FilePathName(v->mdfd_vfd)),
+						 enospc ? errhint("Check free disk space.") : 0));
+			}
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write block %u in file \"%s\": wrote only %d of %d bytes",
+							blocknum + i,
+							FilePathName(v->mdfd_vfd),
+							nbytes, stored),
+					 errhint("Check free disk space.")));
+		}
+
+		/*
+		 * Give back the unused part of the slot.  If the file system can't do
+		 * that, the page is still readable; it just saves no space.
+		 */
+		if (stored < BLCKSZ &&
+			FilePunchHole(v->mdfd_vfd, seekpos + stored, BLCKSZ - stored,
+						  WAIT_EVENT_DATA_FILE_WRITE) < 0 &&
+			errno != EOPNOTSUPP)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not deallocate space in block %u of file \"%s\": %m",
+							blocknum + i,
+							FilePathName(v->mdfd_vfd))));
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+	}
+}
+
+/*
+ * GUC check_hook for page_compression
+ */
+bool
+check_page_compression(int *newval, void **extra, GucSource source)
+{
+#ifndef FALLOC_FL_PUNCH_HOLE
+	if (*newval != PAGE_COMPRESSION_NONE)
+	{
+		GUC_check_errdetail("Page compression requires a platform that can deallocate file space.");
+		return false;
+	}
+#endif
+	return true;
+}
+
 /*
  * mdwriteback() -- Tell the kernel to write pages back to storage.
  *
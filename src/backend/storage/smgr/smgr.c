@@ -53,6 +53,7 @@
 
 #include "access/xlogutils.h"
 #include "lib/ilist.h"
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/md.h"
@@ -62,49 +63,10 @@
 
 
 /*
- * This struct of function pointers defines the API between smgr.c and
- * any individual storage manager module.  Note that smgr subfunctions are
- * generally expected to report problems via elog(ERROR).  An exception is
- * that smgr_unlink should use elog(WARNING), rather than erroring out,
- * because we normally unlink relations during post-commit/abort cleanup,
- * and so it's too late to raise an error.  Also, various conditions that
- * would normally be errors should be allowed during bootstrap and/or WAL
- * recovery --- see comments in md.c for details.
- */
-typedef struct f_smgr
-{
-	void		(*smgr_init) (void);	/* may be NULL */
-	void		(*smgr_shutdown) (void);	/* may be NULL */
-	void		(*smgr_open) (SMgrRelation reln);
-	void		(*smgr_close) (SMgrRelation reln, ForkNumber forknum);
-	void		(*smgr_create) (SMgrRelation reln, ForkNumber forknum,
-								bool isRedo);
-	bool		(*smgr_exists) (SMgrRelation reln, ForkNumber forknum);
-	void		(*smgr_unlink) (RelFileLocatorBackend rlocator, ForkNumber forknum,
-								bool isRedo);
-	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
-								BlockNumber blocknum, const void *buffer, bool skipFsync);
-	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
-									BlockNumber blocknum, int nblocks, bool skipFsync);
-	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
-								  BlockNumber blocknum, int nblocks);
-	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
-							   BlockNumber blocknum,
-							   void **buffers, BlockNumber nblocks);
-	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
-								BlockNumber blocknum,
-								const void **buffers, BlockNumber nblocks,
-								bool skipFsync);
-	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
-								   BlockNumber blocknum, BlockNumber nblocks);
-	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
-	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
-								  BlockNumber nblocks);
-	void		(*smgr_immedsync) (SMgrRelation reln, ForkNumber forknum);
-	void		(*smgr_registersync) (SMgrRelation reln, ForkNumber forknum);
-} f_smgr;
-
-static const f_smgr smgrsw[] = {
+ * The storage manager switch.  md.c is always entry 0; extensions may add
+ * entries with smgr_register() while shared_preload_libraries is processed.
+ */
+static f_smgr smgrsw[MAX_SMGRS] = {
 	/* magnetic disk */
 	{
 		.smgr_init = mdinit,
@@ -127,7 +89,10 @@ static const f_smgr smgrsw[] = {
 	}
 };
 
-static const int NSmgr = lengthof(smgrsw);
+static int	NSmgr = 1;
+
+/* Hook for plugins to choose the storage manager of each relation */
+smgr_select_hook_type smgr_select_hook = NULL;
 
 /*
  * Each backend has a hashtable that stores all extant SMgrRelation objects.
@@ -142,6 +107,35 @@ static void smgrshutdown(int code, Datum arg);
 static void smgrdestroy(SMgrRelation reln);
 
 
+/*
+ * smgr_register() -- Add a storage manager to the switch.
+ *
+ * Returns the selector that smgr_select_hook should return for relations
+ * that are to use the new storage manager.  This may only be called from a
+ * library's _PG_init() while shared_preload_libraries is being processed,
+ * so that every process, including the checkpointer and the startup
+ * process, sees the same set of storage managers in the same order.
+ */
+int
+smgr_register(const f_smgr *smgr)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("storage managers must be registered while loading \"%s\"",
+						"shared_preload_libraries")));
+
+	if (NSmgr >= MAX_SMGRS)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("too many storage managers registered"),
+				 errdetail("At most %d storage managers can be registered.",
+						   MAX_SMGRS - 1)));
+
+	smgrsw[NSmgr] = *smgr;
+	return NSmgr++;
+}
+
 /*
  * smgrinit(), smgrshutdown() -- Initialize or shut down storage
  *								 managers.
@@ -215,23 +209,43 @@ smgropen(RelFileLocator rlocator, ProcNumber backend)
 		dlist_init(&unpinned_relns);
 	}
 
-	/* Look up or create an entry */
+	/* Look up an existing entry */
 	brlocator.locator = rlocator;
 	brlocator.backend = backend;
 	reln = (SMgrRelation) hash_search(SMgrRelationHash,
 									  &brlocator,
-									  HASH_ENTER, &found);
-
-	/* Initialize it if not present before */
-	if (!found)
+									  HASH_FIND, NULL);
+	if (reln == NULL)
 	{
+		/*
+		 * md.c, unless a plugin says otherwise.  Ask before creating the
+		 * entry, so that an error doesn't leave a half-initialized one
+		 * behind.
+		 */
+		int			which = 0;
+
+		if (smgr_select_hook)
+		{
+			which = (*smgr_select_hook) (brlocator);
+			if (which < 0 || which >= NSmgr)
+				elog(ERROR, "invalid storage manager selector %d for relation %u/%u/%u",
+					 which, rlocator.spcOid, rlocator.dbOid,
+					 rlocator.relNumber);
+		}
+
+		reln = (SMgrRelation) hash_search(SMgrRelationHash,
+										  &brlocator,
+										  HASH_ENTER, &found);
+		Assert(!found);
+
 		/* hash_search already filled in the lookup key */
 		reln->smgr_targblock = InvalidBlockNumber;
 		for (int i = 0; i <= MAX_FORKNUM; ++i)
 			reln->smgr_cached_nblocks[i] = InvalidBlockNumber;
-		reln->smgr_which = 0;	/* we only have md.c at present */
+		reln->smgr_private = NULL;
+		reln->smgr_which = which;
 
-		/* implementation-specific initialization */
+		/* implementation-specific initialization; must not fail */
 		smgrsw[reln->smgr_which].smgr_open(reln);
 
 		/* it is not pinned yet */
@@ -206,10 +206,17 @@ pgstat_drop_relation(Relation rel)
 
 /*
  * Report that the table was just vacuumed and flush IO statistics.
+ *
+ * Besides the new tuple counts, caller reports how many pages VACUUM froze
+ * tuples on and the WAL it wrote for that, and the WAL insert position at
+ * the end of the VACUUM (or InvalidXLogRecPtr, if it doesn't track page
+ * age).
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
-					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
+					 PgStat_Counter livetuples, PgStat_Counter deadtuples,
+					 PgStat_Counter pagesfrozen, PgStat_Counter freezewalbytes,
+					 XLogRecPtr endlsn)
 {
 	PgStat_EntryRef *entry_ref;
 	PgStatShared_Relation *shtabentry;
@@ -245,6 +252,15 @@ pgstat_report_vacuum(Oid tableoid, bool shared,
 	 */
 	tabentry->ins_since_vacuum = 0;
 
+	tabentry->pages_frozen += pagesfrozen;
+	tabentry->freeze_wal_bytes += freezewalbytes;
+	if (!XLogRecPtrIsInvalid(endlsn))
+	{
+		memmove(&tabentry->vacuum_end_lsn[1], &tabentry->vacuum_end_lsn[0],
+				sizeof(XLogRecPtr) * (PGSTAT_VACUUM_LSN_HISTORY - 1));
+		tabentry->vacuum_end_lsn[0] = endlsn;
+	}
+
 	if (AmAutoVacuumWorkerProcess())
 	{
 		tabentry->last_autovacuum_time = ts;
@@ -860,6 +876,7 @@ pgstat_relation_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	tabentry->ins_since_vacuum += lstats->counts.tuples_inserted;
 	tabentry->blocks_fetched += lstats->counts.blocks_fetched;
 	tabentry->blocks_hit += lstats->counts.blocks_hit;
+	tabentry->pages_unfrozen += lstats->counts.pages_unfrozen;
 
 	/* Clamp live_tuples in case of negative delta_live_tuples */
 	tabentry->live_tuples = Max(tabentry->live_tuples, 0);
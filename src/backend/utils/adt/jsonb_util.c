@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "common/hashfn.h"
 #include "miscadmin.h"
@@ -36,6 +37,11 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+static struct varlena *fetchJsonbSlice(struct varlena *attr, uint32 offset,
+									   uint32 length);
+static void fillJsonbValueFromSlice(JsonbContainer *container, int index,
+									struct varlena *attr, uint32 hdrlen,
+									JsonbValue *result);
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
@@ -489,6 +495,225 @@ getIthJsonbValueFromContainer(JsonbContainer *container, uint32 i)
 	return result;
 }
 
+/*
+ * Find value by key in a toasted Jsonb object, and fetch it into 'res',
+ * which is also returned.
+ *
+ * This is getKeyJsonValueFromContainer() for a Jsonb that hasn't been
+ * detoasted.  Rather than fetching the whole value, we fetch just the root
+ * header and JEntries, the keys, and the value we're after, each as a slice
+ * of the toasted datum.  That only pays off if the slices can be fetched
+ * without detoasting everything before them; see toast_datum_is_seekable().
+ *
+ * Returns NULL if the Jsonb isn't an object, or has no such key.  'res' can
+ * be passed in as NULL, in which case it's newly palloc'ed here.
+ */
+JsonbValue *
+getKeyJsonValueFromToasted(struct varlena *attr,
+						   const char *keyVal, int keyLen, JsonbValue *res)
+{
+	struct varlena *slice;
+	JsonbContainer *container;
+	uint32		header;
+	uint32		count;
+	uint32		hdrlen;
+	uint32		keyslen;
+	char	   *baseAddr;
+	uint32		stopLow,
+				stopHigh;
+
+	slice = fetchJsonbSlice(attr, 0, sizeof(uint32));
+	memcpy(&header, VARDATA(slice), sizeof(uint32));
+	pfree(slice);
+
+	count = header & JB_CMASK;
+	if ((header & JB_FOBJECT) == 0 || count == 0)
+		return NULL;
+
+	/*
+	 * Fetch the header and JEntries, and the keys after them, into a single
+	 * buffer laid out like the start of the container.  All the keys come
+	 * before the first value.
+	 */
+	hdrlen = offsetof(JsonbContainer, children) + count * 2 * sizeof(JEntry);
+	slice = fetchJsonbSlice(attr, 0, hdrlen);
+	container = (JsonbContainer *) VARDATA(slice);
+	keyslen = getJsonbOffset(container, count);
+
+	container = palloc(hdrlen + keyslen);
+	memcpy(container, VARDATA(slice), hdrlen);
+	pfree(slice);
+	baseAddr = (char *) container + hdrlen;
+	if (keyslen > 0)
+	{
+		slice = fetchJsonbSlice(attr, hdrlen, keyslen);
+		memcpy(baseAddr, VARDATA(slice), keyslen);
+		pfree(slice);
+	}
+
+	/* Binary search the keys, as getKeyJsonValueFromContainer() does */
+	stopLow = 0;
+	stopHigh = count;
+	while (stopLow < stopHigh)
+	{
+		uint32		stopMiddle;
+		int			difference;
+
+		stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+
+		difference = lengthCompareJsonbString(baseAddr + getJsonbOffset(container, stopMiddle),
+											  getJsonbLength(container, stopMiddle),
+											  keyVal, keyLen);
+
+		if (difference == 0)
+		{
+			if (!res)
+				res = palloc(sizeof(JsonbValue));
+
+			fillJsonbValueFromSlice(container, stopMiddle + count,
+									attr, hdrlen, res);
+			pfree(container);
+
+			return res;
+		}
+		else if (difference < 0)
+			stopLow = stopMiddle + 1;
+		else
+			stopHigh = stopMiddle;
+	}
+
+	/* Not found */
+	pfree(container);
+	return NULL;
+}
+
+/*
+ * Get i-th value of a toasted Jsonb array, fetching just the root header,
+ * the JEntries up to the i-th, and the value itself.  Negative subscripts
+ * count from the end of the array.
+ *
+ * Returns palloc()'d copy of the value, or NULL if the Jsonb isn't an array
+ * or the element does not exist.
+ */
+JsonbValue *
+getIthJsonbValueFromToasted(struct varlena *attr, int i)
+{
+	struct varlena *slice;
+	JsonbContainer *container;
+	JsonbValue *result;
+	uint32		header;
+	uint32		nelements;
+	uint32		hdrlen;
+
+	slice = fetchJsonbSlice(attr, 0, sizeof(uint32));
+	memcpy(&header, VARDATA(slice), sizeof(uint32));
+	pfree(slice);
+
+	if ((header & JB_FARRAY) == 0)
+		return NULL;
+
+	nelements = header & JB_CMASK;
+	if (i < 0)
+	{
+		if (-(int64) i > nelements)
+			return NULL;
+		i += nelements;
+	}
+	if ((uint32) i >= nelements)
+		return NULL;
+
+	/*
+	 * The offset and length of the i-th element depend only on the JEntries
+	 * up to and including its own, so fetch no more than those.
+	 */
+	slice = fetchJsonbSlice(attr, 0, offsetof(JsonbContainer, children) +
+							(i + 1) * sizeof(JEntry));
+	container = (JsonbContainer *) VARDATA(slice);
+	hdrlen = offsetof(JsonbContainer, children) + nelements * sizeof(JEntry);
+
+	result = palloc(sizeof(JsonbValue));
+	fillJsonbValueFromSlice(container, i, attr, hdrlen, result);
+	pfree(slice);
+
+	return result;
+}
+
+/*
+ * Fetch 'length' bytes at 'offset' of a toasted Jsonb, complaining if the
+ * datum turns out to be shorter than the JEntries say it is.
+ */
+static struct varlena *
+fetchJsonbSlice(struct varlena *attr, uint32 offset, uint32 length)
+{
+	struct varlena *slice;
+
+	if (offset > PG_INT32_MAX || length > PG_INT32_MAX - offset)
+		elog(ERROR, "invalid jsonb slice");
+
+	slice = detoast_attr_slice(attr, offset, length);
+	if (VARSIZE_ANY_EXHDR(slice) != length)
+		elog(ERROR, "unexpected end of jsonb data");
+
+	return slice;
+}
+
+/*
+ * Like fillJsonbValue(), but for a node of the root container of a toasted
+ * Jsonb.  'container' needs to hold only the JEntries up to the node's own,
+ * and 'hdrlen' is the length of the root header and all its JEntries, ie.
+ * where the variable-length data starts.  The node's data, if any, is
+ * fetched into a buffer of its own.
+ */
+static void
+fillJsonbValueFromSlice(JsonbContainer *container, int index,
+						struct varlena *attr, uint32 hdrlen,
+						JsonbValue *result)
+{
+	JEntry		entry = container->children[index];
+	uint32		offset = getJsonbOffset(container, index);
+	uint32		length = getJsonbLength(container, index);
+	uint32		padding = 0;
+	struct varlena *slice;
+
+	if (JBE_ISNULL(entry) || JBE_ISBOOL_TRUE(entry) || JBE_ISBOOL_FALSE(entry))
+	{
+		fillJsonbValue(container, index, NULL, 0, result);
+		return;
+	}
+
+	/*
+	 * Numerics and containers are aligned relative to the start of the
+	 * variable-length data.  Since the header is a multiple of 4 bytes long,
+	 * skipping that padding leaves the slice data suitably aligned too.
+	 */
+	if (JBE_ISNUMERIC(entry) || JBE_ISCONTAINER(entry))
+	{
+		padding = INTALIGN(offset) - offset;
+		if (padding > length)
+			elog(ERROR, "unexpected jsonb alignment padding");
+	}
+	slice = fetchJsonbSlice(attr, hdrlen + offset + padding, length - padding);
+
+	if (JBE_ISSTRING(entry))
+	{
+		result->type = jbvString;
+		result->val.string.val = VARDATA(slice);
+		result->val.string.len = length;
+	}
+	else if (JBE_ISNUMERIC(entry))
+	{
+		result->type = jbvNumeric;
+		result->val.numeric = (Numeric) VARDATA(slice);
+	}
+	else
+	{
+		Assert(JBE_ISCONTAINER(entry));
+		result->type = jbvBinary;
+		result->val.binary.data = (JsonbContainer *) VARDATA(slice);
+		result->val.binary.len = length - padding;
+	}
+}
+
 /*
  * A helper function to fill in a JsonbValue to represent an element of an
  * array, or a key or value of an object.
@@ -16,6 +16,7 @@
 
 #include <limits.h>
 
+#include "access/detoast.h"
 #include "access/htup_details.h"
 #include "catalog/pg_type.h"
 #include "common/jsonapi.h"
@@ -859,18 +860,28 @@ json_object_field(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
 
-	if (!JB_ROOT_IS_OBJECT(jb))
-		PG_RETURN_NULL();
+	/* Fetch just the parts we need of a large toasted value */
+	if (toast_datum_is_seekable(PG_GETARG_DATUM(0)))
+		v = getKeyJsonValueFromToasted((struct varlena *) PG_GETARG_POINTER(0),
+									   VARDATA_ANY(key),
+									   VARSIZE_ANY_EXHDR(key),
+									   &vbuf);
+	else
+	{
+		Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 
-	v = getKeyJsonValueFromContainer(&jb->root,
-									 VARDATA_ANY(key),
-									 VARSIZE_ANY_EXHDR(key),
-									 &vbuf);
+		if (!JB_ROOT_IS_OBJECT(jb))
+			PG_RETURN_NULL();
+
+		v = getKeyJsonValueFromContainer(&jb->root,
+										 VARDATA_ANY(key),
+										 VARSIZE_ANY_EXHDR(key),
+										 &vbuf);
+	}
 
 	if (v != NULL)
 		PG_RETURN_JSONB_P(JsonbValueToJsonb(v));
@@ -897,18 +908,28 @@ json_object_field_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
 
-	if (!JB_ROOT_IS_OBJECT(jb))
-		PG_RETURN_NULL();
+	/* Fetch just the parts we need of a large toasted value */
+	if (toast_datum_is_seekable(PG_GETARG_DATUM(0)))
+		v = getKeyJsonValueFromToasted((struct varlena *) PG_GETARG_POINTER(0),
+									   VARDATA_ANY(key),
+									   VARSIZE_ANY_EXHDR(key),
+									   &vbuf);
+	else
+	{
+		Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 
-	v = getKeyJsonValueFromContainer(&jb->root,
-									 VARDATA_ANY(key),
-									 VARSIZE_ANY_EXHDR(key),
-									 &vbuf);
+		if (!JB_ROOT_IS_OBJECT(jb))
+			PG_RETURN_NULL();
+
+		v = getKeyJsonValueFromContainer(&jb->root,
+										 VARDATA_ANY(key),
+										 VARSIZE_ANY_EXHDR(key),
+										 &vbuf);
+	}
 
 	if (v != NULL && v->type != jbvNull)
 		PG_RETURN_TEXT_P(JsonbValueAsText(v));
@@ -934,25 +955,33 @@ json_array_element(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
 
-	if (!JB_ROOT_IS_ARRAY(jb))
-		PG_RETURN_NULL();
-
-	/* Handle negative subscript */
-	if (element < 0)
+	/* Fetch just the parts we need of a large toasted value */
+	if (toast_datum_is_seekable(PG_GETARG_DATUM(0)))
+		v = getIthJsonbValueFromToasted((struct varlena *) PG_GETARG_POINTER(0),
+										element);
+	else
 	{
-		uint32		nelements = JB_ROOT_COUNT(jb);
+		Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 
-		if (-element > nelements)
+		if (!JB_ROOT_IS_ARRAY(jb))
 			PG_RETURN_NULL();
-		else
-			element += nelements;
-	}
 
-	v = getIthJsonbValueFromContainer(&jb->root, element);
+		/* Handle negative subscript */
+		if (element < 0)
+		{
+			uint32		nelements = JB_ROOT_COUNT(jb);
+
+			if (-element > nelements)
+				PG_RETURN_NULL();
+			else
+				element += nelements;
+		}
+
+		v = getIthJsonbValueFromContainer(&jb->root, element);
+	}
 	if (v != NULL)
 		PG_RETURN_JSONB_P(JsonbValueToJsonb(v));
 
@@ -977,25 +1006,33 @@ json_array_element_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
 
-	if (!JB_ROOT_IS_ARRAY(jb))
-		PG_RETURN_NULL();
-
-	/* Handle negative subscript */
-	if (element < 0)
+	/* Fetch just the parts we need of a large toasted value */
+	if (toast_datum_is_seekable(PG_GETARG_DATUM(0)))
+		v = getIthJsonbValueFromToasted((struct varlena *) PG_GETARG_POINTER(0),
+										element);
+	else
 	{
-		uint32		nelements = JB_ROOT_COUNT(jb);
+		Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 
-		if (-element > nelements)
+		if (!JB_ROOT_IS_ARRAY(jb))
 			PG_RETURN_NULL();
-		else
-			element += nelements;
-	}
 
-	v = getIthJsonbValueFromContainer(&jb->root, element);
+		/* Handle negative subscript */
+		if (element < 0)
+		{
+			uint32		nelements = JB_ROOT_COUNT(jb);
+
+			if (-element > nelements)
+				PG_RETURN_NULL();
+			else
+				element += nelements;
+		}
+
+		v = getIthJsonbValueFromContainer(&jb->root, element);
+	}
 
 	if (v != NULL && v->type != jbvNull)
 		PG_RETURN_TEXT_P(JsonbValueAsText(v));
@@ -70,6 +70,9 @@ PG_STAT_GET_RELENTRY_INT64(blocks_hit)
 /* pg_stat_get_dead_tuples */
 PG_STAT_GET_RELENTRY_INT64(dead_tuples)
 
+/* pg_stat_get_freeze_wal_bytes */
+PG_STAT_GET_RELENTRY_INT64(freeze_wal_bytes)
+
 /* pg_stat_get_ins_since_vacuum */
 PG_STAT_GET_RELENTRY_INT64(ins_since_vacuum)
 
@@ -82,6 +85,12 @@ PG_STAT_GET_RELENTRY_INT64(mod_since_analyze)
 /* pg_stat_get_numscans */
 PG_STAT_GET_RELENTRY_INT64(numscans)
 
+/* pg_stat_get_pages_frozen */
+PG_STAT_GET_RELENTRY_INT64(pages_frozen)
+
+/* pg_stat_get_pages_unfrozen */
+PG_STAT_GET_RELENTRY_INT64(pages_unfrozen)
+
 /* pg_stat_get_tuples_deleted */
 PG_STAT_GET_RELENTRY_INT64(tuples_deleted)
 
@@ -1526,6 +1535,33 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
 }
 
+/*
+ * Returns counters for clearing xids at transaction end.
+ */
+Datum
+pg_stat_get_procarray_end_xact(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_PROCARRAY_END_XACT_COLS	3
+	TupleDesc	tupdesc;
+	Datum		values[PG_STAT_GET_PROCARRAY_END_XACT_COLS] = {0};
+	bool		nulls[PG_STAT_GET_PROCARRAY_END_XACT_COLS] = {0};
+	uint64		direct_clears;
+	uint64		group_clears;
+	uint64		group_members;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	ProcArrayGetEndTransactionStats(&direct_clears, &group_clears,
+									&group_members);
+
+	values[0] = Int64GetDatum(direct_clears);
+	values[1] = Int64GetDatum(group_clears);
+	values[2] = Int64GetDatum(group_members);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 /*
  * Returns statistics of SLRU caches.
  */
@@ -72,6 +72,8 @@
 #include "replication/syncrep.h"
 #include "storage/bufmgr.h"
 #include "storage/large_object.h"
+#include "storage/md.h"
+#include "storage/page_compression.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "storage/standby.h"
@@ -372,6 +374,12 @@ static const struct config_enum_entry huge_pages_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry buffer_replacement_policy_options[] = {
+	{"clock", BUFFER_REPLACEMENT_CLOCK, false},
+	{"2q", BUFFER_REPLACEMENT_2Q, false},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry huge_pages_status_options[] = {
 	{"off", HUGE_PAGES_OFF, false},
 	{"on", HUGE_PAGES_ON, false},
@@ -461,6 +469,9 @@ static const struct config_enum_entry default_toast_compression_options[] = {
 	{"pglz", TOAST_PGLZ_COMPRESSION, false},
 #ifdef  USE_LZ4
 	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
 #endif
 	{NULL, 0, false}
 };
@@ -484,6 +495,21 @@ static const struct config_enum_entry wal_compression_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry page_compression_options[] = {
+	{"pglz", PAGE_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", PAGE_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", PAGE_COMPRESSION_ZSTD, false},
+#endif
+	{"off", PAGE_COMPRESSION_NONE, false},
+	{"false", PAGE_COMPRESSION_NONE, true},
+	{"no", PAGE_COMPRESSION_NONE, true},
+	{"0", PAGE_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
 /*
  * Options for enum values stored in other modules
  */
@@ -1111,6 +1137,15 @@ struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"bgwriter_cold_flush", PGC_SIGHUP, RESOURCES_BGWRITER,
+			gettext_noop("Background writer also writes dirty buffers that have not been modified recently."),
+			gettext_noop("This spreads out the writes otherwise done by the next checkpoint.")
+		},
+		&bgwriter_cold_flush,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"zero_damaged_pages", PGC_SUSET, DEVELOPER_OPTIONS,
 			gettext_noop("Continues processing past damaged page headers."),
@@ -2260,6 +2295,27 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_buffers_limit", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Limits the number of shared memory buffers in use."),
+			gettext_noop("-1 means no limit, use all of shared_buffers."),
+			GUC_UNIT_BLOCKS
+		},
+		&shared_buffers_limit,
+		-1, -1, INT_MAX / 2,
+		check_shared_buffers_limit, NULL, NULL
+	},
+
+	{
+		{"clock_sweep_partitions", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of partitions of the buffer replacement clock sweep."),
+			NULL
+		},
+		&clock_sweep_partitions,
+		1, 1, MAX_CLOCK_SWEEP_PARTITIONS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_buffer_usage_limit", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the buffer pool size for VACUUM, ANALYZE, and autovacuum."),
@@ -2459,6 +2515,17 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"debug_vacuum_dead_items_limit", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Limits the memory VACUUM uses to store dead tuple identifiers."),
+			gettext_noop("Zero means no limit beyond maintenance_work_mem or autovacuum_work_mem."),
+			GUC_NOT_IN_SAMPLE | GUC_UNIT_KB
+		},
+		&debug_vacuum_dead_items_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used for logical decoding."),
@@ -2669,6 +2736,16 @@ struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"vacuum_freeze_stable_cycles", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Number of VACUUMs a page must go unmodified through before VACUUM freezes it."),
+			gettext_noop("A value of 0 turns off freezing of stable pages.")
+		},
+		&vacuum_freeze_stable_cycles,
+		0, 0, PGSTAT_VACUUM_LSN_HISTORY,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_multixact_freeze_min_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Minimum age at which VACUUM should freeze a MultiXactId in a table row."),
@@ -4946,6 +5023,16 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"page_compression", PGC_SIGHUP, RESOURCES_DISK,
+			gettext_noop("Compresses relation pages as they are written to disk."),
+			NULL
+		},
+		&page_compression,
+		PAGE_COMPRESSION_NONE, page_compression_options,
+		check_page_compression, NULL, NULL
+	},
+
 	{
 		{"wal_level", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Sets the level of information written to the WAL."),
@@ -5007,6 +5094,16 @@ struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"buffer_replacement_policy", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Sets the policy used to choose shared buffers to evict."),
+			NULL
+		},
+		&buffer_replacement_policy,
+		BUFFER_REPLACEMENT_CLOCK, buffer_replacement_policy_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"huge_pages", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Use of huge pages on Linux or Windows."),
@@ -31,6 +31,7 @@
 #include "storage/bufpage.h"
 #include "storage/checksum.h"
 #include "storage/checksum_impl.h"
+#include "storage/page_compression.h"
 
 
 static int64 files_scanned = 0;
@@ -223,6 +224,18 @@ scan_file(const char *fn, int segmentno)
 		if (PageIsNew(buf.data))
 			continue;
 
+		/*
+		 * A compressed page's checksum covers its uncompressed image, which
+		 * we can't reconstruct here.
+		 */
+		if (PageIsCompressedSlot(buf.data))
+		{
+			if (mode == PG_MODE_ENABLE)
+				pg_fatal("cannot enable checksums: block %u in file \"%s\" is compressed",
+						 blockno, fn);
+			continue;
+		}
+
 		csum = pg_checksum_page(buf.data, blockno + segmentno * RELSEG_SIZE);
 		if (mode == PG_MODE_CHECK)
 		{
@@ -1327,6 +1327,7 @@ static const char *const table_storage_parameters[] = {
 	"user_catalog_table",
 	"vacuum_index_cleanup",
 	"vacuum_truncate",
+	"warm_updates",
 	NULL
 };
 
@@ -0,0 +1,238 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_internal.h
+ *	  internal declarations for the columnar table access method
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/columnar_internal.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_INTERNAL_H
+#define COLUMNAR_INTERNAL_H
+
+#include "access/htup_details.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "nodes/pg_list.h"
+#include "storage/buf.h"
+#include "storage/bufpage.h"
+#include "storage/itemptr.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/*
+ * A columnar relation's main fork consists of a metapage followed by data
+ * pages.  The data pages hold one logical stream of bytes: the payload of
+ * each page (everything after its header, up to pd_lower) is
+ * COLUMNAR_PAGE_CAPACITY bytes of the stream, so a stream offset maps
+ * directly onto a block and a position within it.
+ *
+ * The stream is a sequence of row groups, each holding up to
+ * COLUMNAR_GROUP_ROWS rows that were inserted by one transaction and
+ * command.  A row group is laid out as
+ *
+ *		ColumnarGroupHeader
+ *		ColumnarChunkInfo for each attribute
+ *		serialized min/max values
+ *		one chunk per attribute
+ *
+ * The fixed-size header never crosses a page boundary, so it can be updated
+ * in place (VACUUM does that to freeze the inserting XID).  Each chunk holds
+ * the values of one column, optionally compressed with the column's TOAST
+ * compression method.
+ *
+ * Row groups are only ever appended.  The metapage's data_end marks the end
+ * of the last complete row group; a crash while writing one leaves garbage
+ * past data_end, which the next writer simply overwrites.
+ */
+#define COLUMNAR_METAPAGE_BLKNO		0
+#define COLUMNAR_FIRST_DATA_BLKNO	1
+
+#define COLUMNAR_MAGIC				0x434F4C31	/* "COL1" */
+#define COLUMNAR_VERSION			1
+
+#define COLUMNAR_PAGE_CAPACITY		(BLCKSZ - MAXALIGN(SizeOfPageHeaderData))
+
+/* Maximum number of rows in a row group */
+#define COLUMNAR_GROUP_ROWS			10000
+
+/*
+ * Flush a row group early once the buffered values take this much memory,
+ * to keep each chunk well below the varlena size limit.
+ */
+#define COLUMNAR_GROUP_MAX_BYTES	(64 * 1024 * 1024)
+
+/* Don't keep min/max values larger than this */
+#define COLUMNAR_MAX_MINMAX_SIZE	128
+
+typedef struct ColumnarMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	uint64		data_end;		/* end of the last complete row group */
+	uint64		next_row;		/* first unreserved row number */
+	uint64		nrows;			/* rows in all row groups, dead or alive */
+} ColumnarMetaPageData;
+
+#define ColumnarPageGetMeta(page) \
+	((ColumnarMetaPageData *) PageGetContents(page))
+
+typedef struct ColumnarGroupHeader
+{
+	uint64		first_row;		/* row number of the first row */
+	uint64		total_len;		/* bytes in the row group, this included */
+	TransactionId xmin;			/* inserting transaction, or frozen */
+	CommandId	cmin;			/* inserting command */
+	uint32		nrows;			/* number of rows */
+	uint32		meta_len;		/* bytes of chunk infos and min/max values */
+	uint16		natts;			/* number of attributes stored */
+	uint16		flags;			/* see below */
+} ColumnarGroupHeader;
+
+/* ColumnarGroupHeader flags */
+#define COLUMNAR_GROUP_DEAD			0x0001	/* inserter aborted, ignore */
+
+typedef struct ColumnarChunkInfo
+{
+	uint64		offset;			/* from the start of the row group */
+	uint32		length;			/* stored bytes, 0 if there are none */
+	uint32		minmax_off;		/* from the start of the row group */
+	uint16		minmax_len;		/* bytes of serialized min and max */
+	uint16		flags;			/* see below */
+} ColumnarChunkInfo;
+
+/* ColumnarChunkInfo flags */
+#define COLUMNAR_CHUNK_HAS_NULLS	0x0001	/* chunk has a null bitmap */
+#define COLUMNAR_CHUNK_ALL_NULL		0x0002	/* no values stored at all */
+#define COLUMNAR_CHUNK_HAS_MINMAX	0x0004	/* min/max values are stored */
+#define COLUMNAR_CHUNK_COMPRESSED	0x0008	/* chunk is a compressed varlena */
+
+/*
+ * A chunk is stored as a varlena, whose data starts with padding up to
+ * MAXALIGN, then the null bitmap (if any), padding up to MAXALIGN again,
+ * and the values, aligned as in a heap tuple.  Keeping the payload
+ * MAXALIGN'd relative to the start of the varlena lets us point at the
+ * values directly once the chunk has been read into palloc'd memory.
+ */
+#define COLUMNAR_CHUNK_PAYLOAD_OFFSET	MAXALIGN(VARHDRSZ)
+
+/*
+ * Row numbers start at COLUMNAR_FIRST_ROW and are reserved through the
+ * metapage when rows are inserted, so that the TID of a row is known right
+ * away.  A TID is just the row number spread over block number and offset;
+ * it has nothing to do with where the row is stored.
+ */
+#define COLUMNAR_FIRST_ROW			UINT64CONST(1)
+#define COLUMNAR_ROWS_PER_BLOCK		MaxHeapTuplesPerPage
+#define COLUMNAR_MAX_ROW \
+	((uint64) MaxBlockNumber * COLUMNAR_ROWS_PER_BLOCK)
+
+static inline void
+columnar_row_to_tid(uint64 row, ItemPointer tid)
+{
+	ItemPointerSet(tid, (BlockNumber) (row / COLUMNAR_ROWS_PER_BLOCK),
+				   (OffsetNumber) (row % COLUMNAR_ROWS_PER_BLOCK + 1));
+}
+
+static inline uint64
+columnar_tid_to_row(ItemPointer tid)
+{
+	return (uint64) ItemPointerGetBlockNumberNoCheck(tid) *
+		COLUMNAR_ROWS_PER_BLOCK +
+		ItemPointerGetOffsetNumberNoCheck(tid) - 1;
+}
+
+/*
+ * Location of a row group, as kept in the per-relation directory built by
+ * columnar_get_groups() and columnar_find_row_group().
+ */
+typedef struct ColumnarGroupRef
+{
+	uint64		offset;			/* start of the row group in the stream */
+	uint64		first_row;
+	uint32		nrows;
+} ColumnarGroupRef;
+
+/*
+ * In-memory copy of a row group, with the columns that have been loaded.
+ */
+typedef struct ColumnarGroup
+{
+	uint64		offset;			/* start of the row group in the stream */
+	ColumnarGroupHeader hdr;
+	ColumnarChunkInfo *chunks;	/* hdr.natts entries */
+	char	   *meta;			/* chunk infos and min/max values */
+	int			natts;			/* entries in values and isnull */
+	Datum	  **values;			/* per attribute, NULL if not loaded */
+	bool	  **isnull;
+} ColumnarGroup;
+
+/*
+ * A scan qual that can be checked against the min/max values of a chunk.
+ */
+typedef enum ColumnarQualKind
+{
+	COLUMNAR_QUAL_MIN,			/* proc(min, value) must hold */
+	COLUMNAR_QUAL_MAX,			/* proc(max, value) must hold */
+	COLUMNAR_QUAL_RANGE,		/* proc(min, value) and proc2(max, value) */
+	COLUMNAR_QUAL_IS_NULL,
+	COLUMNAR_QUAL_IS_NOT_NULL,
+} ColumnarQualKind;
+
+typedef struct ColumnarScanQual
+{
+	ColumnarQualKind kind;
+	AttrNumber	attnum;
+	Datum		value;
+	Oid			collation;
+	FmgrInfo	proc;
+	FmgrInfo	proc2;
+} ColumnarScanQual;
+
+/* columnar_storage.c */
+extern void columnar_read_meta(Relation rel, ColumnarMetaPageData *meta);
+extern uint64 columnar_reserve_rows(Relation rel, uint32 count);
+extern uint64 columnar_append_group(Relation rel, const char *data, Size len,
+									uint32 nrows, uint64 reserved_end,
+									uint64 used_end);
+extern uint64 columnar_group_start(uint64 offset);
+extern void columnar_read_bytes(Relation rel, uint64 offset, char *dst,
+								Size len, BufferAccessStrategy strategy);
+extern void columnar_update_group_header(Relation rel, uint64 offset,
+										 TransactionId xmin, uint16 flags);
+extern ColumnarGroupRef *columnar_get_groups(Relation rel, uint64 data_end,
+											 int *ngroups);
+extern bool columnar_find_row_group(Relation rel, uint64 row,
+									ColumnarGroupRef *ref);
+extern bool columnar_group_visible(const ColumnarGroupHeader *hdr,
+								   Snapshot snapshot);
+
+/* columnar_reader.c */
+extern void columnar_read_group(Relation rel, uint64 offset,
+								ColumnarGroup *group,
+								BufferAccessStrategy strategy);
+extern void columnar_load_columns(Relation rel, ColumnarGroup *group,
+								  TupleDesc tupdesc, const bool *needed,
+								  BufferAccessStrategy strategy);
+extern void columnar_store_row(ColumnarGroup *group, int rowidx,
+							   TupleTableSlot *slot);
+extern ColumnarScanQual *columnar_prepare_quals(Relation rel, List *quals,
+												int *nquals);
+extern bool columnar_group_matches(ColumnarGroup *group,
+								   ColumnarScanQual *quals, int nquals);
+
+/* columnar_writer.c */
+extern void columnar_insert(Relation rel, TupleTableSlot **slots, int nslots,
+							CommandId cid);
+extern void columnar_flush_pending(Relation rel);
+extern void columnar_discard_pending(Relation rel);
+extern void columnar_write_group(Relation rel, TupleDesc tupdesc,
+								 TransactionId xmin, CommandId cmin,
+								 uint64 first_row, uint64 reserved_end,
+								 int nrows, Datum **values, bool **isnull);
+
+#endif							/* COLUMNAR_INTERNAL_H */
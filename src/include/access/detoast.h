@@ -79,4 +79,13 @@ extern Size toast_raw_datum_size(Datum value);
  */
 extern Size toast_datum_size(Datum value);
 
+/* ----------
+ * toast_datum_is_seekable -
+ *
+ *	Can slices of a varlena datum be fetched from anywhere in it, without
+ *	fetching or decompressing all that comes before?
+ * ----------
+ */
+extern bool toast_datum_is_seekable(Datum value);
+
 #endif							/* DETOAST_H */
@@ -301,9 +301,10 @@ typedef struct xl_heap_prune
  * Does replaying the record require a cleanup-lock?
  *
  * Pruning, in VACUUM's first pass or when otherwise accessing a page,
- * requires a cleanup lock.  For freezing, and VACUUM's second pass which
- * marks LP_DEAD line pointers as unused without moving any tuple data, an
- * ordinary exclusive lock is sufficient.
+ * normally requires a cleanup lock, because it repairs page fragmentation.
+ * For freezing, VACUUM's second pass which marks LP_DEAD line pointers as
+ * unused, and pruning of a page that somebody else had pinned, no tuple data
+ * is moved and an ordinary exclusive lock is sufficient.
  */
 #define		XLHP_CLEANUP_LOCK	       (1 << 2)
 
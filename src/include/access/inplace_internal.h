@@ -0,0 +1,259 @@
+/*-------------------------------------------------------------------------
+ *
+ * inplace_internal.h
+ *	  internal declarations for the inplace table access method
+ *
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/inplace_internal.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef INPLACE_INTERNAL_H
+#define INPLACE_INTERNAL_H
+
+#include "access/htup_details.h"
+#include "access/tableam.h"
+#include "storage/buf.h"
+#include "storage/bufpage.h"
+#include "storage/itemptr.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/*
+ * An inplace relation's main fork consists of a metapage followed by data
+ * pages and undo pages, in no particular order.  Every page has the standard
+ * page layout and an InplacePageOpaqueData in its special space that tells
+ * which kind of page it is.
+ *
+ * A data page holds one item per row.  An item is an InplaceTupleHeaderData
+ * followed by the latest version of the row as a MinimalTuple.  UPDATE and
+ * DELETE modify the item in place; the version they replace is first copied
+ * to an undo record on an undo page, and the new version points to it
+ * through t_undo.  Following t_undo from the current version thus yields
+ * all older versions of the row that some snapshot might still need, newest
+ * first, ending with the version that inserted the row.  The TID of a row
+ * therefore never changes, except when an update has to move the row to
+ * another page (see INPLACE_MOVED).
+ *
+ * Rollback is lazy: an aborted transaction leaves its versions behind, and
+ * readers step over them like over any other invisible version.  The next
+ * transaction that modifies the row, and VACUUM, restore the newest
+ * committed version from undo first.  Hence only the current version of a
+ * row can belong to an aborted transaction.
+ *
+ * Undo records are appended to the undo page the metapage points to.  Once
+ * every transaction that wrote to an undo page is older than any snapshot,
+ * the versions on it are no longer needed; VACUUM first clears the t_undo
+ * pointers leading to them, and then turns the page back into an empty data
+ * page.
+ */
+#define INPLACE_METAPAGE_BLKNO		0
+
+#define INPLACE_MAGIC				0x494E5031	/* "INP1" */
+#define INPLACE_VERSION				1
+
+typedef struct InplaceMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	BlockNumber undo_insert;	/* undo page to append to, or invalid */
+} InplaceMetaPageData;
+
+#define InplacePageGetMeta(page) \
+	((InplaceMetaPageData *) PageGetContents(page))
+
+typedef struct InplacePageOpaqueData
+{
+	uint16		flags;			/* see below */
+	uint16		unused;
+	TransactionId min_xid;		/* undo pages: oldest XID in any record */
+	TransactionId max_xid;		/* undo pages: newest writer of a record */
+} InplacePageOpaqueData;
+
+typedef InplacePageOpaqueData *InplacePageOpaque;
+
+#define InplacePageGetOpaque(page) \
+	((InplacePageOpaque) PageGetSpecialPointer(page))
+
+/* InplacePageOpaqueData flags */
+#define INPLACE_PAGE_META			0x0001
+#define INPLACE_PAGE_DATA			0x0002
+#define INPLACE_PAGE_UNDO			0x0004
+
+/*
+ * Header of a row version.  t_xid and t_cid identify the command that
+ * created the version; whether it inserted, updated or deleted the row is
+ * told by t_flags.  A frozen version has t_xid == FrozenTransactionId and no
+ * prior version.
+ *
+ * Row locks are exclusive only, and are not versioned: t_locker is the
+ * transaction holding the lock, if it is still running.
+ */
+typedef struct InplaceTupleHeaderData
+{
+	TransactionId t_xid;		/* transaction that created this version */
+	CommandId	t_cid;			/* command that created this version */
+	TransactionId t_locker;		/* row lock holder, or invalid */
+	uint16		t_flags;		/* see below */
+	ItemPointerData t_undo;		/* undo record holding the prior version */
+	ItemPointerData t_ctid;		/* new TID if moved; speculative token */
+} InplaceTupleHeaderData;
+
+typedef InplaceTupleHeaderData *InplaceTupleHeader;
+
+/* InplaceTupleHeaderData flags */
+#define INPLACE_INSERTED			0x0001	/* created the row, no prior */
+#define INPLACE_UPDATED				0x0002	/* replaced the prior version */
+#define INPLACE_DELETED				0x0004	/* deleted the row */
+#define INPLACE_MOVED				0x0008	/* with DELETED: row is at t_ctid */
+#define INPLACE_SPECULATIVE			0x0010	/* speculative insertion */
+#define INPLACE_XID_COMMITTED		0x0020	/* t_xid is known committed */
+
+#define INPLACE_TUPLE_HEADER_SIZE	MAXALIGN(sizeof(InplaceTupleHeaderData))
+
+#define InplaceItemGetBody(item) \
+	((MinimalTuple) ((char *) (item) + INPLACE_TUPLE_HEADER_SIZE))
+
+/*
+ * An undo record holds the header of the version that was replaced and,
+ * for an update, its body.  A delete leaves the body of the row alone, so
+ * its record has no body; the prior version then has the same body as the
+ * next newer one.  ur_xid and ur_tid identify the record, so that a reader
+ * can tell if it followed a pointer to an undo record that was discarded.
+ */
+typedef struct InplaceUndoRecordData
+{
+	TransactionId ur_xid;		/* transaction that wrote the record */
+	ItemPointerData ur_tid;		/* row the record belongs to */
+	uint16		ur_flags;		/* currently unused */
+	InplaceTupleHeaderData ur_hdr;	/* header of the prior version */
+} InplaceUndoRecordData;
+
+typedef InplaceUndoRecordData *InplaceUndoRecord;
+
+#define INPLACE_UNDO_HEADER_SIZE	MAXALIGN(sizeof(InplaceUndoRecordData))
+
+#define InplaceUndoGetBody(rec) \
+	((MinimalTuple) ((char *) (rec) + INPLACE_UNDO_HEADER_SIZE))
+
+/*
+ * Largest item that fits on an empty page, and the largest row body that
+ * can be stored.  The latter leaves room for the undo record header, so that
+ * the undo record of any version fits on an empty undo page.
+ */
+#define INPLACE_MAX_ITEM_SIZE \
+	MAXALIGN_DOWN(BLCKSZ - MAXALIGN(SizeOfPageHeaderData + sizeof(ItemIdData)) - \
+				  MAXALIGN(sizeof(InplacePageOpaqueData)))
+#define INPLACE_MAX_BODY_SIZE \
+	(INPLACE_MAX_ITEM_SIZE - INPLACE_UNDO_HEADER_SIZE)
+
+/*
+ * A row version, as copied out of a data page or undo record.  The body
+ * points into memory owned by whoever made the copy.
+ */
+typedef struct InplaceVersion
+{
+	InplaceTupleHeaderData hdr;
+	MinimalTuple body;
+} InplaceVersion;
+
+/* Result of inplace_fetch_version() */
+typedef enum InplaceFetchResult
+{
+	INPLACE_FETCH_OK,			/* found a version visible to the snapshot */
+	INPLACE_FETCH_INVISIBLE,	/* row exists, but no version is visible */
+	INPLACE_FETCH_DEAD,			/* row is dead to everyone */
+	INPLACE_FETCH_NONE,			/* there is no row at the TID */
+} InplaceFetchResult;
+
+struct GlobalVisState;
+struct VacuumParams;
+
+/* inplace_page.c */
+extern void inplace_init_page(Page page, uint16 flags);
+extern bool inplace_is_data_page(Page page);
+extern bool inplace_is_undo_page(Page page);
+extern bool inplace_page_is_empty(Page page);
+extern Buffer inplace_lock_meta(Relation rel, int mode);
+extern Buffer inplace_extend(Relation rel);
+extern Buffer inplace_get_insert_buffer(Relation rel, Size len,
+										Buffer otherBuffer);
+extern Size inplace_item_size(MinimalTuple body);
+extern char *inplace_form_item(InplaceTupleHeader hdr, MinimalTuple body,
+							   Size alloc);
+extern bool inplace_replace_item(Page page, OffsetNumber offnum,
+								 InplaceTupleHeader hdr, MinimalTuple body,
+								 Size alloc);
+extern void inplace_copy_item(Page page, OffsetNumber offnum,
+							  InplaceVersion *version);
+extern InplaceTupleHeader inplace_get_item(Page page, OffsetNumber offnum);
+
+/* inplace_undo.c */
+extern Buffer inplace_undo_reserve(Relation rel, Size len);
+extern Size inplace_undo_size(MinimalTuple body);
+extern void inplace_undo_append(Page undopage, BlockNumber undoblk,
+								TransactionId xid, ItemPointer tid,
+								InplaceTupleHeader prior, MinimalTuple body,
+								ItemPointer ptr);
+extern void inplace_undo_fetch(Relation rel, ItemPointer ptr,
+							   TransactionId xid, ItemPointer tid,
+							   InplaceVersion *version);
+extern bool inplace_rollback(Relation rel, Page page, BlockNumber blkno,
+							 OffsetNumber offnum);
+extern void inplace_undo_retire(Relation rel);
+extern bool inplace_undo_discard(Relation rel, Buffer buf,
+								 TransactionId OldestXmin,
+								 TransactionId *min_xid);
+extern void inplace_undo_conflict(Relation rel, TransactionId horizon);
+
+/* inplace_visibility.c */
+extern bool inplace_version_committed(InplaceTupleHeader hdr);
+extern bool inplace_version_aborted(InplaceTupleHeader hdr);
+extern bool inplace_version_visible(InplaceTupleHeader hdr,
+									Snapshot snapshot);
+extern bool inplace_row_is_dead(InplaceTupleHeader hdr,
+								struct GlobalVisState *vistest);
+extern bool inplace_skip_aborted(Relation rel, ItemPointer tid,
+								 InplaceVersion *version);
+extern InplaceFetchResult inplace_resolve_version(Relation rel,
+												  ItemPointer tid,
+												  Snapshot snapshot,
+												  InplaceVersion *version);
+extern InplaceFetchResult inplace_fetch_version(Relation rel, Buffer buf,
+												ItemPointer tid,
+												Snapshot snapshot,
+												InplaceVersion *version,
+												bool *all_dead);
+extern void inplace_store_version(Relation rel, InplaceVersion *version,
+								  ItemPointer tid, TupleTableSlot *slot);
+
+/* inplace_modify.c */
+extern MinimalTuple inplace_prepare_body(Relation rel, HeapTuple tup,
+										 HeapTuple oldtup, int options);
+extern void inplace_insert(Relation rel, TupleTableSlot **slots, int nslots,
+						   CommandId cid, int options, uint32 specToken);
+extern void inplace_complete_speculative(Relation rel, ItemPointer tid,
+										 bool succeeded);
+extern TM_Result inplace_delete(Relation rel, ItemPointer tid, CommandId cid,
+								Snapshot snapshot, Snapshot crosscheck,
+								bool wait, TM_FailureData *tmfd,
+								bool changingPart);
+extern TM_Result inplace_update(Relation rel, ItemPointer otid,
+								TupleTableSlot *slot, CommandId cid,
+								Snapshot snapshot, Snapshot crosscheck,
+								bool wait, TM_FailureData *tmfd,
+								LockTupleMode *lockmode,
+								TU_UpdateIndexes *update_indexes);
+extern TM_Result inplace_lock(Relation rel, ItemPointer tid,
+							  Snapshot snapshot, TupleTableSlot *slot,
+							  CommandId cid, LockWaitPolicy wait_policy,
+							  uint8 flags, TM_FailureData *tmfd);
+
+/* inplace_vacuum.c */
+extern void inplace_vacuum_rel(Relation rel, struct VacuumParams *params,
+							   BufferAccessStrategy bstrategy);
+
+#endif							/* INPLACE_INTERNAL_H */
@@ -123,6 +123,8 @@ typedef struct IndexScanDescData
 	struct ScanKeyData *orderByData;	/* array of ordering op descriptors */
 	bool		xs_want_itup;	/* caller requests index tuples */
 	bool		xs_temp_snap;	/* unregister snapshot at scan end? */
+	bool		xs_warm_recheck;	/* compare index tuples with heap tuples,
+									 * because of WARM updates? */
 
 	/* signaling to index AM about killing index tuples */
 	bool		kill_prior_tuple;	/* last-returned tuple is dead */
@@ -151,6 +153,16 @@ typedef struct IndexScanDescData
 
 	bool		xs_recheck;		/* T means scan keys must be rechecked */
 
+	/*
+	 * An amgettuple AM that returns the TIDs it collected from one index page
+	 * under a single page lock can advertise that by incrementing
+	 * xs_batchno (starting at 1) whenever it reads a new page.  Index-only
+	 * scans then know that visibility map bits read while returning one TID
+	 * of a batch are recent enough for all the TIDs of that batch.  AMs that
+	 * don't do this leave it at 0.
+	 */
+	uint64		xs_batchno;
+
 	/*
 	 * When fetching with an ordering operator, the values of the ORDER BY
 	 * expressions of the last returned tuple, according to the index.  If
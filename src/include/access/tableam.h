@@ -124,6 +124,14 @@ typedef enum TU_UpdateIndexes
 
 	/* Only summarized columns were updated, TID is unchanged */
 	TU_Summarizing,
+
+	/*
+	 * Only columns of indexes that allow WARM updates (see
+	 * index_warm_eligible()) and summarized columns were updated.  Indexes
+	 * whose columns changed need new entries pointing to the old TID, which
+	 * is the root of the new tuple's HOT chain.
+	 */
+	TU_Warm,
 } TU_UpdateIndexes;
 
 /*
@@ -352,6 +360,24 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Tell the scan which columns the caller needs, and which quals it is
+	 * going to apply to the returned tuples.  `attrs` holds attribute
+	 * numbers offset by FirstLowInvalidHeapAttributeNumber, as built by
+	 * pull_varattnos(); a whole-row reference means all columns are needed.
+	 * `quals` is an implicitly-ANDed list of expressions referencing the
+	 * relation.  The AM may leave other columns NULL in the returned
+	 * tuples, and may skip tuples that cannot satisfy the quals, but must
+	 * not rely on the quals being exhaustive.  Called right after the scan
+	 * has been started.
+	 *
+	 * Optional callback; AMs that implement it also stop the planner from
+	 * using a physical target list for sequential scans.
+	 */
+	void		(*scan_set_projection) (TableScanDesc scan,
+										Bitmapset *attrs,
+										List *quals);
+
 	/*-----------
 	 * Optional functions to provide scanning for ranges of ItemPointers.
 	 * Implementations must either provide both of these functions, or neither
@@ -1071,6 +1097,18 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Restrict `sscan` to the columns in `attrs`, and tell it about `quals`; see
+ * the scan_set_projection callback.  Does nothing if the AM doesn't
+ * implement it.
+ */
+static inline void
+table_scan_set_projection(TableScanDesc sscan, Bitmapset *attrs, List *quals)
+{
+	if (sscan->rs_rd->rd_tableam->scan_set_projection != NULL)
+		sscan->rs_rd->rd_tableam->scan_set_projection(sscan, attrs, quals);
+}
+
 /* ----------------------------------------------------------------------------
  * TID Range scanning related functions.
  * ----------------------------------------------------------------------------
@@ -38,7 +38,8 @@ typedef enum ToastCompressionId
 {
 	TOAST_PGLZ_COMPRESSION_ID = 0,
 	TOAST_LZ4_COMPRESSION_ID = 1,
-	TOAST_INVALID_COMPRESSION_ID = 2,
+	TOAST_ZSTD_COMPRESSION_ID = 2,
+	TOAST_INVALID_COMPRESSION_ID = 3,
 } ToastCompressionId;
 
 /*
@@ -48,6 +49,7 @@ typedef enum ToastCompressionId
  */
 #define TOAST_PGLZ_COMPRESSION			'p'
 #define TOAST_LZ4_COMPRESSION			'l'
+#define TOAST_ZSTD_COMPRESSION			'z'
 #define InvalidCompressionMethod		'\0'
 
 #define CompressionMethodIsValid(cm)  ((cm) != InvalidCompressionMethod)
@@ -65,6 +67,35 @@ extern struct varlena *lz4_decompress_datum(const struct varlena *value);
 extern struct varlena *lz4_decompress_datum_slice(const struct varlena *value,
 												  int32 slicelength);
 
+/*
+ * zstd compresses values larger than ZSTD_TOAST_FRAME_SIZE in independent
+ * frames of that many raw bytes, preceded by a seek table giving the end of
+ * each frame, so that a slice of the value can be decompressed from just the
+ * frames that hold it.  The seek table is kept in a zstd skippable frame,
+ * which plain zstd decompression ignores.
+ *
+ * A frame compressed with a dictionary names it in the Dictionary_ID field
+ * of its frame header.  We don't use dictionaries yet, so all frames have no
+ * dictionary ID, but the format allows for them: a later release can store
+ * dictionaries by ID, and this one refuses to decompress values that need
+ * one instead of calling them corrupt.
+ */
+#define ZSTD_TOAST_FRAME_SIZE		(32 * 1024)
+#define ZSTD_SEEK_TABLE_HEADER_SIZE	16
+
+/* zstd compression/decompression routines */
+extern struct varlena *zstd_compress_datum(const struct varlena *value,
+										   int level);
+extern struct varlena *zstd_decompress_datum(const struct varlena *value);
+extern struct varlena *zstd_decompress_datum_slice(const struct varlena *value,
+												   int32 slicelength);
+extern int32 zstd_seek_table_size(const char *stream, int32 *framesize,
+								  int32 *nframes);
+extern void zstd_frame_bounds(const char *stream, int32 frame,
+							  int32 *start, int32 *end);
+extern void zstd_decompress_frames(const char *src, int32 srclen,
+								   char *dst, int32 dstlen);
+
 /* other stuff */
 extern ToastCompressionId toast_get_compression_id(struct varlena *attr);
 extern char CompressionNameToMethod(const char *compression);
@@ -18,6 +18,7 @@
 #include "access/genam.h"
 #include "access/parallel.h"
 #include "access/tidstore.h"
+#include "access/xlogdefs.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_statistic.h"
 #include "catalog/pg_type.h"
@@ -276,6 +277,15 @@ struct VacuumCutoffs
 	 */
 	TransactionId FreezeLimit;
 	MultiXactId MultiXactCutoff;
+
+	/*
+	 * StablePageLSN is the WAL insert position at the start of the
+	 * vacuum_freeze_stable_cycles'th previous VACUUM of the table.  Pages
+	 * with an older LSN have gone unmodified through that many VACUUMs, and
+	 * are frozen whenever that makes them all-frozen.  InvalidXLogRecPtr if
+	 * not known, or not wanted.
+	 */
+	XLogRecPtr	StablePageLSN;
 };
 
 /*
@@ -292,10 +302,12 @@ typedef struct VacDeadItemsInfo
 extern PGDLLIMPORT int default_statistics_target;	/* PGDLLIMPORT for PostGIS */
 extern PGDLLIMPORT int vacuum_freeze_min_age;
 extern PGDLLIMPORT int vacuum_freeze_table_age;
+extern PGDLLIMPORT int vacuum_freeze_stable_cycles;
 extern PGDLLIMPORT int vacuum_multixact_freeze_min_age;
 extern PGDLLIMPORT int vacuum_multixact_freeze_table_age;
 extern PGDLLIMPORT int vacuum_failsafe_age;
 extern PGDLLIMPORT int vacuum_multixact_failsafe_age;
+extern PGDLLIMPORT int debug_vacuum_dead_items_limit;
 
 /*
  * Maximum value for default_statistics_target and per-column statistics
@@ -360,11 +372,15 @@ extern void VacuumUpdateCosts(void);
 extern ParallelVacuumState *parallel_vacuum_init(Relation rel, Relation *indrels,
 												 int nindexes, int nrequested_workers,
 												 int vac_work_mem, int elevel,
-												 BufferAccessStrategy bstrategy);
+												 BufferAccessStrategy bstrategy,
+												 Size heap_scan_size);
 extern void parallel_vacuum_end(ParallelVacuumState *pvs, IndexBulkDeleteResult **istats);
 extern TidStore *parallel_vacuum_get_dead_items(ParallelVacuumState *pvs,
 												VacDeadItemsInfo **dead_items_info_p);
 extern void parallel_vacuum_reset_dead_items(ParallelVacuumState *pvs);
+extern void *parallel_vacuum_get_heap_scan(ParallelVacuumState *pvs);
+extern int	parallel_vacuum_heap_scan_begin(ParallelVacuumState *pvs);
+extern void parallel_vacuum_heap_scan_end(ParallelVacuumState *pvs);
 extern void parallel_vacuum_bulkdel_all_indexes(ParallelVacuumState *pvs,
 												long num_table_tuples,
 												int num_index_scans);
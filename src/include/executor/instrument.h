@@ -85,6 +85,7 @@ typedef struct Instrumentation
 	double		total;			/* total time (in seconds) */
 	double		ntuples;		/* total tuples produced */
 	double		ntuples2;		/* secondary node-specific tuple counter */
+	double		ntuples3;		/* tertiary node-specific tuple counter */
 	double		nloops;			/* # of run cycles for this node */
 	double		nfiltered1;		/* # of tuples removed by scanqual or joinqual */
 	double		nfiltered2;		/* # of tuples removed by "other" quals */
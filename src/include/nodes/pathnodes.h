@@ -508,6 +508,8 @@ struct PlannerInfo
 	bool		placeholdersFrozen;
 	/* true if planning a recursive WITH item */
 	bool		hasRecursion;
+	/* true if an INSERT has volatile functions other than nextval() */
+	bool		hasVolatileInsert;
 
 	/*
 	 * Information about aggregates. Filled by preprocess_aggrefs().
@@ -815,6 +817,7 @@ typedef struct PartitionSchemeData *PartitionScheme;
 
 /* Bitmask of flags supported by table AMs */
 #define AMFLAG_HAS_TID_RANGE (1 << 0)
+#define AMFLAG_HAS_COLUMN_PROJECTION (1 << 1)
 
 typedef enum RelOptKind
 {
@@ -11,6 +11,7 @@
 #ifndef PGSTAT_H
 #define PGSTAT_H
 
+#include "access/xlogdefs.h"
 #include "datatype/timestamp.h"
 #include "portability/instr_time.h"
 #include "postmaster/pgarch.h"	/* for MAX_XFN_CHARS */
@@ -177,6 +178,8 @@ typedef struct PgStat_TableCounts
 
 	PgStat_Counter blocks_fetched;
 	PgStat_Counter blocks_hit;
+
+	PgStat_Counter pages_unfrozen;
 } PgStat_TableCounts;
 
 /* ----------
@@ -235,7 +238,7 @@ typedef struct PgStat_TableXactStatus
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAC
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCAD
 
 typedef struct PgStat_ArchiverStats
 {
@@ -396,6 +399,12 @@ typedef struct PgStat_StatSubEntry
 	TimestampTz stat_reset_timestamp;
 } PgStat_StatSubEntry;
 
+/*
+ * Number of past VACUUMs of a table whose ending WAL position is kept, to
+ * tell how long its pages have been left unmodified.
+ */
+#define PGSTAT_VACUUM_LSN_HISTORY	8
+
 typedef struct PgStat_StatTabEntry
 {
 	PgStat_Counter numscans;
@@ -426,6 +435,12 @@ typedef struct PgStat_StatTabEntry
 	PgStat_Counter analyze_count;
 	TimestampTz last_autoanalyze_time;	/* autovacuum initiated */
 	PgStat_Counter autoanalyze_count;
+
+	PgStat_Counter pages_frozen;	/* pages with tuples frozen by VACUUM */
+	PgStat_Counter pages_unfrozen;	/* all-frozen pages modified again */
+	PgStat_Counter freeze_wal_bytes;	/* WAL written by VACUUM to freeze */
+	/* WAL insert position at the end of recent VACUUMs, newest first */
+	XLogRecPtr	vacuum_end_lsn[PGSTAT_VACUUM_LSN_HISTORY];
 } PgStat_StatTabEntry;
 
 typedef struct PgStat_WalStats
@@ -591,7 +606,10 @@ extern void pgstat_assoc_relation(Relation rel);
 extern void pgstat_unlink_relation(Relation rel);
 
 extern void pgstat_report_vacuum(Oid tableoid, bool shared,
-								 PgStat_Counter livetuples, PgStat_Counter deadtuples);
+								 PgStat_Counter livetuples, PgStat_Counter deadtuples,
+								 PgStat_Counter pagesfrozen,
+								 PgStat_Counter freezewalbytes,
+								 XLogRecPtr endlsn);
 extern void pgstat_report_analyze(Relation rel,
 								  PgStat_Counter livetuples, PgStat_Counter deadtuples,
 								  bool resetcounter);
@@ -642,6 +660,11 @@ extern void pgstat_report_analyze(Relation rel,
 		if (pgstat_should_count_relation(rel))						\
 			(rel)->pgstat_info->counts.blocks_hit++;				\
 	} while (0)
+#define pgstat_count_heap_unfreeze(rel, n)							\
+	do {															\
+		if (pgstat_should_count_relation(rel))						\
+			(rel)->pgstat_info->counts.pages_unfrozen += (n);		\
+	} while (0)
 
 extern void pgstat_count_heap_insert(Relation rel, PgStat_Counter n);
 extern void pgstat_count_heap_update(Relation rel, bool hot, bool newpage);
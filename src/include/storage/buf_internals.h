@@ -427,7 +427,20 @@ extern void StrategyFreeBuffer(BufferDesc *buf);
 extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
 								 BufferDesc *buf, bool from_ring);
 
-extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
+extern int	StrategySyncStart(int partno, int *first, int *size,
+							  uint32 *complete_passes, uint32 *num_buf_alloc,
+							  uint32 *num_dirty_evictions);
+extern int	StrategyNumPartitions(void);
+extern void StrategyReportDirtyEviction(void);
+extern int	StrategyGetActiveBuffers(void);
+extern uint32 StrategyAdmitUsageCount(uint32 hashcode, int buf_id,
+									  BufferAccessStrategy strategy);
+extern bool StrategyCorrelatedReference(int buf_id);
+extern void StrategyRememberEviction(uint32 hashcode);
+extern void StrategyGetReplacementStats(uint64 *probation_admits,
+										uint64 *ghost_admits,
+										uint64 *ghosts_remembered);
+extern void StrategySetActiveBuffers(int nbuffers);
 extern void StrategyNotifyBgWriter(int bgwprocno);
 
 extern Size StrategyShmemSize(void);
@@ -439,8 +452,11 @@ extern Size BufTableShmemSize(int size);
 extern void InitBufTable(int size);
 extern uint32 BufTableHashCode(BufferTag *tagPtr);
 extern int	BufTableLookup(BufferTag *tagPtr, uint32 hashcode);
+extern int	BufTableLookupHint(uint32 hashcode);
 extern int	BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id);
 extern void BufTableDelete(BufferTag *tagPtr, uint32 hashcode);
+extern BlockNumber BufTableBlockBound(RelFileLocator rlocator,
+									 ForkNumber forknum);
 
 /* localbuf.c */
 extern bool PinLocalBuffer(BufferDesc *buf_hdr, bool adjust_usagecount);
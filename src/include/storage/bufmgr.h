@@ -142,6 +142,13 @@ typedef struct ReadBuffersOperation ReadBuffersOperation;
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
+/* Possible values for buffer_replacement_policy */
+typedef enum BufferReplacementPolicy
+{
+	BUFFER_REPLACEMENT_CLOCK,	/* plain clock sweep */
+	BUFFER_REPLACEMENT_2Q,		/* clock sweep with probation and ghosts */
+} BufferReplacementPolicy;
+
 /* forward declared, to avoid including smgr.h here */
 struct SMgrRelationData;
 
@@ -152,8 +159,15 @@ extern PGDLLIMPORT int NBuffers;
 extern PGDLLIMPORT bool zero_damaged_pages;
 extern PGDLLIMPORT int bgwriter_lru_maxpages;
 extern PGDLLIMPORT double bgwriter_lru_multiplier;
+extern PGDLLIMPORT bool bgwriter_cold_flush;
+extern PGDLLIMPORT int shared_buffers_limit;
 extern PGDLLIMPORT bool track_io_timing;
 
+/* in freelist.c */
+#define MAX_CLOCK_SWEEP_PARTITIONS 16
+extern PGDLLIMPORT int clock_sweep_partitions;
+extern PGDLLIMPORT int buffer_replacement_policy;
+
 /* only applicable when prefetching is available */
 #ifdef USE_PREFETCH
 #define DEFAULT_EFFECTIVE_IO_CONCURRENCY 1
@@ -297,6 +311,8 @@ extern bool IsBufferCleanupOK(Buffer buffer);
 extern bool HoldingBufferPinThatDelaysRecovery(void);
 
 extern bool BgBufferSync(struct WritebackContext *wb_context);
+extern bool BgBufferApplyLimit(void);
+extern int	SharedBuffersLimit(void);
 
 extern void LimitAdditionalPins(uint32 *additional_pins);
 extern void LimitAdditionalLocalPins(uint32 *additional_pins);
@@ -112,6 +112,7 @@ extern ssize_t FileWriteV(File file, const struct iovec *iov, int iovcnt, off_t
 extern int	FileSync(File file, uint32 wait_event_info);
 extern int	FileZero(File file, off_t offset, off_t amount, uint32 wait_event_info);
 extern int	FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info);
+extern int	FilePunchHole(File file, off_t offset, off_t amount, uint32 wait_event_info);
 
 extern off_t FileSize(File file);
 extern int	FileTruncate(File file, off_t offset, uint32 wait_event_info);
@@ -19,6 +19,9 @@
 #include "storage/smgr.h"
 #include "storage/sync.h"
 
+/* GUC variable */
+extern PGDLLIMPORT int page_compression;
+
 /* md storage manager functionality */
 extern void mdinit(void);
 extern void mdopen(SMgrRelation reln);
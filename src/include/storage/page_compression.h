@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+ *
+ * page_compression.h
+ *	  On-disk format of compressed relation pages.
+ *
+ * When page_compression is enabled, md.c may store a main fork page in its
+ * fixed BLCKSZ slot as a compressed image followed by a hole punched in the
+ * file, rather than as the raw page.  The slot then begins with a
+ * PageCompressHeader instead of a PageHeaderData.  The magic value occupies
+ * the position of the high half of pd_lsn, where no real page can hold it.
+ *
+ * This file is usable by frontend code, so that tools reading relation
+ * files directly can recognize compressed slots.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/page_compression.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PAGE_COMPRESSION_H
+#define PAGE_COMPRESSION_H
+
+/* Values for the page_compression GUC */
+typedef enum PageCompression
+{
+	PAGE_COMPRESSION_NONE = 0,
+	PAGE_COMPRESSION_PGLZ,
+	PAGE_COMPRESSION_LZ4,
+	PAGE_COMPRESSION_ZSTD,
+} PageCompression;
+
+typedef struct PageCompressHeader
+{
+	uint32		pch_magic;		/* PAGE_COMPRESS_MAGIC */
+	uint16		pch_method;		/* PageCompression method used */
+	uint16		pch_length;		/* length of compressed data that follows */
+} PageCompressHeader;
+
+#define PAGE_COMPRESS_MAGIC		0xFFFFC0DE
+
+/*
+ * Compressed slots are written, and the rest of the slot punched out, in
+ * units of this size, which should match the file system block size.
+ */
+#define PAGE_COMPRESS_ALIGN		4096
+
+/*
+ * Does the given raw BLCKSZ slot hold a compressed page?
+ */
+static inline bool
+PageIsCompressedSlot(const char *slot)
+{
+	return ((const PageCompressHeader *) slot)->pch_magic == PAGE_COMPRESS_MAGIC;
+}
+
+#endif							/* PAGE_COMPRESSION_H */
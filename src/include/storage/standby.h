@@ -105,5 +105,8 @@ extern void LogAccessExclusiveLockPrepare(void);
 extern XLogRecPtr LogStandbySnapshot(void);
 extern void LogStandbyInvalidations(int nmsgs, SharedInvalidationMessage *msgs,
 									bool relcacheInitFileInval);
+extern void LogStandbySnapshotConflict(RelFileLocator locator,
+									   TransactionId snapshotConflictHorizon,
+									   bool isCatalogRel);
 
 #endif							/* STANDBY_H */
@@ -17,6 +17,7 @@
 #include "access/xlogreader.h"
 #include "lib/stringinfo.h"
 #include "storage/lockdefs.h"
+#include "storage/relfilelocator.h"
 #include "storage/sinval.h"
 
 /* Recovery handlers for the Standby Rmgr (RM_STANDBY_ID) */
@@ -34,6 +35,7 @@ extern void standby_desc_invalidations(StringInfo buf,
 #define XLOG_STANDBY_LOCK			0x00
 #define XLOG_RUNNING_XACTS			0x10
 #define XLOG_INVALIDATIONS			0x20
+#define XLOG_SNAPSHOT_CONFLICT		0x30
 
 typedef struct xl_standby_locks
 {
@@ -71,4 +73,19 @@ typedef struct xl_invalidations
 
 #define MinSizeOfInvalidations offsetof(xl_invalidations, msgs)
 
+/*
+ * Recovery conflict for a change to a relation that is WAL-logged by other
+ * means than its own resource manager, e.g. through generic WAL, and that
+ * removes row versions some snapshots on a standby could still need.
+ */
+typedef struct xl_snapshot_conflict
+{
+	RelFileLocator locator;
+	TransactionId snapshotConflictHorizon;
+	bool		isCatalogRel;	/* to handle recovery conflict during logical
+								 * decoding on standby */
+} xl_snapshot_conflict;
+
+#define SizeOfSnapshotConflict (offsetof(xl_snapshot_conflict, isCatalogRel) + sizeof(bool))
+
 #endif							/* STANDBYDEFS_H */
@@ -404,6 +404,10 @@ extern JsonbValue *getKeyJsonValueFromContainer(JsonbContainer *container,
 												JsonbValue *res);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *container,
 												 uint32 i);
+extern JsonbValue *getKeyJsonValueFromToasted(struct varlena *attr,
+											  const char *keyVal, int keyLen,
+											  JsonbValue *res);
+extern JsonbValue *getIthJsonbValueFromToasted(struct varlena *attr, int i);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
 								  JsonbIteratorToken seq, JsonbValue *jbval);
 extern JsonbIterator *JsonbIteratorInit(JsonbContainer *container);
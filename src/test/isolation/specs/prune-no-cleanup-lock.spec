@@ -0,0 +1,42 @@
+# Test for on-access pruning of a heap page that another backend has
+# pinned, so that no cleanup lock is available.  Line pointers are pruned
+# and can be reused right away, while the space held by the pruned tuples
+# is only reclaimed by a later prune that gets a cleanup lock.
+#
+# The row sizes are chosen so that the page is nearly full once "fill" has
+# run, which is what makes SELECTs try to prune it.  STORAGE plain keeps
+# the filler row from being compressed.
+
+setup
+{
+  CREATE TABLE prunetbl (id int, t text) WITH (autovacuum_enabled = off);
+  ALTER TABLE prunetbl ALTER COLUMN t SET STORAGE plain;
+}
+setup { INSERT INTO prunetbl VALUES (1, 'a'); }
+setup { UPDATE prunetbl SET t = 'b'; }
+setup { UPDATE prunetbl SET t = 'c'; }
+
+teardown
+{
+  DROP TABLE prunetbl;
+}
+
+# This session holds a pin on prunetbl's only heap page:
+session pinholder
+step pin_cursor		{ BEGIN; DECLARE c1 CURSOR FOR SELECT id, t FROM prunetbl; FETCH NEXT FROM c1; }
+step unpin			{ COMMIT; }
+
+session pruner
+step fill			{ INSERT INTO prunetbl VALUES (2, repeat('x', 7624)); }
+step prune			{ SELECT count(*) FROM prunetbl; }
+step reuse			{ INSERT INTO prunetbl VALUES (3, 'd') RETURNING ctid; }
+step update_moved	{ UPDATE prunetbl SET t = repeat('y', 368) WHERE id = 1 RETURNING ctid; }
+step prune_again	{ SELECT count(*) FROM prunetbl; }
+step update_hot		{ UPDATE prunetbl SET t = repeat('z', 368) WHERE id = 3 RETURNING ctid; }
+
+# "prune" has to settle for an exclusive lock.  It frees the line pointer
+# of the intermediate version of row 1, which "reuse" takes over, but not
+# its space, so that "update_moved" doesn't fit on the page.  Once the pin
+# is gone, "prune_again" defragments the page, and the same update of row 3
+# does fit.
+permutation pin_cursor fill prune reuse unpin update_moved prune_again update_hot
@@ -0,0 +1,70 @@
+
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Exercise page_compression: pages are stored compressed on disk and read
+# back intact, including after the setting is turned off again.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = '256kB' # tiny to force I/O
+});
+$node->start;
+
+# The setting is rejected on platforms that can't deallocate file space.
+my ($ret, $stdout, $stderr) = $node->psql('postgres',
+	"ALTER SYSTEM SET page_compression = 'pglz'");
+if ($ret != 0)
+{
+	plan skip_all => "page_compression is not supported on this platform";
+}
+$node->restart;
+
+$node->safe_psql('postgres',
+	"CREATE TABLE t AS SELECT i, repeat('compressible', 20) AS r FROM generate_series(1, 10000) i"
+);
+$node->safe_psql('postgres', 'CHECKPOINT');
+
+# Count the blocks of the table's first segment that begin with the
+# compressed page marker.
+my $path = $node->safe_psql('postgres', "SELECT pg_relation_filepath('t')");
+my $file = $node->data_dir . '/' . $path;
+open(my $fh, '<', $file) or die "could not open $file: $!";
+binmode $fh;
+my $blcksz = $node->safe_psql('postgres', 'SHOW block_size');
+my $compressed = 0;
+my $block;
+while (read($fh, $block, $blcksz) == $blcksz)
+{
+	$compressed++ if unpack('L', $block) == 0xFFFFC0DE;
+}
+close $fh;
+cmp_ok($compressed, '>', 0, 'pages are stored compressed');
+
+# Read everything back through a cold buffer pool.
+$node->restart;
+is( $node->safe_psql(
+		'postgres', "SELECT count(*), sum(i) FROM t WHERE r = repeat('compressible', 20)"),
+	'10000|50005000',
+	'compressed pages read back intact');
+
+# Compressed pages remain readable with compression disabled, and are
+# replaced by raw pages as they are rewritten.
+$node->safe_psql('postgres', 'ALTER SYSTEM RESET page_compression');
+$node->restart;
+$node->safe_psql('postgres', 'UPDATE t SET i = i + 1');
+$node->safe_psql('postgres', 'CHECKPOINT');
+$node->restart;
+is($node->safe_psql('postgres', 'SELECT count(*), sum(i) FROM t'),
+	'10000|50015000', 'pages read back after disabling compression');
+
+$node->stop;
+
+done_testing();
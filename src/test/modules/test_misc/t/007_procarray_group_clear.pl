@@ -0,0 +1,60 @@
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test the counters of pg_stat_get_procarray_end_xact() with concurrent
+# committers.  When a committing backend can't get ProcArrayLock right away,
+# it has its xid cleared by the leader of a group, so with enough committers
+# group_clears must advance eventually.
+
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'max_connections = 40');
+$node->start;
+
+my $stats_query =
+  'SELECT direct_clears, group_clears, group_members FROM pg_stat_get_procarray_end_xact()';
+my ($direct_before, $groups_before, $members_before) =
+  split(/\|/, $node->safe_psql('postgres', $stats_query));
+
+my $nclients = 32;
+my $ntransactions = 200;
+my $rounds = 0;
+my ($direct, $groups, $members);
+while (1)
+{
+	$rounds++;
+	$node->pgbench(
+		"--no-vacuum --client=$nclients --jobs=4 --transactions=$ntransactions",
+		0,
+		[qr{processed: \d+/\d+}],
+		[qr{^$}],
+		"concurrent committers, round $rounds",
+		{ '007_procarray_group_clear' => 'SELECT pg_current_xact_id()' });
+
+	($direct, $groups, $members) =
+	  split(/\|/, $node->safe_psql('postgres', $stats_query));
+	last
+	  if $groups > $groups_before
+	  || $rounds >= $PostgreSQL::Test::Utils::timeout_default;
+}
+
+cmp_ok($groups, '>', $groups_before, 'group_clears advanced');
+cmp_ok($members - $members_before,
+	'>=', $groups - $groups_before, 'every group has at least one member');
+
+# Every commit of the pgbench transactions, which all have an xid, is counted
+# exactly once, either as a direct clear or as a group member
+cmp_ok(
+	($direct - $direct_before) + ($members - $members_before),
+	'>=',
+	$rounds * $nclients * $ntransactions,
+	'all commits with an xid counted');
+
+$node->stop;
+done_testing();
@@ -0,0 +1,31 @@
+CREATE EXTENSION test_smgr;
+
+-- relations are opened through the extension's storage manager
+CREATE TABLE test_smgr_tbl (a int);
+INSERT INTO test_smgr_tbl SELECT generate_series(1, 1000);
+SELECT count(*) FROM test_smgr_tbl;
+SELECT test_smgr_opens() > 0 AS used;
+CHECKPOINT;
+SELECT count(*) FROM test_smgr_tbl;
+
+-- a failing selector leaves no half-opened relation behind
+SELECT pg_relation_filenode('test_smgr_tbl') AS filenode \gset
+\c
+SET test_smgr.fail_relnumber = :filenode;
+DO $$
+BEGIN
+  FOR i IN 1..2 LOOP
+    BEGIN
+      PERFORM count(*) FROM test_smgr_tbl;
+      RAISE NOTICE 'opened';
+    EXCEPTION WHEN internal_error THEN
+      RAISE NOTICE 'failed to open';
+    END;
+  END LOOP;
+END
+$$;
+RESET test_smgr.fail_relnumber;
+SELECT count(*) FROM test_smgr_tbl;
+
+DROP TABLE test_smgr_tbl;
+DROP EXTENSION test_smgr;
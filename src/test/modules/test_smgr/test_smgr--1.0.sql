@@ -0,0 +1,7 @@
+/* src/test/modules/test_smgr/test_smgr--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_smgr" to load this file. \quit
+
+CREATE FUNCTION test_smgr_opens() RETURNS bigint
+  AS 'MODULE_PATHNAME', 'test_smgr_opens' LANGUAGE C STRICT;
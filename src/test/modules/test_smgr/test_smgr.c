@@ -0,0 +1,106 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_smgr.c
+ *		Test storage managers registered by extensions.
+ *
+ * Portions Copyright (c) 1996-2024, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_smgr/test_smgr.c
+ *
+ * The storage manager registered here passes everything on to md.c, and
+ * counts how often this backend opened a relation through it.  Every
+ * relation uses it, except that the test_smgr.fail_relnumber setting makes
+ * the selector hook return an invalid selector for the given relation.
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "storage/md.h"
+#include "storage/smgr.h"
+#include "utils/guc.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_smgr_opens);
+
+static int	test_smgr_which = 0;
+static int	test_smgr_fail_relnumber = 0;
+static int64 test_smgr_nopens = 0;
+
+static void
+test_smgr_open(SMgrRelation reln)
+{
+	test_smgr_nopens++;
+	mdopen(reln);
+}
+
+static const f_smgr test_smgr = {
+	.smgr_init = NULL,			/* md.c's entry initializes it */
+	.smgr_shutdown = NULL,
+	.smgr_open = test_smgr_open,
+	.smgr_close = mdclose,
+	.smgr_create = mdcreate,
+	.smgr_exists = mdexists,
+	.smgr_unlink = mdunlink,
+	.smgr_extend = mdextend,
+	.smgr_zeroextend = mdzeroextend,
+	.smgr_prefetch = mdprefetch,
+	.smgr_readv = mdreadv,
+	.smgr_writev = mdwritev,
+	.smgr_writeback = mdwriteback,
+	.smgr_nblocks = mdnblocks,
+	.smgr_truncate = mdtruncate,
+	.smgr_immedsync = mdimmedsync,
+	.smgr_registersync = mdregistersync,
+};
+
+static int
+test_smgr_select(RelFileLocatorBackend rlocator)
+{
+	if (test_smgr_fail_relnumber != 0 &&
+		rlocator.locator.relNumber == (RelFileNumber) test_smgr_fail_relnumber)
+		return -1;
+
+	return test_smgr_which;
+}
+
+Datum
+test_smgr_opens(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(test_smgr_nopens);
+}
+
+void
+_PG_init(void)
+{
+	if (!process_shared_preload_libraries_in_progress)
+		ereport(ERROR,
+				(errmsg("cannot load \"%s\" after startup", "test_smgr"),
+				 errdetail("\"%s\" must be loaded with \"shared_preload_libraries\".",
+						   "test_smgr")));
+
+	DefineCustomIntVariable("test_smgr.fail_relnumber",
+							"Relation number for which the selector hook fails.",
+							NULL,
+							&test_smgr_fail_relnumber,
+							0,
+							0,
+							PG_INT32_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	MarkGUCPrefixReserved("test_smgr");
+
+	test_smgr_which = smgr_register(&test_smgr);
+
+	smgr_select_hook = test_smgr_select;
+}
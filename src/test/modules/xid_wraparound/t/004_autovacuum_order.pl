@@ -0,0 +1,65 @@
+# Copyright (c) 2024, PostgreSQL Global Development Group
+
+# Test the order in which autovacuum processes the tables that need to be
+# vacuumed to prevent wraparound: the table closest to its own limits comes
+# first, even if another table has an older relfrozenxid.
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Initialize node
+my $node = PostgreSQL::Test::Cluster->new('main');
+
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq[
+autovacuum = off # turned on once the tables are old enough
+autovacuum_naptime = 1s
+autovacuum_freeze_max_age = 500000
+# so that one worker processes both tables, one after the other
+autovacuum_max_workers = 1
+log_autovacuum_min_duration = 0
+]);
+$node->start;
+$node->safe_psql('postgres', 'CREATE EXTENSION xid_wraparound');
+
+# old_table has the older relfrozenxid, but young_table is closer to its
+# lower autovacuum_freeze_max_age: 150000/100000 versus 250000/200000.
+$node->safe_psql('postgres',
+	'CREATE TABLE old_table (a int) WITH (autovacuum_freeze_max_age = 200000)'
+);
+$node->safe_psql('postgres', 'SELECT consume_xids(100000)');
+$node->safe_psql('postgres',
+	'CREATE TABLE young_table (a int) WITH (autovacuum_freeze_max_age = 100000)'
+);
+$node->safe_psql('postgres', 'SELECT consume_xids(150000)');
+
+my $log_offset = -s $node->logfile;
+
+$node->safe_psql(
+	'postgres', qq[
+ALTER SYSTEM SET autovacuum = on;
+SELECT pg_reload_conf();
+]);
+
+# Wait until autovacuum processed both tables
+$node->poll_query_until(
+	'postgres', qq[
+SELECT count(*) = 2 FROM pg_stat_user_tables
+WHERE relname IN ('old_table', 'young_table') AND autovacuum_count > 0
+]) or die "timeout waiting for the tables to be vacuumed";
+
+my $log_contents = slurp_file($node->logfile, $log_offset);
+my $young_pos = index($log_contents,
+	'automatic aggressive vacuum to prevent wraparound of table "postgres.public.young_table"'
+);
+my $old_pos = index($log_contents,
+	'automatic aggressive vacuum to prevent wraparound of table "postgres.public.old_table"'
+);
+ok($young_pos >= 0 && $old_pos >= 0, 'both tables vacuumed to prevent wraparound');
+ok($young_pos < $old_pos, 'table closest to its limits vacuumed first');
+
+$node->stop;
+done_testing();
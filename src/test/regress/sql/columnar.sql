@@ -0,0 +1,68 @@
+--
+-- Columnar table access method
+--
+CREATE TABLE columnar_tbl (a int, b text, c float8) USING columnar;
+INSERT INTO columnar_tbl SELECT g, 'row ' || g, g / 2.0
+  FROM generate_series(1, 25000) g;
+SELECT count(*), sum(a), min(b), max(c) FROM columnar_tbl;
+
+-- scans that read only some columns, and skip row groups by min/max values
+SELECT a, b FROM columnar_tbl WHERE a BETWEEN 12345 AND 12347 ORDER BY a;
+SELECT count(*) FROM columnar_tbl WHERE a > 24990;
+SELECT count(*) FROM columnar_tbl WHERE 100 >= a;
+SELECT b FROM columnar_tbl WHERE a = 20000;
+SELECT count(*) FROM columnar_tbl WHERE a IS NULL;
+
+-- nulls
+INSERT INTO columnar_tbl VALUES (NULL, NULL, NULL), (25001, NULL, 1.5);
+SELECT count(*) FROM columnar_tbl WHERE a IS NULL;
+SELECT count(*) FROM columnar_tbl WHERE b IS NULL;
+SELECT a, c FROM columnar_tbl WHERE c = 1.5 ORDER BY a;
+
+-- rows of aborted transactions and subtransactions are not visible
+BEGIN;
+INSERT INTO columnar_tbl VALUES (-1, 'aborted', 0);
+SELECT a, b FROM columnar_tbl WHERE a < 0;
+ROLLBACK;
+SELECT count(*) FROM columnar_tbl WHERE a < 0;
+BEGIN;
+INSERT INTO columnar_tbl VALUES (-2, 'committed', 0);
+SAVEPOINT s1;
+INSERT INTO columnar_tbl VALUES (-3, 'rolled back', 0);
+ROLLBACK TO s1;
+INSERT INTO columnar_tbl VALUES (-4, 'after savepoint', 0);
+COMMIT;
+SELECT a, b FROM columnar_tbl WHERE a < 0 ORDER BY a;
+
+-- columns added later read as their default in existing row groups
+ALTER TABLE columnar_tbl ADD COLUMN d int DEFAULT 42;
+INSERT INTO columnar_tbl VALUES (-5, 'new', 0, 7);
+SELECT a, d FROM columnar_tbl WHERE a < 0 OR a = 1 ORDER BY a;
+
+VACUUM FULL columnar_tbl;
+SELECT count(*), sum(a), sum(d) FROM columnar_tbl;
+VACUUM columnar_tbl;
+SELECT count(*), sum(a), sum(d) FROM columnar_tbl;
+
+-- rows fetched by TID
+SELECT a, b FROM columnar_tbl WHERE ctid = (SELECT ctid FROM columnar_tbl WHERE a = 12346);
+INSERT INTO columnar_tbl VALUES (25002, 'fetched', 0);
+SELECT a, b FROM columnar_tbl WHERE ctid = (SELECT ctid FROM columnar_tbl WHERE a = 25002);
+SELECT a FROM columnar_tbl WHERE ctid = '(4294967294,1)';
+
+-- not supported
+UPDATE columnar_tbl SET b = 'x' WHERE a = 1;
+DELETE FROM columnar_tbl WHERE a = 1;
+SELECT a FROM columnar_tbl WHERE a = 1 FOR UPDATE;
+CREATE INDEX ON columnar_tbl (a);
+
+TRUNCATE columnar_tbl;
+SELECT count(*) FROM columnar_tbl;
+INSERT INTO columnar_tbl VALUES (1, 'one', 1, 1);
+COPY columnar_tbl (a, b) FROM stdin;
+2	two
+3	three
+\.
+SELECT * FROM columnar_tbl ORDER BY a;
+
+DROP TABLE columnar_tbl;
@@ -0,0 +1,70 @@
+/*
+ * This test is for zstd TOAST compression.
+ */
+
+/* skip test if the server was built without zstd support */
+SELECT NOT ('zstd' = ANY (enumvals)) AS skip_test
+  FROM pg_settings WHERE name = 'default_toast_compression' \gset
+\if :skip_test
+\quit
+\endif
+
+CREATE TABLE cmdata_zstd (id int, f1 text COMPRESSION zstd);
+-- compressed inline
+INSERT INTO cmdata_zstd VALUES (1, repeat('1234567890', 1004));
+-- compressed and stored externally
+INSERT INTO cmdata_zstd
+  SELECT 2, string_agg(fipshash(g::text), '' ORDER BY g) || repeat('a', 4000)
+  FROM generate_series(1, 256) g;
+SELECT id, pg_column_compression(f1), length(f1) FROM cmdata_zstd ORDER BY id;
+
+-- decompress whole values and slices
+SELECT f1 = repeat('1234567890', 1004) FROM cmdata_zstd WHERE id = 1;
+SELECT f1 = (SELECT string_agg(fipshash(g::text), '' ORDER BY g) || repeat('a', 4000)
+             FROM generate_series(1, 256) g)
+  FROM cmdata_zstd WHERE id = 2;
+SELECT id, SUBSTR(f1, 200, 5) FROM cmdata_zstd ORDER BY id;
+
+-- per-column compression level
+ALTER TABLE cmdata_zstd ALTER COLUMN f1 SET (compression_level = 19);
+INSERT INTO cmdata_zstd VALUES (3, repeat('abcdefghij', 1000));
+SELECT pg_column_compression(f1), f1 = repeat('abcdefghij', 1000)
+  FROM cmdata_zstd WHERE id = 3;
+ALTER TABLE cmdata_zstd ALTER COLUMN f1 SET (compression_level = 23);
+ALTER TABLE cmdata_zstd ALTER COLUMN f1 RESET (compression_level);
+
+-- zstd as the default, and switching methods
+SET default_toast_compression = 'zstd';
+CREATE TABLE cmdata_zstd2 (f1 text);
+INSERT INTO cmdata_zstd2 VALUES (repeat('1234567890', 1004));
+ALTER TABLE cmdata_zstd2 ALTER COLUMN f1 SET COMPRESSION pglz;
+INSERT INTO cmdata_zstd2 VALUES (repeat('0987654321', 1004));
+SELECT pg_column_compression(f1), SUBSTR(f1, 200, 5) FROM cmdata_zstd2;
+RESET default_toast_compression;
+
+-- large values are compressed in frames, which jsonb field and element
+-- access decompresses only some of
+CREATE TABLE cmdata_zstd_jsonb (id int, j jsonb COMPRESSION zstd);
+INSERT INTO cmdata_zstd_jsonb
+  SELECT 1, jsonb_object_agg('k' || g, fipshash(g::text)) ||
+            jsonb_build_object('arr', '[10, 20, 30]'::jsonb)
+  FROM generate_series(1, 5000) g;
+INSERT INTO cmdata_zstd_jsonb
+  SELECT 2, jsonb_agg(fipshash(g::text) ORDER BY g)
+  FROM generate_series(1, 5000) g;
+SELECT id, pg_column_compression(j), pg_column_size(j) > 8192 AS external
+  FROM cmdata_zstd_jsonb ORDER BY id;
+SELECT j ->> 'k1' = fipshash('1') AS k1,
+       j ->> 'k4321' = fipshash('4321') AS k4321,
+       j -> 'k5000' = to_jsonb(fipshash('5000')) AS k5000,
+       j -> 'arr' -> 2 AS arr2, j -> 'missing' AS missing
+  FROM cmdata_zstd_jsonb WHERE id = 1;
+SELECT j ->> 0 = fipshash('1') AS first, j ->> 2500 = fipshash('2501') AS mid,
+       j -> -1 = to_jsonb(fipshash('5000')) AS last, j -> 5000 AS after_last
+  FROM cmdata_zstd_jsonb WHERE id = 2;
+-- alternate between the two values within one query
+SELECT id, j ->> 'k3' = fipshash('3') AS k3, j ->> 3 = fipshash('4') AS e3
+  FROM cmdata_zstd_jsonb, generate_series(1, 2) ORDER BY id;
+DROP TABLE cmdata_zstd_jsonb;
+
+DROP TABLE cmdata_zstd, cmdata_zstd2;
@@ -0,0 +1,124 @@
+--
+-- In-place update table access method
+--
+CREATE TABLE inplace_tbl (id int PRIMARY KEY, a int, b text) USING inplace;
+CREATE INDEX inplace_tbl_a ON inplace_tbl (a);
+INSERT INTO inplace_tbl SELECT g, g, 'row ' || g FROM generate_series(1, 1000) g;
+SELECT count(*), sum(a), min(b), max(b) FROM inplace_tbl;
+
+-- updates that leave the indexed columns alone keep the row where it is
+SELECT ctid AS old_ctid FROM inplace_tbl WHERE id = 10 \gset
+UPDATE inplace_tbl SET b = 'updated' WHERE id = 10;
+SELECT ctid = :'old_ctid' AS same_tid, id, a, b FROM inplace_tbl WHERE id = 10;
+
+-- changing an indexed column moves the row
+SELECT ctid AS old_ctid FROM inplace_tbl WHERE id = 20 \gset
+UPDATE inplace_tbl SET a = -20 WHERE id = 20;
+SELECT ctid = :'old_ctid' AS same_tid, id, a, b FROM inplace_tbl WHERE id = 20;
+SELECT id, a FROM inplace_tbl WHERE a = 20;
+SELECT id, a FROM inplace_tbl WHERE a = -20;
+
+-- older snapshots find the old versions in undo
+BEGIN;
+DECLARE inplace_cur CURSOR FOR
+  SELECT id, b FROM inplace_tbl WHERE id IN (30, 31) ORDER BY id;
+UPDATE inplace_tbl SET b = 'new ' || id WHERE id IN (30, 31);
+FETCH ALL FROM inplace_cur;
+SELECT id, b FROM inplace_tbl WHERE id IN (30, 31) ORDER BY id;
+COMMIT;
+
+-- rolled back changes disappear
+BEGIN;
+UPDATE inplace_tbl SET b = 'gone' WHERE id BETWEEN 40 AND 42;
+DELETE FROM inplace_tbl WHERE id = 43;
+INSERT INTO inplace_tbl VALUES (2000, 2000, 'gone');
+ROLLBACK;
+SELECT id, a, b FROM inplace_tbl WHERE id BETWEEN 40 AND 43 OR id = 2000
+  ORDER BY id;
+
+-- and so do those rolled back to a savepoint
+BEGIN;
+UPDATE inplace_tbl SET b = 'kept' WHERE id = 50;
+SAVEPOINT s1;
+UPDATE inplace_tbl SET b = 'lost' WHERE id = 50;
+ROLLBACK TO SAVEPOINT s1;
+SELECT id, b FROM inplace_tbl WHERE id = 50;
+UPDATE inplace_tbl SET b = 'kept again' WHERE id = 50;
+COMMIT;
+SELECT id, b FROM inplace_tbl WHERE id = 50;
+
+DELETE FROM inplace_tbl WHERE id > 900;
+SELECT count(*) FROM inplace_tbl;
+
+-- ON CONFLICT and unique checks
+INSERT INTO inplace_tbl VALUES (1, 1, 'conflict'), (1001, 1001, 'inserted')
+  ON CONFLICT (id) DO UPDATE SET b = excluded.b;
+INSERT INTO inplace_tbl VALUES (2, 2, 'conflict') ON CONFLICT DO NOTHING;
+SELECT id, a, b FROM inplace_tbl WHERE id IN (1, 2, 1001) ORDER BY id;
+INSERT INTO inplace_tbl VALUES (3, 3, 'duplicate');
+
+-- row locks
+BEGIN;
+SELECT id FROM inplace_tbl WHERE id = 4 FOR UPDATE;
+SELECT id FROM inplace_tbl WHERE id = 4 FOR SHARE;
+COMMIT;
+
+VACUUM inplace_tbl;
+SELECT count(*), sum(a) FROM inplace_tbl;
+SET enable_seqscan = off;
+SELECT id, a, b FROM inplace_tbl WHERE id = 10;
+SELECT id, a, b FROM inplace_tbl WHERE a = -20;
+RESET enable_seqscan;
+
+-- index builds see only the live versions
+CREATE UNIQUE INDEX inplace_tbl_b ON inplace_tbl (b);
+SET enable_seqscan = off;
+SELECT id FROM inplace_tbl WHERE b = 'kept again';
+RESET enable_seqscan;
+DROP INDEX inplace_tbl_b;
+
+-- TOAST
+UPDATE inplace_tbl
+  SET b = (SELECT string_agg(md5(g::text), '') FROM generate_series(1, 300) g)
+  WHERE id = 5;
+SELECT id, length(b), md5(b) FROM inplace_tbl WHERE id = 5;
+
+ANALYZE inplace_tbl;
+SELECT reltuples FROM pg_class WHERE relname = 'inplace_tbl';
+
+-- rewrites
+VACUUM FULL inplace_tbl;
+SELECT count(*), sum(a) FROM inplace_tbl;
+CLUSTER inplace_tbl USING inplace_tbl_a;
+SELECT id, a FROM inplace_tbl ORDER BY ctid LIMIT 3;
+SELECT id, length(b), md5(b) FROM inplace_tbl WHERE id = 5;
+
+SELECT * FROM inplace_tbl TABLESAMPLE SYSTEM (50);
+
+DROP TABLE inplace_tbl;
+
+-- VACUUM discards the undo no snapshot needs anymore, and later updates
+-- reuse its space, so the table doesn't grow
+CREATE TEMP TABLE inplace_undo (id int, v int) USING inplace
+  WITH (autovacuum_enabled = off);
+INSERT INTO inplace_undo SELECT g, 0 FROM generate_series(1, 100) g;
+UPDATE inplace_undo SET v = v + 1;
+VACUUM inplace_undo;
+SELECT pg_relation_size('inplace_undo') AS undo_size \gset
+UPDATE inplace_undo SET v = v + 1;
+VACUUM inplace_undo;
+UPDATE inplace_undo SET v = v + 1;
+VACUUM inplace_undo;
+UPDATE inplace_undo SET v = v + 1;
+VACUUM inplace_undo;
+SELECT pg_relation_size('inplace_undo') = :undo_size AS same_size;
+
+-- older versions are found in undo written to a discarded undo page
+BEGIN;
+DECLARE inplace_undo_cur CURSOR FOR SELECT count(*), sum(v) FROM inplace_undo;
+UPDATE inplace_undo SET v = v + 1;
+FETCH ALL FROM inplace_undo_cur;
+SELECT count(*), sum(v) FROM inplace_undo;
+COMMIT;
+SELECT count(*), sum(v) FROM inplace_undo;
+DROP TABLE inplace_undo;
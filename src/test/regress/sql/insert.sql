@@ -674,3 +674,41 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- INSERT ... SELECT buffers rows and inserts them a batch at a time
+create table multiins (a int primary key, b text);
+create function multiins_count() returns bigint language sql volatile
+  as 'select count(*) from multiins';
+insert into multiins select g, 'row ' || g from generate_series(1, 2500) g;
+select count(*), sum(a), count(distinct b) from multiins;
+set enable_seqscan = off;
+select a, b from multiins where a in (1, 1000, 2500) order by a;
+reset enable_seqscan;
+-- duplicates within a batch are caught
+insert into multiins select 3000 + g % 2, 'dup' from generate_series(1, 3) g;
+-- volatile functions may look at the rows inserted so far, so no batching
+insert into multiins select 5000 + g, multiins_count() from generate_series(1, 3) g;
+select a, b from multiins where a > 5000 order by a;
+-- AFTER triggers, including foreign keys, see every row
+create function multiins_trig() returns trigger language plpgsql as $$
+begin
+  raise notice 'inserted % rows', (select count(*) from new_rows);
+  return null;
+end $$;
+create trigger multiins_trig after insert on multiins
+  referencing new table as new_rows
+  for each statement execute function multiins_trig();
+insert into multiins select g, 'new' from generate_series(10001, 11000) g;
+create table multiins_ref (a int references multiins);
+insert into multiins_ref select g from generate_series(1, 10) g;
+insert into multiins_ref select g from generate_series(99998, 99999) g;
+select count(*) from multiins_ref;
+-- rows routed to partitions are batched per partition
+create table multiins_part (a int, b text) partition by range (a);
+create table multiins_part1 partition of multiins_part for values from (1) to (1001);
+create table multiins_part2 partition of multiins_part for values from (1001) to (3001);
+insert into multiins_part select a, b from multiins where a <= 2500;
+select tableoid::regclass, count(*), min(a), max(a) from multiins_part
+  group by 1 order by 1;
+drop table multiins_part, multiins_ref, multiins;
+drop function multiins_count(), multiins_trig();
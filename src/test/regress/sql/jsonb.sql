@@ -1556,3 +1556,25 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- field and element access on values stored out of line, which fetch only
+-- the parts of the value they need
+create temp table test_jsonb_toasted (j jsonb);
+alter table test_jsonb_toasted alter column j set storage external;
+insert into test_jsonb_toasted
+  select jsonb_object_agg('k' || g, g) ||
+         jsonb_build_object('nul', null, 'obj', '{"a": [1, 2]}'::jsonb,
+                            'str', repeat('x', 10))
+  from generate_series(1, 2000) g;
+insert into test_jsonb_toasted
+  select jsonb_agg(g) || '[null, "s", {"a": 1}, true]'::jsonb
+  from generate_series(1, 2000) g;
+select j -> 'k1' as k1, j -> 'k1000' as k1000, j ->> 'k2000' as k2000,
+       j -> 'missing' as missing, j -> 'nul' as nul, j ->> 'nul' as nul_text,
+       j -> 'obj' as obj, j ->> 'str' as str, j -> 0 as elem
+  from test_jsonb_toasted where jsonb_typeof(j) = 'object';
+select j -> 0 as first, j -> 1999 as e1999, j ->> 2001 as e2001,
+       j -> 2002 as e2002, j ->> -1 as last, j -> -4 as e_4,
+       j -> -2005 as before_first, j -> 2004 as after_last, j -> 'k1' as k1
+  from test_jsonb_toasted where jsonb_typeof(j) = 'array';
+drop table test_jsonb_toasted;
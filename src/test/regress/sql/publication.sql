@@ -740,6 +740,11 @@ CREATE UNLOGGED TABLE testpub_unloggedtbl(a int);
 CREATE PUBLICATION testpub_forunloggedtbl FOR TABLE testpub_unloggedtbl;
 DROP TABLE testpub_unloggedtbl;
 
+CREATE TABLE testpub_inplacetbl(a int) USING inplace;
+-- fail - inplace table
+CREATE PUBLICATION testpub_forinplacetbl FOR TABLE testpub_inplacetbl;
+DROP TABLE testpub_inplacetbl;
+
 -- fail - system table
 CREATE PUBLICATION testpub_forsystemtbl FOR TABLE pg_publication;
 
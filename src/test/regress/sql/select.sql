@@ -262,3 +262,47 @@ create table list_parted_tbl1 partition of list_parted_tbl
   for values in (1) partition by list(b);
 explain (costs off) select * from list_parted_tbl;
 drop table list_parted_tbl;
+
+--
+-- Test visibility map lookups of index-only scans.  The heap has only one
+-- page, and the index has 38 items on all but its last leaf page, so each
+-- batch of items that btree reads from a leaf page costs one lookup.
+--
+create function explain_ios_vm(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, verbose, costs off, summary off, timing off) %s',
+            query)
+    loop
+        -- the two sides of a self-join would differ only in their aliases
+        continue when ln ~ '^\s*(Output|Merge Cond):';
+        ln := regexp_replace(ln, 'ios_vm t\d', 'ios_vm');
+        return next ln;
+    end loop;
+end;
+$$;
+create temp table ios_vm (a int);
+insert into ios_vm select 1 from generate_series(1, 210);
+create index ios_vm_a on ios_vm (a) with (fillfactor = 10, deduplicate_items = off);
+vacuum analyze ios_vm;
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+set enable_hashjoin = off;
+set enable_nestloop = off;
+set enable_material = off;
+-- 6 leaf pages, so 6 lookups for 210 items
+select explain_ios_vm('select a from ios_vm');
+-- Restoring the mark of the inner side to its first leaf page starts a new
+-- batch, so each of the 209 restores costs 6 lookups again
+select explain_ios_vm('select t1.a from ios_vm t1 join ios_vm t2 using (a)');
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_hashjoin;
+reset enable_nestloop;
+reset enable_material;
+drop table ios_vm;
+drop function explain_ios_vm(text);
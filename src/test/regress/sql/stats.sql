@@ -849,4 +849,15 @@ DROP TABLE brin_hot_3;
 
 SET enable_seqscan = on;
 
+-- Transactions with an xid are counted when their xid is cleared, either
+-- directly or as a member of a group
+SELECT direct_clears + group_members AS xid_clears_before
+  FROM pg_stat_get_procarray_end_xact() \gset
+BEGIN;
+SELECT pg_current_xact_id() IS NOT NULL AS has_xid;
+COMMIT;
+SELECT direct_clears + group_members > :xid_clears_before AS counted,
+       group_members >= group_clears AS groups_ok
+  FROM pg_stat_get_procarray_end_xact();
+
 -- End of Stats Test
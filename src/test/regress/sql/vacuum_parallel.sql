@@ -39,6 +39,35 @@ VACUUM (PARALLEL 4, INDEX_CLEANUP ON) parallel_vacuum_table;
 -- assertion failure with bug #17245 (in the absence of bugfix):
 INSERT INTO parallel_vacuum_table SELECT i FROM generate_series(1, 10000) i;
 
+-- The first heap pass is shared with the workers for tables larger than
+-- min_parallel_table_scan_size, even when there is only one index:
+CREATE TABLE parallel_vacuum_heap_table (a int, b text) WITH (autovacuum_enabled = off);
+INSERT INTO parallel_vacuum_heap_table
+  SELECT i, repeat('x', 100) FROM generate_series(1, 20000) i;
+CREATE INDEX parallel_vacuum_heap_index ON parallel_vacuum_heap_table(a);
+DELETE FROM parallel_vacuum_heap_table WHERE a % 3 = 0;
+SET min_parallel_table_scan_size TO 0;
+VACUUM (PARALLEL 2) parallel_vacuum_heap_table;
+RESET min_parallel_table_scan_size;
+SELECT count(*) FROM parallel_vacuum_heap_table;
+SET enable_seqscan TO off;
+SELECT count(*) FROM parallel_vacuum_heap_table WHERE a > 0;
+RESET enable_seqscan;
+
+-- With the dead items limit this low, dead_items is full as soon as there
+-- is anything in it.  The participants give back the rest of their chunks,
+-- and the scan takes several rounds of relaunching the workers.
+DELETE FROM parallel_vacuum_heap_table WHERE a % 2000 = 1;
+SET debug_vacuum_dead_items_limit TO '64kB';
+SET min_parallel_table_scan_size TO 0;
+VACUUM (PARALLEL 2) parallel_vacuum_heap_table;
+RESET min_parallel_table_scan_size;
+RESET debug_vacuum_dead_items_limit;
+SELECT count(*) FROM parallel_vacuum_heap_table;
+SET enable_seqscan TO off;
+SELECT count(*) FROM parallel_vacuum_heap_table WHERE a > 0;
+RESET enable_seqscan;
+
 RESET max_parallel_maintenance_workers;
 RESET min_parallel_index_scan_size;
 
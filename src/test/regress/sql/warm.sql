@@ -0,0 +1,64 @@
+--
+-- WARM updates
+--
+CREATE TABLE warm_tbl (id int, a int, b int, c text)
+  WITH (warm_updates = on, fillfactor = 50);
+CREATE INDEX warm_tbl_id ON warm_tbl (id);
+CREATE INDEX warm_tbl_a ON warm_tbl (a);
+CREATE INDEX warm_tbl_b ON warm_tbl (b);
+CREATE INDEX warm_tbl_c ON warm_tbl (lower(c));
+INSERT INTO warm_tbl SELECT g, g, g, 'row ' || g FROM generate_series(1, 100) g;
+VACUUM ANALYZE warm_tbl;
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+-- only warm_tbl_a gets a new entry; the one for the old value is stale
+UPDATE warm_tbl SET a = a + 1000 WHERE id = 10;
+SELECT id, a, b FROM warm_tbl WHERE a = 10;
+SELECT id, a, b FROM warm_tbl WHERE a = 1010;
+SELECT id, a, b FROM warm_tbl WHERE b = 10;
+
+-- the update changed an indexed column, and was HOT nonetheless
+SELECT pg_stat_force_next_flush();
+SELECT n_tup_upd, n_tup_hot_upd FROM pg_stat_user_tables
+  WHERE relname = 'warm_tbl';
+
+-- index-only scans can't check for stale entries
+EXPLAIN (COSTS OFF) SELECT a FROM warm_tbl WHERE a = 1010;
+
+-- bitmap heap scans recheck the index conditions
+RESET enable_bitmapscan;
+SET enable_indexscan = off;
+SELECT id, a FROM warm_tbl WHERE a = 10 OR a = 1010;
+SELECT count(*) FROM warm_tbl WHERE a = 10;
+RESET enable_indexscan;
+SET enable_bitmapscan = off;
+
+-- a second update of the same row is not WARM, but must work all the same
+UPDATE warm_tbl SET a = 10 WHERE id = 10;
+SELECT id, a FROM warm_tbl WHERE a = 10;
+SELECT id, a FROM warm_tbl WHERE a = 1010;
+
+-- changing a column of an expression index prevents WARM
+UPDATE warm_tbl SET c = 'ROW X' WHERE id = 20;
+SELECT id, c FROM warm_tbl WHERE lower(c) = 'row x';
+SELECT id, c FROM warm_tbl WHERE lower(c) = 'row 20';
+
+-- older snapshots still find the old row version
+BEGIN;
+DECLARE warm_cur CURSOR FOR SELECT id, a FROM warm_tbl WHERE a = 30;
+UPDATE warm_tbl SET a = 1030 WHERE id = 30;
+FETCH ALL FROM warm_cur;
+SELECT id, a FROM warm_tbl WHERE a = 30;
+COMMIT;
+
+-- turning WARM off rebuilds the indexes, and allows index-only scans again
+ALTER TABLE warm_tbl SET (warm_updates = off);
+SELECT id, a FROM warm_tbl WHERE a = 30;
+SELECT id, a FROM warm_tbl WHERE a = 1030;
+EXPLAIN (COSTS OFF) SELECT a FROM warm_tbl WHERE a = 1030;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE warm_tbl;